@@ -0,0 +1,286 @@
+/**
+ * @file bench_crypto.c
+ * @brief Micro-benchmarks of the cryptographic primitives and of secure messaging.
+ * @author Khoa Nguyen
+ *
+ * Every case is repeated until it has run for the given time, 20 ms by default, and reported as
+ * one JSON object per line of the "results" array: nanoseconds per call and time stamp counter
+ * cycles per byte. The primitives are timed from 8 bytes to 64 KB, the providers of provider.h
+ * on the same sizes, and secure messaging on SELECT and on READ BINARY responses up to the largest
+ * short APDU. The known-answer tests of the 3DES kernels run first and a failure stops the run,
+ * since the library only falls back silently from a failing kernel. Built with USE_ALLOC_COUNTER,
+ * the run fails if a case allocated heap memory through allocator.h, as a read session must not.
+ *
+ * Usage: bench_crypto [milliseconds per case] > results.json
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <access/secure_message.h>
+#include <cryptography/cpu_features.h>
+#include <cryptography/des.h>
+#include <cryptography/mac3.h>
+#include <cryptography/provider.h>
+#include <cryptography/sha1.h>
+#include <utils/allocator.h>
+#include <utils/reader.h>
+#include <utils/sync.h>
+#include <utils/tlv.h>
+
+#if CPU_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+#define BENCH_MAX_LENGTH  (64 * 1024)
+#define BENCH_READ_LENGTH 224  // Largest READ BINARY response of a short APDU under 3DES and AES
+
+static const int primitiveLengths[] = {8, 16, 64, 256, 1024, 4096, 16384, 65536};
+static const int readLengths[]		= {8, 64, 128, BENCH_READ_LENGTH};
+
+static const unsigned char key[24] = {0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF,
+									  0xFE, 0xDC, 0xBA, 0x98, 0x76, 0x54, 0x32, 0x10,
+									  0x0F, 0x1E, 0x2D, 0x3C, 0x4B, 0x5A, 0x69, 0x78};
+
+static unsigned char input[BENCH_MAX_LENGTH];
+static unsigned char output[BENCH_MAX_LENGTH];
+static long long minTicks;
+static int firstResult = 1;
+static int allocatingCases;
+
+// State of the case being timed
+static struct {
+	int length;
+	const SecureMessagingSession* session;
+	const unsigned char* apdu;
+	int apduLength;
+} current;
+
+static unsigned long long Cycles(void) {
+#if CPU_X86
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+static void RunDesEcb(void) {
+	des_ecb_encrypt(output, input, current.length, (unsigned char*)key);
+}
+
+static void RunDes3CbcEncrypt(void) {
+	des3_cbc_encrypt(output, input, current.length, (unsigned char*)key, 16, NULL);
+}
+
+static void RunDes3CbcDecrypt(void) {
+	des3_cbc_decrypt(output, input, current.length, (unsigned char*)key, 16, NULL);
+}
+
+static void RunMac3(void) {
+	des_mac3_checksum(current.length, output, input, (unsigned char*)key);
+}
+
+static void RunSha1(void) {
+	sha1(input, current.length, output);
+}
+
+static void RunProviderDes3Cbc(void) {
+	crypto_des3_cbc(CRYPTO_ENCRYPT, key, input, current.length, output);
+}
+
+static void RunProviderMac3(void) {
+	crypto_mac3(key, input, current.length, output);
+}
+
+static void RunProviderSha1(void) {
+	crypto_sha1(input, current.length, output);
+}
+
+static void RunWrap(void) {
+	SecureMessagingSession session = *current.session;
+	int length;
+
+	SecureMessagingWrap(&session, current.apdu, current.apduLength, output, &length);
+}
+
+static void RunUnwrap(void) {
+	SecureMessagingSession session = *current.session;
+	int length;
+
+	if (SecureMessagingUnwrap(&session, current.apdu, current.apduLength, output, &length, NULL) !=
+		APP_SUCCESS) {
+		fprintf(stderr, "Unwrap failed\n");
+		exit(1);
+	}
+}
+
+// Times a case and prints its JSON object
+static void Measure(const char* name, const char* backend, int bytes, void (*run)(void)) {
+	long long ops = 0, start, elapsed, allocations;
+	unsigned long long cycles;
+	int i;
+
+	run();	// Warm up the caches and the lazy kernel selection
+
+	allocations = AllocatorThreadCount();
+	cycles		= Cycles();
+	start		= SyncTicks();
+	do {
+		for (i = 0; i < 8; i++)
+			run();
+		ops += 8;
+		elapsed = SyncTicks() - start;
+	} while (elapsed < minTicks);
+	cycles = Cycles() - cycles;
+	if (AllocatorThreadCount() != allocations) {
+		fprintf(stderr, "%s (%s) allocated heap memory\n", name, backend);
+		allocatingCases++;
+	}
+
+	printf("%s    {\"name\": \"%s\", \"backend\": \"%s\", \"bytes\": %d, \"ops\": %lld, ",
+		   firstResult ? "" : ",\n", name, backend, bytes, ops);
+	printf("\"ns_per_op\": %.1f, \"cycles_per_byte\": %.2f}",
+		   (double)elapsed * 1e9 / SyncTicksPerSecond() / ops, (double)cycles / ops / bytes);
+	firstResult = 0;
+}
+
+// Protected response of the card to the next command of the session: DO'87' || DO'99' || DO'8E'
+static int BuildResponse(const SecureMessagingSession* session,
+						 int length,
+						 unsigned char response[SM_MAX_PROTECTED_RESPONSE]) {
+	SecureMessagingSession card = *session;
+	unsigned char command[5 + SM_MAX_COMMAND_DATA] = {0x00, 0xD6, 0x00, 0x00};
+	unsigned char wrapped[SM_MAX_PROTECTED_COMMAND], macInput[SM_MAX_PROTECTED_RESPONSE];
+	unsigned int tag;
+	int wrappedLength, objectLength, headerLength, pos = 0;
+
+	// Command data is encrypted under the same SSC, its DO'87' is the DO'87' of the response
+	command[4] = (unsigned char)length;
+	memcpy(&command[5], input, length);
+	if (SecureMessagingWrap(&card, command, length > 0 ? 5 + length : 4, wrapped, &wrappedLength) !=
+		APP_SUCCESS) {
+		return 0;
+	}
+	if (length > 0) {
+		TlvParse(&wrapped[5], wrappedLength - 5, &tag, &objectLength, &headerLength);
+		memcpy(response, &wrapped[5], headerLength + objectLength);
+		pos = headerLength + objectLength;
+	}
+	response[pos++] = 0x99;
+	response[pos++] = 0x02;
+	response[pos++] = 0x90;
+	response[pos++] = 0x00;
+
+	// MAC of SSC || DO'87' || DO'99'
+	memcpy(macInput, card.sendSequenceCounter, card.blockSize);
+	memcpy(&macInput[card.blockSize], response, pos);
+	response[pos++] = 0x8E;
+	response[pos++] = SM_MAC_LENGTH;
+	SecureMessagingChecksum(&card, macInput, card.blockSize + pos - 2, &response[pos]);
+	pos += SM_MAC_LENGTH;
+	response[pos++] = 0x90;
+	response[pos++] = 0x00;
+	return pos;
+}
+
+static void MeasureSession(const char* cipher, const char* backend) {
+	static const unsigned char select[]		= {0x00, 0xA4, 0x02, 0x0C, 0x02, 0x01, 0x1E};
+	static const unsigned char readBinary[] = {0x00, 0xB0, 0x00, 0x00, 0x00};
+	static const unsigned char ssc[8]		= {0x88, 0x70, 0x22, 0x12, 0x0C, 0x06, 0xC2, 0x26};
+	unsigned char response[SM_MAX_PROTECTED_RESPONSE];
+	SecureMessagingSession session;
+	char name[64];
+	size_t i;
+
+	if (strcmp(cipher, "3des") == 0) {
+		SecureMessagingInit(&session, SM_CIPHER_3DES, key, &key[8], 16, ssc);
+	} else {
+		SecureMessagingInit(&session, SM_CIPHER_AES, key, &key[8], 16, NULL);
+	}
+	current.session = &session;
+
+	snprintf(name, sizeof(name), "sm_%s_wrap_select", cipher);
+	current.apdu	   = select;
+	current.apduLength = sizeof(select);
+	Measure(name, backend, sizeof(select), RunWrap);
+
+	snprintf(name, sizeof(name), "sm_%s_wrap_read_binary", cipher);
+	current.apdu	   = readBinary;
+	current.apduLength = sizeof(readBinary);
+	Measure(name, backend, sizeof(readBinary), RunWrap);
+
+	snprintf(name, sizeof(name), "sm_%s_unwrap_select", cipher);
+	current.apdu	   = response;
+	current.apduLength = BuildResponse(&session, 0, response);
+	Measure(name, backend, current.apduLength, RunUnwrap);
+
+	snprintf(name, sizeof(name), "sm_%s_unwrap_read_binary", cipher);
+	for (i = 0; i < sizeof(readLengths) / sizeof(readLengths[0]); i++) {
+		current.apduLength = BuildResponse(&session, readLengths[i], response);
+		Measure(name, backend, readLengths[i], RunUnwrap);
+	}
+}
+
+int main(int argc, char* argv[]) {
+	static const char* backends[] = {"builtin", "openssl"};
+	const char* selected[CRYPTO_PRIMITIVES];
+	size_t i, b;
+	int p, milliseconds = argc > 1 ? atoi(argv[1]) : 20;
+
+	minTicks = (milliseconds > 0 ? milliseconds : 20) * SyncTicksPerSecond() / 1000;
+	for (i = 0; i < BENCH_MAX_LENGTH; i++)
+		input[i] = (unsigned char)(i * 7 + 1);
+
+	if (des3_self_test() != 0) {
+		fprintf(stderr, "3DES self test failed\n");
+		return 1;
+	}
+
+	// The automatic selection is kept here, then every backend is forced in turn for the provider
+	// and session cases, and the selection is restored once they are done
+	crypto_provider_init();
+	for (p = 0; p < CRYPTO_PRIMITIVES; p++)
+		selected[p] = crypto_provider_selected(p);
+
+	printf("{\n  \"cpu_features\": %u,\n", cpu_features());
+	printf("  \"selected\": {\"des_ecb\": \"%s\", \"des3_cbc\": \"%s\", \"mac3\": \"%s\", "
+		   "\"sha1\": \"%s\"},\n",
+		   selected[CRYPTO_DES_ECB], selected[CRYPTO_DES3_CBC], selected[CRYPTO_MAC3],
+		   selected[CRYPTO_SHA1]);
+	printf("  \"results\": [\n");
+
+	for (i = 0; i < sizeof(primitiveLengths) / sizeof(primitiveLengths[0]); i++) {
+		current.length = primitiveLengths[i];
+		Measure("des_ecb_encrypt", "builtin", current.length, RunDesEcb);
+		Measure("des3_cbc_encrypt", "builtin", current.length, RunDes3CbcEncrypt);
+		Measure("des3_cbc_decrypt", "builtin", current.length, RunDes3CbcDecrypt);
+		Measure("des_mac3_checksum", "builtin", current.length, RunMac3);
+		Measure("sha1", "builtin", current.length, RunSha1);
+	}
+
+	for (b = 0; b < sizeof(backends) / sizeof(backends[0]); b++) {
+		if (crypto_provider_select(CRYPTO_ALL, backends[b]) != 0)
+			continue;
+
+		for (i = 0; i < sizeof(primitiveLengths) / sizeof(primitiveLengths[0]); i++) {
+			current.length = primitiveLengths[i];
+			Measure("crypto_des3_cbc", backends[b], current.length, RunProviderDes3Cbc);
+			Measure("crypto_mac3", backends[b], current.length, RunProviderMac3);
+			Measure("crypto_sha1", backends[b], current.length, RunProviderSha1);
+		}
+		MeasureSession("3des", backends[b]);
+		MeasureSession("aes", backends[b]);
+	}
+
+	// Restores the automatic selection
+	for (p = 0; p < CRYPTO_PRIMITIVES; p++)
+		crypto_provider_select(p, selected[p]);
+
+	printf("\n  ]\n}\n");
+	return allocatingCases != 0;
+}
@@ -0,0 +1,82 @@
+/**
+ * @author Khoa Nguyen
+ * @file active_authentication.h
+ * @brief Header file for Active Authentication functions.
+ *
+ * This header file contains function declarations for reading DG15 and running Active
+ * Authentication (ICAO Doc 9303 Part 11, section 6.1). The chip signs a random challenge of the
+ * terminal with the private key matching the public key of DG15, which proves that the chip is not
+ * a copy. RSA signatures follow ISO/IEC 9796-2 digital signature scheme 1, EC keys sign with ECDSA.
+ */
+
+#pragma once
+#ifndef ACCESS_ACTIVE_AUTHENTICATION_H_
+#define ACCESS_ACTIVE_AUTHENTICATION_H_
+
+#include <access/secure_message.h>
+#include <cryptography/hash.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AA_MAX_DG15		  1024
+#define AA_KEY_CACHE_SIZE 8  // Public keys kept parsed across calls
+
+#define AA_HASH_SHA1	  HASH_SHA1
+#define AA_HASH_SHA224	  HASH_SHA224
+#define AA_HASH_SHA256	  HASH_SHA256
+#define AA_HASH_SHA384	  HASH_SHA384
+#define AA_HASH_SHA512	  HASH_SHA512
+
+/**
+ * @brief Read DG15 over secure messaging.
+ *
+ * @param[in,out] session The secure messaging session, its SSC is updated.
+ * @param[out] dg15 Buffer receiving the content of DG15 (AA_MAX_DG15 bytes).
+ * @param[out] dg15Length Receives the length of the content.
+ *
+ * @return APP_SUCCESS if the file was read, otherwise an error code (the chip does not support
+ * Active Authentication).
+ */
+long ReadDG15(SecureMessagingSession* session, unsigned char* dg15, int* dg15Length);
+
+/**
+ * @brief Find the ActiveAuthenticationInfo of DG14.
+ *
+ * @param[in] dg14 Content of DG14.
+ * @param[in] dg14Length Length of the content.
+ * @param[out] signatureHash Receives the AA_HASH_* of the ECDSA signature algorithm.
+ *
+ * @return APP_SUCCESS if DG14 has a supported ActiveAuthenticationInfo, otherwise APP_ERROR and
+ * signatureHash is left unchanged.
+ */
+int ParseActiveAuthenticationInfo(const unsigned char* dg14, int dg14Length, int* signatureHash);
+
+/**
+ * @brief Performs Active Authentication with the smart card.
+ *
+ * Sends INTERNAL AUTHENTICATE with an 8-byte random challenge over the current session and
+ * verifies the signature of the chip with the public key of DG15. Parsed keys, with the
+ * Montgomery context of RSA moduli and the curve of EC keys, are cached by the SHA-256 of their
+ * SubjectPublicKeyInfo, so a known key only costs the signature verification.
+ *
+ * @param[in,out] session The secure messaging session, its SSC is updated.
+ * @param[in] dg15 Content of DG15.
+ * @param[in] dg15Length Length of the content.
+ * @param[in] signatureHash AA_HASH_* used by ECDSA keys, from ParseActiveAuthenticationInfo
+ * (AA_HASH_SHA1 without ActiveAuthenticationInfo). RSA signatures name their hash in the trailer.
+ *
+ * @return A long value representing the status code. APP_SUCCESS indicates a valid signature,
+ * otherwise an error code is returned.
+ */
+long ActiveAuthenticate(SecureMessagingSession* session,
+						const unsigned char* dg15,
+						int dg15Length,
+						int signatureHash);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	// #ifndef ACCESS_ACTIVE_AUTHENTICATION_H_
@@ -0,0 +1,103 @@
+/**
+ * @author Khoa Nguyen
+ * @file audit.h
+ * @brief Header file for the offline verification of recorded secure messaging sessions.
+ *
+ * This header file provides the replay of recorded sessions for audits. Every protected command
+ * and response of a session is verified again with its session keys, which checks the MAC of each
+ * APDU and that the SSC advances by exactly one per APDU. The files read with SELECT and READ
+ * BINARY are rebuilt, and the data groups are compared with the hashes of EF.SOD when EF.SOD was
+ * read in the same session. Transcript files are verified by worker threads fed from a bounded
+ * queue, one session per job.
+ *
+ * A transcript file is a sequence of session records, with little-endian lengths:
+ *
+ *     "SMTR" | cipher (1) | key length (1) | exchange count (2) | KS_Enc | KS_MAC | SSC
+ *     per exchange: command length (2) | protected command
+ *                   response length (2) | protected response with its status word
+ *
+ * The SSC is the value before the first command, as given to SecureMessagingInit (blockSize
+ * bytes). A record covers one secure messaging channel: the channel restarted by Chip
+ * Authentication is recorded as another session.
+ */
+
+#pragma once
+#ifndef ACCESS_AUDIT_H_
+#define ACCESS_AUDIT_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AUDIT_MAGIC		   "SMTR"
+#define AUDIT_HEADER_SIZE  8
+#define AUDIT_SSC_WINDOW   8	// SSC values tried on each side of the expected one
+#define AUDIT_QUEUE_LENGTH 64	// Sessions read ahead of the workers
+
+// Verdict flags of a session
+#define AUDIT_VALID		0
+#define AUDIT_BAD_MAC	0x01  // A MAC does not verify, the replay stops there
+#define AUDIT_SSC_GAP	0x02  // A MAC verifies only with an SSC skipped or repeated
+#define AUDIT_BAD_HASH	0x04  // A data group does not match its hash in EF.SOD
+#define AUDIT_UNLISTED	0x08  // A data group was read but is not listed in EF.SOD
+#define AUDIT_MALFORMED 0x10  // Truncated record, or a file that cannot be rebuilt
+#define AUDIT_NO_SOD	0x20  // Data groups were read without EF.SOD, their hashes are unchecked
+#define AUDIT_FAILURES	0x1F  // Flags that fail a session
+
+// Verdict of a session
+typedef struct {
+	long long session;	// Index of the session in the transcript
+	int verdict;		// AUDIT_* flags
+	int exchanges;		// Exchanges replayed
+	int dataGroups;		// Data groups whose hash matched EF.SOD
+} AuditResult;
+
+// Totals of a transcript
+typedef struct {
+	long long sessions;
+	long long failed;  // Sessions with a flag of AUDIT_FAILURES
+	int threads;
+	double seconds;
+	double sessionsPerSecond;
+} AuditSummary;
+
+/**
+ * @brief Receives the verdict of each session. Calls are serialized but come from the worker
+ * threads, in the order the sessions finish.
+ */
+typedef void (*AuditCallback)(const AuditResult* result, void* context);
+
+/**
+ * @brief Verifies one session record.
+ *
+ * @param[in] record The session record, in the transcript format.
+ * @param[in] recordLength Length of the record.
+ * @param[out] result Receives the verdict, its session index is 0.
+ *
+ * @return APP_SUCCESS if the session verified, otherwise APP_ERROR.
+ */
+long AuditSession(const unsigned char* record, int recordLength, AuditResult* result);
+
+/**
+ * @brief Verifies every session of a transcript file on a pool of threads.
+ *
+ * @param[in] path The transcript file.
+ * @param[in] threads Number of worker threads, 0 for one per logical processor.
+ * @param[in] callback Receives the verdict of each session, may be NULL.
+ * @param[in] context Passed to the callback.
+ * @param[out] summary Receives the totals and the throughput, may be NULL.
+ *
+ * @return APP_SUCCESS if the whole file was read, otherwise APP_ERROR (the sessions before a
+ * truncated record are still verified).
+ */
+long AuditTranscript(const char* path,
+					 int threads,
+					 AuditCallback callback,
+					 void* context,
+					 AuditSummary* summary);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	// #ifndef ACCESS_AUDIT_H_
@@ -18,6 +18,53 @@ extern "C" {
 
 #include "config.h"
 
+#include <access/secure_message.h>
+
+#define EF_COM_MAX_LENGTH 256
+#define DG1_MAX_LENGTH	  256
+#define DG1_TD1_LENGTH	  95  // '61' L '5F1F' L and the 90 characters of a TD1 MRZ
+#define DG13_MAX_LENGTH	  1024
+#define BAC_KEY_BATCH	  64  // MRZ informations hashed together by SessionKeyBatchGenerate
+
+// Masks of data groups as listed in EF.COM, DG_MASK_ALL has all those ReadIdCardChip decodes
+#define DG_MASK(dataGroup) (1u << (dataGroup))
+#define DG_MASK_TEXT	   (DG_MASK(1) | DG_MASK(13))
+#define DG_MASK_ALL		   (DG_MASK(1) | DG_MASK(2) | DG_MASK(13))
+
+// Candidate of a BAC key search, with everything of its EXTERNAL AUTHENTICATE that does not depend
+// on the challenge of the card
+typedef struct {
+	unsigned char encryptKey[16];	  // K_Enc
+	unsigned char macKey[16];		  // K_MAC
+	unsigned char randomNonceIFD[8];  // RND.IFD
+	unsigned char keyIFD[16];		  // K_IFD
+} BacCandidate;
+
+#define DG_MAX_FIELDS 16
+
+// Field of a data group, its value points into the content and is not NUL-terminated
+typedef struct {
+	const char* name;
+	const unsigned char* value;
+	int length;
+} DataGroupField;
+
+// Content of DG1 or DG13 and its fields
+typedef struct {
+	unsigned char content[DG13_MAX_LENGTH];
+	int length;
+	DataGroupField fields[DG_MAX_FIELDS];
+	int count;
+} DataGroupFields;
+
+// Progress of DG2, called after each chunk with the JPEG bytes it added to the image file (none
+// before the start of image marker) and the bytes of DG2 read so far out of its total length
+typedef void (*ImageProgressCallback)(const unsigned char* image,
+									  int length,
+									  int read,
+									  int total,
+									  void* context);
+
 /**
  * @brief Calculate Key Seed for generating Session Key.
  *
@@ -41,6 +88,37 @@ void SessionKeyGenerate(unsigned char keySeed[16],
 						unsigned char encryptKeyBuf[16],
 						unsigned char macKeyBuf[16]);
 
+/**
+ * @brief Generate the Session Keys of many MRZ informations at once.
+ *
+ * Equivalent to KeySeedCalculate and SessionKeyGenerate for each MRZ information, the SHA-1 hashes
+ * of all of them are computed together by sha1_multi. No memory is allocated.
+ *
+ * @param[in] mrzInformation The MRZ informations as NUL-terminated strings.
+ * @param[in] count Number of MRZ informations.
+ * @param[out] encryptKeyBuf Receives the session encryption key of each MRZ information.
+ * @param[out] macKeyBuf Receives the session MAC key of each MRZ information.
+ */
+void SessionKeyBatchGenerate(unsigned char* mrzInformation[],
+							 int count,
+							 unsigned char encryptKeyBuf[][16],
+							 unsigned char macKeyBuf[][16]);
+
+/**
+ * @brief Prepare the candidates of a BAC key search.
+ *
+ * Derives the session keys of all MRZ informations with SessionKeyBatchGenerate and draws the
+ * RND.IFD and K_IFD of each candidate, so that an attempt only has to encrypt and MAC the challenge
+ * of the card. A candidate must be used for one EXTERNAL AUTHENTICATE only.
+ *
+ * @param[in] mrzInformation The MRZ informations as NUL-terminated strings.
+ * @param[in] count Number of MRZ informations.
+ * @param[out] candidates Receives one candidate per MRZ information.
+ *
+ * @return APP_SUCCESS, or APP_ERROR if the nonces cannot be generated.
+ */
+long BacCandidatesGenerate(unsigned char* mrzInformation[], int count, BacCandidate candidates[]);
+
 /**
  * @brief Find, connect and start session on reader.
  *
@@ -76,6 +154,19 @@ long DetectCard(void);
  */
 long SelectApplication(void);
 
+/**
+ * @brief Select Application over secure messaging.
+ *
+ * Sends the SELECT command of the eMRTD application protected with the session established by
+ * PACE, which runs at the master file level before the application is selected.
+ *
+ * @param[in,out] session The secure messaging session, its SSC is updated.
+ *
+ * @return A long value representing the status code. APP_SUCCESS indicates successful selection,
+		   otherwise an error code is returned.
+ */
+long ProtectedSelectApplication(SecureMessagingSession* session);
+
 /**
  * @brief Get Challenge for Basic Access Control.
  *
@@ -85,7 +176,8 @@ long SelectApplication(void);
  * @param[in] getChallenge of getChallengeResponse array (should be 10).
  *
  * @return A long value representing the status code. APP_SUCCESS indicates successful retrieval,
-		   otherwise an error code is returned.
+		   otherwise an error code is returned, also when the card does not answer with 8 bytes
+		   and the status word 0x9000.
  */
 long GetChallenge(unsigned char getChallengeResponse[10], int getChallengeResponseSize);
 
@@ -95,18 +187,13 @@ long GetChallenge(unsigned char getChallengeResponse[10], int getChallengeRespon
  * This function sends an EXTERNAL AUTHENTICATE command to the smart card, which is used for mutual
  * authentication between the card and the application. It computes necessary data, encrypts and
  * decrypts information, verifies received data, and generates session keys (KS_Enc and KS_MAC) as
- * well as the Send Sequence Counter (SSC).
+ * well as the Send Sequence Counter (SSC) of a 3DES secure messaging session.
  *
  * @param[in] getChallengeResponse Pointer to a 10-byte array containing the response from a
  * previous GET CHALLENGE command.
  * @param[in] encryptKey Pointer to a 16-byte array containing the encryption key (K_Enc).
  * @param[in] macKey Pointer to a 16-byte array containing the MAC key (K_MAC).
- * @param[out] sessionKeyEncrypt Pointer to a 16-byte array where the generated encryption session
- * key (KS_Enc) will be stored.
- * @param[out] sessionKeyMac Pointer to a 16-byte array where the generated MAC session key (KS_MAC)
- * will be stored.
- * @param[out] sendSequenceCounter Pointer to an 8-byte array where the initialized Send Sequence
- * Counter (SSC) will be stored.
+ * @param[out] session The secure messaging session initialized with KS_Enc, KS_MAC and the SSC.
  *
  * @return A long value representing the status code. APP_SUCCESS indicates successful reading,
 		   otherwise an error code is returned.
@@ -114,47 +201,66 @@ long GetChallenge(unsigned char getChallengeResponse[10], int getChallengeRespon
 long ExternalAuthenticate(unsigned char getChallengeResponse[10],
 						  unsigned char encryptKey[16],
 						  unsigned char macKey[16],
-						  unsigned char sessionKeyEncrypt[16],
-						  unsigned char sessionKeyMac[16],
-						  unsigned char sendSequenceCounter[8]);
+						  SecureMessagingSession* session);
+
+/**
+ * @brief Performs the EXTERNAL AUTHENTICATE operation with a prepared candidate.
+ *
+ * Same as ExternalAuthenticate with the keys and nonces of the candidate. A status word other than
+ * 0x9000, as returned by the card for a wrong key, fails without verifying the response.
+ *
+ * @param[in] getChallengeResponse The response of the previous GET CHALLENGE command.
+ * @param[in] candidate The candidate, see BacCandidatesGenerate.
+ * @param[out] session The secure messaging session initialized with KS_Enc, KS_MAC and the SSC.
+ * @param[out] statusWord Receives the status word of the card, 0 if it did not answer. May be NULL.
+ *
+ * @return APP_SUCCESS if the card accepted the keys of the candidate, otherwise an error code.
+ */
+long ExternalAuthenticateCandidate(unsigned char getChallengeResponse[10],
+								   const BacCandidate* candidate,
+								   SecureMessagingSession* session,
+								   unsigned short* statusWord);
+
+/**
+ * @brief Lists the data groups of the tag list of EF.COM.
+ *
+ * @param[in] efCom The content of EF.COM.
+ * @param[in] efComLength Length of the content.
+ * @param[out] dataGroups Receives the DG_MASK of the data groups of the tag list.
+ *
+ * @return APP_SUCCESS, or APP_ERROR if EF.COM has no tag list.
+ */
+long EFCOMDataGroups(const unsigned char* efCom, int efComLength, unsigned int* dataGroups);
 
 /*
 * @brief Read EF.COM to get basic chip's information.
  *
  * Reads the EF.COM file from the smart card, which contains the LDS Version, Tag list, and DG list.
  *
- * @param[in] sessionKeyEncrypt The session encryption key as an array of 16 unsigned chars for
- secure messaging.
- * @param[in] sessionKeyMac The session MAC key as an array of 16 unsigned chars for secure
- messaging.
- * @param[in,out] sendSequenceCounter The send sequence counter as an array of 8 unsigned chars for
- secure messaging, updated after each command/response exchange with the smart card.
+ * @param[in,out] session The secure messaging session, its SSC is updated after each
+ command/response exchange with the smart card.
+ * @param[out] dataGroups Receives the DG_MASK of the data groups of the tag list, may be NULL.
  *
  * @return A long value representing the status code. APP_SUCCESS indicates successful reading,
 		   otherwise an error code is returned.
 */
-long ReadEFCOM(unsigned char sessionKeyEncrypt[16],
-			   unsigned char sessionKeyMac[16],
-			   unsigned char sendSequenceCounter[8]);
+long ReadEFCOM(SecureMessagingSession* session, unsigned int* dataGroups);
 
 /**
  * @brief Read DG1.COM to get basic holder's information.
  *
  * Reads the DG1 data group from the smart card, which contains basic information about the holder.
  *
- * @param[in] sessionKeyEncrypt The session encryption key as an array of 16 unsigned chars for
- secure messaging.
- * @param[in] sessionKeyMac The session MAC key as an array of 16 unsigned chars for secure
- messaging.
- * @param[in,out] sendSequenceCounter The send sequence counter as an array of 8 unsigned chars for
- secure messaging, updated after each command/response exchange with the smart card.
+ * @param[in,out] session The secure messaging session, its SSC is updated after each
+ command/response exchange with the smart card.
+ * @param[in,out] dgHash Started hash fed with the DG1 bytes as they are decrypted, finalized by the
+ caller; NULL to skip hashing.
+ * @param[out] fields Receives the content and the fields of DG1, may be NULL.
  *
  * @return A long value representing the status code. APP_SUCCESS indicates successful reading,
 		   otherwise an error code is returned.
  */
-long ReadDG1(unsigned char sessionKeyEncrypt[16],
-			 unsigned char sessionKeyMac[16],
-			 unsigned char sendSequenceCounter[8]);
+long ReadDG1(SecureMessagingSession* session, hash_ctx* dgHash, DataGroupFields* fields);
 
 /**
 * @brief Read DG2.COM to get holder's image.
@@ -162,39 +268,39 @@ long ReadDG1(unsigned char sessionKeyEncrypt[16],
 * Reads the DG2 data group from the smart card, which contains the holder's image (in JPEG format).
 Saves the retrieved image as a JPEG file in the imageFilePath.
 *
-* @param[in] sessionKeyEncrypt The session encryption key as an array of 16 unsigned chars for
-secure messaging.
-* @param[in] sessionKeyMac The session MAC key as an array of 16 unsigned chars for secure
-messaging.
-* @param[in,out] sendSequenceCounter The send sequence counter as an array of 8 unsigned chars for
-secure messaging, updated after each command/response exchange with the smart card.
+* @param[in,out] session The secure messaging session, its SSC is updated after each
+command/response exchange with the smart card.
 * @param[in] imageFilePath The path to the image file to be saved.
+* @param[in,out] dgHash Started hash fed with the DG2 bytes as they are decrypted, finalized by the
+caller; NULL to skip hashing.
+* @param[in] progress Called after each chunk, the image file is flushed first so a partial JPEG
+can be decoded from it; NULL for no progress.
+* @param[in] context Passed to progress.
 *
 * @return A long value representing the status code. APP_SUCCESS indicates successful reading and
 saving of the image, otherwise an error code is returned.
 */
-long ReadDG2(unsigned char sessionKeyEncrypt[16],
-			 unsigned char sessionKeyMac[16],
-			 unsigned char sendSequenceCounter[8],
-			 unsigned char imageFilePath[]);
+long ReadDG2(SecureMessagingSession* session,
+			 unsigned char imageFilePath[],
+			 hash_ctx* dgHash,
+			 ImageProgressCallback progress,
+			 void* context);
 
 /*
 * @brief Read DG13.COM to get holder's extra information.
 *
 * Reads the DG13 data group from the smart card, which contains extra information about the holder.
 *
-* @param[in] sessionKeyEncrypt The session encryption key as an array of 16 unsigned chars for
-secure messaging.
-* @param[in] sessionKeyMac The session MAC key as an array of 16 unsigned chars for secure
-messaging.
-* @param[in,out] sendSequenceCounter The send sequence counter as an array of 8 unsigned chars for
+* @param[in,out] session The secure messaging session, its SSC is updated after each
+command/response exchange with the smart card.
+* @param[in,out] dgHash Started hash fed with the DG13 bytes as they are decrypted, finalized by
+the caller; NULL to skip hashing.
+* @param[out] fields Receives the content and the fields of DG13, may be NULL.
 *
 * @return A long value representing the status code. APP_SUCCESS indicates successful reading,
 otherwise an error code is returned.
 */
-long ReadDG13(unsigned char sessionKeyEncrypt[16],
-			  unsigned char sessionKeyMac[16],
-			  unsigned char sendSequenceCounter[8]);
+long ReadDG13(SecureMessagingSession* session, hash_ctx* dgHash, DataGroupFields* fields);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,116 @@
+/**
+ * @author Khoa Nguyen
+ * @file bac_queue.h
+ * @brief Header file for the pending set of pre-scanned MRZ keys.
+ *
+ * At a busy counter the MRZs of the people waiting are scanned ahead of time, and their cards are
+ * tapped later in any order. This header file provides a pending set of their BAC keys, derived
+ * with KeySeedCalculate and SessionKeyGenerate once when each MRZ is added, so a tapped card is
+ * matched by EXTERNAL AUTHENTICATE attempts without any derivation. The entries are tried from the
+ * front of the queue, the people who waited longest being the most likely to tap; entries older
+ * than staleMilliseconds, whose holder probably left, are tried after all the fresh ones. The set
+ * is shared by the readers of all threads: attempts work on a snapshot of the entries, and the
+ * entry of the key a card accepted is claimed under the lock, so it is removed exactly once.
+ */
+
+#pragma once
+#ifndef ACCESS_BAC_QUEUE_H_
+#define ACCESS_BAC_QUEUE_H_
+
+#include <access/bac_application.h>
+#include <utils/mrz.h>
+#include <utils/sync.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BAC_QUEUE_MAX_ENTRIES	  256
+#define BAC_QUEUE_DEFAULT_STALE	  (15 * 60 * 1000)	// Milliseconds before an entry is stale
+
+// MRZ key of a person in the queue
+typedef struct {
+	unsigned int id;									// Position in the queue, never 0
+	unsigned char mrzInformation[MRZ_MAX_INFORMATION];	// NUL-terminated
+	unsigned char encryptKey[16];						// K_Enc
+	unsigned char macKey[16];							// K_MAC
+	long long added;									// SyncTicks when the MRZ was added
+	void* context;										// Data of the caller, e.g. a ticket
+} BacQueueEntry;
+
+// Entry of a snapshot, ready for one EXTERNAL AUTHENTICATE
+typedef struct {
+	unsigned int id;
+	BacCandidate candidate;
+} BacQueueCandidate;
+
+// Pending set, entries in the order they were added
+typedef struct {
+	SyncLock lock;
+	BacQueueEntry entries[BAC_QUEUE_MAX_ENTRIES];
+	int count;
+	unsigned int nextId;
+	int staleMilliseconds;
+} BacQueue;
+
+/**
+ * @brief Initializes an empty pending set.
+ *
+ * @param[out] queue The pending set.
+ * @param[in] staleMilliseconds Age after which an entry is tried last, 0 for
+ * BAC_QUEUE_DEFAULT_STALE.
+ */
+void BacQueueInit(BacQueue* queue, int staleMilliseconds);
+
+/**
+ * @brief Derives the BAC key of an MRZ and appends it to the pending set.
+ *
+ * @param[in,out] queue The pending set.
+ * @param[in] mrzInformation The MRZ information, NUL-terminated.
+ * @param[in] context Data of the caller returned with the entry, may be NULL.
+ *
+ * @return The id of the entry, 0 if the set is full.
+ */
+unsigned int BacQueueAdd(BacQueue* queue, const unsigned char mrzInformation[], void* context);
+
+/**
+ * @brief Removes an entry whose holder left the queue.
+ *
+ * @param[in,out] queue The pending set.
+ * @param[in] id The id of the entry.
+ *
+ * @return APP_SUCCESS if the entry was pending, otherwise APP_ERROR.
+ */
+long BacQueueRemove(BacQueue* queue, unsigned int id);
+
+/**
+ * @brief Returns the number of pending entries.
+ */
+int BacQueueCount(BacQueue* queue);
+
+/**
+ * @brief Copies the pending entries in the order they are tried, with fresh nonces.
+ *
+ * @param[in] queue The pending set.
+ * @param[out] candidates Receives the candidates (BAC_QUEUE_MAX_ENTRIES).
+ *
+ * @return The number of candidates, or APP_ERROR if the nonces cannot be generated.
+ */
+int BacQueueSnapshot(BacQueue* queue, BacQueueCandidate candidates[]);
+
+/**
+ * @brief Removes the entry of the key a card accepted.
+ *
+ * @param[in,out] queue The pending set.
+ * @param[in] id The id of the entry.
+ * @param[out] entry Receives the entry, may be NULL.
+ *
+ * @return APP_SUCCESS if this call removed the entry, APP_ERROR if it was no longer pending.
+ */
+long BacQueueClaim(BacQueue* queue, unsigned int id, BacQueueEntry* entry);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	// #ifndef ACCESS_BAC_QUEUE_H_
@@ -0,0 +1,170 @@
+/**
+ * @author Khoa Nguyen
+ * @file bac_search.h
+ * @brief Header file for the candidate model of the BAC key search.
+ *
+ * When only the document number is known, the birth date and the date of expiry of the MRZ key are
+ * guessed. The birth year comes from the document number and the date of expiry falls on the
+ * birthday of the year the holder turns 25, 40 or 60. This header file provides a generator that
+ * enumerates the birth dates with the dates of expiry a card may carry on the day of the read: the
+ * next milestone, the previous one for a card not renewed yet, and the one after the next for a
+ * card renewed early. Each candidate gets a probability from a configurable model and the
+ * candidates are sorted from the most to the least likely, which minimizes the expected number of
+ * attempts on the card. A scheduler watches the time and status word of each attempt, to notice
+ * chips that slow down after wrong keys.
+ */
+
+#pragma once
+#ifndef ACCESS_BAC_SEARCH_H_
+#define ACCESS_BAC_SEARCH_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BAC_SEARCH_MAX_CANDIDATES 1098	// 366 birth dates with 3 dates of expiry each
+#define BAC_SEARCH_WINDOW		  8		// First wrong key refusals whose mean time is the baseline
+
+// Actions of the scheduler after a refused attempt
+#define BAC_SEARCH_CONTINUE 0
+#define BAC_SEARCH_RESELECT 1  // Select the application again before the next attempt
+#define BAC_SEARCH_PAUSE	2  // Wait pauseMilliseconds before the next attempt
+#define BAC_SEARCH_PROMPT	3  // Stop the search and ask the operator for the MRZ
+
+/**
+ * @brief Asks the operator for the MRZ information when the search cannot go on.
+ *
+ * @param[in] documentNumber The document number as an array of 9 unsigned chars.
+ * @param[out] mrzInformation Receives the MRZ information, NUL-terminated.
+ * @param[in] context The promptContext of the model.
+ *
+ * @return APP_SUCCESS if the operator entered the MRZ, otherwise APP_ERROR.
+ */
+typedef long (*BacPromptCallback)(const unsigned char documentNumber[9],
+								  unsigned char mrzInformation[25],
+								  void* context);
+
+// Prior probabilities and schedule of the search, see BacSearchModelDefault
+typedef struct {
+	int year;				   // Date of the read, year 0 for the system clock
+	int month;
+	int day;
+	double monthWeight[12];	   // Relative weight of each birth month, all 0 for uniform
+	double firstOfJanuary;	   // Weight of 1 January relative to another day of January
+	double valid;			   // Card expiring on the next milestone
+	double expired;			   // Card past its expiry, not renewed yet
+	double renewedEarly;	   // Card renewed before a near milestone, expiring on the one after
+	int renewalYears;		   // Years before a milestone in which a card may be renewed early
+	int maxAttempts;		   // Cap on the number of candidates, 0 for none
+	double penaltyRatio;	   // Attempt slower than this times the baseline, 0 for no detection
+	int penaltyAttempts;	   // Slow attempts in a row before the scheduler acts
+	int pauseMilliseconds;	   // Pause of the second action on slow attempts
+	int promptMilliseconds;	   // Attempt time after which the operator is asked, 0 for never
+	BacPromptCallback prompt;  // Asks the operator for the MRZ, NULL to fail the search instead
+	void* promptContext;
+} BacSearchModel;
+
+// Statistics of the search on one card
+typedef struct {
+	int cached;					// 1 if the learned key of the key cache opened the card
+	int found;					// Rank of the candidate the card accepted, -1 if none
+	int attempts;				// EXTERNAL AUTHENTICATE commands of the search
+	int refusals;				// Attempts refused as a wrong key, the ones that are timed
+	int challengeFailures;		// GET CHALLENGE commands that failed
+	double baselineMs;			// Mean time of the first BAC_SEARCH_WINDOW refusals
+	double lastMs;				// Time of the last attempt
+	double maxMs;				// Time of the slowest attempt
+	double totalMs;				// Time of all attempts
+	int penalized;				// Attempts slower than penaltyRatio times the baseline
+	int streak;					// Slow attempts in a row since the last action
+	int reselects;				// Applications selected again
+	int pauses;					// Pauses
+	int prompted;				// 1 if the operator was asked for the MRZ
+	unsigned short lastStatus;	// Status word of the last refused attempt
+	int lastAction;				// Action taken on the last slow attempts
+	int reselectRelieves;		// 1 if the attempt after the last new selection was not slow
+} BacSearchStats;
+
+// Candidate MRZ information with its probability
+typedef struct {
+	unsigned char mrzInformation[25];  // NUL-terminated
+	double probability;
+} BacSearchCandidate;
+
+/**
+ * @brief Fills a model with the default priors.
+ *
+ * The date is taken from the system clock, birth dates are uniform, and a card expires on the next
+ * milestone with probability 0.85, was renewed in the 2 years before it with probability 0.1, or
+ * is expired with probability 0.05. There is no cap on the attempts. Three attempts in a row
+ * slower than 3 times the baseline trigger an action, an attempt of 5 seconds asks the operator,
+ * and there is no prompt callback.
+ *
+ * @param[out] model The model.
+ */
+void BacSearchModelDefault(BacSearchModel* model);
+
+/**
+ * @brief Enumerates the candidate MRZ informations of a document number.
+ *
+ * 29 February is only a candidate in a leap birth year. Candidates of equal probability keep the
+ * calendar order of their birth dates.
+ *
+ * @param[in] documentNumber The document number as an array of 9 unsigned chars.
+ * @param[in] model The priors, NULL for BacSearchModelDefault.
+ * @param[out] candidates Receives the candidates, most likely first (BAC_SEARCH_MAX_CANDIDATES).
+ *
+ * @return The number of candidates, at most model->maxAttempts when it is set.
+ */
+int BacSearchCandidatesGenerate(const unsigned char documentNumber[9],
+								const BacSearchModel* model,
+								BacSearchCandidate candidates[]);
+
+/**
+ * @brief Computes the expected number of attempts of a sorted list of candidates.
+ *
+ * The probabilities are those of the whole search space, so a capped list also counts the
+ * attempts of the searches that fail.
+ *
+ * @param[in] candidates The candidates, in the order they are tried.
+ * @param[in] count Number of candidates.
+ *
+ * @return The expected number of EXTERNAL AUTHENTICATE commands.
+ */
+double BacSearchExpectedAttempts(const BacSearchCandidate candidates[], int count);
+
+/**
+ * @brief Clears the statistics of a search.
+ *
+ * @param[out] stats The statistics.
+ */
+void BacSearchStatsInit(BacSearchStats* stats);
+
+/**
+ * @brief Records a refused attempt and chooses the action before the next one.
+ *
+ * Chips that punish wrong keys answer more and more slowly. Once the baseline is known, an attempt
+ * slower than penaltyRatio times the baseline is counted as penalized, and after penaltyAttempts
+ * of them in a row the scheduler selects the application again, or pauses once a new selection
+ * did not bring the time of the next attempt back under the threshold. An attempt slower than
+ * promptMilliseconds, or a status word telling that BAC is blocked, stops the search for the
+ * operator. A status word telling that the application was deselected selects it again, and the
+ * other failures are not timed.
+ *
+ * @param[in] model The schedule, NULL for BacSearchModelDefault.
+ * @param[in,out] stats The statistics of the search.
+ * @param[in] milliseconds Time of the EXTERNAL AUTHENTICATE command.
+ * @param[in] statusWord Status word of the refused attempt, 0 if there was no response.
+ *
+ * @return One of the BAC_SEARCH_* actions.
+ */
+int BacSearchSchedule(const BacSearchModel* model,
+					  BacSearchStats* stats,
+					  double milliseconds,
+					  unsigned short statusWord);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	// #ifndef ACCESS_BAC_SEARCH_H_
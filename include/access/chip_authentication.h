@@ -0,0 +1,92 @@
+/**
+ * @author Khoa Nguyen
+ * @file chip_authentication.h
+ * @brief Header file for Chip Authentication functions.
+ *
+ * This header file contains function declarations for reading DG14 and running Chip Authentication
+ * (ICAO Doc 9303 Part 11, section 6.2). An ephemeral-static ECDH or DH key agreement with the
+ * static public key of the chip proves that the chip is genuine, and the secure messaging session
+ * is restarted with keys derived from the shared secret, typically upgrading it to AES. The
+ * commands are short APDUs, so DH is limited to moduli of up to 1536 bits.
+ */
+
+#pragma once
+#ifndef ACCESS_CHIP_AUTHENTICATION_H_
+#define ACCESS_CHIP_AUTHENTICATION_H_
+
+#include <access/secure_message.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CA_KEY_AGREEMENT_DH	  1
+#define CA_KEY_AGREEMENT_ECDH 2
+
+#define CA_MAX_OID_LENGTH	  16
+#define CA_MAX_KEY_ID_LENGTH  8
+#define CA_MAX_DG14			  2048
+
+// Parameters of a supported ChipAuthenticationInfo of DG14 and the matching public key
+typedef struct {
+	unsigned char protocol[CA_MAX_OID_LENGTH];	// DER content of the protocol OID
+	int protocolLength;							// Length of the protocol OID
+	int version;								// 1 (MSE:Set KAT) or 2 (General Authenticate)
+	int keyAgreement;							// CA_KEY_AGREEMENT_DH or CA_KEY_AGREEMENT_ECDH
+	int cipher;									// SM_CIPHER_3DES or SM_CIPHER_AES
+	int keyLength;								// Session key length in bytes
+	unsigned char keyId[CA_MAX_KEY_ID_LENGTH];	// DER content of the key identifier
+	int keyIdLength;							// 0 if the chip has a single key
+	const unsigned char* publicKeyInfo;			// SubjectPublicKeyInfo, points into DG14
+	int publicKeyInfoLength;					// Length of the SubjectPublicKeyInfo
+} ChipAuthenticationInfo;
+
+/**
+ * @brief Read DG14 over secure messaging.
+ *
+ * @param[in,out] session The secure messaging session, its SSC is updated.
+ * @param[out] dg14 Buffer receiving the content of DG14 (CA_MAX_DG14 bytes).
+ * @param[out] dg14Length Receives the length of the content.
+ *
+ * @return APP_SUCCESS if the file was read, otherwise an error code (the chip does not support
+ * Chip Authentication).
+ */
+long ReadDG14(SecureMessagingSession* session, unsigned char* dg14, int* dg14Length);
+
+/**
+ * @brief Parse DG14 and choose a Chip Authentication protocol.
+ *
+ * Walks the SecurityInfos of DG14 and selects the strongest supported ChipAuthenticationInfo with
+ * a matching ChipAuthenticationPublicKeyInfo, preferring AES over 3DES. Without any
+ * ChipAuthenticationInfo, version 1 with 3DES is assumed as required by Doc 9303.
+ *
+ * @param[in] dg14 Content of DG14, it must outlive caInfo.
+ * @param[in] dg14Length Length of the content.
+ * @param[out] caInfo Receives the chosen protocol and public key.
+ *
+ * @return APP_SUCCESS if a supported protocol was found, otherwise APP_ERROR.
+ */
+int ParseDG14(const unsigned char* dg14, int dg14Length, ChipAuthenticationInfo* caInfo);
+
+/**
+ * @brief Performs Chip Authentication with the smart card.
+ *
+ * Generates an ephemeral key pair on the domain parameters of the chip's public key, sends the
+ * ephemeral public key with MSE:Set KAT (version 1) or MSE:Set AT and General Authenticate
+ * (version 2) over the current session, then restarts the session with KS_Enc and KS_MAC derived
+ * from the shared secret and a zero SSC. The currently selected file is kept. The chip is
+ * authenticated implicitly: only a genuine chip can answer the next command with the new keys.
+ *
+ * @param[in] caInfo The protocol chosen by ParseDG14.
+ * @param[in,out] session The secure messaging session, replaced by the new one on success.
+ *
+ * @return A long value representing the status code. APP_SUCCESS indicates successful
+ * authentication, otherwise an error code is returned.
+ */
+long ChipAuthenticate(const ChipAuthenticationInfo* caInfo, SecureMessagingSession* session);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	// #ifndef ACCESS_CHIP_AUTHENTICATION_H_
@@ -0,0 +1,95 @@
+/**
+ * @author Khoa Nguyen
+ * @file lds_dump.h
+ * @brief Header file for the dump of the whole LDS of a chip into one container.
+ *
+ * This header file provides the archival dump of every elementary file of the eMRTD application:
+ * EF.COM, EF.SOD and the data groups of DG1 to DG16 that EF.COM lists. The files are read over an
+ * established secure messaging session, each by its short EF identifier so no SELECT is sent, in
+ * an order planned from EF.COM: the small text and security files first, then EF.SOD, then the
+ * large biometric files, the DG3 and DG4 that Extended Access Control protects last. Every file is
+ * streamed into the container as its chunks are decrypted, the index is written once all are read.
+ *
+ * The container is self-describing: a header with LDS_DUMP_MAGIC and the number of files, an index
+ * of LDS_DUMP_MAX_FILES entries giving the file identifier, offset and length of each file, then
+ * the files back to back. Integers are little-endian.
+ */
+
+#pragma once
+#ifndef ACCESS_LDS_DUMP_H_
+#define ACCESS_LDS_DUMP_H_
+
+#include <access/secure_message.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LDS_DUMP_MAGIC	   "IDLDS001"
+#define LDS_DUMP_MAX_FILES 18  // EF.COM, EF.SOD and DG1 to DG16
+
+// Header of the container
+typedef struct {
+	char magic[8];
+	unsigned int count;	 // Entries of the index in use
+	unsigned int size;	 // Length of the container
+} LdsDumpHeader;
+
+// Entry of the index, the unused entries are zero
+typedef struct {
+	unsigned char fileId[2];
+	unsigned char shortFileId;
+	unsigned char dataGroup;  // 0 for EF.COM and EF.SOD
+	unsigned int offset;	  // From the start of the container
+	unsigned int length;
+} LdsDumpEntry;
+
+/**
+ * @brief Plans the read order of the files of a dump.
+ *
+ * @param[in] dataGroups The DG_MASK of the data groups EF.COM lists.
+ * @param[out] shortFileIds Receives the short EF identifiers of the files read after EF.COM
+ * (LDS_DUMP_MAX_FILES).
+ *
+ * @return The number of files after EF.COM.
+ */
+int LdsDumpPlan(unsigned int dataGroups, unsigned char shortFileIds[]);
+
+/**
+ * @brief Dumps the LDS of the chip into a container file.
+ *
+ * Files that EF.COM lists but the chip refuses to read, such as DG3 and DG4 without Extended
+ * Access Control, are left out of the container. A read that fails after the first chunk of a file
+ * stops the dump.
+ *
+ * @param[in,out] session The secure messaging session of the eMRTD application.
+ * @param[in] path The container file to write.
+ * @param[out] dataGroups Receives the DG_MASK of the data groups in the container, may be NULL.
+ *
+ * @return APP_SUCCESS if the container was written, otherwise APP_ERROR.
+ */
+long LdsDumpRead(SecureMessagingSession* session, const char* path, unsigned int* dataGroups);
+
+/**
+ * @brief Finds a file in a container loaded in memory.
+ *
+ * @param[in] container The container.
+ * @param[in] containerLength Length of the container.
+ * @param[in] fileId File identifier (2 bytes) of the file, such as 0x01 0x1D for EF.SOD.
+ * @param[out] data Receives a pointer to the file content inside the container.
+ * @param[out] fileLength Receives the length of the file content.
+ *
+ * @return APP_SUCCESS if the container holds the file, otherwise APP_ERROR, also when the container
+ * is not valid.
+ */
+long LdsDumpFind(const unsigned char* container,
+				 int containerLength,
+				 const unsigned char fileId[2],
+				 const unsigned char** data,
+				 int* fileLength);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	// #ifndef ACCESS_LDS_DUMP_H_
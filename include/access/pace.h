@@ -0,0 +1,94 @@
+/**
+ * @author Khoa Nguyen
+ * @file pace.h
+ * @brief Header file for Password Authenticated Connection Establishment (PACE) functions.
+ *
+ * This header file contains function declarations for reading EF.CardAccess and running PACE with
+ * Generic Mapping over elliptic curve Diffie-Hellman (ICAO Doc 9303 Part 11, section 4.4). The
+ * password is either derived from the MRZ or the Card Access Number (CAN) printed on the card. A
+ * successful run establishes a 3DES or AES secure messaging session.
+ */
+
+#pragma once
+#ifndef ACCESS_PACE_H_
+#define ACCESS_PACE_H_
+
+#include <access/secure_message.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PACE_PASSWORD_MRZ		 1	// Password reference of the MRZ-derived key
+#define PACE_PASSWORD_CAN		 2	// Password reference of the Card Access Number
+
+#define PACE_MAX_OID_LENGTH		 16
+#define PACE_MAX_CARD_ACCESS	 1024
+
+// Parameters of a supported PACEInfo entry of EF.CardAccess
+typedef struct {
+	unsigned char protocol[PACE_MAX_OID_LENGTH];  // DER content of the protocol OID
+	int protocolLength;							  // Length of the protocol OID
+	int version;								  // PACE version (2)
+	int parameterId;							  // Standardized domain parameter ID (8 to 18)
+	int cipher;									  // SM_CIPHER_3DES or SM_CIPHER_AES
+	int keyLength;								  // Session key length in bytes
+} PaceInfo;
+
+/**
+ * @brief Read EF.CardAccess from the master file.
+ *
+ * Reads EF.CardAccess by its short file identifier without secure messaging. It must be called
+ * before the eMRTD application is selected.
+ *
+ * @param[out] cardAccess Buffer receiving the content of EF.CardAccess (PACE_MAX_CARD_ACCESS
+ * bytes).
+ * @param[out] cardAccessLength Receives the length of the content.
+ *
+ * @return APP_SUCCESS if the file was read, otherwise an error code (the chip does not support
+ * PACE).
+ */
+long ReadCardAccess(unsigned char* cardAccess, int* cardAccessLength);
+
+/**
+ * @brief Parse EF.CardAccess and choose a PACE protocol.
+ *
+ * Walks the SecurityInfos of EF.CardAccess and selects the strongest supported PACEInfo, i.e.
+ * ECDH Generic Mapping on a standardized curve, preferring AES over 3DES.
+ *
+ * @param[in] cardAccess Content of EF.CardAccess.
+ * @param[in] cardAccessLength Length of the content.
+ * @param[out] paceInfo Receives the chosen protocol.
+ *
+ * @return APP_SUCCESS if a supported protocol was found, otherwise APP_ERROR.
+ */
+int ParseCardAccess(const unsigned char* cardAccess, int cardAccessLength, PaceInfo* paceInfo);
+
+/**
+ * @brief Performs PACE with the smart card.
+ *
+ * Runs MSE:Set AT and the four General Authenticate steps (encrypted nonce, mapping, key agreement
+ * and mutual authentication), then initializes the secure messaging session with the derived
+ * KS_Enc and KS_MAC and a zero SSC.
+ *
+ * @param[in] paceInfo The protocol chosen by ParseCardAccess.
+ * @param[in] passwordType PACE_PASSWORD_MRZ or PACE_PASSWORD_CAN.
+ * @param[in] password The MRZ information (document number, date of birth, date of expiry with
+ * their check digits) or the CAN digits.
+ * @param[in] passwordLength Length of the password.
+ * @param[out] session The established secure messaging session.
+ *
+ * @return A long value representing the status code. APP_SUCCESS indicates successful
+ * authentication, otherwise an error code is returned.
+ */
+long PaceAuthenticate(const PaceInfo* paceInfo,
+					  int passwordType,
+					  const unsigned char* password,
+					  int passwordLength,
+					  SecureMessagingSession* session);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	// #ifndef ACCESS_PACE_H_
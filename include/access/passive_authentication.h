@@ -0,0 +1,141 @@
+/**
+ * @author Khoa Nguyen
+ * @file passive_authentication.h
+ * @brief Header file for Passive Authentication functions.
+ *
+ * This header file contains function declarations for reading EF.SOD and running Passive
+ * Authentication (ICAO Doc 9303 Part 11, section 5.1). EF.SOD is a CMS SignedData whose content,
+ * the LDSSecurityObject, lists the hash of every data group and is signed by the Document Signer.
+ * The data groups are hashed chunk by chunk as they are decrypted and checked as soon as they are
+ * read, while the signature of EF.SOD is verified on a worker thread.
+ *
+ * The Document Signer certificate embedded in EF.SOD is checked against the CSCA store when one is
+ * loaded (see trust_store.h).
+ */
+
+#pragma once
+#ifndef ACCESS_PASSIVE_AUTHENTICATION_H_
+#define ACCESS_PASSIVE_AUTHENTICATION_H_
+
+#include <access/secure_message.h>
+#include <cryptography/hash.h>
+#include <utils/certificate.h>
+#include <utils/sync.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PA_MAX_SOD		   8192
+#define PA_MAX_DATA_GROUPS 16
+#define PA_PENDING		   1  // Result of a signature verification still running
+
+// Decoded EF.SOD, all pointers refer to the EF.SOD buffer
+typedef struct {
+	int hashAlgorithm;	// HASH_* of the data group hashes
+	int dataGroupCount;
+	int dataGroups[PA_MAX_DATA_GROUPS];	 // Data group numbers
+	const unsigned char* dataGroupHashes[PA_MAX_DATA_GROUPS];
+	const unsigned char* content;  // Encoded LDSSecurityObject, the signed content
+	int contentLength;
+	int digestAlgorithm;  // HASH_* of the signer
+	const unsigned char* signedAttributes;	// [0] IMPLICIT SignedAttributes, NULL if absent
+	int signedAttributesLength;
+	const unsigned char* signatureAlgorithm;  // Content of the AlgorithmIdentifier
+	int signatureAlgorithmLength;
+	const unsigned char* signature;
+	int signatureLength;
+	Certificate signer;	 // Document Signer certificate
+} SodInfo;
+
+// Signature verification of EF.SOD running next to the data group reads
+typedef struct {
+	const SodInfo* sod;
+	SyncThread worker;
+	int threaded;			// The worker thread was started
+	volatile long result;	// PA_PENDING until the verification is done
+} SodVerification;
+
+/**
+ * @brief Read EF.SOD over secure messaging.
+ *
+ * @param[in,out] session The secure messaging session, its SSC is updated.
+ * @param[out] sod Buffer receiving the content of EF.SOD (PA_MAX_SOD bytes).
+ * @param[out] sodLength Receives the length of the content.
+ *
+ * @return APP_SUCCESS if the file was read, otherwise an error code.
+ */
+long ReadSOD(SecureMessagingSession* session, unsigned char* sod, int* sodLength);
+
+/**
+ * @brief Decode EF.SOD.
+ *
+ * @param[in] sod Content of EF.SOD, it must outlive info.
+ * @param[in] sodLength Length of the content.
+ * @param[out] info Receives the data group hashes, the signature and the Document Signer
+ * certificate.
+ *
+ * @return APP_SUCCESS if EF.SOD is well formed and uses supported algorithms, otherwise APP_ERROR.
+ */
+int ParseSOD(const unsigned char* sod, int sodLength, SodInfo* info);
+
+/**
+ * @brief Verify the signature of EF.SOD with the Document Signer certificate.
+ *
+ * The message digest of the signed attributes must be the hash of the LDSSecurityObject, and the
+ * signature over the signed attributes must verify with the public key of the certificate.
+ *
+ * @return APP_SUCCESS if the signature is valid, otherwise APP_ERROR.
+ */
+long VerifySODSignature(const SodInfo* info);
+
+/**
+ * @brief Start VerifySODSignature on a worker thread.
+ *
+ * If a CSCA store is loaded, the Document Signer certificate is then verified with
+ * VerifyDocumentSigner. The verification runs on the calling thread if no thread can be created.
+ *
+ * @param[out] verification The verification, it must stay valid until FinishSODVerification.
+ * @param[in] info The decoded EF.SOD, it must stay valid until FinishSODVerification.
+ */
+void StartSODVerification(SodVerification* verification, const SodInfo* info);
+
+/**
+ * @brief Returns the result of the verification without waiting: PA_PENDING, APP_SUCCESS or
+ * APP_ERROR.
+ */
+long PollSODVerification(const SodVerification* verification);
+
+/**
+ * @brief Wait for the verification to finish.
+ * @return APP_SUCCESS if the signature is valid, otherwise APP_ERROR.
+ */
+long FinishSODVerification(SodVerification* verification);
+
+/**
+ * @brief Start the hash of a data group with the algorithm of EF.SOD.
+ *
+ * @param[in] info The decoded EF.SOD.
+ * @param[in] dataGroup Data group number.
+ * @param[out] dgHash The hash to feed with the content of the data group.
+ *
+ * @return APP_SUCCESS if EF.SOD lists the data group, otherwise APP_ERROR.
+ */
+int StartDataGroupHash(const SodInfo* info, int dataGroup, hash_ctx* dgHash);
+
+/**
+ * @brief Compare the hash of a data group with the hash listed in EF.SOD.
+ *
+ * @param[in] info The decoded EF.SOD.
+ * @param[in] dataGroup Data group number.
+ * @param[in,out] dgHash The hash fed with the whole content of the data group, finalized here.
+ *
+ * @return APP_SUCCESS if the hashes match, otherwise APP_ERROR.
+ */
+long CheckDataGroupHash(const SodInfo* info, int dataGroup, hash_ctx* dgHash);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	// #ifndef ACCESS_PASSIVE_AUTHENTICATION_H_
@@ -6,17 +6,202 @@
  * This file provides the interface for secure messaging between an application
  * and a smart card. It implements protected APDU commands for SELECT and READ BINARY operations,
  * using encryption and MAC calculation to ensure confidentiality and integrity of the
- * communication.
+ * communication. Both the 3DES secure messaging established by BAC and the AES secure messaging
+ * established by PACE are supported through a SecureMessagingSession.
  */
 
 #pragma once
 #ifndef ACCESS_SECURE_MESSAGE_H_
 #define ACCESS_SECURE_MESSAGE_H_
 
+#include <cryptography/hash.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#define SM_CIPHER_3DES			  0	 // 3DES-CBC encryption, ISO 9797-1 MAC algorithm 3
+#define SM_CIPHER_AES			  1	 // AES-CBC encryption, AES-CMAC truncated to 8 bytes
+
+#define SM_MAC_LENGTH			  8
+#define SM_MAX_KEY_LENGTH		  32
+#define SM_MAX_BLOCK_SIZE		  16
+#define SM_MAX_COMMAND_DATA		  255  // Short APDUs only
+#define SM_MAX_PROTECTED_COMMAND  300
+#define SM_MAX_PROTECTED_RESPONSE 320
+#define SM_MAX_READ_CHUNK		  256  // Bytes of a READ BINARY with a short Le
+#define SM_MAX_READ_OFFSET		  0x7FFF  // Highest offset of READ BINARY in P1-P2
+
+#define SM_KDF_ENCRYPT			  1	 // KDF counter for KS_Enc
+#define SM_KDF_MAC				  2	 // KDF counter for KS_MAC
+#define SM_KDF_PASSWORD			  3	 // KDF counter for the PACE password key K_pi
+
+#define SM_STATUS_FILE_NOT_FOUND  0x6A82  // Status word of a SELECT of a missing file
+
+// Session state of a secure messaging channel
+typedef struct {
+	int cipher;											   // SM_CIPHER_3DES or SM_CIPHER_AES
+	int keyLength;										   // Session key length in bytes
+	int blockSize;										   // 8 for 3DES, 16 for AES
+	unsigned char encryptKey[SM_MAX_KEY_LENGTH];		   // KS_Enc
+	unsigned char macKey[SM_MAX_KEY_LENGTH];			   // KS_MAC
+	unsigned char sendSequenceCounter[SM_MAX_BLOCK_SIZE];  // SSC, blockSize bytes
+	hash_ctx* readHash;									   // Hash of READ BINARY data, or NULL
+	int readChunk;										   // Bytes per READ BINARY on this link
+	unsigned int statusWord;							   // Verified status word of the last APDU
+} SecureMessagingSession;
+
+/**
+ * @brief Receives the content of an elementary file as it is read.
+ *
+ * @param data The next bytes of the file.
+ * @param length Number of bytes.
+ * @param offset Offset of data in the file.
+ * @param total Length of the file, known from the first chunk.
+ * @param context The context given to ReadElementaryFile.
+ *
+ * @return APP_SUCCESS to go on reading, otherwise the read stops with this error.
+ */
+typedef int (*ElementaryFileSink)(const unsigned char* data,
+								  int length,
+								  int offset,
+								  int total,
+								  void* context);
+
+/**
+ * @brief Initializes a secure messaging session.
+ *
+ * @param session Pointer to the session to initialize.
+ * @param cipher SM_CIPHER_3DES or SM_CIPHER_AES.
+ * @param encryptKey Session encryption key (KS_Enc).
+ * @param macKey Session MAC key (KS_MAC).
+ * @param keyLength Length of the session keys in bytes (16 for 3DES, 16, 24 or 32 for AES).
+ * @param sendSequenceCounter Initial Send Sequence Counter (blockSize bytes), or NULL to start
+ * from zero as PACE and Chip Authentication do.
+ */
+void SecureMessagingInit(SecureMessagingSession* session,
+						 int cipher,
+						 const unsigned char* encryptKey,
+						 const unsigned char* macKey,
+						 int keyLength,
+						 const unsigned char* sendSequenceCounter);
+
+/**
+ * @brief Derives a key from a shared secret (ICAO Doc 9303 Part 11, KDF).
+ *
+ * Keys for 3DES and AES-128 are taken from SHA-1(secret || counter), keys for AES-192 and AES-256
+ * from SHA-256(secret || counter).
+ *
+ * @param secret Pointer to the shared secret or password.
+ * @param secretLength Length of the secret in bytes.
+ * @param counter SM_KDF_ENCRYPT, SM_KDF_MAC or SM_KDF_PASSWORD.
+ * @param cipher SM_CIPHER_3DES or SM_CIPHER_AES.
+ * @param keyLength Length of the derived key in bytes.
+ * @param key Buffer receiving the derived key.
+ */
+void SecureMessagingKeyDerive(const unsigned char* secret,
+							  int secretLength,
+							  unsigned int counter,
+							  int cipher,
+							  int keyLength,
+							  unsigned char* key);
+
+/**
+ * @brief Computes the 8-byte MAC of the session cipher over data padded with ISO 9797-1 padding
+ * method 2.
+ *
+ * @param session Pointer to the session providing the cipher and KS_MAC.
+ * @param data Pointer to the data (not modified).
+ * @param length Length of the data in bytes.
+ * @param mac Buffer receiving the 8-byte MAC.
+ */
+void SecureMessagingChecksum(const SecureMessagingSession* session,
+							 const unsigned char* data,
+							 int length,
+							 unsigned char mac[SM_MAC_LENGTH]);
+
+/**
+ * @brief Protects a command APDU.
+ *
+ * The SSC is incremented, the command data (if any) is encrypted into DO'87', the expected length
+ * (if any) is put into DO'97' and the MAC is appended as DO'8E'.
+ *
+ * @param session Pointer to the session, its SSC is updated.
+ * @param cmd Unprotected command APDU (short length encoding).
+ * @param cmdLen Length of the unprotected command APDU.
+ * @param protectedCmd Buffer receiving the protected command APDU (SM_MAX_PROTECTED_COMMAND
+ * bytes).
+ * @param protectedCmdLen Receives the length of the protected command APDU.
+ *
+ * @return APP_SUCCESS if successful; otherwise APP_ERROR.
+ */
+int SecureMessagingWrap(SecureMessagingSession* session,
+						const unsigned char* cmd,
+						int cmdLen,
+						unsigned char* protectedCmd,
+						int* protectedCmdLen);
+
+/**
+ * @brief Verifies and decrypts a protected response APDU.
+ *
+ * The SSC is incremented, the MAC in DO'8E' is checked over DO'87' and DO'99', and the content of
+ * DO'87' is decrypted and unpadded.
+ *
+ * @param session Pointer to the session, its SSC is updated.
+ * @param res Protected response APDU including the trailing status word.
+ * @param resLen Length of the protected response APDU.
+ * @param data Buffer receiving the plain response data (unpadded, at most resLen bytes).
+ * @param dataLen Receives the length of the plain response data.
+ * @param statusWord Receives the status word protected in DO'99', may be NULL.
+ *
+ * @return APP_SUCCESS if the response is authentic; otherwise APP_ERROR.
+ */
+int SecureMessagingUnwrap(SecureMessagingSession* session,
+						  const unsigned char* res,
+						  int resLen,
+						  unsigned char* data,
+						  int* dataLen,
+						  unsigned int* statusWord);
+
+/**
+ * @brief Verifies and decrypts a protected command APDU, the card side of SecureMessagingWrap.
+ *
+ * The SSC is incremented, the MAC in DO'8E' is checked over the header, DO'87' and DO'97', and the
+ * unprotected command is rebuilt from the decrypted data and the expected length. Recorded
+ * sessions are replayed with it offline.
+ *
+ * @param session Pointer to the session, its SSC is updated.
+ * @param protectedCmd Protected command APDU.
+ * @param protectedCmdLen Length of the protected command APDU.
+ * @param cmd Buffer receiving the unprotected command APDU (SM_MAX_PROTECTED_COMMAND bytes).
+ * @param cmdLen Receives the length of the unprotected command APDU.
+ *
+ * @return APP_SUCCESS if the command is authentic; otherwise APP_ERROR.
+ */
+int SecureMessagingUnwrapCommand(SecureMessagingSession* session,
+								 const unsigned char* protectedCmd,
+								 int protectedCmdLen,
+								 unsigned char* cmd,
+								 int* cmdLen);
+
+/**
+ * @brief Sends a command APDU to the smart card over secure messaging.
+ *
+ * @param session Pointer to the session, its SSC is updated.
+ * @param cmd Unprotected command APDU (short length encoding).
+ * @param cmdLen Length of the unprotected command APDU.
+ * @param responseBuf Buffer receiving the plain response data.
+ * @param responseLen Receives the length of the plain response data.
+ *
+ * @return APP_SUCCESS if the card answered 90 00 (or 62 82 at the end of a file) with a valid MAC;
+ * otherwise an error code indicating failure reason.
+ */
+int ProtectedTransmitAPDU(SecureMessagingSession* session,
+						  const unsigned char* cmd,
+						  int cmdLen,
+						  unsigned char* responseBuf,
+						  int* responseLen);
+
 /**
  * @brief Sends a protected SELECT APDU command to the smart card.
  *
@@ -24,47 +209,99 @@ extern "C" {
  * and MAC calculation to ensure confidentiality and integrity of the communication.
  *
  * @param cmdData File identifier (2 bytes) to be selected by this command.
- * @param sendSequenceCounter Pointer to an 8-byte array representing the current Send Sequence
- * Counter (SSC).
- * @param encryptSessionKey Pointer to a 16-byte array containing the encryption session key
- * (KS_Enc).
- * @param macSessionKey Pointer to a 16-byte array containing the MAC session key (KS_MAC).
+ * @param session Pointer to the secure messaging session, its SSC is updated.
  *
  * @return APP_SUCCESS if successful; otherwise, an error code indicating failure reason.
  */
-int ProtectedSelectAPDU(unsigned char cmdData[2],
-						unsigned char* sendSequenceCounter,
-						unsigned char encryptSessionKey[16],
-						unsigned char macSessionKey[16]);
+int ProtectedSelectAPDU(unsigned char cmdData[2], SecureMessagingSession* session);
 
 /**
  * @brief Sends a protected READ BINARY APDU command to the smart card.
  *
  * This function sends a protected READ BINARY APDU command to the smart card using encryption
  * and MAC calculation to ensure confidentiality and integrity of the communication. The response
- * data will be decrypted and stored in the provided buffer.
+ * data will be decrypted and stored in the provided buffer, and hashed into session->readHash if
+ * it is set.
  *
  * @param cmdHeader Pointer to a 4-byte array representing the command header for the READ BINARY
  * operation.
- * @param resLen Length of expected response data in bytes.
+ * @param resLen Length of expected response data in bytes (0 for 256).
  * @param responseBuf Pointer to a buffer where the decrypted response data will be stored.
- * @param sendSequenceCounter Pointer to an 8-byte array representing the current Send Sequence
- * Counter (SSC).
- * @param encryptSessionKey Pointer to a 16-byte array containing the encryption session key
- * (KS_Enc).
- * @param macSessionKey Pointer to a 16-byte array containing the MAC session key (KS_MAC).
+ * @param session Pointer to the secure messaging session, its SSC is updated.
  *
  * @return APP_SUCCESS if successful; otherwise, an error code indicating failure reason.
  */
 int ProtectedReadBinaryAPDU(unsigned char cmdHeader[4],
 							unsigned char resLen,
 							unsigned char* responseBuf,
-							unsigned char* sendSequenceCounter,
-							unsigned char encryptSessionKey[16],
-							unsigned char macSessionKey[16]);
+							SecureMessagingSession* session);
+
+/**
+ * @brief Reads the whole content of an elementary file over secure messaging into a sink.
+ *
+ * The file content must be a single BER-TLV object, as all LDS files are. The first READ BINARY
+ * asks for session->readChunk bytes, the tag and length of the object (in any of the 1 to 4 byte
+ * length forms) give the length of the file, and the rest is read in the fewest READ BINARY
+ * commands of session->readChunk bytes. The content is hashed into session->readHash if it is set
+ * and passed to the sink chunk by chunk, nothing is buffered.
+ *
+ * @param fileId File identifier (2 bytes) of the elementary file, NULL if it is already selected.
+ * @param sink Receives the content.
+ * @param context Passed to the sink.
+ * @param fileLength Receives the length of the file content, may be NULL.
+ * @param session Pointer to the secure messaging session, its SSC is updated.
+ *
+ * @return APP_SUCCESS if successful; otherwise APP_ERROR or the error of the sink, also when the
+ * last chunk of the file would start above SM_MAX_READ_OFFSET.
+ */
+int ReadElementaryFile(unsigned char fileId[2],
+					   ElementaryFileSink sink,
+					   void* context,
+					   int* fileLength,
+					   SecureMessagingSession* session);
+
+/**
+ * @brief Reads the whole content of an elementary file identified by its short EF identifier.
+ *
+ * Same as ReadElementaryFile, but the first READ BINARY selects the file by its short EF
+ * identifier (1 to 30), which saves the SELECT command.
+ *
+ * @param shortFileId Short EF identifier of the elementary file.
+ * @param sink Receives the content.
+ * @param context Passed to the sink.
+ * @param fileLength Receives the length of the file content, may be NULL.
+ * @param session Pointer to the secure messaging session, its SSC is updated.
+ *
+ * @return APP_SUCCESS if successful; otherwise APP_ERROR or the error of the sink.
+ */
+int ReadShortElementaryFile(unsigned char shortFileId,
+							ElementaryFileSink sink,
+							void* context,
+							int* fileLength,
+							SecureMessagingSession* session);
+
+/**
+ * @brief Selects an elementary file and reads its whole content over secure messaging.
+ *
+ * Same as ReadElementaryFile with the content copied into a buffer.
+ *
+ * @param fileId File identifier (2 bytes) of the elementary file.
+ * @param fileBuf Buffer receiving the file content.
+ * @param fileBufSize Size of fileBuf in bytes.
+ * @param fileLength Receives the length of the file content.
+ * @param session Pointer to the secure messaging session, its SSC is updated.
+ *
+ * @return APP_SUCCESS if successful; otherwise APP_ERROR, also when the file does not fit in
+ * fileBuf.
+ */
+int ProtectedReadFile(unsigned char fileId[2],
+					  unsigned char* fileBuf,
+					  int fileBufSize,
+					  int* fileLength,
+					  SecureMessagingSession* session);
 
 #ifdef __cplusplus
 }
 #endif
 
-#endif	// #ifndef ACCESS_SECURE_MESSAGE_H_
\ No newline at end of file
+#endif	// #ifndef ACCESS_SECURE_MESSAGE_H_
@@ -12,17 +12,45 @@
 #ifndef CHIP_READER_H_
 #define CHIP_READER_H_
 
+#include <access/bac_queue.h>
+#include <access/bac_search.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// Outcome of Passive Authentication of a completed read, a higher value is a stronger result
+#define READ_PA_NOT_PERFORMED	0	 // The chip has no EF.SOD, the data groups are not verified
+#define READ_PA_CHAIN_UNCHECKED 1	 // EF.SOD verified, no CSCA store checked its Document Signer
+#define READ_PA_VERIFIED		2	 // EF.SOD and its Document Signer are verified
+
+// Callbacks of a read, called on the reading thread as each data group is done
+typedef struct {
+	// Called once a data group is read and, if verified, its hash agrees with EF.SOD; the fields
+	// are those of DG1 or DG13, NULL for DG2, and only valid during the call. The signature of
+	// EF.SOD may still be checked on its worker, the result of the read covers it.
+	void (*dataGroupRead)(int dataGroup,
+						  const DataGroupField fields[],
+						  int count,
+						  int verified,
+						  void* context);
+	ImageProgressCallback portraitProgress;	 // Progress of DG2, may be NULL
+	// Called once the read succeeded, with the READ_PA_* outcome of Passive Authentication
+	void (*passiveAuthentication)(int result, void* context);
+	void* context;
+} ReadCallbacks;
+
 /**
  * @brief Reads data from an ID card chip using Basic Access Control (BAC) protocol.
  *
  * Given the MRZ information, this function reads data from an ID card chip using the BAC protocol,
  * which includes initializing the reader, selecting applications, getting challenges, and reading
  * data groups (EF.COM, DG1, and DG2). This function works with a smart card reader and the
- * corresponding smart card that supports BAC protocol.
+ * corresponding smart card that supports BAC protocol. If the chip lists PACE in EF.CardAccess,
+ * PACE keyed by the MRZ is performed instead, falling back to BAC if it fails. Passive
+ * Authentication is only skipped when the chip reports in a verified response that it has no
+ * EF.SOD, any other failure to read EF.SOD fails the read. ReadIdCardChipWithCallbacks reports
+ * whether Passive Authentication was performed and whether the Document Signer was checked.
  *
  * @param[in] mrzInformation The MRZ information as an array of unsigned chars used for BAC
  authentication.
@@ -34,11 +62,110 @@ extern "C" {
  */
 long ReadIdCardChip(unsigned char mrzInformation[], unsigned char imageFilePath[]);
 
+/**
+ * @brief Reads the wanted data groups from an ID card chip.
+ *
+ * Same as ReadIdCardChip, but only the data groups of the mask that the tag list of EF.COM lists
+ * are read, so a text-only read (DG_MASK_TEXT) skips the transfer of the portrait.
+ *
+ * @param[in] mrzInformation The MRZ information as an array of unsigned chars used for BAC
+ authentication.
+ * @param[in] dataGroups The DG_MASK of the wanted data groups among DG_MASK_ALL.
+ * @param[out] imageFilePath The file path to the image file created when DG2 is read, may be NULL
+		   when DG2 is not wanted.
+ *
+ * @return A long value representing the status code. APP_SUCCESS indicates successful reading of
+		   data from the ID card chip, otherwise an error code is returned.
+ */
+long ReadIdCardChipDataGroups(unsigned char mrzInformation[],
+							  unsigned int dataGroups,
+							  unsigned char imageFilePath[]);
+
+/**
+ * @brief Reads the wanted data groups from an ID card chip, reporting each as it is done.
+ *
+ * Same as ReadIdCardChipDataGroups, but DG1 and DG13 are read before DG2 and their fields are
+ * passed to dataGroupRead as soon as their hashes are checked, so they can be shown while the
+ * portrait is transferred. The progress of DG2 is reported after each chunk, with the image file
+ * flushed so a partial JPEG can be decoded from it.
+ *
+ * @param[in] mrzInformation The MRZ information as an array of unsigned chars used for BAC
+ authentication.
+ * @param[in] dataGroups The DG_MASK of the wanted data groups among DG_MASK_ALL.
+ * @param[out] imageFilePath The file path to the image file created when DG2 is read, may be NULL
+		   when DG2 is not wanted.
+ * @param[in] callbacks The callbacks, any of them may be NULL.
+ *
+ * @return A long value representing the status code. APP_SUCCESS indicates successful reading of
+		   data from the ID card chip, otherwise an error code is returned.
+ */
+long ReadIdCardChipWithCallbacks(unsigned char mrzInformation[],
+								 unsigned int dataGroups,
+								 unsigned char imageFilePath[],
+								 const ReadCallbacks* callbacks);
+
+/**
+ * @brief Dumps every elementary file of an ID card chip into one container file.
+ *
+ * The session is established as in ReadIdCardChip, then EF.COM, EF.SOD and the data groups that
+ * EF.COM lists are written to a container with an index of their offsets, see lds_dump.h. The
+ * files are stored as read, neither parsed nor verified.
+ *
+ * @param[in] mrzInformation The MRZ information as an array of unsigned chars used for BAC
+ authentication.
+ * @param[in] dumpFilePath The container file to write.
+ *
+ * @return A long value representing the status code. APP_SUCCESS indicates the container was
+		   written, otherwise an error code is returned.
+ */
+long ReadIdCardChipDump(unsigned char mrzInformation[], const char* dumpFilePath);
+
+/**
+ * @brief Reads data from an ID card chip using PACE keyed by the Card Access Number (CAN).
+ *
+ * Same as ReadIdCardChip, but the password is the 6-digit CAN printed on the card. The chip must
+ * support PACE, as BAC cannot be keyed by the CAN.
+ *
+ * @param[in] cardAccessNumber The CAN as a null-terminated string of digits.
+ * @param[out] imageFilePath The file path to the image file that will be created after reading
+		   data from the ID card chip.
+ *
+ * @return A long value representing the status code. APP_SUCCESS indicates successful reading of
+		   data from the ID card chip, otherwise an error code is returned.
+ */
+long ReadIdCardChipWithCan(unsigned char cardAccessNumber[], unsigned char imageFilePath[]);
+
+/**
+ * @brief Reads data from an ID card chip with the TD1 MRZ text read by an OCR engine.
+ *
+ * The three lines are parsed with MrzTd1Parse and the keys that agree with the check digits are
+ * enumerated with MrzCandidatesGenerate, correcting the characters OCR engines confuse. They are
+ * tried most likely first, by PACE or by BAC with the attempts timed as in a document-number
+ * search. Nothing is sent to the card when the text holds no consistent key.
+ *
+ * @param[in] text The MRZ text, three lines of 30 characters.
+ * @param[in] length Length of the text.
+ * @param[in] confidence Confidence of each byte of the text from 0 to 100, or NULL.
+ * @param[out] imageFilePath The file path to the image file that will be created after reading
+		   data from the ID card chip.
+ *
+ * @return A long value representing the status code. APP_SUCCESS indicates successful reading of
+		   data from the ID card chip, otherwise an error code is returned.
+ */
+long ReadIdCardChipWithMrzText(const unsigned char* text,
+							   int length,
+							   const unsigned char* confidence,
+							   unsigned char imageFilePath[]);
+
 /*
  * @brief Reads data with only the document number instead of MRZ information.
  *
  * Given the document number, this function derives the holder's birth year and test possible birth
- * dates to find the correct one.
+ * dates and dates of expiry to find the correct one, most likely first, with the default model of
+ * BacSearchModelDefault. The keys of all candidates are derived before the first attempt, and the
+ * search stops if the card fails to give a challenge. When a key cache is open (see key_cache.h),
+ * the key learned at a previous read of the document number is tried first, and the key found by
+ * a search is learned.
  *
  * @param[in] documentNumber The document number as an array of 9 unsigned chars.
  * @param[out] imageFilePath The file path to the image file that will be created after reading data
@@ -50,6 +177,48 @@ long ReadIdCardChip(unsigned char mrzInformation[], unsigned char imageFilePath[
 long ReadIdCardChipWithDocumentNumber(unsigned char documentNumber[9],
 									  unsigned char imageFilePath[]);
 
+/*
+ * @brief Reads data with only the document number, with the priors of the given model.
+ *
+ * Same as ReadIdCardChipWithDocumentNumber, the candidates come from BacSearchCandidatesGenerate
+ * and model->maxAttempts bounds the number of EXTERNAL AUTHENTICATE commands. The attempts are
+ * scheduled by BacSearchSchedule: when the chip slows down after wrong keys, the application is
+ * selected again, the search pauses, or model->prompt asks the operator for the MRZ.
+ *
+ * @param[in] documentNumber The document number as an array of 9 unsigned chars.
+ * @param[in] model The priors and schedule of the search, NULL for BacSearchModelDefault.
+ * @param[out] imageFilePath The file path to the image file that will be created after reading data
+ * from the ID card chip.
+ * @param[out] stats Receives the statistics of the search on this card, may be NULL.
+ *
+ * @return A long value representing the status code. APP_SUCCESS indicates successful reading of
+ * data from the ID card chip, otherwise an error code is returned.
+ */
+long ReadIdCardChipWithSearchModel(unsigned char documentNumber[9],
+								   const BacSearchModel* model,
+								   unsigned char imageFilePath[],
+								   BacSearchStats* stats);
+
+/**
+ * @brief Reads data from an ID card chip whose MRZ was scanned ahead of time.
+ *
+ * The BAC keys pending in the queue are tried in the order of BacQueueSnapshot, with the attempts
+ * timed as in a document-number search, and the entry of the key the card accepts is removed from
+ * the queue. Readers on several threads may share one queue.
+ *
+ * @param[in,out] queue The pending set, see bac_queue.h.
+ * @param[out] imageFilePath The file path to the image file that will be created after reading data
+ * from the ID card chip.
+ * @param[out] matched Receives the entry the card matched, may be NULL. Only its id is set when
+ * another reader removed the entry first.
+ *
+ * @return A long value representing the status code. APP_SUCCESS indicates successful reading of
+ * data from the ID card chip, otherwise an error code is returned.
+ */
+long ReadIdCardChipFromQueue(BacQueue* queue,
+							 unsigned char imageFilePath[],
+							 BacQueueEntry* matched);
+
 #ifdef __cplusplus
 }
 #endif
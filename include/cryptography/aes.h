@@ -0,0 +1,77 @@
+/**
+ * @author Khoa Nguyen
+ * @file aes.h
+ * @brief Header file for AES block cipher.
+ *
+ * This header file provides APIs for AES-128, AES-192 and AES-256 encryption and decryption in
+ * Electronic Codebook (ECB) and Cipher Block Chaining (CBC) modes, as used by PACE and AES secure
+ * messaging.
+ */
+
+#pragma once
+#ifndef CRYPTOGRAPHY_AES_H_
+#define CRYPTOGRAPHY_AES_H_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AES_ENCRYPT	   1
+#define AES_DECRYPT	   0
+
+#define AES_BLOCK_SIZE	 (16)
+#define AES_KEY_LENGTH	 -0x0020  // Invalid key length
+#define AES_INPUT_LENGTH -0x0022  // The data input has an invalid length
+
+// AES context structure
+typedef struct {
+	int nr;				   // Number of rounds
+	unsigned int rk[68];  // Round keys
+} aes_context;
+
+// AES key schedule (encryption), keybits is 128, 192 or 256
+int aes_setkey_enc(aes_context* ctx, const unsigned char* key, unsigned int keybits);
+
+// AES key schedule (decryption), keybits is 128, 192 or 256
+int aes_setkey_dec(aes_context* ctx, const unsigned char* key, unsigned int keybits);
+
+// AES-ECB block encryption/decryption
+int aes_crypt_ecb(aes_context* ctx,
+				  int mode,
+				  const unsigned char input[16],
+				  unsigned char output[16]);
+
+// AES-CBC buffer encryption/decryption, length must be a multiple of 16
+int aes_crypt_cbc(aes_context* ctx,
+				  int mode,
+				  size_t length,
+				  unsigned char iv[16],
+				  const unsigned char* input,
+				  unsigned char* output);
+
+// AES-CBC buffer encryption API, klen is the key length in bytes
+unsigned int aes_cbc_encrypt(unsigned char* pout,
+							 const unsigned char* pdata,
+							 unsigned int nlen,
+							 const unsigned char* pkey,
+							 unsigned int klen,
+							 const unsigned char* piv);
+
+// AES-CBC buffer decryption API, klen is the key length in bytes
+unsigned int aes_cbc_decrypt(unsigned char* pout,
+							 const unsigned char* pdata,
+							 unsigned int nlen,
+							 const unsigned char* pkey,
+							 unsigned int klen,
+							 const unsigned char* piv);
+
+// Wipes the round keys of an AES context
+void aes_free(aes_context* ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	// #ifndef CRYPTOGRAPHY_AES_H_
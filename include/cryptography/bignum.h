@@ -0,0 +1,103 @@
+/**
+ * @author Khoa Nguyen
+ * @file bignum.h
+ * @brief Header file for multi-precision integer and Montgomery arithmetic.
+ *
+ * Numbers are stored as little-endian arrays of 32-bit limbs with an explicit limb count, so the
+ * same routines serve elliptic curve field elements and RSA/DH moduli. Modular arithmetic is done
+ * in Montgomery form through a mont_context prepared once per modulus.
+ */
+
+#pragma once
+#ifndef CRYPTOGRAPHY_BIGNUM_H_
+#define CRYPTOGRAPHY_BIGNUM_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BN_MAX_LIMBS 130	   // Enough for 4096-bit moduli
+#define BN_BAD_INPUT -0x0040  // The input does not fit or the modulus is invalid
+
+// Montgomery context for an odd modulus m
+typedef struct {
+	int n;							 // Number of limbs of the modulus
+	unsigned int m[BN_MAX_LIMBS];	 // Modulus
+	unsigned int mInv;				 // -m^-1 mod 2^32
+	unsigned int one[BN_MAX_LIMBS];	 // R mod m, with R = 2^(32 * n)
+	unsigned int rr[BN_MAX_LIMBS];	 // R^2 mod m
+} mont_context;
+
+// Load big-endian bytes into n limbs, returns BN_BAD_INPUT when the value does not fit
+int bn_read_binary(unsigned int* x, int n, const unsigned char* buf, int len);
+
+// Store n limbs as len big-endian bytes (truncating the most significant bytes if needed)
+void bn_write_binary(const unsigned int* x, int n, unsigned char* buf, int len);
+
+// Compare two numbers, returns -1, 0 or 1
+int bn_cmp(const unsigned int* a, const unsigned int* b, int n);
+
+// r = a + b, returns the carry
+unsigned int bn_add(unsigned int* r, const unsigned int* a, const unsigned int* b, int n);
+
+// r = a - b, returns the borrow
+unsigned int bn_sub(unsigned int* r, const unsigned int* a, const unsigned int* b, int n);
+
+// Returns 1 if a is zero
+int bn_is_zero(const unsigned int* a, int n);
+
+// Returns the number of significant bits of a
+int bn_bitlen(const unsigned int* a, int n);
+
+// r = cond ? a : b in constant time, cond must be 0 or 1
+void bn_select(unsigned int* r,
+			   const unsigned int* a,
+			   const unsigned int* b,
+			   int n,
+			   unsigned int cond);
+
+// r = a mod m (an limbs reduced by an n-limb modulus), slow, meant for setup code
+void bn_mod(unsigned int* r, const unsigned int* a, int an, const unsigned int* m, int n);
+
+// Prepare a Montgomery context, m must be odd
+int mont_init(mont_context* ctx, const unsigned int* m, int n);
+
+// r = a * b * R^-1 mod m
+void mont_mul(const mont_context* ctx,
+			  unsigned int* r,
+			  const unsigned int* a,
+			  const unsigned int* b);
+
+// r = a + b mod m
+void mont_add(const mont_context* ctx,
+			  unsigned int* r,
+			  const unsigned int* a,
+			  const unsigned int* b);
+
+// r = a - b mod m
+void mont_sub(const mont_context* ctx,
+			  unsigned int* r,
+			  const unsigned int* a,
+			  const unsigned int* b);
+
+// Convert a (< m) into Montgomery form
+void mont_to(const mont_context* ctx, unsigned int* r, const unsigned int* a);
+
+// Convert a out of Montgomery form
+void mont_from(const mont_context* ctx, unsigned int* r, const unsigned int* a);
+
+// r = a^e with a and r in Montgomery form, e has en limbs, constant time in the value of e
+void mont_exp(const mont_context* ctx,
+			  unsigned int* r,
+			  const unsigned int* a,
+			  const unsigned int* e,
+			  int en);
+
+// r = a^-1 with a and r in Montgomery form, m must be prime
+void mont_inv(const mont_context* ctx, unsigned int* r, const unsigned int* a);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	// #ifndef CRYPTOGRAPHY_BIGNUM_H_
@@ -0,0 +1,49 @@
+/**
+ * @author Khoa Nguyen
+ * @file chacha20.h
+ * @brief Header file for the ChaCha20 keystream.
+ *
+ * This header file provides the ChaCha20 block function of RFC 8439, used as the generator of the
+ * random nonces and keys of the access protocols, see utils/random.h.
+ */
+
+#pragma once
+#ifndef CRYPTOGRAPHY_CHACHA20_H_
+#define CRYPTOGRAPHY_CHACHA20_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CHACHA20_KEY_LENGTH		  32
+#define CHACHA20_NONCE_LENGTH	  12
+#define CHACHA20_BLOCK_LENGTH	  64
+
+#define CHACHA20_SELF_TEST_FAILED -0x0078  // The keystream disagrees with the known answer
+
+/**
+ * @brief Computes consecutive blocks of keystream.
+ *
+ * @param key Key (32 bytes).
+ * @param nonce Nonce (12 bytes).
+ * @param counter Block counter of the first block.
+ * @param output Buffer receiving blocks * CHACHA20_BLOCK_LENGTH bytes.
+ * @param blocks Number of blocks.
+ */
+void chacha20_keystream(const unsigned char key[CHACHA20_KEY_LENGTH],
+						const unsigned char nonce[CHACHA20_NONCE_LENGTH],
+						unsigned int counter,
+						unsigned char* output,
+						int blocks);
+
+/**
+ * @brief Known-answer test of RFC 8439, section 2.3.2.
+ * @return 0 if successful, CHACHA20_SELF_TEST_FAILED otherwise.
+ */
+int chacha20_self_test(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	// #ifndef CRYPTOGRAPHY_CHACHA20_H_
@@ -0,0 +1,37 @@
+/**
+ * @author Khoa Nguyen
+ * @file cmac.h
+ * @brief Header file for AES-CMAC message authentication code.
+ *
+ * This header file provides an API for calculating the checksum using CMAC (NIST SP 800-38B) with
+ * AES encryption, which is the MAC algorithm of PACE and AES secure messaging.
+ */
+
+#pragma once
+#ifndef CRYPTOGRAPHY_CMAC_H_
+#define CRYPTOGRAPHY_CMAC_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Calculates AES-CMAC of the input data.
+ *
+ * @param length Length of the input data.
+ * @param buff Buffer to store the calculated checksum (16 bytes).
+ * @param data Input data for which the checksum is to be calculated. It is not modified.
+ * @param key Encryption key used in the calculation.
+ * @param keyLength Length of the key in bytes (16, 24 or 32).
+ */
+void aes_cmac_checksum(int length,
+					   unsigned char buff[16],
+					   const unsigned char* data,
+					   const unsigned char* key,
+					   int keyLength);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	// #ifndef CRYPTOGRAPHY_CMAC_H_
@@ -0,0 +1,50 @@
+/**
+ * @author Khoa Nguyen
+ * @file cpu_features.h
+ * @brief Header file for runtime CPU feature detection.
+ *
+ * This header file provides the instruction set extensions used to dispatch the cryptographic
+ * kernels at runtime. The library is built for the baseline instruction set, the functions using
+ * an extension are compiled with CPU_TARGET and only called when cpu_features reports it.
+ */
+
+#pragma once
+#ifndef CRYPTOGRAPHY_CPU_FEATURES_H_
+#define CRYPTOGRAPHY_CPU_FEATURES_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CPU_X86 1
+#else
+#define CPU_X86 0
+#endif
+
+// MSVC accepts intrinsics of any extension, GCC and Clang need them enabled per function
+#if defined(__GNUC__) || defined(__clang__)
+#define CPU_TARGET(x) __attribute__((target(x)))
+#else
+#define CPU_TARGET(x)
+#endif
+
+#define CPU_FEATURE_SSSE3  0x01
+#define CPU_FEATURE_SSE41  0x02
+#define CPU_FEATURE_AVX2   0x04
+#define CPU_FEATURE_SHA	   0x08	 // SHA-1 and SHA-256 extensions
+#define CPU_FEATURE_AVX512 0x10	 // AVX-512 F and BW
+
+/**
+ * @brief Returns the CPU_FEATURE_* flags of the running processor.
+ *
+ * The CPUID leaves are queried on the first call, AVX2 and AVX-512 are only reported when the
+ * operating system saves the extended registers.
+ */
+unsigned int cpu_features(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	// #ifndef CRYPTOGRAPHY_CPU_FEATURES_H_
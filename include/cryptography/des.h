@@ -11,10 +11,13 @@
  * - DES-ECB
  * - DES-CBC
  * - 3DES-ECB
- * - 3DES-CBC
+ * - 3DES-CBC, with multi-block decryption kernels dispatched at runtime
+ * - DES/3DES-ECB of independent blocks under different keys in one call, see des_batch.h
  */
 
 #pragma once
+#include <stddef.h>
+
 #include "typedef.h"
 
 #ifndef CRYPTOGRAPHY_DES3_H_
@@ -26,17 +29,21 @@ extern "C" {
 
 #define MBEDTLS_DES_ENCRYPT					 1
 #define MBEDTLS_DES_DECRYPT					 0
-#define MBEDTLS_ERR_DES_INVALID_INPUT_LENGTH 0
+#define MBEDTLS_ERR_DES_INVALID_INPUT_LENGTH DES_INPUT_LENGTH
 
 #define USE_DES_EN							 1	// Use DES
 #define USE_DES_ECB_EN						 1	// ECB mode using DES
 #define USE_DES_CBC_EN						 0	// CBC mode using DES
 
 #define USE_3DES_EN							 1	// Use 3DES
-#define USE_3DES_ECB_EN						 0	// ECB mode using 3DES
+#define USE_3DES_ECB_EN						 1	// ECB mode using 3DES
 #define USE_3DES_CBC_EN						 1	// CBC mode using 3DES
 
 #define DES_INPUT_LENGTH					 -0x0002  // The data input has an invalid length
+#define DES_SELF_TEST_FAILED				 -0x0004  // A kernel disagrees with the reference
+#define DES_KEY_LENGTH						 -0x0006  // The 3DES key is neither 16 nor 24 bytes
+
+#define DES_MULTI_LANES					 8	// Blocks of one des_crypt_ecb_multi call
 
 #define MBEDTLS_DES_KEY_SIZE				 8
 #define DES_KEY_SIZE						 (8)
@@ -62,6 +69,37 @@ unsigned int des_ecb_decrypt(unsigned char* pout,
 typedef struct {
 	uint32_t sk[32];  // DES subkeys
 } des_context;
+
+// DES key schedule for encryption
+int des_setkey_enc(des_context* ctx, const unsigned char key[DES_KEY_SIZE]);
+
+// DES key schedule for decryption
+int des_setkey_dec(des_context* ctx, const unsigned char key[DES_KEY_SIZE]);
+
+// Clears the subkeys
+void des_free(des_context* ctx);
+
+#if (USE_DES_ECB_EN || USE_DES_CBC_EN)
+// DES of one block with the subkeys of the context
+int des_crypt_ecb(des_context* ctx, const unsigned char input[8], unsigned char output[8]);
+#endif	// #if (USE_DES_ECB_EN || USE_DES_CBC_EN)
+
+#if USE_DES_ECB_EN
+/**
+ * @brief DES-ECB encryption with a prepared key schedule, never allocates.
+ *
+ * @param ctx Subkeys for encryption.
+ * @param input Input data, a last partial block is padded with zeros.
+ * @param length Length of the input data.
+ * @param output Buffer receiving the length rounded up to a multiple of 8.
+ *
+ * @return 0.
+ */
+int des_ecb_encrypt_ctx(des_context* ctx,
+						const unsigned char* input,
+						size_t length,
+						unsigned char* output);
+#endif	// #if USE_DES_ECB_EN
 #endif
 
 #if USE_DES_CBC_EN
@@ -80,7 +118,59 @@ unsigned int des_cbc_encrypt(unsigned char* pout,
 #endif	// #if USE_DES_EN
 
 #if USE_3DES_EN
+// Triple-DES context structure
+typedef struct {
+	uint32_t sk[96];  // 3DES subkeys
+} des3_context;
+
+// 3DES-EDE2 key schedule for encryption
+int des3_set2key_enc(des3_context* ctx, const unsigned char key[DES_KEY_SIZE * 2]);
+
+// 3DES-EDE2 key schedule for decryption
+int des3_set2key_dec(des3_context* ctx, const unsigned char key[DES_KEY_SIZE * 2]);
+
+// 3DES-EDE3 key schedule for encryption
+int des3_set3key_enc(des3_context* ctx, const unsigned char key[DES_KEY_SIZE * 3]);
+
+// 3DES-EDE3 key schedule for decryption
+int des3_set3key_dec(des3_context* ctx, const unsigned char key[DES_KEY_SIZE * 3]);
+
+/**
+ * @brief 3DES key schedule of a key of either length.
+ *
+ * @param ctx Context receiving the subkeys.
+ * @param mode MBEDTLS_DES_ENCRYPT or MBEDTLS_DES_DECRYPT.
+ * @param key 3DES key.
+ * @param keyLength DES3_KEY2_SIZE or DES3_KEY3_SIZE.
+ *
+ * @return 0 if successful, DES_KEY_LENGTH otherwise.
+ */
+int des3_setkey(des3_context* ctx, int mode, const unsigned char* key, unsigned int keyLength);
+
+// Clears the subkeys
+void des3_free(des3_context* ctx);
+
+#if (USE_3DES_ECB_EN || USE_3DES_CBC_EN)
+// 3DES of one block with the subkeys of the context
+int des3_crypt_ecb(des3_context* ctx, const unsigned char input[8], unsigned char output[8]);
+#endif	// #if (USE_3DES_ECB_EN || USE_3DES_CBC_EN)
+
 #if USE_3DES_ECB_EN
+/**
+ * @brief 3DES-ECB encryption with a prepared key schedule, never allocates.
+ *
+ * @param ctx Subkeys for encryption.
+ * @param input Input data, a last partial block is padded with zeros.
+ * @param length Length of the input data.
+ * @param output Buffer receiving the length rounded up to a multiple of 8.
+ *
+ * @return 0.
+ */
+int des3_ecb_encrypt_ctx(des3_context* ctx,
+						 const unsigned char* input,
+						 size_t length,
+						 unsigned char* output);
+
 // 3DES-ECB buffer encryption API
 unsigned int des3_ecb_encrypt(unsigned char* pout,
 							  unsigned char* pdata,
@@ -97,6 +187,42 @@ unsigned int des3_ecb_decrypt(unsigned char* pout,
 #endif	// #if USE_3DES_ECB_EN
 
 #if USE_3DES_CBC_EN
+/**
+ * @brief 3DES-CBC with a prepared key schedule, never allocates.
+ *
+ * @param ctx Subkeys for the direction of mode.
+ * @param mode MBEDTLS_DES_ENCRYPT or MBEDTLS_DES_DECRYPT.
+ * @param length Length of the input data, a multiple of 8.
+ * @param iv Chaining value (8 bytes), updated for a following call.
+ * @param input Input data.
+ * @param output Buffer receiving length bytes, may be the input.
+ *
+ * @return 0 if successful, DES_INPUT_LENGTH otherwise.
+ */
+int des3_crypt_cbc(des3_context* ctx,
+				   int mode,
+				   size_t length,
+				   unsigned char iv[8],
+				   const unsigned char* input,
+				   unsigned char* output);
+
+/**
+ * @brief 3DES-CBC encryption of any length with a prepared key schedule, never allocates.
+ *
+ * @param ctx Subkeys for encryption.
+ * @param iv Chaining value (8 bytes), updated for a following call.
+ * @param input Input data, a last partial block is padded with zeros.
+ * @param length Length of the input data.
+ * @param output Buffer receiving the length rounded up to a multiple of 8.
+ *
+ * @return 0.
+ */
+int des3_cbc_encrypt_ctx(des3_context* ctx,
+						 unsigned char iv[8],
+						 const unsigned char* input,
+						 size_t length,
+						 unsigned char* output);
+
 // 3DES-CBC buffer encryption API
 unsigned int des3_cbc_encrypt(unsigned char* pout,
 							  unsigned char* pdata,
@@ -112,6 +238,42 @@ unsigned int des3_cbc_decrypt(unsigned char* pout,
 							  unsigned char* pkey,
 							  unsigned int klen,
 							  unsigned char* piv);
+
+/**
+ * @brief Known-answer test of the 3DES-CBC decryption kernels.
+ *
+ * CBC decryption runs several blocks at once, interleaved in scalar code or in the lanes of
+ * AVX2 registers. Each kernel is checked against a known answer and against the single-block
+ * implementation. A kernel that fails is never dispatched.
+ *
+ * @return 0 if all kernels available on this CPU pass, DES_SELF_TEST_FAILED otherwise.
+ */
+int des3_self_test(void);
+
+/**
+ * @brief DES or 3DES-ECB of independent blocks, each under its own key schedule.
+ *
+ * Up to DES_MULTI_LANES blocks go through the lanes of one AVX2 kernel call, which costs about as
+ * much as a single block. This lets blocks of different sessions share one call.
+ *
+ * @param sk Subkeys of each block, 32 words of a des_context (passes = 1) or 96 words of a
+ * des3_context (passes = 3), for encryption or decryption.
+ * @param passes 1 for DES, 3 for 3DES.
+ * @param input Input block of each lane (8 bytes).
+ * @param output Output block of each lane (8 bytes), may be its input block.
+ * @param count Number of blocks, at most DES_MULTI_LANES.
+ */
+void des_crypt_ecb_multi(const uint32_t* const sk[],
+						 int passes,
+						 const unsigned char* const input[],
+						 unsigned char* const output[],
+						 int count);
+
+/**
+ * @brief Number of blocks des_crypt_ecb_multi computes for the cost of one on this CPU.
+ * @return DES_MULTI_LANES with the AVX2 kernel, 1 otherwise.
+ */
+int des_crypt_ecb_multi_lanes(void);
 #endif	// #if USE_3DES_CBC_EN
 #endif	// #if USE_3DES_EN
 
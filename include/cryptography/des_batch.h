@@ -0,0 +1,91 @@
+/**
+ * @author Khoa Nguyen
+ * @file des_batch.h
+ * @brief Header file for the cross-session DES batching engine.
+ *
+ * A host with many readers runs many BAC sessions at once, each computing MAC3 and 3DES-CBC over a
+ * few blocks at a time. The engine queues the pending blocks of all sessions, each block with the
+ * key schedule of its session, and computes up to DES_MULTI_LANES of them per des_crypt_ecb_multi
+ * call. A batch is computed as soon as it is full, as soon as every session inside a call of the
+ * engine is waiting on it, or once its first block has waited for the configured latency. The
+ * independent blocks of a call, those of a CBC decryption, are submitted at once.
+ *
+ * Reader threads call des_batch_attach before their session starts and des_batch_detach after it
+ * ends. With at most one attached session, when no other session is inside a call, or on a CPU
+ * without a multi-lane kernel, the blocks are computed immediately.
+ */
+
+#pragma once
+#ifndef CRYPTOGRAPHY_DES_BATCH_H_
+#define CRYPTOGRAPHY_DES_BATCH_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DES_BATCH_LATENCY_US 50	 // Default bound on the wait of a block for other sessions
+
+// Counters of the engine, blocks / calls is the average number of lanes used
+typedef struct {
+	unsigned long long blocks;	// Blocks computed in batches
+	unsigned long long calls;	// Calls of des_crypt_ecb_multi
+} des_batch_stats;
+
+/**
+ * @brief Registers a session of the calling thread with the engine.
+ */
+void des_batch_attach(void);
+
+/**
+ * @brief Unregisters a session, the blocks waiting for it are computed.
+ */
+void des_batch_detach(void);
+
+/**
+ * @brief Sets the longest time a block waits for the blocks of other sessions.
+ * @param microseconds The bound, 0 computes every batch immediately.
+ */
+void des_batch_set_latency(unsigned int microseconds);
+
+/**
+ * @brief Reads the counters of the engine.
+ */
+void des_batch_get_stats(des_batch_stats* stats);
+
+/**
+ * @brief Calculates ISO 9797 MAC algorithm 3 with DES through the engine, as des_mac3_checksum.
+ *
+ * @param key Encryption key used in the calculation (16 bytes).
+ * @param data Padded input data, it is not modified.
+ * @param length Length of the input data, a positive multiple of 8.
+ * @param mac Buffer to store the calculated checksum (8 bytes).
+ *
+ * @return 0 if successful, DES_INPUT_LENGTH otherwise.
+ */
+int des_batch_mac3(const unsigned char key[16],
+				   const unsigned char* data,
+				   int length,
+				   unsigned char mac[8]);
+
+/**
+ * @brief 3DES-EDE2 CBC with a zero IV through the engine.
+ *
+ * @param mode MBEDTLS_DES_ENCRYPT or MBEDTLS_DES_DECRYPT.
+ * @param key Encryption key (16 bytes).
+ * @param input Input data.
+ * @param length Length of the input data, a multiple of 8.
+ * @param output Buffer receiving length bytes, may be the input.
+ *
+ * @return 0 if successful, DES_INPUT_LENGTH otherwise.
+ */
+int des_batch_cbc(int mode,
+				  const unsigned char key[16],
+				  const unsigned char* input,
+				  int length,
+				  unsigned char* output);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	// #ifndef CRYPTOGRAPHY_DES_BATCH_H_
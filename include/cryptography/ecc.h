@@ -0,0 +1,135 @@
+/**
+ * @author Khoa Nguyen
+ * @file ecc.h
+ * @brief Header file for elliptic curve arithmetic over prime fields.
+ *
+ * This header file provides point arithmetic on short Weierstrass curves y^2 = x^3 + ax + b, the
+ * standardized Brainpool and NIST domain parameters of BSI TR-03110 / ICAO Doc 9303 Part 11, and
+ * the scalar multiplications needed by ECDH key agreement:
+ * - Fixed-base multiplication with a precomputed comb table of the generator
+ * - Variable-base multiplication with a constant-time Montgomery ladder
+ *
+ * ECDSA signature verification for Active Authentication is built on the same two multiplications.
+ */
+
+#pragma once
+#ifndef CRYPTOGRAPHY_ECC_H_
+#define CRYPTOGRAPHY_ECC_H_
+
+#include <cryptography/bignum.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ECC_MAX_LIMBS	  17  // 521-bit curves
+#define ECC_MAX_BYTES	  66
+#define ECC_COMB_WIDTH	  5
+#define ECC_COMB_POINTS	  (1 << ECC_COMB_WIDTH)
+
+#define ECC_BAD_INPUT	  -0x0050  // Invalid point encoding or parameters
+#define ECC_NOT_ON_CURVE  -0x0052  // The point does not satisfy the curve equation
+#define ECC_INFINITY	  -0x0054  // The result is the point at infinity
+#define ECC_BAD_SIGNATURE -0x0056  // The signature does not verify
+
+// Point in Jacobian coordinates (X / Z^2, Y / Z^3), coordinates in Montgomery form, Z = 0 for the
+// point at infinity
+typedef struct {
+	unsigned int x[ECC_MAX_LIMBS];
+	unsigned int y[ECC_MAX_LIMBS];
+	unsigned int z[ECC_MAX_LIMBS];
+} ecc_point;
+
+// Curve domain parameters
+typedef struct {
+	int id;							  // Standardized domain parameter ID, 0 for explicit ones
+	int byteLength;					  // Length of a field element in bytes
+	int orderByteLength;			  // Length of a scalar in bytes
+	int orderBits;					  // Bit length of the group order
+	mont_context field;				  // Arithmetic modulo p
+	mont_context order;				  // Arithmetic modulo the group order n
+	unsigned int a[ECC_MAX_LIMBS];	  // Coefficient a (Montgomery form)
+	unsigned int b[ECC_MAX_LIMBS];	  // Coefficient b (Montgomery form)
+	int aIsMinusThree;				  // Enables the faster doubling formula
+	ecc_point g;					  // Generator
+	int combReady;					  // Set once the comb table below is computed
+	unsigned int comb[ECC_COMB_POINTS][2][ECC_MAX_LIMBS];  // Affine multiples of g
+} ecc_group;
+
+/**
+ * @brief Returns the curve of a standardized domain parameter ID (8 to 18).
+ * @param id Standardized domain parameter ID.
+ * @return Pointer to the shared, initialized group or NULL if the ID is not an elliptic curve.
+ */
+const ecc_group* ecc_group_get(int id);
+
+/**
+ * @brief Loads explicit curve domain parameters (big-endian byte strings).
+ * @return 0 if successful, ECC_BAD_INPUT otherwise.
+ */
+int ecc_group_load(ecc_group* grp,
+				   const unsigned char* p,
+				   int pLen,
+				   const unsigned char* a,
+				   int aLen,
+				   const unsigned char* b,
+				   int bLen,
+				   const unsigned char* g,
+				   int gLen,
+				   const unsigned char* n,
+				   int nLen);
+
+// Decode an uncompressed point (0x04 || X || Y) and check that it lies on the curve
+int ecc_point_read(const ecc_group* grp, ecc_point* pt, const unsigned char* buf, int len);
+
+// Encode a point uncompressed, returns the encoded length or ECC_INFINITY
+int ecc_point_write(const ecc_group* grp, const ecc_point* pt, unsigned char* buf);
+
+// Affine x-coordinate of a point as byteLength big-endian bytes
+int ecc_point_x(const ecc_group* grp, const ecc_point* pt, unsigned char* x);
+
+// Returns 1 if the point is the point at infinity
+int ecc_is_infinity(const ecc_group* grp, const ecc_point* pt);
+
+// R = P + Q
+void ecc_add(const ecc_group* grp, ecc_point* r, const ecc_point* p, const ecc_point* q);
+
+// R = k * P with a constant-time Montgomery ladder
+int ecc_mul(const ecc_group* grp,
+			ecc_point* r,
+			const unsigned char* k,
+			int kLen,
+			const ecc_point* p);
+
+// R = k * G using the precomputed comb table of the generator
+int ecc_mul_base(const ecc_group* grp, ecc_point* r, const unsigned char* k, int kLen);
+
+// Derive a private key in [1, n - 1] from random bytes (at least orderByteLength + 8 of them)
+int ecc_gen_private(const ecc_group* grp,
+					unsigned char* d,
+					const unsigned char* random,
+					int randomLen);
+
+/**
+ * @brief Verifies an ECDSA signature.
+ *
+ * @param grp The curve of the public key.
+ * @param q The public key.
+ * @param hash The message digest, truncated to the bit length of the group order if longer.
+ * @param hashLen Length of the digest in bytes.
+ * @param r Big-endian r, orderByteLength bytes.
+ * @param s Big-endian s, orderByteLength bytes.
+ * @return 0 if the signature is valid, ECC_BAD_SIGNATURE otherwise.
+ */
+int ecdsa_verify(const ecc_group* grp,
+				 const ecc_point* q,
+				 const unsigned char* hash,
+				 int hashLen,
+				 const unsigned char* r,
+				 const unsigned char* s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	// #ifndef CRYPTOGRAPHY_ECC_H_
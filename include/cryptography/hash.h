@@ -0,0 +1,77 @@
+/**
+ * @author Khoa Nguyen
+ * @file hash.h
+ * @brief Header file for hashing with an algorithm chosen at runtime.
+ *
+ * This header file provides one init/update/final API over SHA-1 and the SHA-2 family, for the
+ * protocols that learn the hash algorithm from the chip: the data group hashes of EF.SOD and the
+ * signatures of Active Authentication.
+ */
+
+#pragma once
+#ifndef CRYPTOGRAPHY_HASH_H_
+#define CRYPTOGRAPHY_HASH_H_
+
+#include <cryptography/sha1.h>
+#include <cryptography/sha256.h>
+#include <cryptography/sha512.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HASH_SHA1			   1
+#define HASH_SHA224			   2
+#define HASH_SHA256			   3
+#define HASH_SHA384			   4
+#define HASH_SHA512			   5
+
+#define HASH_MAX_DIGEST_LENGTH SHA512_DIGEST_LENGTH
+
+#define HASH_BAD_ALGORITHM	   -0x0076	// Unknown HASH_* identifier
+
+// Streaming context of any of the algorithms
+typedef struct {
+	int algorithm;	// HASH_*
+	union {
+		sha1_ctx sha1;
+		sha256_ctx sha256;	// SHA-224 and SHA-256
+		sha512_ctx sha512;	// SHA-384 and SHA-512
+	} ctx;
+} hash_ctx;
+
+/**
+ * @brief Returns the digest length of a HASH_* algorithm in bytes, 0 if it is unknown.
+ */
+int hash_length(int algorithm);
+
+/**
+ * @brief Starts a new hash.
+ * @return 0 if successful, HASH_BAD_ALGORITHM otherwise.
+ */
+int hash_init(hash_ctx* ctx, int algorithm);
+
+/**
+ * @brief Hashes the next part of the message.
+ */
+void hash_update(hash_ctx* ctx, const unsigned char* input, long long length);
+
+/**
+ * @brief Writes the hash of the message, hash_length(ctx->algorithm) bytes.
+ */
+void hash_final(hash_ctx* ctx, unsigned char* output);
+
+/**
+ * @brief Computes the hash of a whole message.
+ * @return The digest length if successful, HASH_BAD_ALGORITHM otherwise.
+ */
+int hash_compute(int algorithm,
+				 const unsigned char* input,
+				 long long length,
+				 unsigned char* output);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	// #ifndef CRYPTOGRAPHY_HASH_H_
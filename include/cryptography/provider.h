@@ -0,0 +1,163 @@
+/**
+ * @author Khoa Nguyen
+ * @file provider.h
+ * @brief Header file for the pluggable cryptography providers.
+ *
+ * The symmetric primitives of secure messaging (DES, 3DES-CBC, MAC3 and SHA-1) are called through
+ * this layer instead of a fixed implementation. A provider is a table of functions with a mask of
+ * the primitives it implements. The built-in provider wraps the kernels of this library, and the
+ * OpenSSL provider wraps libcrypto when the library is configured with USE_OPENSSL.
+ *
+ * Before the first use, every provider is checked against the built-in one and timed on each
+ * primitive, and the fastest one is selected per primitive. The selection can be changed at any
+ * time with crypto_provider_select, for instance to compare the providers in production.
+ */
+
+#pragma once
+#ifndef CRYPTOGRAPHY_PROVIDER_H_
+#define CRYPTOGRAPHY_PROVIDER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CRYPTO_ENCRYPT				 1		  // MBEDTLS_DES_ENCRYPT
+#define CRYPTO_DECRYPT				 0		  // MBEDTLS_DES_DECRYPT
+
+#define CRYPTO_DES_ECB				 0		  // Single DES block
+#define CRYPTO_DES3_CBC				 1		  // 3DES-EDE2 CBC with a zero IV
+#define CRYPTO_MAC3					 2		  // ISO 9797 MAC algorithm 3 with DES
+#define CRYPTO_SHA1					 3		  // SHA-1
+#define CRYPTO_PRIMITIVES			 4		  // Number of primitives
+#define CRYPTO_ALL					 -1		  // Every primitive, for crypto_provider_select
+
+#define CRYPTO_CAP(primitive)		 (1u << (primitive))
+#define CRYPTO_CAP_ALL				 ((1u << CRYPTO_PRIMITIVES) - 1)
+
+#define CRYPTO_PROVIDER_MAX			 4		  // Registered providers
+
+#define CRYPTO_PROVIDER_INPUT_LENGTH -0x0002  // DES_INPUT_LENGTH
+#define CRYPTO_PROVIDER_NOT_FOUND	 -0x0080  // No provider has this name
+#define CRYPTO_PROVIDER_UNSUPPORTED	 -0x0082  // The provider lacks the primitive
+#define CRYPTO_PROVIDER_FULL		 -0x0084  // CRYPTO_PROVIDER_MAX providers are registered
+#define CRYPTO_PROVIDER_FAILED		 -0x0086  // The backend reported an error
+
+// A cryptography backend, the functions of primitives outside the mask may be NULL
+typedef struct {
+	const char* name;
+	unsigned int capabilities;	// CRYPTO_CAP of the implemented primitives
+
+	// One block of DES with an 8-byte key, mode is CRYPTO_ENCRYPT or CRYPTO_DECRYPT
+	int (*des_ecb)(int mode,
+				   const unsigned char key[8],
+				   const unsigned char input[8],
+				   unsigned char output[8]);
+
+	// 3DES-EDE2 CBC with a 16-byte key and a zero IV, the length is a multiple of 8
+	int (*des3_cbc)(int mode,
+					const unsigned char key[16],
+					const unsigned char* input,
+					int length,
+					unsigned char* output);
+
+	// MAC3 of padded data with a 16-byte key, the length is a positive multiple of 8
+	int (*mac3)(const unsigned char key[16],
+				const unsigned char* data,
+				int length,
+				unsigned char mac[8]);
+
+	// SHA-1 digest (20 bytes)
+	int (*sha1)(const unsigned char* input, long long length, unsigned char output[20]);
+} crypto_provider;
+
+/**
+ * @brief Registers the providers built into the library and selects the fastest ones.
+ *
+ * Called by the first cryptography call, readers call it before their sessions start so that the
+ * timing is not disturbed by the batching of concurrent sessions.
+ */
+void crypto_provider_init(void);
+
+/**
+ * @brief Registers an additional provider, it is used once selected by crypto_provider_select or
+ * crypto_provider_benchmark.
+ * @param provider The provider, it must stay valid while the library is used.
+ * @return 0 if successful, CRYPTO_PROVIDER_FULL otherwise.
+ */
+int crypto_provider_register(const crypto_provider* provider);
+
+/**
+ * @brief Times every provider on every primitive it implements and selects the fastest.
+ *
+ * A provider whose output differs from the built-in provider is never selected.
+ */
+void crypto_provider_benchmark(void);
+
+/**
+ * @brief Selects the provider of a primitive, the calls already running finish with the old one.
+ * @param primitive CRYPTO_DES_ECB to CRYPTO_SHA1, or CRYPTO_ALL.
+ * @param name Name of a registered provider, "builtin" or "openssl".
+ * @return 0 if successful, CRYPTO_PROVIDER_NOT_FOUND or CRYPTO_PROVIDER_UNSUPPORTED otherwise.
+ */
+int crypto_provider_select(int primitive, const char* name);
+
+/**
+ * @brief Name of the provider selected for a primitive, or NULL for an unknown primitive.
+ */
+const char* crypto_provider_selected(int primitive);
+
+/**
+ * @brief Result of the last benchmark.
+ * @return Nanoseconds per call of the primitive with the provider, -1 if it was not timed.
+ */
+long long crypto_provider_timing(const char* name, int primitive);
+
+/**
+ * @brief DES of one block with the selected provider.
+ * @return 0 if successful, a negative error code otherwise.
+ */
+int crypto_des_ecb(int mode,
+				   const unsigned char key[8],
+				   const unsigned char input[8],
+				   unsigned char output[8]);
+
+/**
+ * @brief 3DES-EDE2 CBC with a zero IV with the selected provider.
+ * @return 0 if successful, a negative error code otherwise.
+ */
+int crypto_des3_cbc(int mode,
+					const unsigned char key[16],
+					const unsigned char* input,
+					int length,
+					unsigned char* output);
+
+/**
+ * @brief MAC3 of padded data with the selected provider.
+ * @return 0 if successful, a negative error code otherwise.
+ */
+int crypto_mac3(const unsigned char key[16],
+				const unsigned char* data,
+				int length,
+				unsigned char mac[8]);
+
+/**
+ * @brief SHA-1 with the selected provider.
+ * @return 0 if successful, a negative error code otherwise.
+ */
+int crypto_sha1(const unsigned char* input, long long length, unsigned char output[20]);
+
+/**
+ * @brief Built-in provider, registered by crypto_provider_init.
+ */
+const crypto_provider* crypto_provider_builtin(void);
+
+/**
+ * @brief OpenSSL libcrypto provider, NULL when the library is built without USE_OPENSSL.
+ */
+const crypto_provider* crypto_provider_openssl(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	// #ifndef CRYPTOGRAPHY_PROVIDER_H_
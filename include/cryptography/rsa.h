@@ -0,0 +1,56 @@
+/**
+ * @author Khoa Nguyen
+ * @file rsa.h
+ * @brief Header file for the RSA public key operation.
+ *
+ * This header file provides the RSA public key operation used to verify the signatures of Active
+ * Authentication. The Montgomery context of the modulus is prepared once by rsa_set_public, so a
+ * context kept across calls only pays for the exponentiation.
+ */
+
+#pragma once
+#ifndef CRYPTOGRAPHY_RSA_H_
+#define CRYPTOGRAPHY_RSA_H_
+
+#include <cryptography/bignum.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RSA_MAX_BYTES (BN_MAX_LIMBS * 4 - 8)  // 4096-bit moduli
+
+#define RSA_BAD_INPUT -0x0060  // Invalid key or input larger than the modulus
+
+// RSA public key
+typedef struct {
+	int len;						// Length of the modulus in bytes
+	mont_context n;					// Arithmetic modulo N
+	unsigned int e[BN_MAX_LIMBS];	// Public exponent
+	int eLimbs;						// Number of limbs of the public exponent
+} rsa_context;
+
+/**
+ * @brief Loads an RSA public key (big-endian byte strings, leading zeros allowed).
+ * @return 0 if successful, RSA_BAD_INPUT otherwise.
+ */
+int rsa_set_public(rsa_context* ctx,
+				   const unsigned char* n,
+				   int nLen,
+				   const unsigned char* e,
+				   int eLen);
+
+/**
+ * @brief Computes output = input^e mod N.
+ * @param ctx The public key.
+ * @param input ctx->len bytes, must be smaller than N.
+ * @param output Buffer receiving ctx->len bytes.
+ * @return 0 if successful, RSA_BAD_INPUT otherwise.
+ */
+int rsa_public(const rsa_context* ctx, const unsigned char* input, unsigned char* output);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	// #ifndef CRYPTOGRAPHY_RSA_H_
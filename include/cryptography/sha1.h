@@ -2,6 +2,11 @@
  * @author Khoa Nguyen
  * @file sha1.h
  * @brief Header file for SHA-1 hash algorithm.
+ *
+ * This header file provides a one-shot SHA-1 and an init/update/final API, so data can be hashed
+ * as it arrives. Blocks are compressed by the SHA extensions of x86 processors when available,
+ * chosen at runtime, and by an unrolled portable implementation otherwise. Many short messages, as
+ * the key derivation of BAC hashes, are best hashed together by sha1_multi.
  */
 
 #pragma once
@@ -12,17 +17,76 @@
 extern "C" {
 #endif
 
+#define SHA1_DIGEST_LENGTH	  20
+#define SHA1_BLOCK_LENGTH	  64
+#define SHA1_MULTI_LANES	  8	 // Messages hashed together by sha1_multi
+
+#define SHA1_SELF_TEST_FAILED -0x0070  // A kernel disagrees with the known answers
+
+// SHA-1 streaming context
+typedef struct {
+	unsigned int state[5];						// Intermediate hash value
+	unsigned long long length;					// Bytes hashed so far
+	unsigned char buffer[SHA1_BLOCK_LENGTH];	// Partial block
+	int kernel;									// Compression kernel, chosen by sha1_init
+} sha1_ctx;
+
+/**
+ * @brief Starts a new hash.
+ */
+void sha1_init(sha1_ctx* ctx);
+
+/**
+ * @brief Hashes the next part of the message.
+ * @param ctx The context.
+ * @param input The data, of any length.
+ * @param length Length of the data in bytes.
+ */
+void sha1_update(sha1_ctx* ctx, const unsigned char* input, long long length);
+
+/**
+ * @brief Pads the message and writes its hash, the context must be initialized again for reuse.
+ * @param ctx The context.
+ * @param output Buffer receiving SHA1_DIGEST_LENGTH bytes.
+ */
+void sha1_final(sha1_ctx* ctx, unsigned char output[SHA1_DIGEST_LENGTH]);
+
 /**
  * @brief Computes the SHA-1 hash of the input data and stores the result in the output buffer.
  * @param input Pointer to an unsigned char array containing the data to be hashed.
  * @param length Length of the input data in bytes.
  * @param output Pointer to an unsigned char array where the resulting hash will be stored (should
- * be 40 bytes long).
+ * be 20 bytes long).
+ */
+void sha1(const unsigned char* input, long long length, unsigned char* output);
+
+/**
+ * @brief Hashes independent messages, with one AVX2 lane per message when available.
+ * @param input The messages.
+ * @param length Length of each message in bytes.
+ * @param output Buffers receiving SHA1_DIGEST_LENGTH bytes each.
+ * @param count Number of messages, any number.
+ */
+void sha1_multi(const unsigned char* const input[],
+				const long long length[],
+				unsigned char* const output[],
+				int count);
+
+/**
+ * @brief Returns the number of messages sha1_multi hashes in one pass on this CPU, 1 without
+ * AVX2.
+ */
+int sha1_multi_lanes(void);
+
+/**
+ * @brief Known-answer test of the SHA-1 kernels available on this CPU.
+ * @return 0 if all kernels pass, SHA1_SELF_TEST_FAILED otherwise. A kernel that fails is never
+ * dispatched.
  */
-void sha1(unsigned char* input, long long length, unsigned char* output);
+int sha1_self_test(void);
 
 #ifdef __cplusplus
 }
 #endif
 
-#endif	// #ifndef CRYPTOGRAPHY_SHA1_H_
\ No newline at end of file
+#endif	// #ifndef CRYPTOGRAPHY_SHA1_H_
@@ -0,0 +1,88 @@
+/**
+ * @author Khoa Nguyen
+ * @file sha256.h
+ * @brief Header file for SHA-224 and SHA-256 hash algorithms.
+ *
+ * This header file provides one-shot SHA-224 and SHA-256 and an init/update/final API, so data can
+ * be hashed as it arrives. Blocks are compressed by the SHA extensions of x86 processors when
+ * available, chosen at runtime, and by a portable implementation otherwise.
+ */
+
+#pragma once
+#ifndef CRYPTOGRAPHY_SHA256_H_
+#define CRYPTOGRAPHY_SHA256_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SHA224_DIGEST_LENGTH	28
+#define SHA256_DIGEST_LENGTH	32
+#define SHA256_BLOCK_LENGTH		64
+
+#define SHA256_SELF_TEST_FAILED -0x0072	 // A kernel disagrees with the known answers
+
+// SHA-224 and SHA-256 streaming context
+typedef struct {
+	unsigned int state[8];						// Intermediate hash value
+	unsigned long long length;					// Bytes hashed so far
+	unsigned char buffer[SHA256_BLOCK_LENGTH];	// Partial block
+	int digestLength;							// SHA224_DIGEST_LENGTH or SHA256_DIGEST_LENGTH
+	int kernel;									// Compression kernel, chosen by the init functions
+} sha256_ctx;
+
+/**
+ * @brief Starts a new SHA-224 hash.
+ */
+void sha224_init(sha256_ctx* ctx);
+
+/**
+ * @brief Starts a new SHA-256 hash.
+ */
+void sha256_init(sha256_ctx* ctx);
+
+/**
+ * @brief Hashes the next part of the message.
+ * @param ctx The context.
+ * @param input The data, of any length.
+ * @param length Length of the data in bytes.
+ */
+void sha256_update(sha256_ctx* ctx, const unsigned char* input, long long length);
+
+/**
+ * @brief Pads the message and writes its hash, the context must be initialized again for reuse.
+ * @param ctx The context.
+ * @param output Buffer receiving ctx->digestLength bytes.
+ */
+void sha256_final(sha256_ctx* ctx, unsigned char* output);
+
+/**
+ * @brief Computes the SHA-224 hash of the input data and stores the result in the output buffer.
+ * @param input Pointer to an unsigned char array containing the data to be hashed.
+ * @param length Length of the input data in bytes.
+ * @param output Pointer to an unsigned char array where the resulting hash will be stored (should
+ * be 28 bytes long).
+ */
+void sha224(const unsigned char* input, long long length, unsigned char* output);
+
+/**
+ * @brief Computes the SHA-256 hash of the input data and stores the result in the output buffer.
+ * @param input Pointer to an unsigned char array containing the data to be hashed.
+ * @param length Length of the input data in bytes.
+ * @param output Pointer to an unsigned char array where the resulting hash will be stored (should
+ * be 32 bytes long).
+ */
+void sha256(const unsigned char* input, long long length, unsigned char* output);
+
+/**
+ * @brief Known-answer test of the SHA-256 kernels available on this CPU.
+ * @return 0 if all kernels pass, SHA256_SELF_TEST_FAILED otherwise. A kernel that fails is never
+ * dispatched.
+ */
+int sha256_self_test(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	// #ifndef CRYPTOGRAPHY_SHA256_H_
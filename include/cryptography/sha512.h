@@ -0,0 +1,82 @@
+/**
+ * @author Khoa Nguyen
+ * @file sha512.h
+ * @brief Header file for SHA-384 and SHA-512 hash algorithms.
+ *
+ * This header file provides one-shot SHA-384 and SHA-512 and an init/update/final API, so data can
+ * be hashed as it arrives. On processors with AVX2 the message schedule is computed four words at a
+ * time, chosen at runtime.
+ */
+
+#pragma once
+#ifndef CRYPTOGRAPHY_SHA512_H_
+#define CRYPTOGRAPHY_SHA512_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SHA384_DIGEST_LENGTH	48
+#define SHA512_DIGEST_LENGTH	64
+#define SHA512_BLOCK_LENGTH		128
+
+#define SHA512_SELF_TEST_FAILED -0x0074	 // A kernel disagrees with the known answers
+
+// SHA-384 and SHA-512 streaming context
+typedef struct {
+	unsigned long long state[8];				// Intermediate hash value
+	unsigned long long length;					// Bytes hashed so far
+	unsigned char buffer[SHA512_BLOCK_LENGTH];	// Partial block
+	int digestLength;							// SHA384_DIGEST_LENGTH or SHA512_DIGEST_LENGTH
+	int kernel;									// Compression kernel, chosen by the init functions
+} sha512_ctx;
+
+/**
+ * @brief Starts a new SHA-384 hash.
+ */
+void sha384_init(sha512_ctx* ctx);
+
+/**
+ * @brief Starts a new SHA-512 hash.
+ */
+void sha512_init(sha512_ctx* ctx);
+
+/**
+ * @brief Hashes the next part of the message.
+ * @param ctx The context.
+ * @param input The data, of any length.
+ * @param length Length of the data in bytes.
+ */
+void sha512_update(sha512_ctx* ctx, const unsigned char* input, long long length);
+
+/**
+ * @brief Pads the message and writes its hash, the context must be initialized again for reuse.
+ * @param ctx The context.
+ * @param output Buffer receiving ctx->digestLength bytes.
+ */
+void sha512_final(sha512_ctx* ctx, unsigned char* output);
+
+/**
+ * @brief Computes the SHA-384 hash of the input data.
+ * @param output Buffer receiving 48 bytes.
+ */
+void sha384(const unsigned char* input, long long length, unsigned char* output);
+
+/**
+ * @brief Computes the SHA-512 hash of the input data.
+ * @param output Buffer receiving 64 bytes.
+ */
+void sha512(const unsigned char* input, long long length, unsigned char* output);
+
+/**
+ * @brief Known-answer test of the SHA-512 kernels available on this CPU.
+ * @return 0 if all kernels pass, SHA512_SELF_TEST_FAILED otherwise. A kernel that fails is never
+ * dispatched.
+ */
+int sha512_self_test(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	// #ifndef CRYPTOGRAPHY_SHA512_H_
@@ -0,0 +1,38 @@
+/**
+ * @author Khoa Nguyen
+ * @file allocator.h
+ * @brief Header file for the heap allocations of the library.
+ *
+ * Every heap allocation of the library goes through these functions: the trust store and the
+ * offline audit allocate, a read session must not. Built with USE_ALLOC_COUNTER, the allocations
+ * of each thread are counted, so a harness can check that the code it runs did not allocate while
+ * other threads do. Allocations of the C runtime and of OpenSSL do not go through these functions
+ * and are not counted.
+ */
+
+#pragma once
+#ifndef UTILS_ALLOCATOR_H_
+#define UTILS_ALLOCATOR_H_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void* AllocatorMalloc(size_t size);
+void* AllocatorCalloc(size_t count, size_t size);
+void* AllocatorRealloc(void* block, size_t size);
+void AllocatorFree(void* block);
+
+/**
+ * @brief Number of allocations made by the calling thread since it started.
+ * @return The count, always 0 without USE_ALLOC_COUNTER.
+ */
+long long AllocatorThreadCount(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	// #ifndef UTILS_ALLOCATOR_H_
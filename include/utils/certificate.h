@@ -0,0 +1,104 @@
+/**
+ * @author Khoa Nguyen
+ * @file certificate.h
+ * @brief Header file for X.509 certificate decoding and signature verification functions.
+ *
+ * This header file provides helpers to decode the X.509 certificates found in EF.SOD and to verify
+ * the signatures of Passive Authentication: RSA with PKCS #1 v1.5 or RSASSA-PSS padding, and ECDSA
+ * with DER encoded signatures.
+ */
+
+#pragma once
+#ifndef UTILS_CERTIFICATE_H_
+#define UTILS_CERTIFICATE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Fields of a Certificate, all pointers refer to the decoded buffer
+typedef struct {
+	const unsigned char* tbs;  // TBSCertificate with its tag and length, the signed bytes
+	int tbsLength;
+	const unsigned char* serialNumber;	// Value of the INTEGER
+	int serialNumberLength;
+	const unsigned char* issuer;  // Name with its tag and length
+	int issuerLength;
+	const unsigned char* subject;  // Name with its tag and length
+	int subjectLength;
+	const unsigned char* publicKey;	 // SubjectPublicKeyInfo with its tag and length
+	int publicKeyLength;
+	const unsigned char* extensions;  // Content of the Extensions SEQUENCE, NULL if absent
+	int extensionsLength;
+	const unsigned char* signatureAlgorithm;  // Content of the AlgorithmIdentifier
+	int signatureAlgorithmLength;
+	const unsigned char* signature;	 // Content of the signature BIT STRING after the unused bits
+	int signatureLength;
+} Certificate;
+
+/**
+ * @brief Decodes a Certificate.
+ * @param buf Buffer starting with the Certificate SEQUENCE, it must outlive cert.
+ * @param bufLen Number of bytes available in buf.
+ * @param cert Receives the fields of the certificate.
+ * @return APP_SUCCESS if the structure is well formed, APP_ERROR otherwise.
+ */
+int ParseCertificate(const unsigned char* buf, int bufLen, Certificate* cert);
+
+/**
+ * @brief Finds an extension of a certificate.
+ * @param cert The decoded certificate.
+ * @param oid Extension identifier, e.g. 55 1D 0E for the subject key identifier.
+ * @param oidLength Length of the identifier.
+ * @param value Receives a pointer to the content of the extnValue OCTET STRING.
+ * @param length Receives the length of the content.
+ * @return APP_SUCCESS if found, APP_ERROR otherwise.
+ */
+int CertificateExtension(const Certificate* cert,
+						 const unsigned char* oid,
+						 int oidLength,
+						 const unsigned char** value,
+						 int* length);
+
+/**
+ * @brief Returns the HASH_* of a digest algorithm (SHA-1 or SHA-2) given by its OID.
+ * @return The hash algorithm, or APP_ERROR if it is not supported.
+ */
+int DigestAlgorithm(const unsigned char* oid, int oidLength);
+
+/**
+ * @brief Returns the HASH_* of a signature algorithm.
+ * @param algorithm Content of the AlgorithmIdentifier (algorithm OID and parameters).
+ * @param algorithmLength Length of the content.
+ * @return The hash algorithm, 0 for rsaEncryption which leaves the hash to the caller (the digest
+ * algorithm of a CMS SignerInfo), or APP_ERROR if the algorithm is not supported.
+ */
+int SignatureHashAlgorithm(const unsigned char* algorithm, int algorithmLength);
+
+/**
+ * @brief Verifies a signature over a message digest.
+ *
+ * @param publicKey SubjectPublicKeyInfo of the signer, with its tag and length.
+ * @param publicKeyLength Length of the SubjectPublicKeyInfo.
+ * @param algorithm Content of the AlgorithmIdentifier of the signature.
+ * @param algorithmLength Length of the content.
+ * @param hashAlgorithm HASH_* of the digest.
+ * @param digest The message digest, hash_length(hashAlgorithm) bytes.
+ * @param signature The signature, DER encoded for ECDSA.
+ * @param signatureLength Length of the signature.
+ * @return APP_SUCCESS if the signature is valid, APP_ERROR otherwise.
+ */
+int SignatureVerify(const unsigned char* publicKey,
+					int publicKeyLength,
+					const unsigned char* algorithm,
+					int algorithmLength,
+					int hashAlgorithm,
+					const unsigned char* digest,
+					const unsigned char* signature,
+					int signatureLength);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	// #ifndef UTILS_CERTIFICATE_H_
@@ -0,0 +1,90 @@
+/**
+ * @author Khoa Nguyen
+ * @file key_cache.h
+ * @brief Header file for the learned BAC key cache of document-number reads.
+ *
+ * This header file provides a persistent cache from a document number to the birth date and date
+ * of expiry that opened its chip, with the BAC keys K_Enc and K_MAC derived from them. A card read
+ * again is then authenticated by its first EXTERNAL AUTHENTICATE instead of after a search.
+ *
+ * The cache is a fixed-size file mapped into memory and shared by every process that opens it:
+ * a header followed by KEY_CACHE_WAYS-way sets of slots, the least recently used slot of a set
+ * being replaced. Each slot is found by the AES-CMAC of its document number and holds its fields
+ * encrypted with AES-128-CBC and authenticated with AES-CMAC, under keys derived from a secret of
+ * the installation, so the file reveals neither document numbers nor birth dates. Threads are
+ * serialized by a lock and processes by a lock on the file.
+ */
+
+#pragma once
+#ifndef UTILS_KEY_CACHE_H_
+#define UTILS_KEY_CACHE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define KEY_CACHE_MAGIC			"IDKEYC01"
+#define KEY_CACHE_SECRET_LENGTH 32
+#define KEY_CACHE_WAYS			8	  // Slots of a set, a document number may only use its set
+#define KEY_CACHE_DEFAULT_SLOTS 4096  // Slots of a new file, rounded up to a multiple of the ways
+
+// Learned key of a document number
+typedef struct {
+	unsigned char birthDate[6];		// YYMMDD
+	unsigned char expiryDate[6];	// YYMMDD
+	unsigned char encryptKey[16];	// K_Enc
+	unsigned char macKey[16];		// K_MAC
+} KeyCacheEntry;
+
+/**
+ * @brief Opens or creates a cache file and makes it the cache of all threads.
+ *
+ * @param[in] path The cache file, created with slots slots if it does not exist.
+ * @param[in] slots Number of slots of a new file, 0 for KEY_CACHE_DEFAULT_SLOTS. The size of an
+ * existing file is kept.
+ * @param[in] secret The secret the keys of the slots are derived from (KEY_CACHE_SECRET_LENGTH
+ * bytes), the same for every process sharing the file.
+ *
+ * @return APP_SUCCESS if the cache was opened, otherwise APP_ERROR and the previous cache is kept.
+ */
+long KeyCacheOpen(const char* path, int slots, const unsigned char secret[KEY_CACHE_SECRET_LENGTH]);
+
+/**
+ * @brief Closes the current cache, document-number reads always search.
+ */
+void KeyCacheClose(void);
+
+/**
+ * @brief Looks up the learned key of a document number and marks it as recently used.
+ *
+ * @param[in] documentNumber The document number as an array of 9 unsigned chars.
+ * @param[out] entry Receives the learned key.
+ *
+ * @return APP_SUCCESS if the document number is cached, otherwise APP_ERROR (also when no cache is
+ * open, or when its slot fails authentication).
+ */
+long KeyCacheLookup(const unsigned char documentNumber[9], KeyCacheEntry* entry);
+
+/**
+ * @brief Stores the learned key of a document number, replacing the least recently used slot of
+ * its set if it is full.
+ *
+ * @param[in] documentNumber The document number as an array of 9 unsigned chars.
+ * @param[in] entry The learned key.
+ *
+ * @return APP_SUCCESS if the key was stored, otherwise APP_ERROR.
+ */
+long KeyCacheStore(const unsigned char documentNumber[9], const KeyCacheEntry* entry);
+
+/**
+ * @brief Forgets the learned key of a document number, after the card refused it.
+ *
+ * @param[in] documentNumber The document number as an array of 9 unsigned chars.
+ */
+void KeyCacheRemove(const unsigned char documentNumber[9]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	// #ifndef UTILS_KEY_CACHE_H_
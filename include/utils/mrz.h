@@ -0,0 +1,95 @@
+/**
+ * @author Khoa Nguyen
+ * @file mrz.h
+ * @brief Header file for the ingestion of OCR-read TD1 MRZ text.
+ *
+ * This header file provides the parsing of the three lines of a TD1 machine readable zone (ICAO
+ * Doc 9303 Part 5) as read by an OCR engine, with the confidence of each character, and the
+ * enumeration of the MRZ informations of the BAC and PACE key it may hold. The parse does not copy
+ * the text: each field points into it. Characters that OCR engines confuse (O and 0, I and 1, B
+ * and 8, S and 5...) are corrected where the check digits require it, so only keys whose document
+ * number, date of birth and date of expiry agree with their check digits are sent to the card,
+ * most likely first.
+ */
+
+#pragma once
+#ifndef UTILS_MRZ_H_
+#define UTILS_MRZ_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MRZ_TD1_LINE_LENGTH	  30
+#define MRZ_MAX_INFORMATION	  40  // Longest MRZ information with its NUL, for a 22-digit number
+#define MRZ_MAX_CANDIDATES	  64
+#define MRZ_MAX_CORRECTIONS	  2	  // Characters corrected in a field with its check digit
+#define MRZ_FIELD_VARIANTS	  8	  // Corrections of a field kept before they are combined
+#define MRZ_COMPOSITE_FLOOR	  0.01	// Weight of a key whose composite check digit disagrees
+
+// Characters of a field in the MRZ text
+typedef struct {
+	const unsigned char* text;
+	const unsigned char* confidence;  // Confidence of each character from 0 to 100, or NULL
+	int length;
+} MrzField;
+
+// Fields of a TD1 MRZ that make the key, pointing into the text
+typedef struct {
+	const unsigned char* line[3];
+	const unsigned char* lineConfidence[3];
+	MrzField documentNumber;		   // First 9 characters of the document number
+	MrzField documentNumberExtension;  // Rest of a longer number in the optional data, or empty
+	MrzField documentNumberCheck;
+	MrzField birthDate;
+	MrzField birthDateCheck;
+	MrzField expiryDate;
+	MrzField expiryDateCheck;
+	MrzField compositeCheck;
+} MrzTd1;
+
+// Candidate MRZ information with its likelihood among all the keys the check digits allow
+typedef struct {
+	unsigned char mrzInformation[MRZ_MAX_INFORMATION];	// NUL-terminated
+	double likelihood;
+} MrzCandidate;
+
+/**
+ * @brief Parses the three lines of a TD1 MRZ without copying them.
+ *
+ * Lines are separated by LF or CR LF, and the spaces an OCR engine may add at the end of a line
+ * are ignored. Lower case letters are read as upper case.
+ *
+ * @param[in] text The MRZ text, it must stay valid while the result is used.
+ * @param[in] length Length of the text.
+ * @param[in] confidence Confidence of each byte of the text from 0 to 100, or NULL.
+ * @param[out] mrz Receives the fields.
+ *
+ * @return APP_SUCCESS if the text has three lines of 30 characters, otherwise APP_ERROR.
+ */
+long MrzTd1Parse(const unsigned char* text,
+				 int length,
+				 const unsigned char* confidence,
+				 MrzTd1* mrz);
+
+/**
+ * @brief Enumerates the MRZ informations consistent with the check digits, most likely first.
+ *
+ * A character is taken as read with its confidence, capped at 99%, and the characters it is
+ * confused with share the rest. Up to MRZ_MAX_CORRECTIONS characters are corrected per field, a
+ * letter in a numeric field always is, and dates must be valid. The composite check digit ranks
+ * the keys, as it also covers optional data that is not corrected.
+ *
+ * @param[in] mrz The parsed MRZ.
+ * @param[out] candidates Receives the candidates.
+ * @param[in] maxCandidates Capacity of candidates, at most MRZ_MAX_CANDIDATES are returned.
+ *
+ * @return The number of candidates, 0 if no correction agrees with the check digits.
+ */
+int MrzCandidatesGenerate(const MrzTd1* mrz, MrzCandidate candidates[], int maxCandidates);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	// #ifndef UTILS_MRZ_H_
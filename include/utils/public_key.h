@@ -0,0 +1,54 @@
+/**
+ * @author Khoa Nguyen
+ * @file public_key.h
+ * @brief Header file for SubjectPublicKeyInfo decoding functions.
+ *
+ * This header file provides helpers to decode the SubjectPublicKeyInfo structures of DG14 and DG15
+ * and to resolve the elliptic curve of a key, given as a named curve, a standardized domain
+ * parameter ID or explicit ECParameters.
+ */
+
+#pragma once
+#ifndef UTILS_PUBLIC_KEY_H_
+#define UTILS_PUBLIC_KEY_H_
+
+#include <cryptography/ecc.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Fields of a SubjectPublicKeyInfo, all pointers refer to the decoded buffer
+typedef struct {
+	const unsigned char* algorithm;	 // Algorithm OID
+	int algorithmLength;
+	unsigned int parametersTag;	 // 0 if the parameters are absent
+	const unsigned char* parameters;
+	int parametersLength;
+	const unsigned char* key;  // Content of the subjectPublicKey BIT STRING
+	int keyLength;
+} PublicKeyInfo;
+
+/**
+ * @brief Decodes a SubjectPublicKeyInfo.
+ * @param buf Buffer starting with the SubjectPublicKeyInfo SEQUENCE, it must outlive info.
+ * @param bufLen Number of bytes available in buf.
+ * @param info Receives the algorithm, its parameters and the public key.
+ * @return APP_SUCCESS if the structure is well formed, APP_ERROR otherwise.
+ */
+int ParsePublicKeyInfo(const unsigned char* buf, int bufLen, PublicKeyInfo* info);
+
+/**
+ * @brief Resolves the curve of an elliptic curve public key.
+ * @param info The decoded SubjectPublicKeyInfo.
+ * @param explicitGroup Storage for explicit domain parameters.
+ * @return The shared group of a named curve or standardized ID, explicitGroup once loaded with
+ * explicit parameters, or NULL if the parameters are not supported.
+ */
+const ecc_group* PublicKeyCurve(const PublicKeyInfo* info, ecc_group* explicitGroup);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	// #ifndef UTILS_PUBLIC_KEY_H_
@@ -0,0 +1,47 @@
+/**
+ * @author Khoa Nguyen
+ * @file random.h
+ * @brief Header file for the random generator of nonces and keys.
+ *
+ * Every thread owns a ChaCha20 generator keyed from the system generator (BCryptGenRandom), so
+ * concurrent sessions never share a stream and a nonce costs no system call. The keystream is
+ * computed RANDOM_POOL_BLOCKS blocks at a time, and the first 32 bytes of every refill replace
+ * the key, so the bytes already handed out cannot be recomputed from the state. The key is
+ * renewed from the system generator every RANDOM_RESEED_BYTES bytes.
+ *
+ * For replay testing, RandomSeed makes the generator of the calling thread deterministic.
+ */
+
+#pragma once
+#ifndef UTILS_RANDOM_H_
+#define UTILS_RANDOM_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RANDOM_POOL_BLOCKS	8				   // ChaCha20 blocks computed per refill
+#define RANDOM_RESEED_BYTES (1024 * 1024)  // Bytes served before the key is renewed
+
+#define RANDOM_SEED_LENGTH	32
+
+/**
+ * @brief Fills a buffer with random bytes from the generator of the calling thread.
+ * @param buffer Buffer receiving the bytes.
+ * @param length Number of bytes.
+ * @return APP_SUCCESS, or APP_ERROR if the system generator fails.
+ */
+long RandomBytes(unsigned char* buffer, int length);
+
+/**
+ * @brief Makes the generator of the calling thread deterministic, or random again.
+ * @param seed Key of the generator (RANDOM_SEED_LENGTH bytes), the same seed replays the same
+ * bytes. NULL keys the generator from the system generator again.
+ */
+void RandomSeed(const unsigned char seed[RANDOM_SEED_LENGTH]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	// #ifndef UTILS_RANDOM_H_
@@ -0,0 +1,90 @@
+/**
+ * @author Khoa Nguyen
+ * @file sync.h
+ * @brief Header file for synchronization primitives.
+ *
+ * This header file wraps the slim reader/writer lock, the condition variable, the threads and the
+ * performance counter of Windows. Windows.h cannot be included next to the typedefs of the
+ * cryptography headers, so the types here only have the size of their Windows counterparts.
+ */
+
+#pragma once
+#ifndef UTILS_SYNC_H_
+#define UTILS_SYNC_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SYNC_INIT {0}  // Static initializer of SyncLock and SyncCondition
+
+// Slim reader/writer lock (SRWLOCK)
+typedef struct {
+	void* ptr;
+} SyncLock;
+
+// Condition variable (CONDITION_VARIABLE)
+typedef struct {
+	void* ptr;
+} SyncCondition;
+
+// Thread started by SyncThreadStart
+typedef struct {
+	void* handle;
+	void (*routine)(void*);
+	void* argument;
+} SyncThread;
+
+void SyncLockExclusive(SyncLock* lock);
+void SyncUnlockExclusive(SyncLock* lock);
+void SyncLockShared(SyncLock* lock);
+void SyncUnlockShared(SyncLock* lock);
+
+/**
+ * @brief Releases the exclusive lock, sleeps until the condition is signaled and locks again.
+ */
+void SyncWait(SyncCondition* condition, SyncLock* lock);
+
+/**
+ * @brief Wakes all threads sleeping on the condition.
+ */
+void SyncWakeAll(SyncCondition* condition);
+
+/**
+ * @brief Gives the rest of the time slice to another ready thread.
+ */
+void SyncYield(void);
+
+/**
+ * @brief Starts a thread running routine(argument).
+ * @param thread Receives the thread, it must stay valid until SyncThreadJoin.
+ * @return 0 if successful, -1 if the thread could not be created.
+ */
+int SyncThreadStart(SyncThread* thread, void (*routine)(void*), void* argument);
+
+/**
+ * @brief Waits for the routine of a thread to return and releases the thread.
+ */
+void SyncThreadJoin(SyncThread* thread);
+
+/**
+ * @brief Number of logical processors of the machine, at least 1.
+ */
+int SyncProcessorCount(void);
+
+/**
+ * @brief Reads the performance counter.
+ * @return The counter, in SyncTicksPerSecond units.
+ */
+long long SyncTicks(void);
+
+/**
+ * @brief Frequency of the performance counter.
+ */
+long long SyncTicksPerSecond(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	// #ifndef UTILS_SYNC_H_
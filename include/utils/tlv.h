@@ -0,0 +1,109 @@
+/**
+ * @author Khoa Nguyen
+ * @file tlv.h
+ * @brief Header file for BER-TLV encoding and decoding functions.
+ *
+ * This header file provides helpers to walk the BER-TLV structures found in secure messaging
+ * responses, General Authenticate data and the ASN.1 files of the LDS (EF.CardAccess, DG14, ...).
+ */
+
+#pragma once
+#ifndef UTILS_TLV_H_
+#define UTILS_TLV_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Decodes the tag and length of the BER-TLV object at the start of a buffer.
+ * @param buf Pointer to the encoded object.
+ * @param bufLen Number of bytes available in buf.
+ * @param tag Receives the tag, multi-byte tags are packed big-endian (e.g. 0x7F49).
+ * @param length Receives the length of the value field.
+ * @param headerLength Receives the number of tag and length bytes preceding the value.
+ * @return APP_SUCCESS if the object is well formed and fits in the buffer, APP_ERROR otherwise.
+ */
+int TlvParse(const unsigned char* buf,
+			 int bufLen,
+			 unsigned int* tag,
+			 int* length,
+			 int* headerLength);
+
+/**
+ * @brief Decodes the tag and length of a BER-TLV object whose value may not be fully available yet.
+ *
+ * Same as TlvParse but only the tag and length bytes need to be present, which lets file readers
+ * learn the total size of an elementary file from its first chunk.
+ *
+ * @return APP_SUCCESS if the tag and length are well formed, APP_ERROR otherwise.
+ */
+int TlvParseHeader(const unsigned char* buf,
+				   int bufLen,
+				   unsigned int* tag,
+				   int* length,
+				   int* headerLength);
+
+/**
+ * @brief Finds a BER-TLV object by tag among the objects concatenated in a buffer.
+ * @param buf Pointer to the concatenated objects (not searched recursively).
+ * @param bufLen Length of buf.
+ * @param tag Tag to look for.
+ * @param value Receives a pointer to the value field of the first match.
+ * @param length Receives the length of the value field.
+ * @return APP_SUCCESS if found, APP_ERROR otherwise.
+ */
+int TlvFind(const unsigned char* buf,
+			int bufLen,
+			unsigned int tag,
+			const unsigned char** value,
+			int* length);
+
+/**
+ * @brief Splits the BER-TLV objects concatenated in a buffer, e.g. the fields of a SEQUENCE.
+ * @param buf Pointer to the concatenated objects.
+ * @param bufLen Length of buf.
+ * @param tags Receives the tag of each object.
+ * @param values Receives a pointer to the value field of each object.
+ * @param lengths Receives the length of each value field.
+ * @param maxCount Capacity of the output arrays, further objects are not decoded.
+ * @return Number of objects decoded, or APP_ERROR if an object is malformed.
+ */
+int TlvSplit(const unsigned char* buf,
+			 int bufLen,
+			 unsigned int* tags,
+			 const unsigned char** values,
+			 int* lengths,
+			 int maxCount);
+
+/**
+ * @brief Reads the value of a DER INTEGER of at most 4 bytes.
+ * @param value Pointer to the value field of the INTEGER.
+ * @param length Length of the value field.
+ * @return The non-negative value, or -1 if it is empty, negative or too long.
+ */
+int TlvReadInteger(const unsigned char* value, int length);
+
+/**
+ * @brief Encodes a BER length field.
+ * @param length The length to encode (up to 0xFFFF).
+ * @param out Buffer receiving the encoded length (up to 3 bytes).
+ * @return Number of bytes written.
+ */
+int TlvEncodeLength(int length, unsigned char* out);
+
+/**
+ * @brief Encodes a BER-TLV object with a one or two byte tag.
+ * @param tag The tag, two byte tags are packed big-endian.
+ * @param value Pointer to the value field.
+ * @param length Length of the value field.
+ * @param out Buffer receiving the encoded object.
+ * @return Number of bytes written.
+ */
+int TlvEncode(unsigned int tag, const unsigned char* value, int length, unsigned char* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	// #ifndef UTILS_TLV_H_
@@ -0,0 +1,86 @@
+/**
+ * @author Khoa Nguyen
+ * @file trust_store.h
+ * @brief Header file for the CSCA certificate store of Passive Authentication.
+ *
+ * This header file provides the store of trusted Country Signing CA certificates that Document
+ * Signer certificates are checked against. A CSCA master list, or a file of concatenated DER
+ * certificates, is compiled once by TrustStoreCompile into a binary file holding the certificates
+ * and two sorted indexes: by subject key identifier, matched with the authority key identifier of
+ * a Document Signer, and by subject, matched with its issuer. TrustStoreLoad maps that file into
+ * memory, so loading costs no parsing and a lookup is a binary search.
+ *
+ * Loading a new store while readers are running is safe: the new store is published at once, and
+ * the previous one stays mapped until the last reader using it releases it (read-copy-update).
+ * Document Signer certificates that verified are cached by the SHA-256 of their TBSCertificate, so
+ * a Document Signer seen again costs a hash and a lookup instead of an RSA or ECDSA verification.
+ *
+ * The signature of the master list itself is not checked, the file is trusted as published.
+ */
+
+#pragma once
+#ifndef UTILS_TRUST_STORE_H_
+#define UTILS_TRUST_STORE_H_
+
+#include <utils/certificate.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TRUST_STORE_MAGIC	   "IDCSCA01"
+#define TRUST_KEY_LENGTH	   20	// SHA-1 of a key identifier or of a subject
+#define TRUST_CACHE_SIZE	   256	// Verified Document Signer certificates kept per store
+#define TRUST_MAX_MASTER_LIST  (16 * 1024 * 1024)
+
+/**
+ * @brief Compiles a CSCA master list into a store file.
+ *
+ * @param[in] masterListPath A CSCA master list (CMS SignedData of a CscaMasterList), or a file of
+ * concatenated DER certificates.
+ * @param[in] storePath The store file to write. Publishing a new store is atomic if it is written
+ * to a temporary path first and then renamed over the store loaded by the readers.
+ *
+ * @return APP_SUCCESS if the store was written, otherwise APP_ERROR.
+ */
+long TrustStoreCompile(const char* masterListPath, const char* storePath);
+
+/**
+ * @brief Maps a store file and makes it the store of all threads.
+ *
+ * The previous store, if any, is released once the readers using it are done.
+ *
+ * @param[in] storePath The store file written by TrustStoreCompile.
+ *
+ * @return APP_SUCCESS if the store was loaded, otherwise APP_ERROR and the previous store is kept.
+ */
+long TrustStoreLoad(const char* storePath);
+
+/**
+ * @brief Releases the current store, Document Signers are no longer checked.
+ */
+void TrustStoreUnload(void);
+
+/**
+ * @brief Returns 1 if a store is loaded, 0 otherwise.
+ */
+int TrustStoreLoaded(void);
+
+/**
+ * @brief Verifies a Document Signer certificate with the CSCA certificate that issued it.
+ *
+ * The CSCA is looked up by the authority key identifier of the certificate, or by its issuer if it
+ * has none. Every candidate CSCA is tried, which covers the link certificates of a key rollover.
+ *
+ * @param[in] documentSigner The decoded Document Signer certificate.
+ *
+ * @return APP_SUCCESS if a CSCA of the store signed the certificate, otherwise APP_ERROR (also when
+ * no store is loaded).
+ */
+long VerifyDocumentSigner(const Certificate* documentSigner);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	// #ifndef UTILS_TRUST_STORE_H_
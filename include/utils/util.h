@@ -20,10 +20,14 @@ void Delay(int millisecond);
 
 /**
  * @brief Generates a random nonce and stores it in the provided buffer.
+ *
+ * The bytes come from the ChaCha20 generator of the calling thread, see utils/random.h.
+ *
  * @param buffer Pointer to an unsigned char array where the generated nonce will be stored.
  * @param len Length of the buffer, determines how many bytes of nonce will be generated.
+ * @return APP_SUCCESS, or APP_ERROR if the system generator fails.
  */
-void RandomNonceGenerate(unsigned char* buffer, int len);
+long RandomNonceGenerate(unsigned char* buffer, int len);
 
 /**
  * @brief Pads a byte array with zeros from a specified starting position to the end.
@@ -70,6 +74,13 @@ int ExpirationYearCalculate(const int birthYear, const int currentYear);
  */
 int CharToYear(const unsigned char year[2], const int currentYear);
 
+/**
+ * @brief Converts a year to the string of its last 2 digits.
+ * @param year The year.
+ * @param yearChar Pointer to an unsigned char array where the 2 characters will be stored.
+ */
+void YearToChar(const int year, unsigned char yearChar[2]);
+
 /**
  * @brief Checks if a date is valid.
  * @param day The day of the date.
@@ -0,0 +1,333 @@
+/**
+ * @author Khoa Nguyen
+ * @file active_authentication.c
+ * @brief Source file for Active Authentication functions.
+ *
+ * This source file contains the implementation of DG15 parsing and Active Authentication. Decoded
+ * public keys are kept in a small cache indexed by the SHA-256 of their SubjectPublicKeyInfo and
+ * evicted least recently used first, which skips the DER decoding, the Montgomery setup of RSA
+ * moduli and the loading of explicit curves when the same key is seen again.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <access/active_authentication.h>
+#include <cryptography/ecc.h>
+#include <cryptography/rsa.h>
+#include <cryptography/hash.h>
+#include <cryptography/sha256.h>
+#include <utils/public_key.h>
+#include <utils/reader.h>
+#include <utils/tlv.h>
+#include <utils/util.h>
+
+#define AA_CHALLENGE_LENGTH 8
+#define AA_MAX_DIGEST		HASH_MAX_DIGEST_LENGTH
+
+#define AA_KEY_RSA			1
+#define AA_KEY_ECDSA		2
+
+// rsaEncryption = 1.2.840.113549.1.1.1
+static const unsigned char RSA_OID[9] = {0x2A, 0x86, 0x48, 0x86, 0xF7, 0x0D, 0x01, 0x01, 0x01};
+
+// id-ecPublicKey = 1.2.840.10045.2.1
+static const unsigned char EC_PUBLIC_KEY_OID[7] = {0x2A, 0x86, 0x48, 0xCE, 0x3D, 0x02, 0x01};
+
+// id-AA = 2.23.136.1.1.5
+static const unsigned char AA_OID[6] = {0x67, 0x81, 0x08, 0x01, 0x01, 0x05};
+
+// ecdsa-with-SHA1 = 1.2.840.10045.4.1, ecdsa-with-SHA224 to SHA512 = 1.2.840.10045.4.3.1 to 4
+static const unsigned char ECDSA_SHA1_OID[7] = {0x2A, 0x86, 0x48, 0xCE, 0x3D, 0x04, 0x01};
+static const unsigned char ECDSA_SHA2_OID[7] = {0x2A, 0x86, 0x48, 0xCE, 0x3D, 0x04, 0x03};
+
+// Decoded public key of DG15
+typedef struct {
+	unsigned char keyHash[32];	// SHA-256 of the SubjectPublicKeyInfo
+	int type;					// AA_KEY_RSA, AA_KEY_ECDSA or 0 for a free entry
+	unsigned long long lastUse;
+	rsa_context rsa;
+	const ecc_group* grp;  // Shared group or explicitGroup below
+	ecc_group explicitGroup;
+	ecc_point q;
+} CachedKey;
+
+static CachedKey keyCache[AA_KEY_CACHE_SIZE];
+static unsigned long long keyCacheClock;
+
+// Returns the digest length, or APP_ERROR if the hash algorithm is not available
+static int DigestLength(int hashAlgorithm) {
+	int length = hash_length(hashAlgorithm);
+	return length > 0 ? length : APP_ERROR;
+}
+
+static int DigestCompute(int hashAlgorithm,
+						 unsigned char* input,
+						 int length,
+						 unsigned char* output) {
+	int digestLength = hash_compute(hashAlgorithm, input, length, output);
+	return digestLength > 0 ? digestLength : APP_ERROR;
+}
+
+// ISO/IEC 9796-2 trailer: BC is SHA-1, otherwise the hash identifier of ISO/IEC 10118 precedes CC
+static int TrailerHash(const unsigned char* trailer, int* trailerLength) {
+	if (trailer[1] == 0xBC) {
+		*trailerLength = 1;
+		return AA_HASH_SHA1;
+	}
+	if (trailer[1] != 0xCC) {
+		return APP_ERROR;
+	}
+	*trailerLength = 2;
+	switch (trailer[0]) {
+		case 0x33:
+			return AA_HASH_SHA1;
+		case 0x34:
+			return AA_HASH_SHA256;
+		case 0x35:
+			return AA_HASH_SHA512;
+		case 0x36:
+			return AA_HASH_SHA384;
+		case 0x38:
+			return AA_HASH_SHA224;
+		default:
+			return APP_ERROR;
+	}
+}
+
+static int LoadKey(const unsigned char* spki, int spkiLength, CachedKey* entry) {
+	PublicKeyInfo info;
+	if (ParsePublicKeyInfo(spki, spkiLength, &info) != APP_SUCCESS) {
+		return APP_ERROR;
+	}
+
+	// RSAPublicKey ::= SEQUENCE { modulus INTEGER, publicExponent INTEGER }
+	if (info.algorithmLength == sizeof(RSA_OID) &&
+		!memcmp(info.algorithm, RSA_OID, sizeof(RSA_OID))) {
+		const unsigned char *rsaKey, *values[2];
+		int rsaKeyLength, lengths[2];
+		unsigned int tags[2];
+		if (TlvFind(info.key, info.keyLength, 0x30, &rsaKey, &rsaKeyLength) != APP_SUCCESS ||
+			TlvSplit(rsaKey, rsaKeyLength, tags, values, lengths, 2) != 2 || tags[0] != 0x02 ||
+			tags[1] != 0x02 ||
+			rsa_set_public(&entry->rsa, values[0], lengths[0], values[1], lengths[1]) != 0) {
+			return APP_ERROR;
+		}
+		entry->type = AA_KEY_RSA;
+		return APP_SUCCESS;
+	}
+
+	if (info.algorithmLength == sizeof(EC_PUBLIC_KEY_OID) &&
+		!memcmp(info.algorithm, EC_PUBLIC_KEY_OID, sizeof(EC_PUBLIC_KEY_OID))) {
+		entry->grp = PublicKeyCurve(&info, &entry->explicitGroup);
+		if (entry->grp == NULL ||
+			ecc_point_read(entry->grp, &entry->q, info.key, info.keyLength) != 0) {
+			return APP_ERROR;
+		}
+		entry->type = AA_KEY_ECDSA;
+		return APP_SUCCESS;
+	}
+	return APP_ERROR;
+}
+
+// Returns the cached key of a SubjectPublicKeyInfo, decoding it into the least recently used entry
+static const CachedKey* KeyCacheGet(const unsigned char* spki, int spkiLength) {
+	unsigned char keyHash[32];
+	CachedKey* victim = &keyCache[0];
+
+	sha256(spki, spkiLength, keyHash);
+	for (int i = 0; i < AA_KEY_CACHE_SIZE; i++) {
+		if (keyCache[i].type != 0 && !memcmp(keyCache[i].keyHash, keyHash, sizeof(keyHash))) {
+			keyCache[i].lastUse = ++keyCacheClock;
+			return &keyCache[i];
+		}
+		if (keyCache[i].type == 0 || (victim->type != 0 && keyCache[i].lastUse < victim->lastUse)) {
+			victim = &keyCache[i];
+		}
+	}
+
+	victim->type = 0;
+	if (LoadKey(spki, spkiLength, victim) != APP_SUCCESS) {
+		victim->type = 0;
+		return NULL;
+	}
+	memcpy(victim->keyHash, keyHash, sizeof(keyHash));
+	victim->lastUse = ++keyCacheClock;
+	return victim;
+}
+
+// ISO/IEC 9796-2 scheme 1 with partial message recovery: F = 6A || M1 || H || trailer
+static int RsaVerify(const rsa_context* rsa,
+					 const unsigned char* signature,
+					 int signatureLength,
+					 const unsigned char* challenge) {
+	unsigned char f[RSA_MAX_BYTES];
+	unsigned char message[RSA_MAX_BYTES + AA_CHALLENGE_LENGTH];
+	unsigned char digest[AA_MAX_DIGEST];
+	int k = rsa->len;
+	int trailerLength;
+
+	if (signatureLength != k || rsa_public(rsa, signature, f) != 0 || f[0] != 0x6A) {
+		return APP_ERROR;
+	}
+	int hashAlgorithm = TrailerHash(&f[k - 2], &trailerLength);
+	int digestLength  = DigestLength(hashAlgorithm);
+	int m1Length	  = k - 1 - digestLength - trailerLength;
+	if (hashAlgorithm == APP_ERROR || digestLength == APP_ERROR || m1Length <= 0) {
+		return APP_ERROR;
+	}
+
+	// The digest covers M1 || RND.IFD, where M1 is the recovered part of the message
+	memcpy(message, &f[1], m1Length);
+	memcpy(&message[m1Length], challenge, AA_CHALLENGE_LENGTH);
+	DigestCompute(hashAlgorithm, message, m1Length + AA_CHALLENGE_LENGTH, digest);
+	return memcmp(digest, &f[1 + m1Length], digestLength) ? APP_ERROR : APP_SUCCESS;
+}
+
+// ECDSA, the signature is r || s (BSI TR-03111), DER encoded signatures are accepted as well
+static int EcdsaVerify(const CachedKey* key,
+					   const unsigned char* signature,
+					   int signatureLength,
+					   unsigned char* challenge,
+					   int signatureHash) {
+	unsigned char r[ECC_MAX_BYTES], s[ECC_MAX_BYTES];
+	unsigned char digest[AA_MAX_DIGEST];
+	int len = key->grp->orderByteLength;
+
+	if (signatureLength == 2 * len) {
+		memcpy(r, signature, len);
+		memcpy(s, &signature[len], len);
+	} else {
+		// ECDSA-Sig-Value ::= SEQUENCE { r INTEGER, s INTEGER }
+		const unsigned char *sequence, *values[2];
+		int sequenceLength, lengths[2];
+		unsigned int tags[2];
+		if (TlvFind(signature, signatureLength, 0x30, &sequence, &sequenceLength) != APP_SUCCESS ||
+			TlvSplit(sequence, sequenceLength, tags, values, lengths, 2) != 2 || tags[0] != 0x02 ||
+			tags[1] != 0x02) {
+			return APP_ERROR;
+		}
+		for (int i = 0; i < 2; i++) {
+			while (lengths[i] > 0 && values[i][0] == 0x00) {
+				values[i]++;
+				lengths[i]--;
+			}
+			if (lengths[i] > len) {
+				return APP_ERROR;
+			}
+		}
+		memset(r, 0, len);
+		memset(s, 0, len);
+		memcpy(&r[len - lengths[0]], values[0], lengths[0]);
+		memcpy(&s[len - lengths[1]], values[1], lengths[1]);
+	}
+
+	int digestLength = DigestCompute(signatureHash, challenge, AA_CHALLENGE_LENGTH, digest);
+	if (digestLength == APP_ERROR || ecdsa_verify(key->grp, &key->q, digest, digestLength, r, s)) {
+		return APP_ERROR;
+	}
+	return APP_SUCCESS;
+}
+
+long ReadDG15(SecureMessagingSession* session, unsigned char* dg15, int* dg15Length) {
+	// Unprotected command: 0x00, 0xA4, 0x02, 0x0C, 0x02, 0x01, 0x0F
+	unsigned char selectDataGroup15CmdData[2] = {0x01, 0x0F};
+	int ret = ProtectedReadFile(selectDataGroup15CmdData, dg15, AA_MAX_DG15, dg15Length, session);
+	if (ret != APP_SUCCESS) {
+		printf("Fail to Read DG15.\n");
+		return ret;
+	}
+	return APP_SUCCESS;
+}
+
+int ParseActiveAuthenticationInfo(const unsigned char* dg14, int dg14Length, int* signatureHash) {
+	const unsigned char *content, *securityInfos;
+	int contentLength, securityInfosLength;
+	if (TlvFind(dg14, dg14Length, 0x6E, &content, &contentLength) != APP_SUCCESS ||
+		TlvFind(content, contentLength, 0x31, &securityInfos, &securityInfosLength) !=
+			APP_SUCCESS) {
+		return APP_ERROR;
+	}
+
+	int pos = 0;
+	while (pos < securityInfosLength) {
+		unsigned int tag;
+		int length, headerLength;
+		if (TlvParse(&securityInfos[pos], securityInfosLength - pos, &tag, &length,
+					 &headerLength) != APP_SUCCESS) {
+			return APP_ERROR;
+		}
+		const unsigned char* info = &securityInfos[pos + headerLength];
+		pos += headerLength + length;
+
+		// ActiveAuthenticationInfo ::= SEQUENCE { id-AA, version INTEGER, signatureAlgorithm OID }
+		const unsigned char* fields[3];
+		int fieldLengths[3];
+		unsigned int fieldTags[3];
+		if (tag != 0x30 || TlvSplit(info, length, fieldTags, fields, fieldLengths, 3) != 3 ||
+			fieldTags[0] != 0x06 || fieldLengths[0] != sizeof(AA_OID) ||
+			memcmp(fields[0], AA_OID, sizeof(AA_OID)) || fieldTags[2] != 0x06) {
+			continue;
+		}
+		if (fieldLengths[2] == sizeof(ECDSA_SHA1_OID) &&
+			!memcmp(fields[2], ECDSA_SHA1_OID, sizeof(ECDSA_SHA1_OID))) {
+			*signatureHash = AA_HASH_SHA1;
+			return APP_SUCCESS;
+		}
+		if (fieldLengths[2] == sizeof(ECDSA_SHA2_OID) + 1 &&
+			!memcmp(fields[2], ECDSA_SHA2_OID, sizeof(ECDSA_SHA2_OID)) &&
+			fields[2][sizeof(ECDSA_SHA2_OID)] >= 1 && fields[2][sizeof(ECDSA_SHA2_OID)] <= 4) {
+			// ecdsa-with-SHA224, SHA256, SHA384, SHA512
+			*signatureHash = AA_HASH_SHA224 + fields[2][sizeof(ECDSA_SHA2_OID)] - 1;
+			return APP_SUCCESS;
+		}
+	}
+	return APP_ERROR;
+}
+
+long ActiveAuthenticate(SecureMessagingSession* session,
+						const unsigned char* dg15,
+						int dg15Length,
+						int signatureHash) {
+	unsigned char challenge[AA_CHALLENGE_LENGTH];
+	unsigned char command[5 + AA_CHALLENGE_LENGTH + 1];
+	unsigned char response[SM_MAX_PROTECTED_RESPONSE];
+	int responseLength;
+
+	// DG15 ::= [APPLICATION 15] SubjectPublicKeyInfo
+	const unsigned char* spki;
+	int spkiLength;
+	const CachedKey* key = NULL;
+	if (TlvFind(dg15, dg15Length, 0x6F, &spki, &spkiLength) == APP_SUCCESS) {
+		key = KeyCacheGet(spki, spkiLength);
+	}
+	if (key == NULL) {
+		printf("Invalid Active Authentication public key.\n");
+		return APP_ERROR;
+	}
+
+	// Internal Authenticate: 0x00, 0x88, 0x00, 0x00, 0x08, RND.IFD, 0x00
+	unsigned char internalAuthenticateCommand[5] = {0x00, 0x88, 0x00, 0x00, AA_CHALLENGE_LENGTH};
+	if (RandomNonceGenerate(challenge, AA_CHALLENGE_LENGTH) != APP_SUCCESS) {
+		printf("Fail to Generate Random Nonce.\n");
+		return APP_ERROR;
+	}
+	memcpy(command, internalAuthenticateCommand, 5);
+	memcpy(&command[5], challenge, AA_CHALLENGE_LENGTH);
+	command[5 + AA_CHALLENGE_LENGTH] = 0x00;
+	int ret = ProtectedTransmitAPDU(session, command, sizeof(command), response, &responseLength);
+	if (ret != APP_SUCCESS) {
+		printf("Fail to Internal Authenticate.\n");
+		return ret;
+	}
+
+	if (key->type == AA_KEY_RSA) {
+		ret = RsaVerify(&key->rsa, response, responseLength, challenge);
+	} else {
+		ret = EcdsaVerify(key, response, responseLength, challenge, signatureHash);
+	}
+	if (ret != APP_SUCCESS) {
+		printf("Invalid Active Authentication signature.\n");
+	}
+	return ret;
+}
@@ -0,0 +1,476 @@
+/**
+ * @author Khoa Nguyen
+ * @file audit.c
+ * @brief Source file for the offline verification of recorded secure messaging sessions.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <access/audit.h>
+#include <access/passive_authentication.h>
+#include <access/secure_message.h>
+#include <utils/allocator.h>
+#include <utils/reader.h>
+#include <utils/sync.h>
+#include <utils/tlv.h>
+
+#define AUDIT_MAX_FILES		  0x20	// Files 0100 to 011F: the data groups, EF.SOD and EF.COM
+#define AUDIT_MAX_FILE_LENGTH (0x8000 + 256)  // Largest offset of READ BINARY plus one chunk
+#define AUDIT_SOD_FILE		  0x1D
+#define AUDIT_NO_FILE		  -1
+
+#define AUDIT_SLOT_FREE	 0
+#define AUDIT_SLOT_READY 1	// Filled by the reader, waiting for a worker
+#define AUDIT_SLOT_BUSY	 2
+
+// A file rebuilt from the READ BINARY responses of a session
+typedef struct {
+	unsigned char* content;	 // AUDIT_MAX_FILE_LENGTH bytes, allocated on first use
+	int length;				 // Bytes read contiguously from offset 0
+	int read;				 // The file was read in this session
+} AuditFile;
+
+// Buffers of a worker, kept from one session to the next
+typedef struct {
+	AuditFile files[AUDIT_MAX_FILES];
+} AuditWorkspace;
+
+// Session record waiting in the queue
+typedef struct {
+	unsigned char* record;
+	int length;
+	int capacity;
+	long long session;
+	int state;	// AUDIT_SLOT_*
+} AuditSlot;
+
+typedef struct {
+	SyncLock lock;
+	SyncCondition changed;	// A slot changed state or the reader is done
+	AuditSlot slots[AUDIT_QUEUE_LENGTH];
+	int head;  // Next slot to verify
+	int tail;  // Next slot to fill
+	int done;  // No more records
+	AuditCallback callback;
+	void* context;
+	long long sessions;
+	long long failed;
+} AuditQueue;
+
+static int ReadLength(const unsigned char* buf) {
+	return buf[0] | buf[1] << 8;
+}
+
+// Adds delta to the SSC, a big-endian counter of length bytes
+static void AddToCounter(unsigned char* counter, int length, int delta) {
+	int carry = delta;
+	for (int i = length - 1; i >= 0 && carry != 0; i--) {
+		int sum	   = counter[i] + carry;
+		counter[i] = (unsigned char)sum;
+		carry	   = sum >> 8;	// Arithmetic shift, negative for a borrow
+	}
+}
+
+/**
+ * @brief Verifies a protected command or response, trying the SSC values around the expected one
+ * if the MAC does not verify.
+ *
+ * @return APP_SUCCESS if the MAC verified, the session then continues from the SSC that matched.
+ */
+static int ReplayApdu(SecureMessagingSession* session,
+					  int command,
+					  const unsigned char* apdu,
+					  int apduLength,
+					  unsigned char* data,
+					  int* dataLength,
+					  unsigned int* statusWord,
+					  int* verdict) {
+	SecureMessagingSession probe;
+
+	for (int delta = 0; delta <= 2 * AUDIT_SSC_WINDOW; delta++) {
+		// 0, 1, -1, 2, -2 and so on
+		int offset = delta % 2 ? (delta + 1) / 2 : -delta / 2;
+		probe	   = *session;
+		AddToCounter(probe.sendSequenceCounter, probe.blockSize, offset);
+		int res = command
+					  ? SecureMessagingUnwrapCommand(&probe, apdu, apduLength, data, dataLength)
+					  : SecureMessagingUnwrap(&probe, apdu, apduLength, data, dataLength,
+											  statusWord);
+		if (res == APP_SUCCESS) {
+			if (offset != 0) {
+				*verdict |= AUDIT_SSC_GAP;
+			}
+			*session = probe;
+			return APP_SUCCESS;
+		}
+	}
+	*verdict |= AUDIT_BAD_MAC;
+	return APP_ERROR;
+}
+
+// Copies a READ BINARY response into the file being rebuilt
+static int StoreChunk(AuditFile* file, int offset, const unsigned char* data, int length) {
+	if (offset + length > AUDIT_MAX_FILE_LENGTH) {
+		return APP_ERROR;
+	}
+	if (file->content == NULL) {
+		file->content = AllocatorMalloc(AUDIT_MAX_FILE_LENGTH);
+	}
+	if (file->content == NULL) {
+		return APP_ERROR;
+	}
+	file->read = 1;
+	if (offset <= file->length) {
+		memcpy(&file->content[offset], data, length);
+		if (offset + length > file->length) {
+			file->length = offset + length;
+		}
+	}
+	return APP_SUCCESS;
+}
+
+// Length of the BER-TLV object of a file, or APP_ERROR if it was not read whole
+static int FileLength(const AuditFile* file) {
+	unsigned int tag;
+	int length, headerLength;
+
+	if (TlvParseHeader(file->content, file->length, &tag, &length, &headerLength) !=
+			APP_SUCCESS ||
+		headerLength + length > file->length) {
+		return APP_ERROR;
+	}
+	return headerLength + length;
+}
+
+// Compares the data groups read with the hashes of EF.SOD
+static void CheckDataGroups(const AuditWorkspace* workspace, AuditResult* result) {
+	const AuditFile* sodFile = &workspace->files[AUDIT_SOD_FILE];
+	unsigned char digest[HASH_MAX_DIGEST_LENGTH];
+	SodInfo sod;
+	int sodLength = AUDIT_NO_FILE;
+
+	if (sodFile->read && (sodLength = FileLength(sodFile)) != APP_ERROR &&
+		ParseSOD(sodFile->content, sodLength, &sod) != APP_SUCCESS) {
+		result->verdict |= AUDIT_MALFORMED;
+		return;
+	}
+	for (int dataGroup = 1; dataGroup <= PA_MAX_DATA_GROUPS; dataGroup++) {
+		const AuditFile* file = &workspace->files[dataGroup];
+		int i, length;
+		if (!file->read) {
+			continue;
+		}
+		if (!sodFile->read || sodLength == APP_ERROR) {
+			result->verdict |= AUDIT_NO_SOD;
+			continue;
+		}
+
+		// A data group read in part, as by an aborted read, has no hash to compare
+		if ((length = FileLength(file)) == APP_ERROR) {
+			continue;
+		}
+		for (i = 0; i < sod.dataGroupCount && sod.dataGroups[i] != dataGroup; i++) {
+		}
+		if (i == sod.dataGroupCount) {
+			result->verdict |= AUDIT_UNLISTED;
+			continue;
+		}
+		hash_compute(sod.hashAlgorithm, file->content, length, digest);
+		if (memcmp(digest, sod.dataGroupHashes[i], hash_length(sod.hashAlgorithm))) {
+			result->verdict |= AUDIT_BAD_HASH;
+		} else {
+			result->dataGroups++;
+		}
+	}
+}
+
+static void ReplaySession(const unsigned char* record,
+						  int recordLength,
+						  AuditWorkspace* workspace,
+						  AuditResult* result) {
+	SecureMessagingSession session;
+	unsigned char command[SM_MAX_PROTECTED_COMMAND], data[SM_MAX_PROTECTED_RESPONSE];
+	int commandLength, dataLength, exchanges, keyLength, blockSize, position;
+	int current = AUDIT_NO_FILE;
+	unsigned int statusWord;
+
+	result->verdict	   = AUDIT_VALID;
+	result->exchanges  = 0;
+	result->dataGroups = 0;
+	for (int i = 0; i < AUDIT_MAX_FILES; i++) {
+		workspace->files[i].length = 0;
+		workspace->files[i].read   = 0;
+	}
+
+	// Header, session keys and SSC
+	if (recordLength < AUDIT_HEADER_SIZE || memcmp(record, AUDIT_MAGIC, 4) || record[4] > 1) {
+		result->verdict = AUDIT_MALFORMED;
+		return;
+	}
+	keyLength = record[5];
+	if ((keyLength != 16 && keyLength != 24 && keyLength != 32) ||
+		(record[4] == SM_CIPHER_3DES && keyLength != 16)) {
+		result->verdict = AUDIT_MALFORMED;
+		return;
+	}
+	blockSize = record[4] == SM_CIPHER_AES ? 16 : 8;
+	exchanges = ReadLength(&record[6]);
+	position  = AUDIT_HEADER_SIZE + 2 * keyLength + blockSize;
+	if (recordLength < position) {
+		result->verdict = AUDIT_MALFORMED;
+		return;
+	}
+	SecureMessagingInit(&session, record[4], &record[AUDIT_HEADER_SIZE],
+						&record[AUDIT_HEADER_SIZE + keyLength], keyLength,
+						&record[AUDIT_HEADER_SIZE + 2 * keyLength]);
+
+	for (; result->exchanges < exchanges; result->exchanges++) {
+		const unsigned char *protectedCommand, *protectedResponse;
+		int protectedCommandLength, protectedResponseLength;
+
+		if (recordLength - position < 2 ||
+			(protectedCommandLength = ReadLength(&record[position])) >
+				recordLength - position - 4 ||
+			protectedCommandLength > SM_MAX_PROTECTED_COMMAND ||
+			(protectedResponseLength =
+				 ReadLength(&record[position + 2 + protectedCommandLength])) >
+				recordLength - position - 4 - protectedCommandLength ||
+			protectedResponseLength > SM_MAX_PROTECTED_RESPONSE) {
+			result->verdict |= AUDIT_MALFORMED;
+			return;
+		}
+		protectedCommand  = &record[position + 2];
+		protectedResponse = &record[position + 4 + protectedCommandLength];
+		position += 4 + protectedCommandLength + protectedResponseLength;
+
+		if (ReplayApdu(&session, 1, protectedCommand, protectedCommandLength, command,
+					   &commandLength, NULL, &result->verdict) != APP_SUCCESS ||
+			ReplayApdu(&session, 0, protectedResponse, protectedResponseLength, data,
+					   &dataLength, &statusWord, &result->verdict) != APP_SUCCESS) {
+			return;
+		}
+
+		// SELECT by file identifier, READ BINARY by offset or by short file identifier
+		if (command[1] == 0xA4 && commandLength >= 7 && command[4] == 2) {
+			current = command[5] == 0x01 && command[6] < AUDIT_MAX_FILES ? command[6]
+																		 : AUDIT_NO_FILE;
+		} else if (command[1] == 0xB0 && (statusWord == 0x9000 || statusWord == 0x6282)) {
+			int offset = (command[2] & 0x7F) << 8 | command[3];
+			if (command[2] & 0x80) {
+				current = command[2] & 0x1F;
+				offset	= command[3];
+			}
+			if (current != AUDIT_NO_FILE &&
+				StoreChunk(&workspace->files[current], offset, data, dataLength) != APP_SUCCESS) {
+				result->verdict |= AUDIT_MALFORMED;
+			}
+		}
+	}
+	CheckDataGroups(workspace, result);
+}
+
+static void FreeWorkspace(AuditWorkspace* workspace) {
+	for (int i = 0; i < AUDIT_MAX_FILES; i++) {
+		AllocatorFree(workspace->files[i].content);
+	}
+}
+
+long AuditSession(const unsigned char* record, int recordLength, AuditResult* result) {
+	AuditWorkspace* workspace = AllocatorCalloc(1, sizeof(AuditWorkspace));
+	if (workspace == NULL) {
+		return APP_ERROR;
+	}
+	result->session = 0;
+	ReplaySession(record, recordLength, workspace, result);
+	FreeWorkspace(workspace);
+	AllocatorFree(workspace);
+	return result->verdict & AUDIT_FAILURES ? APP_ERROR : APP_SUCCESS;
+}
+
+static void AuditWorkerMain(void* argument) {
+	AuditQueue* queue		  = (AuditQueue*)argument;
+	AuditWorkspace* workspace = AllocatorCalloc(1, sizeof(AuditWorkspace));
+	AuditResult result;
+
+	for (;;) {
+		SyncLockExclusive(&queue->lock);
+		while (queue->slots[queue->head].state != AUDIT_SLOT_READY && !queue->done) {
+			SyncWait(&queue->changed, &queue->lock);
+		}
+		AuditSlot* slot = &queue->slots[queue->head];
+		if (slot->state != AUDIT_SLOT_READY) {
+			SyncUnlockExclusive(&queue->lock);
+			break;
+		}
+		slot->state = AUDIT_SLOT_BUSY;
+		queue->head = (queue->head + 1) % AUDIT_QUEUE_LENGTH;
+		SyncUnlockExclusive(&queue->lock);
+
+		result.session = slot->session;
+		if (workspace != NULL) {
+			ReplaySession(slot->record, slot->length, workspace, &result);
+		} else {
+			result.verdict = AUDIT_MALFORMED;
+		}
+
+		SyncLockExclusive(&queue->lock);
+		queue->sessions++;
+		if (result.verdict & AUDIT_FAILURES) {
+			queue->failed++;
+		}
+		if (queue->callback != NULL) {
+			queue->callback(&result, queue->context);
+		}
+		slot->state = AUDIT_SLOT_FREE;
+		SyncWakeAll(&queue->changed);
+		SyncUnlockExclusive(&queue->lock);
+	}
+
+	if (workspace != NULL) {
+		FreeWorkspace(workspace);
+		AllocatorFree(workspace);
+	}
+}
+
+// Appends bytes of the transcript to the record of a slot
+static int ReadRecordBytes(FILE* file, AuditSlot* slot, int length) {
+	if (slot->length + length > slot->capacity) {
+		int capacity		  = (slot->length + length) * 2;
+		unsigned char* record = AllocatorRealloc(slot->record, capacity);
+		if (record == NULL) {
+			return APP_ERROR;
+		}
+		slot->record   = record;
+		slot->capacity = capacity;
+	}
+	if (fread(&slot->record[slot->length], 1, length, file) != (size_t)length) {
+		return APP_ERROR;
+	}
+	slot->length += length;
+	return APP_SUCCESS;
+}
+
+/**
+ * @brief Reads the next session record of a transcript.
+ * @return 1 if a record was read, 0 at the end of the file, APP_ERROR if the record is truncated.
+ */
+static int ReadRecord(FILE* file, AuditSlot* slot) {
+	int c = fgetc(file);
+	if (c == EOF) {
+		return 0;
+	}
+	ungetc(c, file);
+
+	slot->length = 0;
+	if (ReadRecordBytes(file, slot, AUDIT_HEADER_SIZE) != APP_SUCCESS ||
+		memcmp(slot->record, AUDIT_MAGIC, 4)) {
+		return APP_ERROR;
+	}
+	int keyLength = slot->record[5];
+	int exchanges = ReadLength(&slot->record[6]);
+	if (ReadRecordBytes(file, slot, 2 * keyLength + (slot->record[4] ? 16 : 8)) != APP_SUCCESS) {
+		return APP_ERROR;
+	}
+	for (int i = 0; i < 2 * exchanges; i++) {
+		if (ReadRecordBytes(file, slot, 2) != APP_SUCCESS ||
+			ReadRecordBytes(file, slot, ReadLength(&slot->record[slot->length - 2])) !=
+				APP_SUCCESS) {
+			return APP_ERROR;
+		}
+	}
+	return 1;
+}
+
+long AuditTranscript(const char* path,
+					 int threads,
+					 AuditCallback callback,
+					 void* context,
+					 AuditSummary* summary) {
+	FILE* file = NULL;
+	SyncThread* workers;
+	AuditQueue* queue;
+	long res = APP_SUCCESS;
+	int started, read;
+
+	if (fopen_s(&file, path, "rb") != 0 || file == NULL) {
+		printf("Fail to Open transcript.\n");
+		return APP_ERROR;
+	}
+	if (threads <= 0) {
+		threads = SyncProcessorCount();
+	}
+	queue	= AllocatorCalloc(1, sizeof(AuditQueue));
+	workers = AllocatorCalloc(threads, sizeof(SyncThread));
+	if (queue == NULL || workers == NULL) {
+		AllocatorFree(queue);
+		AllocatorFree(workers);
+		fclose(file);
+		return APP_ERROR;
+	}
+	queue->callback = callback;
+	queue->context	= context;
+
+	long long start = SyncTicks();
+	for (started = 0; started < threads; started++) {
+		if (SyncThreadStart(&workers[started], AuditWorkerMain, queue) != 0) {
+			break;
+		}
+	}
+
+	// The reader fills the slots in order, a slot is refilled once its session is verified
+	for (long long session = 0;; session++) {
+		AuditSlot* slot = &queue->slots[queue->tail];
+		SyncLockExclusive(&queue->lock);
+		while (slot->state != AUDIT_SLOT_FREE) {
+			SyncWait(&queue->changed, &queue->lock);
+		}
+		SyncUnlockExclusive(&queue->lock);
+
+		if ((read = ReadRecord(file, slot)) != 1) {
+			if (read == APP_ERROR) {
+				printf("Truncated transcript after %lld sessions.\n", session);
+				res = APP_ERROR;
+			}
+			break;
+		}
+		slot->session = session;
+
+		SyncLockExclusive(&queue->lock);
+		slot->state = AUDIT_SLOT_READY;
+		queue->tail = (queue->tail + 1) % AUDIT_QUEUE_LENGTH;
+		SyncWakeAll(&queue->changed);
+		SyncUnlockExclusive(&queue->lock);
+
+		// Without workers, the reader verifies the sessions itself
+		if (started == 0) {
+			queue->done = 1;
+			AuditWorkerMain(queue);
+			queue->done = 0;
+		}
+	}
+	fclose(file);
+
+	SyncLockExclusive(&queue->lock);
+	queue->done = 1;
+	SyncWakeAll(&queue->changed);
+	SyncUnlockExclusive(&queue->lock);
+	for (int i = 0; i < started; i++) {
+		SyncThreadJoin(&workers[i]);
+	}
+
+	if (summary != NULL) {
+		summary->sessions		   = queue->sessions;
+		summary->failed			   = queue->failed;
+		summary->threads		   = started > 0 ? started : 1;
+		summary->seconds		   = (double)(SyncTicks() - start) / SyncTicksPerSecond();
+		summary->sessionsPerSecond =
+			summary->seconds > 0 ? queue->sessions / summary->seconds : 0;
+	}
+	for (int i = 0; i < AUDIT_QUEUE_LENGTH; i++) {
+		AllocatorFree(queue->slots[i].record);
+	}
+	AllocatorFree(queue);
+	AllocatorFree(workers);
+	return res;
+}
@@ -15,15 +15,16 @@
 #include <access/bac_application.h>
 #include <access/secure_message.h>
 #include <cryptography/des.h>
-#include <cryptography/mac3.h>
+#include <cryptography/provider.h>
 #include <cryptography/sha1.h>
 #include <utils/reader.h>
+#include <utils/tlv.h>
 #include <utils/util.h>
 
 void KeySeedCalculate(unsigned char mrzInformation[], unsigned char mrzKeySeed[16]) {
 	// Kseed = first 16 bytes of the hash
 	unsigned char mrzInformationDigest[20];
-	sha1(mrzInformation, (int)strlen((char*)mrzInformation), mrzInformationDigest);
+	crypto_sha1(mrzInformation, (int)strlen((char*)mrzInformation), mrzInformationDigest);
 	memcpy(mrzKeySeed, mrzInformationDigest, 16);
 }
 
@@ -41,13 +42,51 @@ void SessionKeyGenerate(unsigned char keySeed[16],
 	d2[19] = 0x02;
 
 	// 3DES key KEnc and KMAC = first 16 bytes of each hash
-	sha1((unsigned char*)d1, 20, d1digest);
-	sha1((unsigned char*)d2, 20, d2digest);
+	crypto_sha1(d1, 20, d1digest);
+	crypto_sha1(d2, 20, d2digest);
 
 	memcpy(encryptKeyBuf, d1digest, 16);
 	memcpy(macKeyBuf, d2digest, 16);
 }
 
+void SessionKeyBatchGenerate(unsigned char* mrzInformation[],
+							 int count,
+							 unsigned char encryptKeyBuf[][16],
+							 unsigned char macKeyBuf[][16]) {
+	const unsigned char* input[2 * BAC_KEY_BATCH];
+	unsigned char* output[2 * BAC_KEY_BATCH];
+	long long length[2 * BAC_KEY_BATCH];
+	unsigned char d[2 * BAC_KEY_BATCH][20], digest[2 * BAC_KEY_BATCH][20];
+
+	for (int first = 0; first < count; first += BAC_KEY_BATCH) {
+		int n = count - first < BAC_KEY_BATCH ? count - first : BAC_KEY_BATCH;
+
+		// Kseed = first 16 bytes of the hash
+		for (int i = 0; i < n; i++) {
+			input[i]  = mrzInformation[first + i];
+			length[i] = (long long)strlen((char*)mrzInformation[first + i]);
+			output[i] = digest[i];
+		}
+		sha1_multi(input, length, output, n);
+
+		// D = Kseed || c, D1 (c = 1 for KEnc) and D2 (c = 2 for KMAC) alternate
+		for (int i = 0; i < 2 * n; i++) {
+			memcpy(d[i], digest[i / 2], 16);
+			memset(&d[i][16], 0x00, 3);
+			d[i][19]  = (unsigned char)(i % 2 + 1);
+			input[i]  = d[i];
+			length[i] = 20;
+			output[i] = digest[i];
+		}
+		sha1_multi(input, length, output, 2 * n);
+
+		for (int i = 0; i < n; i++) {
+			memcpy(encryptKeyBuf[first + i], digest[2 * i], 16);
+			memcpy(macKeyBuf[first + i], digest[2 * i + 1], 16);
+		}
+	}
+}
+
 long InitReader(void) {
 	long ret = InitializeReader();
 	if (ret != APP_SUCCESS) {
@@ -89,14 +128,57 @@ long SelectApplication(void) {
 	return APP_SUCCESS;
 }
 
+long ProtectedSelectApplication(SecureMessagingSession* session) {
+	// (AID for BAC application) over secure messaging, as required after PACE
+	unsigned char selectApplicationCommand[] = {0x00, 0xA4, 0x04, 0x0C, 0x07, 0xA0,
+												0x00, 0x00, 0x02, 0x47, 0x10, 0x01};
+	unsigned char selectApplicationResponse[SM_MAX_PROTECTED_RESPONSE];
+	int selectApplicationResponseLength;
+	int ret = ProtectedTransmitAPDU(session, selectApplicationCommand,
+									sizeof(selectApplicationCommand), selectApplicationResponse,
+									&selectApplicationResponseLength);
+	if (ret != APP_SUCCESS) {
+		printf("Fail to Select Application.\n");
+		return ret;
+	}
+	return APP_SUCCESS;
+}
+
 long GetChallenge(unsigned char getChallengeResponse[10], int getChallengeResponseSize) {
 	// Expected response APDU: RND.IC (8 bytes) || 0x90 || 0x00
-	unsigned char getChallengeCommand[] = {0x00, 0x84, 0x00, 0x00, 0x08};
+	unsigned char getChallengeCommand[]		 = {0x00, 0x84, 0x00, 0x00, 0x08};
+	unsigned long getChallengeResponseLength = getChallengeResponseSize;
 	long ret = TransmitDataToCard(getChallengeCommand, sizeof(getChallengeCommand),
-								  getChallengeResponse, &getChallengeResponseSize);
-	if (ret != APP_SUCCESS) {
+								  getChallengeResponse, &getChallengeResponseLength);
+	if (ret != APP_SUCCESS || getChallengeResponseLength != 10 || getChallengeResponse[8] != 0x90 ||
+		getChallengeResponse[9] != 0x00) {
 		printf("Fail to Get Challenge.\n");
-		return ret;
+		return ret != APP_SUCCESS ? ret : APP_ERROR;
+	}
+	return APP_SUCCESS;
+}
+
+long BacCandidatesGenerate(unsigned char* mrzInformation[], int count, BacCandidate candidates[]) {
+	unsigned char encryptKeys[BAC_KEY_BATCH][16], macKeys[BAC_KEY_BATCH][16];
+	unsigned char nonces[BAC_KEY_BATCH][24];
+
+	for (int first = 0; first < count; first += BAC_KEY_BATCH) {
+		int n = count - first < BAC_KEY_BATCH ? count - first : BAC_KEY_BATCH;
+
+		// RND.IFD || K_IFD of the whole batch at once
+		SessionKeyBatchGenerate(&mrzInformation[first], n, encryptKeys, macKeys);
+		if (RandomNonceGenerate(nonces[0], n * 24) != APP_SUCCESS) {
+			printf("Fail to Generate Random Nonce.\n");
+			return APP_ERROR;
+		}
+
+		for (int i = 0; i < n; i++) {
+			BacCandidate* candidate = &candidates[first + i];
+			memcpy(candidate->encryptKey, encryptKeys[i], 16);
+			memcpy(candidate->macKey, macKeys[i], 16);
+			memcpy(candidate->randomNonceIFD, nonces[i], 8);
+			memcpy(candidate->keyIFD, &nonces[i][8], 16);
+		}
 	}
 	return APP_SUCCESS;
 }
@@ -104,22 +186,34 @@ long GetChallenge(unsigned char getChallengeResponse[10], int getChallengeRespon
 long ExternalAuthenticate(unsigned char getChallengeResponse[10],
 						  unsigned char encryptKey[16],
 						  unsigned char macKey[16],
-						  unsigned char sessionKeyEncrypt[16],
-						  unsigned char sessionKeyMac[16],
-						  unsigned char sendSequenceCounter[8]) {
+						  SecureMessagingSession* session) {
+	BacCandidate candidate;
+	memcpy(candidate.encryptKey, encryptKey, 16);
+	memcpy(candidate.macKey, macKey, 16);
+
+	// RND.IFD and K_IFD
+	if (RandomNonceGenerate(candidate.randomNonceIFD, 8) != APP_SUCCESS ||
+		RandomNonceGenerate(candidate.keyIFD, 16) != APP_SUCCESS) {
+		printf("Fail to Generate Random Nonce.\n");
+		return APP_ERROR;
+	}
+	return ExternalAuthenticateCandidate(getChallengeResponse, &candidate, session, NULL);
+}
+
+long ExternalAuthenticateCandidate(unsigned char getChallengeResponse[10],
+								   const BacCandidate* candidate,
+								   SecureMessagingSession* session,
+								   unsigned short* statusWord) {
+	const unsigned char* encryptKey		= candidate->encryptKey;
+	const unsigned char* macKey			= candidate->macKey;
+	const unsigned char* randomNonceIFD = candidate->randomNonceIFD;
+	const unsigned char* keyIFD			= candidate->keyIFD;
+
 	// Compute data for EXTERNAL AUTHENTICATE
 	// RND.IC
 	unsigned char challenge[8];
 	memcpy(challenge, getChallengeResponse, 8);
 
-	// RND.IFD
-	unsigned char randomNonceIFD[8];
-	RandomNonceGenerate((unsigned char*)randomNonceIFD, 8);
-
-	// K_IFD
-	unsigned char keyIFD[16];
-	RandomNonceGenerate((unsigned char*)keyIFD, 16);
-
 	// S = RND.IFD || RND.IC || K_IFD
 	unsigned char concatS[32];
 	memcpy(concatS, randomNonceIFD, 8);
@@ -128,14 +222,14 @@ long ExternalAuthenticate(unsigned char getChallengeResponse[10],
 
 	// E_IFD = encrypt S with 3DES key K_Enc
 	unsigned char encryptIFD[32];
-	des3_cbc_encrypt(encryptIFD, concatS, 32, encryptKey, 16, 0);
+	crypto_des3_cbc(MBEDTLS_DES_ENCRYPT, encryptKey, concatS, 32, encryptIFD);
 
 	// M_IFD = (MAC algorithm 3, DES cipher, Padding method 2) of E_IFD
 	unsigned char macIFD[8];
 	unsigned char paddedEncryptIFD[40];
 	memcpy(paddedEncryptIFD, encryptIFD, 32);
 	PadByteArray(paddedEncryptIFD, 32);
-	des_mac3_checksum(40, macIFD, paddedEncryptIFD, macKey);
+	crypto_mac3(macKey, paddedEncryptIFD, 40, macIFD);
 
 	// cmd_data = E_IFD || M_IFD
 	unsigned char externalAuthenticateCommandData[40];
@@ -153,10 +247,22 @@ long ExternalAuthenticate(unsigned char getChallengeResponse[10],
 	long ret =
 		TransmitDataToCard(externalAuthenticateCommand, sizeof(externalAuthenticateCommand),
 						   externalAuthenticateResponse, &externalAuthenticateResponseLength);
+	if (statusWord != NULL) {
+		*statusWord = 0;
+	}
 	if (ret != APP_SUCCESS) {
 		printf("Fail to External Authenticate.\n");
 		return ret;
 	}
+	if (statusWord != NULL && externalAuthenticateResponseLength >= 2) {
+		*statusWord = externalAuthenticateResponse[externalAuthenticateResponseLength - 2] << 8 |
+					  externalAuthenticateResponse[externalAuthenticateResponseLength - 1];
+	}
+	if (externalAuthenticateResponseLength != 42 || externalAuthenticateResponse[40] != 0x90 ||
+		externalAuthenticateResponse[41] != 0x00) {
+		printf("External Authenticate is refused by the card.\n");
+		return APP_ERROR;
+	}
 
 	// Verify response
 	unsigned char encryptIC[32], macIC[8];	// E_IC, M_IC
@@ -168,7 +274,7 @@ long ExternalAuthenticate(unsigned char getChallengeResponse[10],
 	unsigned char paddedMacCheckIC[40];
 	memcpy(paddedMacCheckIC, encryptIC, 32);
 	PadByteArray(paddedMacCheckIC, 32);
-	des_mac3_checksum(40, macCheckIC, paddedMacCheckIC, macKey);
+	crypto_mac3(macKey, paddedMacCheckIC, 40, macCheckIC);
 
 	if (memcmp(macIC, macCheckIC, 8)) {
 		printf("Invalid External Authenticate response.\n");
@@ -177,7 +283,7 @@ long ExternalAuthenticate(unsigned char getChallengeResponse[10],
 
 	// Decrypt E_IC to get R = RND.IC || RND.IFD || K.IC
 	unsigned char concatR[32];
-	des3_cbc_decrypt(concatR, encryptIC, 32, encryptKey, 16, 0);
+	crypto_des3_cbc(MBEDTLS_DES_DECRYPT, encryptKey, encryptIC, 32, concatR);
 
 	// Compare received RND.IFD with generated RND.IFD
 	unsigned char randomNonceIFDCheck[8];
@@ -195,355 +301,337 @@ long ExternalAuthenticate(unsigned char getChallengeResponse[10],
 	}
 
 	// KS_Enc, KS_MAC
+	unsigned char sessionKeyEncrypt[16], sessionKeyMac[16];
 	SessionKeyGenerate(sessionKeySeed, sessionKeyEncrypt, sessionKeyMac);
 
 	// SSC = RND.IC (4 least significant bytes) || RND.IFD (4 least significant bytes)
 	// SSC += 1 every time before a command or response APDU is generated
+	unsigned char sendSequenceCounter[8];
 	memcpy(sendSequenceCounter, &challenge[4], 4);
 	memcpy(&sendSequenceCounter[4], &randomNonceIFD[4], 4);
 
+	SecureMessagingInit(session, SM_CIPHER_3DES, sessionKeyEncrypt, sessionKeyMac, 16,
+						sendSequenceCounter);
+
 	return APP_SUCCESS;
 }
 
-long ReadEFCOM(unsigned char sessionKeyEncrypt[16],
-			   unsigned char sessionKeyMac[16],
-			   unsigned char sendSequenceCounter[8]) {
-	// Construct protected APDU command to Select EF.COM
-	// Unprotected command: 0x00, 0xA4, 0x02, 0x0C, 0x02, 0x01, 0x1E
-	unsigned char selectEFCOMCmdData[2] = {0x01, 0x1E};
-	int ret = ProtectedSelectAPDU(selectEFCOMCmdData, sendSequenceCounter, sessionKeyEncrypt,
-								  sessionKeyMac);
-	if (ret != APP_SUCCESS) {
-		printf("Fail to Select EF.COM.\n");
-		return ret;
+// Print the value of a data object of EF.COM as characters, nothing if it is absent
+static void PrintEFCOMObject(const unsigned char* objects, int objectsLength, unsigned int tag) {
+	const unsigned char* value;
+	int length;
+	if (TlvFind(objects, objectsLength, tag, &value, &length) == APP_SUCCESS) {
+		printf("%.*s", length, value);
+	}
+}
+
+// Data group of a tag of the EF.COM tag list, 0 if it is not one
+static int DataGroupFromTag(unsigned char tag) {
+	static const unsigned char dataGroupTags[16] = {0x61, 0x75, 0x63, 0x76, 0x65, 0x66, 0x67, 0x68,
+													0x69, 0x6A, 0x6B, 0x6C, 0x6D, 0x6E, 0x6F, 0x70};
+	for (int i = 0; i < 16; i++) {
+		if (dataGroupTags[i] == tag) {
+			return i + 1;
+		}
+	}
+	return 0;
+}
+
+long EFCOMDataGroups(const unsigned char* efCom, int efComLength, unsigned int* dataGroups) {
+	unsigned int tag;
+	int length, headerLength;
+	const unsigned char* tagList;
+	int tagListLength;
+	if (TlvParse(efCom, efComLength, &tag, &length, &headerLength) != APP_SUCCESS || tag != 0x60 ||
+		TlvFind(&efCom[headerLength], length, 0x5C, &tagList, &tagListLength) != APP_SUCCESS) {
+		return APP_ERROR;
 	}
 
-	// Read Binary 26 bytes of EF.COM
-	// Unprotected command APDU: 0x00, 0xB0, 0x00, 0x00, 0x04
-	unsigned char readBinaryEFCOMCmdHeader[4] = {0x0C, 0xB0, 0x00, 0x00};
-	unsigned char readBinaryEFCOMResponse[32];
-	ret = ProtectedReadBinaryAPDU(readBinaryEFCOMCmdHeader, 0x1A, readBinaryEFCOMResponse,
-								  sendSequenceCounter, sessionKeyEncrypt, sessionKeyMac);
+	*dataGroups = 0;
+	for (int i = 0; i < tagListLength; i++) {
+		int dataGroup = DataGroupFromTag(tagList[i]);
+		if (dataGroup != 0) {
+			*dataGroups |= DG_MASK(dataGroup);
+		}
+	}
+	return APP_SUCCESS;
+}
+
+long ReadEFCOM(SecureMessagingSession* session, unsigned int* dataGroups) {
+	// Read EF.COM, its length comes from its first bytes
+	// Unprotected command: 0x00, 0xA4, 0x02, 0x0C, 0x02, 0x01, 0x1E
+	unsigned char selectEFCOMCmdData[2] = {0x01, 0x1E};
+	unsigned char readBinaryEFCOMResponse[EF_COM_MAX_LENGTH];
+	int efComLength;
+	int ret = ProtectedReadFile(selectEFCOMCmdData, readBinaryEFCOMResponse,
+								sizeof(readBinaryEFCOMResponse), &efComLength, session);
 	if (ret != APP_SUCCESS) {
-		printf("Fail to Read Binary of EF.COM.\n");
+		printf("Fail to Read EF.COM.\n");
 		return ret;
 	}
 
 #if DEBUG
 	printf("EF.COM: ");
-	for (int i = 0; i < 32; i++) {
+	for (int i = 0; i < efComLength; i++) {
 		printf("%02X ", readBinaryEFCOMResponse[i]);
 	}
 	printf("\n");
 #endif
 
+	// EF.COM = '60' || LDS version (5F01) || Unicode version (5F36) || tag list (5C)
+	unsigned int tag;
+	int length, headerLength;
+	if (TlvParse(readBinaryEFCOMResponse, efComLength, &tag, &length, &headerLength) !=
+			APP_SUCCESS ||
+		tag != 0x60) {
+		printf("Invalid EF.COM.\n");
+		return APP_ERROR;
+	}
+	const unsigned char* objects = &readBinaryEFCOMResponse[headerLength];
+
 	printf("\nEF.COM");
 	printf("\n> LDS Version number: ");
-	for (int i = 0; i < 4; i++) {
-		printf("%c", readBinaryEFCOMResponse[i + 5]);
-	}
+	PrintEFCOMObject(objects, length, 0x5F01);
 	printf("\n> Unicode Version: ");
-	for (int i = 0; i < 6; i++) {
-		printf("%c", readBinaryEFCOMResponse[i + 12]);
-	}
+	PrintEFCOMObject(objects, length, 0x5F36);
 	printf("\n> Tag list: ");
-	for (int i = 0; i < readBinaryEFCOMResponse[19]; i++) {
-		printf("%02X ", readBinaryEFCOMResponse[i + 20]);
+	const unsigned char* tagList;
+	int tagListLength;
+	if (TlvFind(objects, length, 0x5C, &tagList, &tagListLength) != APP_SUCCESS) {
+		printf("\nEF.COM has no tag list.\n");
+		return APP_ERROR;
+	}
+	for (int i = 0; i < tagListLength; i++) {
+		printf("%02X ", tagList[i]);
 	}
 	printf("\n");
 
+	if (dataGroups != NULL) {
+		return EFCOMDataGroups(readBinaryEFCOMResponse, efComLength, dataGroups);
+	}
 	return APP_SUCCESS;
 }
 
-long ReadDG1(unsigned char sessionKeyEncrypt[16],
-			 unsigned char sessionKeyMac[16],
-			 unsigned char sendSequenceCounter[8]) {
-	// Construct protected APDU command to Select DG1
-	// Unprotected command: 0x00, 0xA4, 0x02, 0x0C, 0x02, 0x01, 0x01
-	unsigned char selectDataGroup1CmdData[2] = {0x01, 0x01};
-	int ret = ProtectedSelectAPDU(selectDataGroup1CmdData, sendSequenceCounter, sessionKeyEncrypt,
-								  sessionKeyMac);
-	if (ret != APP_SUCCESS) {
-		printf("Fail to Select DG1.\n");
-		return ret;
+// Field of a data group at a fixed offset
+typedef struct {
+	const char* name;
+	int offset;
+	int length;
+} FieldLayout;
+
+// Fields of the 90 characters of a TD1 MRZ
+static const FieldLayout dataGroup1Layout[] = {
+	{"Document code", 5, 2},
+	{"Issuing State or Organization", 7, 3},
+	{"Document number", 10, 9},
+	// Optional data and /or in the case of a Document Number exceeding nine characters, least
+	// significant characters of document number plus document number check digit plus filler
+	// character
+	{"Remaining of Document number", 20, 15},
+	{"Date of birth", 35, 6},
+	{"Sex", 42, 1},
+	{"Date of Expiry", 43, 6},
+	{"Nationality", 50, 3},
+	{"Name of holder", 65, 30},
+};
+
+static const FieldLayout dataGroup13Layout[] = {
+	{"Card ID", 30, 12},
+	{"Full name", 49, 24},
+	{"Date of birth", 80, 10},
+	{"Gender", 97, 4},
+	{"Nationality", 108, 10},
+	{"Ethnicity", 125, 4},
+	{"Religion", 136, 6},
+	{"Place of origin", 149, 38},
+	{"Place of residence", 193, 66},
+	{"Personal identification", 266, 46},
+	{"Issued date", 319, 10},
+	{"Expiration date", 336, 10},
+	{"Father's name", 355, 19},
+	{"Mother's name", 378, 19},
+	{"Old number", 416, 12},
+};
+
+// Points the fields into the content, a field past the end of the content is cut short
+static void ParseFields(DataGroupFields* fields, const FieldLayout layout[], int count) {
+	fields->count = count;
+	for (int i = 0; i < count; i++) {
+		int offset = layout[i].offset < fields->length ? layout[i].offset : fields->length;
+		int length = fields->length - offset;
+
+		fields->fields[i].name	 = layout[i].name;
+		fields->fields[i].value	 = &fields->content[offset];
+		fields->fields[i].length = layout[i].length < length ? layout[i].length : length;
+	}
+}
+
+static void PrintFields(const char* title, const DataGroupFields* fields) {
+	printf("\n%s", title);
+	for (int i = 0; i < fields->count; i++) {
+		printf("\n> %s: ", fields->fields[i].name);
+		fwrite(fields->fields[i].value, 1, fields->fields[i].length, stdout);
 	}
+	printf("\n");
+}
 
-	// Read Binary of 95 bytes of DG1
-	// Unprotected command APDU: 0x00, 0xB0, 0x00, 0x00, 0x04
-	unsigned char readBinaryDataGroup1CmdHeader[4] = {0x0C, 0xB0, 0x00, 0x00};
-	unsigned char readBinaryDataGroup1Response[96];	 // 95 bytes with padding
-	ret = ProtectedReadBinaryAPDU(readBinaryDataGroup1CmdHeader, 0x5F, readBinaryDataGroup1Response,
-								  sendSequenceCounter, sessionKeyEncrypt, sessionKeyMac);
+long ReadDG1(SecureMessagingSession* session, hash_ctx* dgHash, DataGroupFields* fields) {
+	DataGroupFields localFields;
+	if (fields == NULL) {
+		fields = &localFields;
+	}
+
+	// Read DG1, the chunks are hashed as they are decrypted
+	// Unprotected command: 0x00, 0xA4, 0x02, 0x0C, 0x02, 0x01, 0x01
+	unsigned char selectDataGroup1CmdData[2] = {0x01, 0x01};
+	session->readHash = dgHash;
+	int ret = ProtectedReadFile(selectDataGroup1CmdData, fields->content, DG1_MAX_LENGTH,
+								&fields->length, session);
+	session->readHash = NULL;
 	if (ret != APP_SUCCESS) {
-		printf("Fail to Read Binary of DG1.\n");
+		printf("Fail to Read DG1.\n");
 		return ret;
 	}
 
 #if DEBUG
 	printf("DG1: ");
-	for (int i = 0; i < 96; i++) {
-		printf("%02X ", readBinaryDataGroup1Response[i]);
+	for (int i = 0; i < fields->length; i++) {
+		printf("%02X ", fields->content[i]);
 	}
 	printf("\n");
 #endif	// #if DEBUG
 
-	printf("\nData Group 1");
-	printf("\n> Document code: ");
-	for (int i = 0; i < 2; i++) {
-		printf("%c", readBinaryDataGroup1Response[i + 5]);
-	}
-	printf("\n> Issuing State or Organization: ");
-	for (int i = 0; i < 3; i++) {
-		printf("%c", readBinaryDataGroup1Response[i + 7]);
-	}
-	printf("\n> Document number: ");
-	for (int i = 0; i < 9; i++) {
-		printf("%c", readBinaryDataGroup1Response[i + 10]);
-	}
-	// Optional data and /or in the case of a Document Number exceeding nine characters, least
-	// significant characters of document number plus document number check digit plus filler
-	// character
-	printf("\n> Remaining of Document number: ");
-	for (int i = 0; i < 15; i++) {
-		printf("%c", readBinaryDataGroup1Response[i + 20]);
-	}
-	printf("\n> Date of birth: ");
-	for (int i = 0; i < 6; i++) {
-		printf("%c", readBinaryDataGroup1Response[i + 35]);
-	}
-	printf("\n> Sex: ");
-	for (int i = 0; i < 1; i++) {
-		printf("%c", readBinaryDataGroup1Response[i + 42]);
-	}
-	printf("\n> Date of Expiry: ");
-	for (int i = 0; i < 6; i++) {
-		printf("%c", readBinaryDataGroup1Response[i + 43]);
-	}
-	printf("\n> Nationality: ");
-	for (int i = 0; i < 3; i++) {
-		printf("%c", readBinaryDataGroup1Response[i + 50]);
-	}
-	printf("\n> Name of holder: ");
-	for (int i = 0; i < 30; i++) {
-		printf("%c", readBinaryDataGroup1Response[i + 65]);
+	// The fields are those of the 90 characters of a TD1 MRZ
+	if (fields->length < DG1_TD1_LENGTH) {
+		printf("DG1 is not the MRZ of a TD1 card.\n");
+		return APP_ERROR;
 	}
-	printf("\n");
 
+	ParseFields(fields, dataGroup1Layout, sizeof(dataGroup1Layout) / sizeof(dataGroup1Layout[0]));
+	PrintFields("Data Group 1", fields);
 	return APP_SUCCESS;
 }
 
-long ReadDG2(unsigned char sessionKeyEncrypt[16],
-			 unsigned char sessionKeyMac[16],
-			 unsigned char sendSequenceCounter[8],
-			 unsigned char imageFilePath[]) {
-	// Construct protected APDU command to Select DG2
-	// Unprotected command: 0x00, 0xA4, 0x02, 0x0C, 0x02, 0x01, 0x02
-	unsigned char selectDataGroup2CmdData[2] = {0x01, 0x02};
-	int ret = ProtectedSelectAPDU(selectDataGroup2CmdData, sendSequenceCounter, sessionKeyEncrypt,
-								  sessionKeyMac);
-	if (ret != APP_SUCCESS) {
-		printf("Fail to Select DG2.\n");
-		return ret;
-	}
+// Writes the JPEG image of DG2 to a file, from its start of image marker on
+typedef struct {
+	FILE* file;
+	int matched;  // Bytes of the marker matched so far
+	int started;
+	ImageProgressCallback progress;
+	void* context;
+} ImageWriter;
 
-	// Open Image file
-	FILE* ptr;
-	fopen_s(&ptr, imageFilePath, "wb");
-	if (ptr == NULL) {
-		printf("Error opening file!\n");
-		return APP_ERROR;
-	}
-
-	// Read Binary First 256 bytes of DG2
-	unsigned char readBinaryDataGroup2CmdHeader[4] = {0x0C, 0xB0, 0x00, 0x00};
-	unsigned char tempDataGroup2Buffer[264],
-		dataGroup2Buffer[4];  // DG2 length = dataGroup2Buffer[2] * 16^2 + dataGroup2Buffer[3]
-	ret = ProtectedReadBinaryAPDU(readBinaryDataGroup2CmdHeader, (unsigned char)256,
-								  tempDataGroup2Buffer, sendSequenceCounter, sessionKeyEncrypt,
-								  sessionKeyMac);
+static const unsigned char jpegMarker[3] = {0xFF, 0xD8, 0xFF};	// SOI then the first marker
 
-	if (ret != APP_SUCCESS) {
-		printf("Fail to Read Binary of DG2.\n");
-		fclose(ptr);
-		return ret;
-	}
+static int WriteImage(const unsigned char* data, int length, int offset, int total, void* context) {
+	ImageWriter* writer = (ImageWriter*)context;
 
 #if DEBUG
-	printf("DG2: ");
-	for (int i = 0; i < 256; i++) {
-		printf("%02X ", tempDataGroup2Buffer[i]);
+	for (int i = 0; i < length; i++) {
+		printf("%02X ", data[i]);
 	}
 #endif	// #if DEBUG
 
-	// Find jpeg header
-	int jpegHeader = 0;
-	for (int i = 0; i < 256; i++) {
-		if (tempDataGroup2Buffer[i] == 0xFF && tempDataGroup2Buffer[i + 1] == 0xD8 &&
-			tempDataGroup2Buffer[i + 2] == 0xFF && tempDataGroup2Buffer[i + 3] == 0xE0) {
-			break;
-		}
-		jpegHeader++;
-	}
-	fwrite(&tempDataGroup2Buffer[jpegHeader], 256 - jpegHeader, 1, ptr);
-	memcpy(dataGroup2Buffer, tempDataGroup2Buffer, 4);
-
-	// Read Binary remaining bytes of DG2
-	for (int i = 1; i < dataGroup2Buffer[2]; i++) {
-		readBinaryDataGroup2CmdHeader[2] = i;
-		ret = ProtectedReadBinaryAPDU(readBinaryDataGroup2CmdHeader, (unsigned char)256,
-									  tempDataGroup2Buffer, sendSequenceCounter, sessionKeyEncrypt,
-									  sessionKeyMac);
-		if (ret != APP_SUCCESS) {
-			printf("Fail to Read Binary of DG2.\n");
-			fclose(ptr);
-			return ret;
+	// The marker may be split across chunks
+	int i = 0;
+	while (!writer->started && i < length) {
+		if (data[i] == jpegMarker[writer->matched]) {
+			writer->matched++;
+		} else {
+			writer->matched = data[i] == jpegMarker[0] ? 1 : 0;
 		}
-
-#if DEBUG
-		for (int i = 0; i < 256; i++) {
-			printf("%02X ", tempDataGroup2Buffer[i]);
+		i++;
+		if (writer->matched == sizeof(jpegMarker)) {
+			writer->started = 1;
+			fwrite(jpegMarker, sizeof(jpegMarker), 1, writer->file);
+			if (writer->progress != NULL) {
+				writer->progress(jpegMarker, sizeof(jpegMarker), offset + i, total,
+								 writer->context);
+			}
 		}
-#endif	// #if DEBUG
+	}
+	if (writer->started && i < length) {
+		fwrite(&data[i], length - i, 1, writer->file);
+	}
 
-		fwrite(&tempDataGroup2Buffer[0], 256, 1, ptr);
+	// The image so far is flushed to the file for a viewer that decodes a partial JPEG
+	if (writer->progress != NULL) {
+		fflush(writer->file);
+		writer->progress(&data[i], writer->started ? length - i : 0, offset + length, total,
+						 writer->context);
 	}
+	return APP_SUCCESS;
+}
 
-	// Read Binary last bytes of DG2
-	readBinaryDataGroup2CmdHeader[2] = dataGroup2Buffer[2];
-	ret = ProtectedReadBinaryAPDU(readBinaryDataGroup2CmdHeader, dataGroup2Buffer[3],
-								  tempDataGroup2Buffer, sendSequenceCounter, sessionKeyEncrypt,
-								  sessionKeyMac);
-	if (ret != APP_SUCCESS) {
-		printf("Fail to Read Binary of DG2.\n");
-		fclose(ptr);
-		return ret;
+long ReadDG2(SecureMessagingSession* session,
+			 unsigned char imageFilePath[],
+			 hash_ctx* dgHash,
+			 ImageProgressCallback progress,
+			 void* context) {
+	// Open Image file
+	ImageWriter writer = {NULL, 0, 0, progress, context};
+	fopen_s(&writer.file, imageFilePath, "wb");
+	if (writer.file == NULL) {
+		printf("Error opening file!\n");
+		return APP_ERROR;
 	}
 
+	// Read DG2 into the file, the chunks are hashed as they are decrypted
+	// Unprotected command: 0x00, 0xA4, 0x02, 0x0C, 0x02, 0x01, 0x02
+	unsigned char selectDataGroup2CmdData[2] = {0x01, 0x02};
+#if DEBUG
+	printf("DG2: ");
+#endif	// #if DEBUG
+	session->readHash = dgHash;
+	int ret = ReadElementaryFile(selectDataGroup2CmdData, WriteImage, &writer, NULL, session);
+	session->readHash = NULL;
 #if DEBUG
-	for (int i = 0; i < dataGroup2Buffer[3]; i++) {
-		printf("%02X ", tempDataGroup2Buffer[i]);
-	}
 	printf("\n");
 #endif	// #if DEBUG
+	fclose(writer.file);
+	if (ret != APP_SUCCESS) {
+		printf("Fail to Read DG2.\n");
+		return ret;
+	}
 
-	fwrite(&tempDataGroup2Buffer[0], dataGroup2Buffer[3], 1, ptr);
 	printf("\nData Group 2");
-	printf("\n> Holder's portrait image is saved in %s.\n", imageFilePath);
-
-	// Close Image file
-	fclose(ptr);
+	if (writer.started) {
+		printf("\n> Holder's portrait image is saved in %s.\n", imageFilePath);
+	} else {
+		printf("\n> Holder's portrait is not a JPEG image.\n");
+	}
 
 	return APP_SUCCESS;
 }
 
-long ReadDG13(unsigned char sessionKeyEncrypt[16],
-			  unsigned char sessionKeyMac[16],
-			  unsigned char sendSequenceCounter[8]) {
-	// Construct protected APDU command to Select DG13
-	// Unprotected command: 0x00, 0xA4, 0x02, 0x0C, 0x02, 0x01, 0x0D
-	static unsigned char selectDataGroup13CmdData[2] = {0x01, 0x0D};
-	int ret = ProtectedSelectAPDU(selectDataGroup13CmdData, sendSequenceCounter, sessionKeyEncrypt,
-								  sessionKeyMac);
-	if (ret != APP_SUCCESS) {
-		printf("Fail to Select DG13.\n");
-		return ret;
-	}
-
-	// Read Binary First 256 bytes of DG13
-	unsigned char readBinaryDataGroup13CmdHeader[4] = {0x0C, 0xB0, 0x00, 0x00};
-	unsigned char readBinaryDataGroup13Response[512];
-	ret = ProtectedReadBinaryAPDU(readBinaryDataGroup13CmdHeader, (unsigned char)256,
-								  readBinaryDataGroup13Response, sendSequenceCounter,
-								  sessionKeyEncrypt, sessionKeyMac);
-	if (ret != APP_SUCCESS) {
-		printf("Fail to Read Binary of DG13.\n");
-		return ret;
+long ReadDG13(SecureMessagingSession* session, hash_ctx* dgHash, DataGroupFields* fields) {
+	DataGroupFields localFields;
+	if (fields == NULL) {
+		fields = &localFields;
 	}
 
-	// Read Binary remaining bytes of DG13
-	readBinaryDataGroup13CmdHeader[2] = 0x01;
-	ret = ProtectedReadBinaryAPDU(readBinaryDataGroup13CmdHeader, readBinaryDataGroup13Response[3],
-								  &readBinaryDataGroup13Response[256], sendSequenceCounter,
-								  sessionKeyEncrypt, sessionKeyMac);
+	// Read DG13, the chunks are hashed as they are decrypted
+	// Unprotected command: 0x00, 0xA4, 0x02, 0x0C, 0x02, 0x01, 0x0D
+	static unsigned char selectDataGroup13CmdData[2] = {0x01, 0x0D};
+	session->readHash = dgHash;
+	int ret = ProtectedReadFile(selectDataGroup13CmdData, fields->content, DG13_MAX_LENGTH,
+								&fields->length, session);
+	session->readHash = NULL;
 	if (ret != APP_SUCCESS) {
-		printf("Fail to Read Binary of DG13.\n");
+		printf("Fail to Read DG13.\n");
 		return ret;
 	}
 
 #if DEBUG
 	printf("DG13:\n");
-	for (int i = 0; i < 256; i++) {
-		printf("%02X ", readBinaryDataGroup13Response[i]);
-	}
-	for (int i = 256; i < 256 + readBinaryDataGroup13Response[3]; i++) {
-		printf("%02X ", readBinaryDataGroup13Response[i]);
+	for (int i = 0; i < fields->length; i++) {
+		printf("%02X ", fields->content[i]);
 	}
 	printf("\n");
 #endif	// #if DEBUG
 
-	printf("\nData Group 13 (UTF-8)");
-	printf("\n> Card ID: ");
-	for (int i = 0; i < 12; i++) {
-		printf("%c", readBinaryDataGroup13Response[i + 30]);
-	}
-	printf("\n> Full name: ");
-	for (int i = 0; i < 24; i++) {
-		printf("%c", readBinaryDataGroup13Response[i + 49]);
-	}
-	printf("\n> Date of birth: ");
-	for (int i = 0; i < 10; i++) {
-		printf("%c", readBinaryDataGroup13Response[i + 80]);
-	}
-	printf("\n> Gender: ");
-	for (int i = 0; i < 4; i++) {
-		printf("%c", readBinaryDataGroup13Response[i + 97]);
-	}
-	printf("\n> Nationality: ");
-	for (int i = 0; i < 10; i++) {
-		printf("%c", readBinaryDataGroup13Response[i + 108]);
-	}
-	printf("\n> Ethnicity: ");
-	for (int i = 0; i < 4; i++) {
-		printf("%c", readBinaryDataGroup13Response[i + 125]);
-	}
-	printf("\n> Religion: ");
-	for (int i = 0; i < 6; i++) {
-		printf("%c", readBinaryDataGroup13Response[i + 136]);
-	}
-	printf("\n> Place of origin: ");
-	for (int i = 0; i < 38; i++) {
-		printf("%c", readBinaryDataGroup13Response[i + 149]);
-	}
-	printf("\n> Place of residence: ");
-	for (int i = 0; i < 66; i++) {
-		printf("%c", readBinaryDataGroup13Response[i + 193]);
-	}
-	printf("\n> Personal identification: ");
-	for (int i = 0; i < 46; i++) {
-		printf("%c", readBinaryDataGroup13Response[i + 266]);
-	}
-	printf("\n> Issued date: ");
-	for (int i = 0; i < 10; i++) {
-		printf("%c", readBinaryDataGroup13Response[i + 319]);
-	}
-	printf("\n> Expiration date: ");
-	for (int i = 0; i < 10; i++) {
-		printf("%c", readBinaryDataGroup13Response[i + 336]);
-	}
-	printf("\n> Father's name: ");
-	for (int i = 0; i < 19; i++) {
-		printf("%c", readBinaryDataGroup13Response[i + 355]);
-	}
-	printf("\n> Mother's name: ");
-	for (int i = 0; i < 19; i++) {
-		printf("%c", readBinaryDataGroup13Response[i + 378]);
-	}
-	printf("\n> Old number: ");
-	for (int i = 0; i < 12; i++) {
-		printf("%c", readBinaryDataGroup13Response[i + 416]);
-	}
-
-	printf("\n");
-
+	ParseFields(fields, dataGroup13Layout,
+				sizeof(dataGroup13Layout) / sizeof(dataGroup13Layout[0]));
+	PrintFields("Data Group 13 (UTF-8)", fields);
 	return APP_SUCCESS;
 }
\ No newline at end of file
@@ -0,0 +1,137 @@
+/**
+ * @author Khoa Nguyen
+ * @file bac_queue.c
+ * @brief Source file for the pending set of pre-scanned MRZ keys.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <access/bac_queue.h>
+#include <utils/reader.h>
+#include <utils/util.h>
+
+// Implementation that should never be optimized out by the compiler
+static void zeroize(void* v, size_t n) {
+	volatile unsigned char* p = (unsigned char*)v;
+	while (n--)
+		*p++ = 0;
+}
+
+void BacQueueInit(BacQueue* queue, int staleMilliseconds) {
+	memset(queue, 0, sizeof(BacQueue));
+	queue->nextId			 = 1;
+	queue->staleMilliseconds = staleMilliseconds > 0 ? staleMilliseconds : BAC_QUEUE_DEFAULT_STALE;
+}
+
+unsigned int BacQueueAdd(BacQueue* queue, const unsigned char mrzInformation[], void* context) {
+	BacQueueEntry entry;
+	unsigned char mrzKeySeed[16];
+	size_t length = strlen((const char*)mrzInformation);
+
+	if (length >= MRZ_MAX_INFORMATION) {
+		return 0;
+	}
+	// The key is derived before the set is locked, the readers never wait for SHA-1
+	memcpy(entry.mrzInformation, mrzInformation, length + 1);
+	KeySeedCalculate(entry.mrzInformation, mrzKeySeed);
+	SessionKeyGenerate(mrzKeySeed, entry.encryptKey, entry.macKey);
+	memset(mrzKeySeed, 0, sizeof(mrzKeySeed));
+	entry.added	  = SyncTicks();
+	entry.context = context;
+
+	SyncLockExclusive(&queue->lock);
+	if (queue->count == BAC_QUEUE_MAX_ENTRIES) {
+		SyncUnlockExclusive(&queue->lock);
+		memset(&entry, 0, sizeof(entry));
+		return 0;
+	}
+	unsigned int id = entry.id = queue->nextId++;
+	if (queue->nextId == 0) {
+		queue->nextId = 1;
+	}
+	queue->entries[queue->count++] = entry;
+	SyncUnlockExclusive(&queue->lock);
+
+	memset(&entry, 0, sizeof(entry));
+	return id;
+}
+
+// Index of an entry, -1 if it is not pending, the set must be locked
+static int FindEntry(const BacQueue* queue, unsigned int id) {
+	for (int i = 0; i < queue->count; i++) {
+		if (queue->entries[i].id == id) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+static long TakeEntry(BacQueue* queue, unsigned int id, BacQueueEntry* entry) {
+	SyncLockExclusive(&queue->lock);
+	int i = FindEntry(queue, id);
+	if (i < 0) {
+		SyncUnlockExclusive(&queue->lock);
+		return APP_ERROR;
+	}
+	if (entry != NULL) {
+		*entry = queue->entries[i];
+	}
+	memmove(&queue->entries[i], &queue->entries[i + 1],
+			(queue->count - i - 1) * sizeof(BacQueueEntry));
+	queue->count--;
+	memset(&queue->entries[queue->count], 0, sizeof(BacQueueEntry));
+	SyncUnlockExclusive(&queue->lock);
+	return APP_SUCCESS;
+}
+
+long BacQueueRemove(BacQueue* queue, unsigned int id) {
+	return TakeEntry(queue, id, NULL);
+}
+
+long BacQueueClaim(BacQueue* queue, unsigned int id, BacQueueEntry* entry) {
+	return TakeEntry(queue, id, entry);
+}
+
+int BacQueueCount(BacQueue* queue) {
+	SyncLockShared(&queue->lock);
+	int count = queue->count;
+	SyncUnlockShared(&queue->lock);
+	return count;
+}
+
+int BacQueueSnapshot(BacQueue* queue, BacQueueCandidate candidates[]) {
+	unsigned char nonces[BAC_QUEUE_MAX_ENTRIES][24];
+	long long stale =
+		SyncTicks() - (long long)queue->staleMilliseconds * SyncTicksPerSecond() / 1000;
+	int count = 0;
+
+	// Fresh entries from the front of the queue, then the stale ones
+	SyncLockShared(&queue->lock);
+	for (int pass = 0; pass < 2; pass++) {
+		for (int i = 0; i < queue->count; i++) {
+			const BacQueueEntry* entry = &queue->entries[i];
+			if ((entry->added < stale) != pass) {
+				continue;
+			}
+			candidates[count].id = entry->id;
+			memcpy(candidates[count].candidate.encryptKey, entry->encryptKey, 16);
+			memcpy(candidates[count].candidate.macKey, entry->macKey, 16);
+			count++;
+		}
+	}
+	SyncUnlockShared(&queue->lock);
+
+	if (count > 0 && RandomNonceGenerate(nonces[0], count * 24) != APP_SUCCESS) {
+		printf("Fail to Generate Random Nonce.\n");
+		zeroize(nonces, sizeof(nonces));
+		return APP_ERROR;
+	}
+	for (int i = 0; i < count; i++) {
+		memcpy(candidates[i].candidate.randomNonceIFD, nonces[i], 8);
+		memcpy(candidates[i].candidate.keyIFD, &nonces[i][8], 16);
+	}
+	// K.IFD is key material of the session the card accepts
+	zeroize(nonces, sizeof(nonces));
+	return count;
+}
@@ -0,0 +1,277 @@
+/**
+ * @author Khoa Nguyen
+ * @file bac_search.c
+ * @brief Source file for the candidate model of the BAC key search.
+ *
+ * The candidates are built in calendar order, each birth date with its dates of expiry, then
+ * sorted by probability. The probability of a candidate is the weight of its birth date times the
+ * prior of its date of expiry, the priors of the dates of expiry a birth date cannot have on the
+ * day of the read being given to the others.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <access/bac_search.h>
+#include <utils/util.h>
+
+static const int milestones[] = {25, 40, 60};
+
+#define MILESTONE_COUNT (int)(sizeof(milestones) / sizeof(milestones[0]))
+
+void BacSearchModelDefault(BacSearchModel* model) {
+	memset(model, 0, sizeof(BacSearchModel));
+	model->firstOfJanuary	  = 1.0;
+	model->valid			  = 0.85;
+	model->expired			  = 0.05;
+	model->renewedEarly		  = 0.1;
+	model->renewalYears		  = 2;
+	model->penaltyRatio		  = 3.0;
+	model->penaltyAttempts	  = 3;
+	model->pauseMilliseconds  = 1000;
+	model->promptMilliseconds = 5000;
+}
+
+static int IsLeapYear(int year) {
+	return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+static int DaysInMonth(int month, int year) {
+	int day = 31;
+	while (!IsValidDate(day, month)) {
+		day--;
+	}
+	return month == 2 && !IsLeapYear(year) ? 28 : day;
+}
+
+// MRZ information: document number, date of birth and date of expiry, each with its check digit
+static void CandidateSet(BacSearchCandidate* candidate,
+						 const unsigned char documentNumber[9],
+						 int birthYear,
+						 int month,
+						 int day,
+						 int expirationYear,
+						 double probability) {
+	unsigned char* mrz = candidate->mrzInformation;
+	memcpy(mrz, documentNumber, 9);
+	mrz[9] = IntToChar(CheckDigitCalculate(documentNumber, 9));
+
+	unsigned char date[6] = {0, 0, IntToChar(month / 10), IntToChar(month % 10),
+							 IntToChar(day / 10), IntToChar(day % 10)};
+	YearToChar(birthYear, date);
+	memcpy(&mrz[10], date, 6);
+	mrz[16] = IntToChar(CheckDigitCalculate(date, 6));
+	YearToChar(expirationYear, date);
+	memcpy(&mrz[17], date, 6);
+	mrz[23] = IntToChar(CheckDigitCalculate(date, 6));
+	mrz[24] = '\0';
+
+	candidate->probability = probability;
+}
+
+// Most likely first, then the calendar order of the date of birth and of the date of expiry
+static int CandidateCompare(const void* a, const void* b) {
+	const BacSearchCandidate* x = (const BacSearchCandidate*)a;
+	const BacSearchCandidate* y = (const BacSearchCandidate*)b;
+	if (x->probability != y->probability) {
+		return x->probability > y->probability ? -1 : 1;
+	}
+	return memcmp(&x->mrzInformation[10], &y->mrzInformation[10], 13);
+}
+
+int BacSearchCandidatesGenerate(const unsigned char documentNumber[9],
+								const BacSearchModel* model,
+								BacSearchCandidate candidates[]) {
+	BacSearchModel defaultModel;
+	if (model == NULL) {
+		BacSearchModelDefault(&defaultModel);
+		model = &defaultModel;
+	}
+
+	int year = model->year, month = model->month, day = model->day;
+	if (year == 0) {
+		time_t now = time(NULL);
+		struct tm local;
+		localtime_s(&local, &now);
+		year  = local.tm_year + 1900;
+		month = local.tm_mon + 1;
+		day	  = local.tm_mday;
+	}
+	long today = (long)year * 10000 + month * 100 + day;
+
+	// The birth year is encoded in the document number
+	int birthYear = CharToYear(&documentNumber[1], year);
+
+	int uniform = 1;
+	for (int i = 0; i < 12; i++) {
+		if (model->monthWeight[i] > 0) {
+			uniform = 0;
+		}
+	}
+
+	int count	 = 0;
+	double total = 0;
+	for (int m = 1; m <= 12; m++) {
+		int days = DaysInMonth(m, birthYear);
+		for (int d = 1; d <= days; d++) {
+			double weight = uniform ? 1.0 : model->monthWeight[m - 1] / days;
+			if (m == 1 && d == 1) {
+				weight *= model->firstOfJanuary;
+			}
+			if (weight <= 0) {
+				continue;
+			}
+			total += weight;
+
+			// First milestone on or after the day of the read
+			int next = 0;
+			while (next < MILESTONE_COUNT &&
+				   (long)(birthYear + milestones[next]) * 10000 + m * 100 + d < today) {
+				next++;
+			}
+
+			int expiration[3];
+			double prior[3];
+			int variants = 0;
+			if (next == MILESTONE_COUNT) {
+				expiration[variants] = birthYear + milestones[MILESTONE_COUNT - 1];
+				prior[variants++]	 = model->valid + model->expired;
+			} else {
+				expiration[variants] = birthYear + milestones[next];
+				prior[variants++]	 = model->valid;
+				if (next > 0) {
+					expiration[variants] = birthYear + milestones[next - 1];
+					prior[variants++]	 = model->expired;
+				}
+				long nextDate = (long)(birthYear + milestones[next]) * 10000 + m * 100 + d;
+				if (next + 1 < MILESTONE_COUNT &&
+					nextDate < today + (long)model->renewalYears * 10000) {
+					expiration[variants] = birthYear + milestones[next + 1];
+					prior[variants++]	 = model->renewedEarly;
+				}
+			}
+
+			double priors = 0;
+			for (int v = 0; v < variants; v++) {
+				priors += prior[v];
+			}
+			for (int v = 0; v < variants; v++) {
+				if (prior[v] > 0) {
+					CandidateSet(&candidates[count++], documentNumber, birthYear, m, d,
+								 expiration[v], weight * prior[v] / priors);
+				}
+			}
+		}
+	}
+
+	for (int i = 0; i < count; i++) {
+		candidates[i].probability /= total;
+	}
+	qsort(candidates, count, sizeof(BacSearchCandidate), CandidateCompare);
+
+	if (model->maxAttempts > 0 && count > model->maxAttempts) {
+		count = model->maxAttempts;
+	}
+	return count;
+}
+
+double BacSearchExpectedAttempts(const BacSearchCandidate candidates[], int count) {
+	double expected = 0, found = 0;
+	for (int i = 0; i < count; i++) {
+		expected += (i + 1) * candidates[i].probability;
+		found += candidates[i].probability;
+	}
+	// A failed search tries every candidate
+	return expected + count * (1 - found);
+}
+
+void BacSearchStatsInit(BacSearchStats* stats) {
+	memset(stats, 0, sizeof(BacSearchStats));
+	stats->found = -1;
+}
+
+// The chip no longer has the eMRTD application selected, for example after a reset of the card
+static int ApplicationDeselected(unsigned short statusWord) {
+	switch (statusWord) {
+	case 0x0000:  // No response, the card may have been reset
+	case 0x6985:  // Conditions of use not satisfied, no BAC key is referenced
+	case 0x6A82:  // Application or file not found
+	case 0x6A88:  // Referenced data not found
+	case 0x6D00:  // Instruction not supported outside the application
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+// The answers of chips to a wrong BAC key, the only attempts whose time tells a penalty
+static int WrongKey(unsigned short statusWord) {
+	return statusWord == 0x6300 || statusWord == 0x6982 || statusWord == 0x6988;
+}
+
+int BacSearchSchedule(const BacSearchModel* model,
+					  BacSearchStats* stats,
+					  double milliseconds,
+					  unsigned short statusWord) {
+	BacSearchModel defaultModel;
+	if (model == NULL) {
+		BacSearchModelDefault(&defaultModel);
+		model = &defaultModel;
+	}
+
+	stats->attempts++;
+	stats->lastMs = milliseconds;
+	stats->totalMs += milliseconds;
+	if (milliseconds > stats->maxMs) {
+		stats->maxMs = milliseconds;
+	}
+	stats->lastStatus = statusWord;
+
+	// Authentication method blocked: no key is tried any more
+	if (statusWord == 0x6983) {
+		return BAC_SEARCH_PROMPT;
+	}
+	if (model->promptMilliseconds > 0 && milliseconds >= model->promptMilliseconds) {
+		return BAC_SEARCH_PROMPT;
+	}
+	if (ApplicationDeselected(statusWord)) {
+		stats->reselects++;
+		return BAC_SEARCH_RESELECT;
+	}
+	// Other failures are timed by something else than the key check, they would skew the baseline
+	if (!WrongKey(statusWord)) {
+		return BAC_SEARCH_CONTINUE;
+	}
+
+	stats->refusals++;
+	if (stats->refusals <= BAC_SEARCH_WINDOW) {
+		stats->baselineMs += (milliseconds - stats->baselineMs) / stats->refusals;
+		return BAC_SEARCH_CONTINUE;
+	}
+	// The attempt after an action tells whether the action relieved the chip
+	int slow = model->penaltyRatio > 0 && milliseconds > model->penaltyRatio * stats->baselineMs;
+	if (stats->lastAction == BAC_SEARCH_RESELECT) {
+		stats->reselectRelieves = !slow;
+	}
+	stats->lastAction = BAC_SEARCH_CONTINUE;
+	if (!slow) {
+		stats->streak = 0;
+		return BAC_SEARCH_CONTINUE;
+	}
+	stats->penalized++;
+	if (++stats->streak < model->penaltyAttempts) {
+		return BAC_SEARCH_CONTINUE;
+	}
+
+	// A new selection resets the counter of some chips, a pause lets others cool down
+	stats->streak = 0;
+	if (stats->reselects == 0 || stats->reselectRelieves) {
+		stats->reselects++;
+		stats->lastAction = BAC_SEARCH_RESELECT;
+		return BAC_SEARCH_RESELECT;
+	}
+	stats->pauses++;
+	stats->lastAction = BAC_SEARCH_PAUSE;
+	return BAC_SEARCH_PAUSE;
+}
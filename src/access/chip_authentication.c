@@ -0,0 +1,423 @@
+/**
+ * @author Khoa Nguyen
+ * @file chip_authentication.c
+ * @brief Source file for Chip Authentication functions.
+ *
+ * This source file contains the implementation of DG14 parsing and Chip Authentication. The
+ * ephemeral key of the terminal is generated with the precomputed comb table of the curve
+ * generator (explicit parameters of DG14 that match a standardized curve share its table) and the
+ * shared secret is computed with the constant-time Montgomery ladder. DH keys use Montgomery
+ * exponentiation with a fixed window.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <access/chip_authentication.h>
+#include <cryptography/bignum.h>
+#include <cryptography/ecc.h>
+#include <utils/public_key.h>
+#include <utils/reader.h>
+#include <utils/tlv.h>
+#include <utils/util.h>
+
+// 1536-bit moduli, the ephemeral public key of a larger one does not fit a short protected APDU
+#define CA_MAX_DH_BYTES	  192
+#define CA_MAX_PUBLIC_KEY (CA_MAX_DH_BYTES + 8)
+#define CA_MAX_KEYS		  4
+
+// id-CA = 0.4.0.127.0.7.2.2.3, followed by the key agreement (1 DH, 2 ECDH) and the cipher arcs
+static const unsigned char CA_OID[8] = {0x04, 0x00, 0x7F, 0x00, 0x07, 0x02, 0x02, 0x03};
+
+// id-PK = 0.4.0.127.0.7.2.2.1, followed by the key agreement arc
+static const unsigned char PK_OID[8] = {0x04, 0x00, 0x7F, 0x00, 0x07, 0x02, 0x02, 0x01};
+
+// dhKeyAgreement (PKCS #3) = 1.2.840.113549.1.3.1, its third parameter is privateValueLength
+static const unsigned char PKCS3_DH_OID[9] = {0x2A, 0x86, 0x48, 0x86, 0xF7,
+											  0x0D, 0x01, 0x03, 0x01};
+
+// ChipAuthenticationPublicKeyInfo found in DG14
+typedef struct {
+	int keyAgreement;
+	const unsigned char* keyId;
+	int keyIdLength;
+	const unsigned char* publicKeyInfo;
+	int publicKeyInfoLength;
+} PublicKeyEntry;
+
+// Returns the number of bytes of a big-endian value without its leading zeros
+static int SignificantLength(const unsigned char* value, int length) {
+	while (length > 0 && value[0] == 0x00) {
+		value++;
+		length--;
+	}
+	return length;
+}
+
+// Ephemeral-static ECDH, the shared secret is the x-coordinate of the shared point
+static int EcdhKeyAgreement(const PublicKeyInfo* fields,
+							unsigned char* publicKey,
+							int* publicKeyLength,
+							unsigned char* sharedSecret,
+							int* sharedSecretLength) {
+	ecc_group explicitGroup;
+	const ecc_group* grp = PublicKeyCurve(fields, &explicitGroup);
+	ecc_point chipKey, point;
+	unsigned char privateKey[ECC_MAX_BYTES];
+	unsigned char random[ECC_MAX_BYTES + 8];
+	int ret = APP_ERROR;
+
+	if (grp == NULL) {
+		return APP_ERROR;
+	}
+
+	int scalarLength = grp->orderByteLength;
+	if (RandomNonceGenerate(random, scalarLength + 8) != APP_SUCCESS ||
+		ecc_point_read(grp, &chipKey, fields->key, fields->keyLength) != 0 ||
+		ecc_gen_private(grp, privateKey, random, scalarLength + 8) != 0 ||
+		ecc_mul_base(grp, &point, privateKey, scalarLength) != 0) {
+		goto end;
+	}
+	*publicKeyLength = ecc_point_write(grp, &point, publicKey);
+
+	if (ecc_mul(grp, &point, privateKey, scalarLength, &chipKey) != 0 ||
+		ecc_point_x(grp, &point, sharedSecret) != 0) {
+		goto end;
+	}
+	*sharedSecretLength = grp->byteLength;
+	ret					= APP_SUCCESS;
+
+end:
+	memset(privateKey, 0, sizeof(privateKey));
+	memset(random, 0, sizeof(random));
+	return ret;
+}
+
+// Ephemeral-static DH, the domain parameters are { p, g, q } (X9.42) or { p, g, l } (PKCS #3)
+static int DhKeyAgreement(const PublicKeyInfo* fields,
+						  unsigned char* publicKey,
+						  int* publicKeyLength,
+						  unsigned char* sharedSecret,
+						  int* sharedSecretLength) {
+	mont_context ctx;
+	const unsigned char* values[3];
+	int lengths[3];
+	unsigned int tags[3];
+	unsigned int p[BN_MAX_LIMBS], t[BN_MAX_LIMBS], y[BN_MAX_LIMBS], x[BN_MAX_LIMBS];
+	unsigned int one[BN_MAX_LIMBS] = {1};
+	unsigned char random[CA_MAX_DH_BYTES];
+	int ret = APP_ERROR;
+
+	if (fields->parametersTag != 0x30) {
+		return APP_ERROR;
+	}
+	int count = TlvSplit(fields->parameters, fields->parametersLength, tags, values, lengths, 3);
+	if (count < 2 || tags[0] != 0x02 || tags[1] != 0x02) {
+		return APP_ERROR;
+	}
+
+	int modulusLength = SignificantLength(values[0], lengths[0]);
+	int n			  = (modulusLength + 3) / 4;
+	if (modulusLength > CA_MAX_DH_BYTES) {
+		printf("DH moduli above %d bits need extended APDUs, which are not supported.\n",
+			   CA_MAX_DH_BYTES * 8);
+		return APP_ERROR;
+	}
+	if (modulusLength == 0 || bn_read_binary(p, n, values[0], lengths[0]) != 0 ||
+		mont_init(&ctx, p, n) != 0) {
+		return APP_ERROR;
+	}
+
+	// The exponent is as long as the subgroup order or privateValueLength, or the modulus
+	int exponentLength = modulusLength;
+	if (count == 3 && tags[2] == 0x02) {
+		if (fields->algorithmLength == sizeof(PKCS3_DH_OID) &&
+			!memcmp(fields->algorithm, PKCS3_DH_OID, sizeof(PKCS3_DH_OID))) {
+			exponentLength = (TlvReadInteger(values[2], lengths[2]) + 7) / 8;
+		} else {
+			exponentLength = SignificantLength(values[2], lengths[2]);
+		}
+		if (exponentLength < 16 || exponentLength > modulusLength) {
+			exponentLength = modulusLength;
+		}
+	}
+
+	// The public key is an INTEGER inside the BIT STRING, check 1 < y < p - 1
+	const unsigned char* key = fields->key;
+	int keyLength			 = fields->keyLength;
+	unsigned int tag;
+	int length, headerLength;
+	if (TlvParse(key, keyLength, &tag, &length, &headerLength) == APP_SUCCESS && tag == 0x02 &&
+		headerLength + length == keyLength) {
+		key += headerLength;
+		keyLength = length;
+	}
+	bn_sub(t, p, one, n);
+	if (bn_read_binary(y, n, key, keyLength) != 0 || bn_cmp(y, one, n) <= 0 ||
+		bn_cmp(y, t, n) >= 0) {
+		return APP_ERROR;
+	}
+
+	// Generator, it must be a reduced element as well
+	if (bn_read_binary(t, n, values[1], lengths[1]) != 0 || bn_cmp(t, p, n) >= 0 ||
+		bn_cmp(t, one, n) <= 0) {
+		return APP_ERROR;
+	}
+
+	int en = (exponentLength + 3) / 4;
+	if (RandomNonceGenerate(random, exponentLength) != APP_SUCCESS) {
+		return APP_ERROR;
+	}
+	bn_read_binary(x, en, random, exponentLength);
+
+	// PK = g^x mod p
+	mont_to(&ctx, t, t);
+	mont_exp(&ctx, t, t, x, en);
+	mont_from(&ctx, t, t);
+	bn_write_binary(t, n, publicKey, modulusLength);
+	*publicKeyLength = modulusLength;
+
+	// K = y^x mod p, it must not be 1
+	mont_to(&ctx, y, y);
+	mont_exp(&ctx, t, y, x, en);
+	mont_from(&ctx, t, t);
+	if (bn_cmp(t, one, n) != 0) {
+		bn_write_binary(t, n, sharedSecret, modulusLength);
+		*sharedSecretLength = modulusLength;
+		ret					= APP_SUCCESS;
+	}
+
+	memset(x, 0, sizeof(x));
+	memset(random, 0, sizeof(random));
+	memset(t, 0, sizeof(t));
+	return ret;
+}
+
+long ReadDG14(SecureMessagingSession* session, unsigned char* dg14, int* dg14Length) {
+	// Unprotected command: 0x00, 0xA4, 0x02, 0x0C, 0x02, 0x01, 0x0E
+	unsigned char selectDataGroup14CmdData[2] = {0x01, 0x0E};
+	int ret = ProtectedReadFile(selectDataGroup14CmdData, dg14, CA_MAX_DG14, dg14Length, session);
+	if (ret != APP_SUCCESS) {
+		printf("Fail to Read DG14.\n");
+		return ret;
+	}
+	return APP_SUCCESS;
+}
+
+int ParseDG14(const unsigned char* dg14, int dg14Length, ChipAuthenticationInfo* caInfo) {
+	// DG14 ::= [APPLICATION 14] SecurityInfos, SecurityInfos ::= SET OF SecurityInfo
+	const unsigned char *content, *securityInfos;
+	int contentLength, securityInfosLength;
+	if (TlvFind(dg14, dg14Length, 0x6E, &content, &contentLength) != APP_SUCCESS ||
+		TlvFind(content, contentLength, 0x31, &securityInfos, &securityInfosLength) !=
+			APP_SUCCESS) {
+		return APP_ERROR;
+	}
+
+	PublicKeyEntry keys[CA_MAX_KEYS];
+	int keyCount	= 0;
+	int caInfoCount = 0;
+	int found		= 0;
+
+	// First pass collects the public keys, the second one matches the protocols against them
+	for (int pass = 0; pass < 2; pass++) {
+		int pos = 0;
+		while (pos < securityInfosLength) {
+			unsigned int tag;
+			int length, headerLength;
+			if (TlvParse(&securityInfos[pos], securityInfosLength - pos, &tag, &length,
+						 &headerLength) != APP_SUCCESS) {
+				return APP_ERROR;
+			}
+			const unsigned char* info = &securityInfos[pos + headerLength];
+			pos += headerLength + length;
+
+			const unsigned char* fields[3];
+			int fieldLengths[3];
+			unsigned int fieldTags[3];
+			int fieldCount = TlvSplit(info, length, fieldTags, fields, fieldLengths, 3);
+			if (tag != 0x30 || fieldCount < 2 || fieldTags[0] != 0x06 ||
+				fieldLengths[0] < (int)sizeof(CA_OID) + 1) {
+				continue;
+			}
+			const unsigned char* keyId = fieldCount == 3 && fieldTags[2] == 0x02 ? fields[2] : NULL;
+			int keyIdLength			   = keyId != NULL ? fieldLengths[2] : 0;
+
+			// ChipAuthenticationPublicKeyInfo ::= SEQUENCE { id-PK-*, SubjectPublicKeyInfo, keyId }
+			if (pass == 0) {
+				if (fieldLengths[0] == sizeof(PK_OID) + 1 &&
+					!memcmp(fields[0], PK_OID, sizeof(PK_OID)) && fieldTags[1] == 0x30 &&
+					keyCount < CA_MAX_KEYS) {
+					PublicKeyEntry* entry	   = &keys[keyCount++];
+					entry->keyAgreement		   = fields[0][sizeof(PK_OID)];
+					entry->keyId			   = keyId;
+					entry->keyIdLength		   = keyIdLength;
+					entry->publicKeyInfo	   = fields[0] + fieldLengths[0];
+					entry->publicKeyInfoLength = (int)(fields[1] + fieldLengths[1] -
+													   entry->publicKeyInfo);
+				}
+				continue;
+			}
+
+			// ChipAuthenticationInfo ::= SEQUENCE { id-CA-*, version INTEGER, keyId OPTIONAL }
+			if (fieldLengths[0] != sizeof(CA_OID) + 2 ||
+				memcmp(fields[0], CA_OID, sizeof(CA_OID))) {
+				continue;
+			}
+			caInfoCount++;
+			int keyAgreement = fields[0][sizeof(CA_OID)];
+			int cipherId	 = fields[0][sizeof(CA_OID) + 1];
+			int version =
+				fieldTags[1] == 0x02 ? TlvReadInteger(fields[1], fieldLengths[1]) : -1;
+			if ((keyAgreement != CA_KEY_AGREEMENT_DH && keyAgreement != CA_KEY_AGREEMENT_ECDH) ||
+				cipherId < 1 || cipherId > 4 || (version != 1 && version != 2) ||
+				keyIdLength > CA_MAX_KEY_ID_LENGTH) {
+				continue;
+			}
+
+			// The key identifier is only mandatory when the chip has several keys
+			const PublicKeyEntry* key = NULL;
+			for (int i = 0; i < keyCount && key == NULL; i++) {
+				if (keys[i].keyAgreement == keyAgreement &&
+					(keyIdLength == 0 || keys[i].keyIdLength == 0 ||
+					 (keys[i].keyIdLength == keyIdLength &&
+					  !memcmp(keys[i].keyId, keyId, keyIdLength)))) {
+					key = &keys[i];
+				}
+			}
+			if (key == NULL) {
+				continue;
+			}
+
+			// Prefer AES to 3DES and longer keys to shorter ones
+			int keyLength = cipherId == 1 ? 16 : 8 * cipherId;
+			int cipher	  = cipherId == 1 ? SM_CIPHER_3DES : SM_CIPHER_AES;
+			if (found && (caInfo->cipher > cipher ||
+						  (caInfo->cipher == cipher && caInfo->keyLength >= keyLength))) {
+				continue;
+			}
+			memcpy(caInfo->protocol, fields[0], fieldLengths[0]);
+			caInfo->protocolLength		= fieldLengths[0];
+			caInfo->version				= version;
+			caInfo->keyAgreement		= keyAgreement;
+			caInfo->cipher				= cipher;
+			caInfo->keyLength			= keyLength;
+			caInfo->keyIdLength			= keyIdLength;
+			caInfo->publicKeyInfo		= key->publicKeyInfo;
+			caInfo->publicKeyInfoLength = key->publicKeyInfoLength;
+			memcpy(caInfo->keyId, keyId, keyIdLength);
+			found = 1;
+		}
+	}
+
+	// Without ChipAuthenticationInfo the chip supports version 1 with 3DES
+	if (!found && caInfoCount == 0 && keyCount > 0 &&
+		(keys[0].keyAgreement == CA_KEY_AGREEMENT_DH ||
+		 keys[0].keyAgreement == CA_KEY_AGREEMENT_ECDH)) {
+		memcpy(caInfo->protocol, CA_OID, sizeof(CA_OID));
+		caInfo->protocol[sizeof(CA_OID)]	 = (unsigned char)keys[0].keyAgreement;
+		caInfo->protocol[sizeof(CA_OID) + 1] = 0x01;
+		caInfo->protocolLength				 = sizeof(CA_OID) + 2;
+		caInfo->version						 = 1;
+		caInfo->keyAgreement				 = keys[0].keyAgreement;
+		caInfo->cipher						 = SM_CIPHER_3DES;
+		caInfo->keyLength					 = 16;
+		caInfo->keyIdLength					 = 0;
+		caInfo->publicKeyInfo				 = keys[0].publicKeyInfo;
+		caInfo->publicKeyInfoLength			 = keys[0].publicKeyInfoLength;
+		found								 = 1;
+	}
+	return found ? APP_SUCCESS : APP_ERROR;
+}
+
+long ChipAuthenticate(const ChipAuthenticationInfo* caInfo, SecureMessagingSession* session) {
+	long ret = APP_ERROR;
+	unsigned char publicKey[CA_MAX_PUBLIC_KEY];
+	unsigned char sharedSecret[CA_MAX_DH_BYTES];
+	unsigned char encryptKey[SM_MAX_KEY_LENGTH], macKey[SM_MAX_KEY_LENGTH];
+	unsigned char dynamicData[CA_MAX_PUBLIC_KEY + 8];
+	unsigned char command[CA_MAX_PUBLIC_KEY + 16];
+	unsigned char response[SM_MAX_PROTECTED_RESPONSE];
+	int publicKeyLength, sharedSecretLength, commandLength, responseLength;
+	PublicKeyInfo fields;
+
+	if (ParsePublicKeyInfo(caInfo->publicKeyInfo, caInfo->publicKeyInfoLength, &fields) ==
+		APP_SUCCESS) {
+		if (caInfo->keyAgreement == CA_KEY_AGREEMENT_ECDH) {
+			ret = EcdhKeyAgreement(&fields, publicKey, &publicKeyLength, sharedSecret,
+								   &sharedSecretLength);
+		} else {
+			ret = DhKeyAgreement(&fields, publicKey, &publicKeyLength, sharedSecret,
+								 &sharedSecretLength);
+		}
+	}
+	if (ret != APP_SUCCESS) {
+		printf("Invalid Chip Authentication public key.\n");
+		goto end;
+	}
+
+	if (caInfo->version == 1 && caInfo->cipher == SM_CIPHER_3DES) {
+		// MSE:Set KAT: 91 ephemeral public key || 84 key identifier
+		unsigned char mseSetCommand[4] = {0x00, 0x22, 0x41, 0xA6};
+		memcpy(command, mseSetCommand, 4);
+		commandLength = 5;
+		commandLength += TlvEncode(0x91, publicKey, publicKeyLength, &command[commandLength]);
+		if (caInfo->keyIdLength > 0) {
+			commandLength +=
+				TlvEncode(0x84, caInfo->keyId, caInfo->keyIdLength, &command[commandLength]);
+		}
+		command[4] = (unsigned char)(commandLength - 5);
+		ret = ProtectedTransmitAPDU(session, command, commandLength, response, &responseLength);
+		if (ret != APP_SUCCESS) {
+			printf("Fail to Set Key Agreement Template.\n");
+			goto end;
+		}
+	} else {
+		// MSE:Set AT: 80 protocol OID || 84 key identifier
+		unsigned char mseSetCommand[4] = {0x00, 0x22, 0x41, 0xA4};
+		memcpy(command, mseSetCommand, 4);
+		commandLength = 5;
+		commandLength +=
+			TlvEncode(0x80, caInfo->protocol, caInfo->protocolLength, &command[commandLength]);
+		if (caInfo->keyIdLength > 0) {
+			commandLength +=
+				TlvEncode(0x84, caInfo->keyId, caInfo->keyIdLength, &command[commandLength]);
+		}
+		command[4] = (unsigned char)(commandLength - 5);
+		ret = ProtectedTransmitAPDU(session, command, commandLength, response, &responseLength);
+		if (ret != APP_SUCCESS) {
+			printf("Fail to Set Authentication Template for Chip Authentication.\n");
+			goto end;
+		}
+
+		// General Authenticate: 7C { 80 ephemeral public key }, the answer is an empty 7C
+		unsigned char generalAuthenticateCommand[4] = {0x00, 0x86, 0x00, 0x00};
+		int dynamicDataLength = TlvEncode(0x80, publicKey, publicKeyLength, dynamicData);
+		memcpy(command, generalAuthenticateCommand, 4);
+		commandLength = 5;
+		commandLength += TlvEncode(0x7C, dynamicData, dynamicDataLength, &command[commandLength]);
+		command[4]				= (unsigned char)(commandLength - 5);
+		command[commandLength++] = 0x00;
+		ret = ProtectedTransmitAPDU(session, command, commandLength, response, &responseLength);
+		if (ret != APP_SUCCESS) {
+			printf("Fail to General Authenticate.\n");
+			goto end;
+		}
+	}
+
+	// The chip has switched to the new keys, restart the session with SSC = 0 on the same link
+	SecureMessagingKeyDerive(sharedSecret, sharedSecretLength, SM_KDF_ENCRYPT, caInfo->cipher,
+							 caInfo->keyLength, encryptKey);
+	SecureMessagingKeyDerive(sharedSecret, sharedSecretLength, SM_KDF_MAC, caInfo->cipher,
+							 caInfo->keyLength, macKey);
+	int readChunk = session->readChunk;
+	SecureMessagingInit(session, caInfo->cipher, encryptKey, macKey, caInfo->keyLength, NULL);
+	session->readChunk = readChunk;
+	ret = APP_SUCCESS;
+
+end:
+	memset(sharedSecret, 0, sizeof(sharedSecret));
+	memset(encryptKey, 0, sizeof(encryptKey));
+	memset(macKey, 0, sizeof(macKey));
+	return ret;
+}
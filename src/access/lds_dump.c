@@ -0,0 +1,187 @@
+/**
+ * @author Khoa Nguyen
+ * @file lds_dump.c
+ * @brief Source file for the dump of the whole LDS of a chip into one container.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <access/bac_application.h>
+#include <access/lds_dump.h>
+#include <utils/reader.h>
+
+#define EF_COM_SHORT_ID 0x1E
+#define EF_SOD_SHORT_ID 0x1D
+
+// Read order after EF.COM by typical size, 0 for EF.SOD: text and security data groups, EF.SOD,
+// then the biometric ones, DG3 and DG4 last as a chip without Extended Access Control refuses them
+static const int readOrder[] = {1, 11, 12, 13, 14, 15, 16, 8, 9, 10, 0, 5, 6, 7, 2, 3, 4};
+
+// Destination of the files, copying the content of the current file to keep if it is set
+typedef struct {
+	FILE* file;
+	unsigned int offset;  // Offset of the next file in the container
+	int written;		  // Bytes written of the current file
+	unsigned char* keep;
+	int keepSize;
+} DumpWriter;
+
+int LdsDumpPlan(unsigned int dataGroups, unsigned char shortFileIds[]) {
+	int count = 0;
+	for (int i = 0; i < (int)(sizeof(readOrder) / sizeof(readOrder[0])); i++) {
+		if (readOrder[i] == 0) {
+			shortFileIds[count++] = EF_SOD_SHORT_ID;
+		} else if (dataGroups & DG_MASK(readOrder[i])) {
+			shortFileIds[count++] = (unsigned char)readOrder[i];
+		}
+	}
+	return count;
+}
+
+static int WriteChunk(const unsigned char* data, int length, int offset, int total, void* context) {
+	DumpWriter* writer = (DumpWriter*)context;
+	if (writer->keep != NULL) {
+		if (total > writer->keepSize) {
+			return APP_ERROR;
+		}
+		memcpy(&writer->keep[offset], data, length);
+	}
+	if (fwrite(data, 1, length, writer->file) != (size_t)length) {
+		printf("Fail to Write LDS dump.\n");
+		return APP_ERROR;
+	}
+	writer->written += length;
+	return APP_SUCCESS;
+}
+
+// Streams a file into the container and fills its index entry
+static long DumpFile(SecureMessagingSession* session,
+					 DumpWriter* writer,
+					 unsigned char shortFileId,
+					 LdsDumpEntry* entry) {
+	int length;
+
+	writer->written = 0;
+	long ret = ReadShortElementaryFile(shortFileId, WriteChunk, writer, &length, session);
+	if (ret != APP_SUCCESS) {
+		return ret;
+	}
+	entry->fileId[0]   = 0x01;
+	entry->fileId[1]   = shortFileId;
+	entry->shortFileId = shortFileId;
+	entry->dataGroup   = shortFileId <= 16 ? shortFileId : 0;
+	entry->offset	   = writer->offset;
+	entry->length	   = length;
+	writer->offset += length;
+	return APP_SUCCESS;
+}
+
+long LdsDumpRead(SecureMessagingSession* session, const char* path, unsigned int* dataGroups) {
+	LdsDumpHeader header;
+	LdsDumpEntry index[LDS_DUMP_MAX_FILES];
+	unsigned char efCom[EF_COM_MAX_LENGTH];
+	unsigned char shortFileIds[LDS_DUMP_MAX_FILES];
+	DumpWriter writer = {NULL, sizeof(header) + sizeof(index), 0, NULL, 0};
+	unsigned int present, dumped = 0;
+	long res = APP_ERROR;
+
+	memset(&header, 0, sizeof(header));
+	memset(index, 0, sizeof(index));
+	fopen_s(&writer.file, path, "wb");
+	if (writer.file == NULL) {
+		printf("Fail to Open LDS dump.\n");
+		return APP_ERROR;
+	}
+
+	// The header and the index are written again once the files are read
+	if (fwrite(&header, sizeof(header), 1, writer.file) != 1 ||
+		fwrite(index, sizeof(index), 1, writer.file) != 1) {
+		printf("Fail to Write LDS dump.\n");
+		goto end;
+	}
+
+	// EF.COM first, its tag list plans the other reads
+	writer.keep		= efCom;
+	writer.keepSize = sizeof(efCom);
+	if (DumpFile(session, &writer, EF_COM_SHORT_ID, &index[0]) != APP_SUCCESS ||
+		EFCOMDataGroups(efCom, index[0].length, &present) != APP_SUCCESS) {
+		printf("Fail to Read EF.COM.\n");
+		goto end;
+	}
+	writer.keep	 = NULL;
+	header.count = 1;
+
+	int count = LdsDumpPlan(present, shortFileIds);
+	for (int i = 0; i < count; i++) {
+		if (DumpFile(session, &writer, shortFileIds[i], &index[header.count]) == APP_SUCCESS) {
+			dumped |= index[header.count++].dataGroup ? DG_MASK(shortFileIds[i]) : 0;
+			continue;
+		}
+		// A file refused at its first chunk leaves nothing behind, a read broken off does not
+		if (writer.written > 0) {
+			printf("Fail to Read the LDS, the dump is incomplete.\n");
+			goto end;
+		}
+		if (shortFileIds[i] == EF_SOD_SHORT_ID) {
+			printf("EF.SOD is not readable, it is left out of the dump.\n");
+		} else {
+			printf("DG%d is not readable, it is left out of the dump.\n", shortFileIds[i]);
+		}
+	}
+
+	memcpy(header.magic, LDS_DUMP_MAGIC, 8);
+	header.size = writer.offset;
+	if (fseek(writer.file, 0, SEEK_SET) != 0 ||
+		fwrite(&header, sizeof(header), 1, writer.file) != 1 ||
+		fwrite(index, sizeof(index), 1, writer.file) != 1) {
+		printf("Fail to Write LDS dump.\n");
+		goto end;
+	}
+	res = APP_SUCCESS;
+
+end:
+	if (fclose(writer.file) != 0) {
+		res = APP_ERROR;
+	}
+	if (res != APP_SUCCESS) {
+		remove(path);
+	}
+	if (dataGroups != NULL) {
+		*dataGroups = res == APP_SUCCESS ? dumped : 0;
+	}
+	return res;
+}
+
+long LdsDumpFind(const unsigned char* container,
+				 int containerLength,
+				 const unsigned char fileId[2],
+				 const unsigned char** data,
+				 int* fileLength) {
+	LdsDumpHeader header;
+	LdsDumpEntry index[LDS_DUMP_MAX_FILES];
+
+	if (containerLength < (int)(sizeof(header) + sizeof(index))) {
+		return APP_ERROR;
+	}
+	memcpy(&header, container, sizeof(header));
+	memcpy(index, &container[sizeof(header)], sizeof(index));
+	if (memcmp(header.magic, LDS_DUMP_MAGIC, 8) || header.count > LDS_DUMP_MAX_FILES ||
+		header.size != (unsigned int)containerLength) {
+		return APP_ERROR;
+	}
+
+	for (unsigned int i = 0; i < header.count; i++) {
+		const LdsDumpEntry* entry = &index[i];
+		if (memcmp(entry->fileId, fileId, 2)) {
+			continue;
+		}
+		if (entry->offset > header.size || entry->length > header.size - entry->offset) {
+			return APP_ERROR;
+		}
+		*data		= &container[entry->offset];
+		*fileLength = (int)entry->length;
+		return APP_SUCCESS;
+	}
+	return APP_ERROR;
+}
@@ -0,0 +1,379 @@
+/**
+ * @author Khoa Nguyen
+ * @file pace.c
+ * @brief Source file for Password Authenticated Connection Establishment (PACE) functions.
+ *
+ * This source file contains the implementation of EF.CardAccess parsing and PACE with Generic
+ * Mapping over ECDH. The two fixed-base multiplications of a run (the nonce mapping s * G and the
+ * mapping key) use the precomputed comb table of the curve generator, the three variable-base
+ * multiplications use the constant-time Montgomery ladder.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <access/pace.h>
+#include <cryptography/aes.h>
+#include <cryptography/cmac.h>
+#include <cryptography/des.h>
+#include <cryptography/ecc.h>
+#include <cryptography/provider.h>
+#include <utils/reader.h>
+#include <utils/tlv.h>
+#include <utils/util.h>
+
+#define PACE_MAX_POINT_LENGTH (1 + 2 * ECC_MAX_BYTES)
+#define PACE_MAX_APDU		  300
+
+// id-PACE-ECDH-GM = 0.4.0.127.0.7.2.2.4.2, the last arc gives the cipher
+static const unsigned char PACE_ECDH_GM_OID[9] = {0x04, 0x00, 0x7F, 0x00, 0x07,
+												  0x02, 0x02, 0x04, 0x02};
+
+// Sends an unprotected command and checks for status 90 00, resLen excludes the status word
+static long TransmitCommand(unsigned char* cmd,
+							int cmdLen,
+							unsigned char* res,
+							unsigned long* resLen) {
+	long ret = TransmitDataToCard(cmd, cmdLen, res, resLen);
+	if (ret != APP_SUCCESS) {
+		return ret;
+	}
+	if (*resLen < 2 || res[*resLen - 2] != 0x90 || res[*resLen - 1] != 0x00) {
+		return APP_ERROR;
+	}
+	*resLen -= 2;
+	return APP_SUCCESS;
+}
+
+// One General Authenticate step: sends 7C { tag || data } and extracts responseTag from the answer,
+// a value longer than outSize is refused before it is copied
+static long GeneralAuthenticate(int lastCommand,
+								unsigned char tag,
+								const unsigned char* data,
+								int dataLen,
+								unsigned char responseTag,
+								unsigned char* out,
+								int outSize,
+								int* outLen) {
+	unsigned char dynamicData[PACE_MAX_APDU];
+	int dynamicDataLen = 0;
+	if (dataLen > 0) {
+		dynamicDataLen = TlvEncode(tag, data, dataLen, dynamicData);
+	}
+
+	// Command chaining (CLA = 0x10) for all steps but the last one
+	unsigned char cmd[PACE_MAX_APDU] = {lastCommand ? 0x00 : 0x10, 0x86, 0x00, 0x00};
+	int cmdLen = 5;
+	cmdLen += TlvEncode(0x7C, dynamicData, dynamicDataLen, &cmd[cmdLen]);
+	cmd[4]		  = (unsigned char)(cmdLen - 5);
+	cmd[cmdLen++] = 0x00;
+
+	unsigned char res[PACE_MAX_APDU];
+	unsigned long resLen = sizeof(res);
+	long ret			 = TransmitCommand(cmd, cmdLen, res, &resLen);
+	if (ret != APP_SUCCESS) {
+		return ret;
+	}
+
+	const unsigned char* responseData;
+	const unsigned char* value;
+	int responseDataLen, valueLen;
+	if (TlvFind(res, (int)resLen, 0x7C, &responseData, &responseDataLen) != APP_SUCCESS ||
+		TlvFind(responseData, responseDataLen, responseTag, &value, &valueLen) != APP_SUCCESS) {
+		return APP_ERROR;
+	}
+	if (valueLen > outSize) {
+		return APP_ERROR;
+	}
+	memcpy(out, value, valueLen);
+	*outLen = valueLen;
+	return APP_SUCCESS;
+}
+
+// Authentication token T = MAC(KS_MAC, 7F49 { 06 OID || 86 public key })
+static void AuthenticationToken(const SecureMessagingSession* session,
+								const PaceInfo* paceInfo,
+								const unsigned char* publicKey,
+								int publicKeyLength,
+								unsigned char token[SM_MAC_LENGTH]) {
+	unsigned char content[PACE_MAX_OID_LENGTH + PACE_MAX_POINT_LENGTH + 8];
+	unsigned char publicKeyData[sizeof(content) + 4];
+	int contentLen = TlvEncode(0x06, paceInfo->protocol, paceInfo->protocolLength, content);
+	contentLen += TlvEncode(0x86, publicKey, publicKeyLength, &content[contentLen]);
+	int publicKeyDataLen = TlvEncode(0x7F49, content, contentLen, publicKeyData);
+
+	if (session->cipher == SM_CIPHER_3DES) {
+		SecureMessagingChecksum(session, publicKeyData, publicKeyDataLen, token);
+	} else {
+		// AES-CMAC over the unpadded data
+		unsigned char fullMac[16];
+		aes_cmac_checksum(publicKeyDataLen, fullMac, publicKeyData, session->macKey,
+						  session->keyLength);
+		memcpy(token, fullMac, SM_MAC_LENGTH);
+	}
+}
+
+long ReadCardAccess(unsigned char* cardAccess, int* cardAccessLength) {
+	// Read Binary with short file identifier 0x1C (EF.CardAccess) from offset 0
+	unsigned char readBinaryCommand[5] = {0x00, 0xB0, 0x9C, 0x00, 0x00};
+	unsigned char response[258];
+	unsigned long responseLength = sizeof(response);
+	long ret = TransmitDataToCard(readBinaryCommand, sizeof(readBinaryCommand), response,
+								  &responseLength);
+	if (ret != APP_SUCCESS) {
+		return ret;
+	}
+
+	// 62 82: end of file reached before Le bytes, the usual answer for a short file
+	if (responseLength < 2 ||
+		!((response[responseLength - 2] == 0x90 && response[responseLength - 1] == 0x00) ||
+		  (response[responseLength - 2] == 0x62 && response[responseLength - 1] == 0x82))) {
+		return APP_ERROR;
+	}
+	responseLength -= 2;
+
+	unsigned int tag;
+	int length, headerLength;
+	if (TlvParseHeader(response, (int)responseLength, &tag, &length, &headerLength) !=
+			APP_SUCCESS ||
+		headerLength + length > PACE_MAX_CARD_ACCESS) {
+		printf("Invalid EF.CardAccess.\n");
+		return APP_ERROR;
+	}
+	int total = headerLength + length;
+	int read  = (int)responseLength < total ? (int)responseLength : total;
+	memcpy(cardAccess, response, read);
+
+	// Read the remaining bytes, EF.CardAccess is now the current file
+	while (read < total) {
+		int chunk						 = total - read < 256 ? total - read : 256;
+		unsigned char readBinaryNext[5] = {0x00, 0xB0, (unsigned char)(read >> 8),
+										   (unsigned char)read, (unsigned char)chunk};
+		responseLength					 = sizeof(response);
+		ret = TransmitCommand(readBinaryNext, sizeof(readBinaryNext), response, &responseLength);
+		if (ret != APP_SUCCESS || responseLength == 0) {
+			printf("Fail to Read Binary of EF.CardAccess.\n");
+			return APP_ERROR;
+		}
+		if ((int)responseLength > total - read) {
+			responseLength = total - read;
+		}
+		memcpy(&cardAccess[read], response, responseLength);
+		read += (int)responseLength;
+	}
+
+	*cardAccessLength = total;
+	return APP_SUCCESS;
+}
+
+int ParseCardAccess(const unsigned char* cardAccess, int cardAccessLength, PaceInfo* paceInfo) {
+	// SecurityInfos ::= SET OF SecurityInfo
+	const unsigned char* securityInfos;
+	int securityInfosLength;
+	if (TlvFind(cardAccess, cardAccessLength, 0x31, &securityInfos, &securityInfosLength) !=
+		APP_SUCCESS) {
+		return APP_ERROR;
+	}
+
+	int found = 0;
+	int pos	  = 0;
+	while (pos < securityInfosLength) {
+		unsigned int tag;
+		int length, headerLength;
+		if (TlvParse(&securityInfos[pos], securityInfosLength - pos, &tag, &length,
+					 &headerLength) != APP_SUCCESS) {
+			return APP_ERROR;
+		}
+		const unsigned char* info = &securityInfos[pos + headerLength];
+		pos += headerLength + length;
+		if (tag != 0x30) {
+			continue;
+		}
+
+		// PACEInfo ::= SEQUENCE { protocol OID, version INTEGER, parameterId INTEGER OPTIONAL }
+		const unsigned char* fields[3];
+		int fieldLengths[3];
+		unsigned int fieldTags[3];
+		int fieldCount = TlvSplit(info, length, fieldTags, fields, fieldLengths, 3);
+		if (fieldCount < 3 || fieldTags[0] != 0x06 || fieldTags[1] != 0x02 ||
+			fieldTags[2] != 0x02 || fieldLengths[0] != sizeof(PACE_ECDH_GM_OID) + 1 ||
+			memcmp(fields[0], PACE_ECDH_GM_OID, sizeof(PACE_ECDH_GM_OID))) {
+			// Not ECDH-GM, or explicit domain parameters which are not supported
+			continue;
+		}
+
+		int cipherId	= fields[0][sizeof(PACE_ECDH_GM_OID)];
+		int version		= TlvReadInteger(fields[1], fieldLengths[1]);
+		int parameterId = TlvReadInteger(fields[2], fieldLengths[2]);
+		if (cipherId < 1 || cipherId > 4 || version != 2 || ecc_group_get(parameterId) == NULL) {
+			continue;
+		}
+
+		// Prefer AES to 3DES and longer keys to shorter ones
+		int keyLength = cipherId == 1 ? 16 : 8 * cipherId;
+		int cipher	  = cipherId == 1 ? SM_CIPHER_3DES : SM_CIPHER_AES;
+		if (found && (paceInfo->cipher > cipher ||
+					  (paceInfo->cipher == cipher && paceInfo->keyLength >= keyLength))) {
+			continue;
+		}
+		memcpy(paceInfo->protocol, fields[0], fieldLengths[0]);
+		paceInfo->protocolLength = fieldLengths[0];
+		paceInfo->version		 = version;
+		paceInfo->parameterId	 = parameterId;
+		paceInfo->cipher		 = cipher;
+		paceInfo->keyLength		 = keyLength;
+		found					 = 1;
+	}
+	return found ? APP_SUCCESS : APP_ERROR;
+}
+
+long PaceAuthenticate(const PaceInfo* paceInfo,
+					  int passwordType,
+					  const unsigned char* password,
+					  int passwordLength,
+					  SecureMessagingSession* session) {
+	long ret = APP_ERROR;
+	const ecc_group* grp = ecc_group_get(paceInfo->parameterId);
+	if (grp == NULL) {
+		printf("Unsupported PACE domain parameters.\n");
+		return APP_ERROR;
+	}
+	int blockSize	= paceInfo->cipher == SM_CIPHER_AES ? 16 : 8;
+	int scalarLength = grp->orderByteLength;
+
+	unsigned char passwordKey[SM_MAX_KEY_LENGTH];  // K_pi
+	unsigned char nonce[SM_MAX_BLOCK_SIZE];		   // s
+	unsigned char privateKey[ECC_MAX_BYTES];	   // SK_map, then SK_eph
+	unsigned char random[ECC_MAX_BYTES + 8];
+	unsigned char sharedSecret[ECC_MAX_BYTES];	   // K
+	unsigned char encryptKey[SM_MAX_KEY_LENGTH], macKey[SM_MAX_KEY_LENGTH];
+	unsigned char publicKey[PACE_MAX_POINT_LENGTH], chipPublicKey[PACE_MAX_POINT_LENGTH];
+	unsigned char buffer[PACE_MAX_APDU];
+	int publicKeyLength, chipPublicKeyLength, bufferLength;
+	ecc_point point, mapped, generator;
+
+	// K_pi = KDF(f(pi), 3), f(pi) = SHA-1(MRZ information) or the CAN itself
+	if (passwordType == PACE_PASSWORD_MRZ) {
+		unsigned char mrzDigest[20];
+		crypto_sha1((unsigned char*)password, passwordLength, mrzDigest);
+		SecureMessagingKeyDerive(mrzDigest, 20, SM_KDF_PASSWORD, paceInfo->cipher,
+								 paceInfo->keyLength, passwordKey);
+		memset(mrzDigest, 0, sizeof(mrzDigest));
+	} else {
+		SecureMessagingKeyDerive(password, passwordLength, SM_KDF_PASSWORD, paceInfo->cipher,
+								 paceInfo->keyLength, passwordKey);
+	}
+
+	// MSE:Set AT: 80 protocol OID || 83 password reference || 84 domain parameter ID
+	unsigned char mseSetCommand[PACE_MAX_APDU] = {0x00, 0x22, 0xC1, 0xA4};
+	int mseSetLength = 5;
+	mseSetLength += TlvEncode(0x80, paceInfo->protocol, paceInfo->protocolLength,
+							  &mseSetCommand[mseSetLength]);
+	unsigned char passwordReference = (unsigned char)passwordType;
+	mseSetLength += TlvEncode(0x83, &passwordReference, 1, &mseSetCommand[mseSetLength]);
+	unsigned char parameterId = (unsigned char)paceInfo->parameterId;
+	mseSetLength += TlvEncode(0x84, &parameterId, 1, &mseSetCommand[mseSetLength]);
+	mseSetCommand[4] = (unsigned char)(mseSetLength - 5);
+
+	unsigned long mseSetResponseLength = sizeof(buffer);
+	ret = TransmitCommand(mseSetCommand, mseSetLength, buffer, &mseSetResponseLength);
+	if (ret != APP_SUCCESS) {
+		printf("Fail to Set Authentication Template for PACE.\n");
+		goto end;
+	}
+
+	// Step 1: s = D(K_pi, z)
+	ret = GeneralAuthenticate(0, 0, NULL, 0, 0x80, buffer, sizeof(buffer), &bufferLength);
+	if (ret != APP_SUCCESS || bufferLength != blockSize) {
+		printf("Fail to Get Encrypted Nonce.\n");
+		ret = APP_ERROR;
+		goto end;
+	}
+	if (paceInfo->cipher == SM_CIPHER_AES) {
+		aes_cbc_decrypt(nonce, buffer, blockSize, passwordKey, paceInfo->keyLength, NULL);
+	} else {
+		crypto_des3_cbc(MBEDTLS_DES_DECRYPT, passwordKey, buffer, blockSize, nonce);
+	}
+
+	// Step 2: mapping, G' = s * G + SK_map * PK_map,IC
+	ret = APP_ERROR;
+	if (RandomNonceGenerate(random, scalarLength + 8) != APP_SUCCESS ||
+		ecc_gen_private(grp, privateKey, random, scalarLength + 8) != 0 ||
+		ecc_mul_base(grp, &point, privateKey, scalarLength) != 0) {
+		goto end;
+	}
+	publicKeyLength = ecc_point_write(grp, &point, publicKey);
+	if (GeneralAuthenticate(0, 0x81, publicKey, publicKeyLength, 0x82, chipPublicKey,
+							sizeof(chipPublicKey), &chipPublicKeyLength) != APP_SUCCESS) {
+		printf("Fail to Map Nonce.\n");
+		goto end;
+	}
+	if (ecc_point_read(grp, &point, chipPublicKey, chipPublicKeyLength) != 0 ||
+		ecc_mul(grp, &mapped, privateKey, scalarLength, &point) != 0 ||
+		ecc_mul_base(grp, &generator, nonce, blockSize) != 0) {
+		printf("Invalid PACE mapping data.\n");
+		goto end;
+	}
+	ecc_add(grp, &generator, &generator, &mapped);
+	if (ecc_is_infinity(grp, &generator)) {
+		goto end;
+	}
+
+	// Step 3: key agreement on G', K = x(SK_eph * PK_eph,IC)
+	if (RandomNonceGenerate(random, scalarLength + 8) != APP_SUCCESS ||
+		ecc_gen_private(grp, privateKey, random, scalarLength + 8) != 0 ||
+		ecc_mul(grp, &point, privateKey, scalarLength, &generator) != 0) {
+		goto end;
+	}
+	publicKeyLength = ecc_point_write(grp, &point, publicKey);
+	if (GeneralAuthenticate(0, 0x83, publicKey, publicKeyLength, 0x84, chipPublicKey,
+							sizeof(chipPublicKey), &chipPublicKeyLength) != APP_SUCCESS) {
+		printf("Fail to Perform Key Agreement.\n");
+		goto end;
+	}
+	if (chipPublicKeyLength == publicKeyLength &&
+		!memcmp(chipPublicKey, publicKey, publicKeyLength)) {
+		printf("Invalid PACE ephemeral public key.\n");
+		goto end;
+	}
+	if (ecc_point_read(grp, &mapped, chipPublicKey, chipPublicKeyLength) != 0 ||
+		ecc_mul(grp, &point, privateKey, scalarLength, &mapped) != 0 ||
+		ecc_point_x(grp, &point, sharedSecret) != 0) {
+		goto end;
+	}
+
+	// KS_Enc = KDF(K, 1), KS_MAC = KDF(K, 2)
+	SecureMessagingKeyDerive(sharedSecret, grp->byteLength, SM_KDF_ENCRYPT, paceInfo->cipher,
+							 paceInfo->keyLength, encryptKey);
+	SecureMessagingKeyDerive(sharedSecret, grp->byteLength, SM_KDF_MAC, paceInfo->cipher,
+							 paceInfo->keyLength, macKey);
+	SecureMessagingInit(session, paceInfo->cipher, encryptKey, macKey, paceInfo->keyLength, NULL);
+
+	// Step 4: mutual authentication, T_IFD over PK_eph,IC and T_IC over PK_eph,IFD
+	unsigned char token[SM_MAC_LENGTH], tokenCheck[SM_MAC_LENGTH];
+	AuthenticationToken(session, paceInfo, chipPublicKey, chipPublicKeyLength, token);
+	if (GeneralAuthenticate(1, 0x85, token, SM_MAC_LENGTH, 0x86, buffer, sizeof(buffer),
+							&bufferLength) != APP_SUCCESS) {
+		printf("Fail to Perform Mutual Authentication.\n");
+		goto end;
+	}
+	AuthenticationToken(session, paceInfo, publicKey, publicKeyLength, tokenCheck);
+	if (bufferLength != SM_MAC_LENGTH || memcmp(buffer, tokenCheck, SM_MAC_LENGTH)) {
+		printf("Invalid PACE authentication token.\n");
+		goto end;
+	}
+	ret = APP_SUCCESS;
+
+end:
+	memset(passwordKey, 0, sizeof(passwordKey));
+	memset(nonce, 0, sizeof(nonce));
+	memset(privateKey, 0, sizeof(privateKey));
+	memset(random, 0, sizeof(random));
+	memset(sharedSecret, 0, sizeof(sharedSecret));
+	memset(encryptKey, 0, sizeof(encryptKey));
+	memset(macKey, 0, sizeof(macKey));
+	if (ret != APP_SUCCESS) {
+		memset(session, 0, sizeof(SecureMessagingSession));
+	}
+	return ret;
+}
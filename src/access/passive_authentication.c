@@ -0,0 +1,344 @@
+/**
+ * @author Khoa Nguyen
+ * @file passive_authentication.c
+ * @brief Source file for Passive Authentication functions.
+ *
+ * This source file contains the implementation of EF.SOD decoding and Passive Authentication. The
+ * signature of EF.SOD costs a public key operation of the Document Signer, so it runs on a worker
+ * thread while the main thread reads and hashes the data groups.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <access/passive_authentication.h>
+#include <utils/reader.h>
+#include <utils/tlv.h>
+#include <utils/trust_store.h>
+
+#define PA_MAX_SIGNED_DATA_FIELDS 6
+#define PA_MAX_SIGNER_INFO_FIELDS 7
+
+// id-signedData = 1.2.840.113549.1.7.2
+static const unsigned char SIGNED_DATA_OID[9] = {0x2A, 0x86, 0x48, 0x86, 0xF7,
+												 0x0D, 0x01, 0x07, 0x02};
+
+// id-icao-mrtd-security-ldsSecurityObject = 2.23.136.1.1.1
+static const unsigned char LDS_SECURITY_OBJECT_OID[6] = {0x67, 0x81, 0x08, 0x01, 0x01, 0x01};
+
+// id-messageDigest = 1.2.840.113549.1.9.4
+static const unsigned char MESSAGE_DIGEST_OID[9] = {0x2A, 0x86, 0x48, 0x86, 0xF7,
+													0x0D, 0x01, 0x09, 0x04};
+
+// id-ce-subjectKeyIdentifier = 2.5.29.14
+static const unsigned char SUBJECT_KEY_IDENTIFIER_OID[3] = {0x55, 0x1D, 0x0E};
+
+// LDSSecurityObject ::= SEQUENCE { version INTEGER, hashAlgorithm AlgorithmIdentifier,
+//									dataGroupHashValues SEQUENCE OF DataGroupHash,
+//									ldsVersionInfo LDSVersionInfo OPTIONAL }
+static int ParseLdsSecurityObject(const unsigned char* content, int contentLength, SodInfo* info) {
+	const unsigned char *object, *values[4], *algorithm[2];
+	int objectLength, lengths[4], algorithmLengths[2];
+	unsigned int tags[4], algorithmTags[2];
+
+	if (TlvFind(content, contentLength, 0x30, &object, &objectLength) != APP_SUCCESS ||
+		TlvSplit(object, objectLength, tags, values, lengths, 4) < 3 || tags[0] != 0x02 ||
+		tags[1] != 0x30 || tags[2] != 0x30 ||
+		TlvSplit(values[1], lengths[1], algorithmTags, algorithm, algorithmLengths, 2) < 1 ||
+		algorithmTags[0] != 0x06) {
+		return APP_ERROR;
+	}
+	info->hashAlgorithm = DigestAlgorithm(algorithm[0], algorithmLengths[0]);
+	if (info->hashAlgorithm == APP_ERROR) {
+		return APP_ERROR;
+	}
+
+	// DataGroupHash ::= SEQUENCE { dataGroupNumber INTEGER, dataGroupHashValue OCTET STRING }
+	int hashLength		 = hash_length(info->hashAlgorithm);
+	int pos				 = 0;
+	info->dataGroupCount = 0;
+	while (pos < lengths[2]) {
+		unsigned int tag, fieldTags[2];
+		int length, headerLength, fieldLengths[2];
+		const unsigned char* fields[2];
+		if (TlvParse(&values[2][pos], lengths[2] - pos, &tag, &length, &headerLength) !=
+				APP_SUCCESS ||
+			tag != 0x30 || info->dataGroupCount == PA_MAX_DATA_GROUPS ||
+			TlvSplit(&values[2][pos + headerLength], length, fieldTags, fields, fieldLengths, 2) !=
+				2 ||
+			fieldTags[0] != 0x02 || fieldTags[1] != 0x04 || fieldLengths[1] != hashLength) {
+			return APP_ERROR;
+		}
+		info->dataGroups[info->dataGroupCount]		= TlvReadInteger(fields[0], fieldLengths[0]);
+		info->dataGroupHashes[info->dataGroupCount] = fields[1];
+		info->dataGroupCount++;
+		pos += headerLength + length;
+	}
+	return APP_SUCCESS;
+}
+
+// The signer is named by issuer and serial number, or by subject key identifier ([0])
+static int IsSigner(const Certificate* cert,
+					unsigned int sidTag,
+					const unsigned char* sid,
+					int sidLength) {
+	const unsigned char* values[2];
+	int lengths[2];
+	unsigned int tags[2];
+
+	if (sidTag == 0x80) {
+		const unsigned char *extension, *keyIdentifier;
+		int extensionLength, keyIdentifierLength;
+		return CertificateExtension(cert, SUBJECT_KEY_IDENTIFIER_OID,
+									sizeof(SUBJECT_KEY_IDENTIFIER_OID), &extension,
+									&extensionLength) == APP_SUCCESS &&
+			   TlvFind(extension, extensionLength, 0x04, &keyIdentifier, &keyIdentifierLength) ==
+				   APP_SUCCESS &&
+			   keyIdentifierLength == sidLength && !memcmp(keyIdentifier, sid, sidLength);
+	}
+
+	// IssuerAndSerialNumber ::= SEQUENCE { issuer Name, serialNumber INTEGER }
+	unsigned int issuerTag;
+	int issuerLength, issuerHeaderLength;
+	if (sidTag != 0x30 || TlvSplit(sid, sidLength, tags, values, lengths, 2) != 2 ||
+		tags[0] != 0x30 || tags[1] != 0x02 ||
+		TlvParse(cert->issuer, cert->issuerLength, &issuerTag, &issuerLength,
+				 &issuerHeaderLength) != APP_SUCCESS) {
+		return 0;
+	}
+	return lengths[0] == issuerLength &&
+		   !memcmp(values[0], &cert->issuer[issuerHeaderLength], issuerLength) &&
+		   lengths[1] == cert->serialNumberLength &&
+		   !memcmp(values[1], cert->serialNumber, lengths[1]);
+}
+
+// SignerInfo ::= SEQUENCE { version, sid, digestAlgorithm, signedAttrs [0] IMPLICIT OPTIONAL,
+//							 signatureAlgorithm, signature OCTET STRING, unsignedAttrs [1] }
+static int ParseSignerInfo(const unsigned char* signerInfo,
+						   int signerInfoLength,
+						   const unsigned char* certificates,
+						   int certificatesLength,
+						   SodInfo* info) {
+	const unsigned char *values[PA_MAX_SIGNER_INFO_FIELDS], *algorithm[2];
+	int lengths[PA_MAX_SIGNER_INFO_FIELDS], algorithmLengths[2];
+	unsigned int tags[PA_MAX_SIGNER_INFO_FIELDS], algorithmTags[2];
+
+	int count = TlvSplit(signerInfo, signerInfoLength, tags, values, lengths,
+						 PA_MAX_SIGNER_INFO_FIELDS);
+
+	// The signed attributes are optional, the message digest is then signed directly
+	int hasAttributes = count > 3 && tags[3] == 0xA0;
+	if (count < 5 + hasAttributes || tags[0] != 0x02 || tags[2] != 0x30 ||
+		tags[3 + hasAttributes] != 0x30 || tags[4 + hasAttributes] != 0x04 ||
+		TlvSplit(values[2], lengths[2], algorithmTags, algorithm, algorithmLengths, 2) < 1 ||
+		algorithmTags[0] != 0x06) {
+		return APP_ERROR;
+	}
+	info->digestAlgorithm = DigestAlgorithm(algorithm[0], algorithmLengths[0]);
+	if (info->digestAlgorithm == APP_ERROR) {
+		return APP_ERROR;
+	}
+	info->signedAttributes		   = hasAttributes ? values[3] : NULL;
+	info->signedAttributesLength   = hasAttributes ? lengths[3] : 0;
+	info->signatureAlgorithm	   = values[3 + hasAttributes];
+	info->signatureAlgorithmLength = lengths[3 + hasAttributes];
+	info->signature				   = values[4 + hasAttributes];
+	info->signatureLength		   = lengths[4 + hasAttributes];
+
+	// The Document Signer certificate is the one named by sid
+	int pos = 0;
+	while (pos < certificatesLength) {
+		unsigned int tag;
+		int length, headerLength;
+		if (TlvParse(&certificates[pos], certificatesLength - pos, &tag, &length,
+					 &headerLength) != APP_SUCCESS) {
+			return APP_ERROR;
+		}
+		if (tag == 0x30 &&
+			ParseCertificate(&certificates[pos], headerLength + length, &info->signer) ==
+				APP_SUCCESS &&
+			IsSigner(&info->signer, tags[1], values[1], lengths[1])) {
+			return APP_SUCCESS;
+		}
+		pos += headerLength + length;
+	}
+	return APP_ERROR;
+}
+
+long ReadSOD(SecureMessagingSession* session, unsigned char* sod, int* sodLength) {
+	// Unprotected command: 0x00, 0xA4, 0x02, 0x0C, 0x02, 0x01, 0x1D
+	unsigned char selectSODCmdData[2] = {0x01, 0x1D};
+	int ret = ProtectedReadFile(selectSODCmdData, sod, PA_MAX_SOD, sodLength, session);
+	if (ret != APP_SUCCESS) {
+		printf("Fail to Read EF.SOD.\n");
+		return ret;
+	}
+	return APP_SUCCESS;
+}
+
+int ParseSOD(const unsigned char* sod, int sodLength, SodInfo* info) {
+	const unsigned char *application, *content, *contentInfo[2], *signedData;
+	const unsigned char* signedDataFields[PA_MAX_SIGNED_DATA_FIELDS];
+	int applicationLength, contentLength, contentInfoLengths[2], signedDataLength;
+	int signedDataLengths[PA_MAX_SIGNED_DATA_FIELDS];
+	unsigned int contentInfoTags[2], signedDataTags[PA_MAX_SIGNED_DATA_FIELDS];
+
+	// EF.SOD ::= [APPLICATION 23] ContentInfo, ContentInfo ::= SEQUENCE { id-signedData,
+	// content [0] EXPLICIT SignedData }
+	if (TlvFind(sod, sodLength, 0x77, &application, &applicationLength) != APP_SUCCESS ||
+		TlvFind(application, applicationLength, 0x30, &content, &contentLength) != APP_SUCCESS ||
+		TlvSplit(content, contentLength, contentInfoTags, contentInfo, contentInfoLengths, 2) !=
+			2 ||
+		contentInfoTags[0] != 0x06 || contentInfoLengths[0] != sizeof(SIGNED_DATA_OID) ||
+		memcmp(contentInfo[0], SIGNED_DATA_OID, sizeof(SIGNED_DATA_OID)) ||
+		contentInfoTags[1] != 0xA0 ||
+		TlvFind(contentInfo[1], contentInfoLengths[1], 0x30, &signedData, &signedDataLength) !=
+			APP_SUCCESS) {
+		return APP_ERROR;
+	}
+
+	// SignedData ::= SEQUENCE { version, digestAlgorithms SET, encapContentInfo,
+	//							 certificates [0] IMPLICIT OPTIONAL, crls [1] IMPLICIT OPTIONAL,
+	//							 signerInfos SET }, EF.SOD always carries the Document Signer
+	int count = TlvSplit(signedData, signedDataLength, signedDataTags, signedDataFields,
+						 signedDataLengths, PA_MAX_SIGNED_DATA_FIELDS);
+	if (count < 4 || signedDataTags[0] != 0x02 || signedDataTags[1] != 0x31 ||
+		signedDataTags[2] != 0x30 || signedDataTags[3] != 0xA0 ||
+		signedDataTags[count - 1] != 0x31) {
+		return APP_ERROR;
+	}
+
+	// EncapsulatedContentInfo ::= SEQUENCE { id-icao-ldsSecurityObject,
+	//										  eContent [0] EXPLICIT OCTET STRING }
+	const unsigned char* encapsulated[2];
+	int encapsulatedLengths[2];
+	unsigned int encapsulatedTags[2];
+	if (TlvSplit(signedDataFields[2], signedDataLengths[2], encapsulatedTags, encapsulated,
+				 encapsulatedLengths, 2) != 2 ||
+		encapsulatedTags[0] != 0x06 || encapsulatedLengths[0] != sizeof(LDS_SECURITY_OBJECT_OID) ||
+		memcmp(encapsulated[0], LDS_SECURITY_OBJECT_OID, sizeof(LDS_SECURITY_OBJECT_OID)) ||
+		encapsulatedTags[1] != 0xA0 ||
+		TlvFind(encapsulated[1], encapsulatedLengths[1], 0x04, &info->content,
+				&info->contentLength) != APP_SUCCESS ||
+		ParseLdsSecurityObject(info->content, info->contentLength, info) != APP_SUCCESS) {
+		return APP_ERROR;
+	}
+
+	// EF.SOD has a single SignerInfo
+	const unsigned char* signerInfo;
+	int signerInfoLength;
+	if (TlvFind(signedDataFields[count - 1], signedDataLengths[count - 1], 0x30, &signerInfo,
+				&signerInfoLength) != APP_SUCCESS) {
+		return APP_ERROR;
+	}
+	return ParseSignerInfo(signerInfo, signerInfoLength, signedDataFields[3], signedDataLengths[3],
+						   info);
+}
+
+long VerifySODSignature(const SodInfo* info) {
+	unsigned char digest[HASH_MAX_DIGEST_LENGTH];
+	int digestLength =
+		hash_compute(info->digestAlgorithm, info->content, info->contentLength, digest);
+
+	if (info->signedAttributes != NULL) {
+		// Attribute ::= SEQUENCE { attrType OID, attrValues SET OF AttributeValue }
+		const unsigned char* messageDigest = NULL;
+		int pos = 0, messageDigestLength = 0;
+		while (pos < info->signedAttributesLength) {
+			const unsigned char *attribute = &info->signedAttributes[pos], *fields[2];
+			unsigned int tag, fieldTags[2];
+			int length, headerLength, fieldLengths[2];
+			if (TlvParse(attribute, info->signedAttributesLength - pos, &tag, &length,
+						 &headerLength) != APP_SUCCESS) {
+				return APP_ERROR;
+			}
+			pos += headerLength + length;
+			if (tag == 0x30 &&
+				TlvSplit(&attribute[headerLength], length, fieldTags, fields, fieldLengths, 2) ==
+					2 &&
+				fieldTags[0] == 0x06 && fieldLengths[0] == sizeof(MESSAGE_DIGEST_OID) &&
+				!memcmp(fields[0], MESSAGE_DIGEST_OID, sizeof(MESSAGE_DIGEST_OID)) &&
+				fieldTags[1] == 0x31) {
+				TlvFind(fields[1], fieldLengths[1], 0x04, &messageDigest, &messageDigestLength);
+			}
+		}
+		if (messageDigest == NULL || messageDigestLength != digestLength ||
+			memcmp(messageDigest, digest, digestLength)) {
+			return APP_ERROR;
+		}
+
+		// The signature covers the DER encoding of the attributes as a SET OF
+		unsigned char header[4] = {0x31};
+		int headerLength		= 1 + TlvEncodeLength(info->signedAttributesLength, &header[1]);
+		hash_ctx ctx;
+		hash_init(&ctx, info->digestAlgorithm);
+		hash_update(&ctx, header, headerLength);
+		hash_update(&ctx, info->signedAttributes, info->signedAttributesLength);
+		hash_final(&ctx, digest);
+	}
+
+	return SignatureVerify(info->signer.publicKey, info->signer.publicKeyLength,
+						   info->signatureAlgorithm, info->signatureAlgorithmLength,
+						   info->digestAlgorithm, digest, info->signature, info->signatureLength);
+}
+
+/**
+ * @brief Verifies the signature of EF.SOD, then its Document Signer if a CSCA store is loaded.
+ */
+static long VerifySOD(const SodInfo* info) {
+	if (VerifySODSignature(info) != APP_SUCCESS) {
+		return APP_ERROR;
+	}
+	return TrustStoreLoaded() ? VerifyDocumentSigner(&info->signer) : APP_SUCCESS;
+}
+
+static void SODVerificationMain(void* argument) {
+	SodVerification* verification = (SodVerification*)argument;
+	verification->result		  = VerifySOD(verification->sod);
+}
+
+void StartSODVerification(SodVerification* verification, const SodInfo* info) {
+	verification->sod	   = info;
+	verification->result   = PA_PENDING;
+	verification->threaded = SyncThreadStart(&verification->worker, SODVerificationMain,
+											 verification) == 0;
+	if (!verification->threaded) {
+		verification->result = VerifySOD(info);
+	}
+}
+
+long PollSODVerification(const SodVerification* verification) {
+	return verification->result;
+}
+
+long FinishSODVerification(SodVerification* verification) {
+	if (verification->threaded) {
+		SyncThreadJoin(&verification->worker);
+		verification->threaded = 0;
+	}
+	return verification->result;
+}
+
+int StartDataGroupHash(const SodInfo* info, int dataGroup, hash_ctx* dgHash) {
+	for (int i = 0; i < info->dataGroupCount; i++) {
+		if (info->dataGroups[i] == dataGroup) {
+			hash_init(dgHash, info->hashAlgorithm);
+			return APP_SUCCESS;
+		}
+	}
+	return APP_ERROR;
+}
+
+long CheckDataGroupHash(const SodInfo* info, int dataGroup, hash_ctx* dgHash) {
+	unsigned char digest[HASH_MAX_DIGEST_LENGTH];
+
+	hash_final(dgHash, digest);
+	for (int i = 0; i < info->dataGroupCount; i++) {
+		if (info->dataGroups[i] == dataGroup &&
+			!memcmp(info->dataGroupHashes[i], digest, hash_length(info->hashAlgorithm))) {
+			return APP_SUCCESS;
+		}
+	}
+	printf("Invalid hash of DG%d.\n", dataGroup);
+	return APP_ERROR;
+}
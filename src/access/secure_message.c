@@ -5,196 +5,563 @@
  *
  * This file provides the implementation for secure messaging between an application
  * and a smart card. It implements protected APDU commands for SELECT and READ BINARY operations,
- * using encryption and MAC calculation and integrity of the communication.
+ * using encryption and MAC calculation and integrity of the communication. The wrap and unwrap
+ * steps follow ICAO Doc 9303 Part 11 for both 3DES and AES session keys.
  */
 
 #include <stdio.h>
 #include <string.h>
 
+#include <access/secure_message.h>
+#include <cryptography/aes.h>
+#include <cryptography/cmac.h>
 #include <cryptography/des.h>
-#include <cryptography/mac3.h>
+#include <cryptography/provider.h>
+#include <cryptography/sha256.h>
 #include <utils/reader.h>
+#include <utils/tlv.h>
 #include <utils/util.h>
 
-inline void IncreaseUnsignedCharByOne(unsigned char* hexArray, int len) {
+#define SM_MAX_MAC_INPUT	 400  // Largest padded MAC input
+#define SM_MAX_SECRET_LENGTH 512  // Up to 4096-bit DH shared secrets
+
+static void IncreaseUnsignedCharByOne(unsigned char* hexArray, int len) {
 	int lastIndex = len - 1;
-	while (hexArray[lastIndex] == 255) {
+	while (lastIndex > 0 && hexArray[lastIndex] == 255) {
 		hexArray[lastIndex] = 0;
 		lastIndex -= 1;
 	}
 	hexArray[lastIndex] += 1;
 }
 
-int ProtectedSelectAPDU(unsigned char cmdData[2],
-						unsigned char* sendSequenceCounter,
-						unsigned char encryptSessionKey[16],
-						unsigned char macSessionKey[16]) {
-	// Padding CmdHeader
-	unsigned char selectCmdHeader[4] = {0x0C, 0xA4, 0x02, 0x0C};
-	unsigned char cmdHeader[8];
-	memcpy(cmdHeader, selectCmdHeader, 4);
-	PadByteArray(cmdHeader, 4);
+// Appends ISO 9797-1 padding method 2 and returns the padded length
+static int PadToBlock(unsigned char* buf, int length, int blockSize) {
+	buf[length++] = 0x80;
+	while (length % blockSize) {
+		buf[length++] = 0x00;
+	}
+	return length;
+}
 
-	// Padding Data
-	unsigned char padData[8];
-	memcpy(padData, cmdData, 2);
-	PadByteArray(padData, 2);
+// Encrypts (or decrypts) whole blocks with KS_Enc, AES uses IV = E(KS_Enc, SSC)
+static int SessionCrypt(const SecureMessagingSession* session,
+						int mode,
+						const unsigned char* input,
+						int length,
+						unsigned char* output) {
+	if (session->cipher == SM_CIPHER_3DES) {
+		return crypto_des3_cbc(mode == AES_ENCRYPT ? MBEDTLS_DES_ENCRYPT : MBEDTLS_DES_DECRYPT,
+							   session->encryptKey, input, length, output);
+	}
 
-	// Encrypt data with KS_Enc
-	unsigned char encryptData[8];
-	des3_cbc_encrypt(encryptData, padData, 8, encryptSessionKey, 16, 0);
+	aes_context ctx;
+	unsigned char iv[16];
+	if (aes_setkey_enc(&ctx, session->encryptKey, session->keyLength * 8) != 0) {
+		return APP_ERROR;
+	}
+	aes_crypt_ecb(&ctx, AES_ENCRYPT, session->sendSequenceCounter, iv);
+	if (mode == AES_DECRYPT) {
+		aes_setkey_dec(&ctx, session->encryptKey, session->keyLength * 8);
+	}
+	int ret = aes_crypt_cbc(&ctx, mode, length, iv, input, output);
+	aes_free(&ctx);
+	return ret;
+}
 
-	// Build DO'87'
-	unsigned char dataObject87[11] = {0x87, 0x09, 0x01};
-	memcpy(&dataObject87[3], encryptData, 8);
+// Secure messaging data objects of a protected command or response body
+typedef struct {
+	const unsigned char* encrypted;	 // Content of DO'87' after the padding indicator, or NULL
+	int encryptedLength;
+	const unsigned char* plain;	 // Content of DO'97' or DO'99', or NULL
+	int plainLength;
+	int macInput;	// Length of the body covered by the MAC, up to DO'8E'
+	int macOffset;	// Offset of the content of DO'8E' in the body
+} SmObjects;
 
-	// M = CmdHeader || DO'87'
-	unsigned char concatM[19];
-	memcpy(concatM, cmdHeader, 8);
-	memcpy(&concatM[8], dataObject87, 11);
+// Locates DO'87', DO'97' or DO'99' and DO'8E' in a protected body
+static int ParseObjects(const unsigned char* body, int bodyLen, int blockSize, SmObjects* objects) {
+	int pos = 0;
 
-	// Increment SSC with 1
-	IncreaseUnsignedCharByOne(sendSequenceCounter, 8);
-
-	// N = SSC || M || Padding
-	unsigned char concatN[32];
-	memcpy(concatN, sendSequenceCounter, 8);
-	memcpy(&concatN[8], concatM, 19);
-	PadByteArray(concatN, 27);
-
-	// Compute MAC of M
-	unsigned char mac[8];  // CC
-	des_mac3_checksum(32, mac, concatN, macSessionKey);
-
-	// Build DO'8E'
-	unsigned char dataObject8E[10] = {0x8E, 0x08};
-	memcpy(&dataObject8E[2], mac, 8);
-
-	// Construct protected APDU
-	unsigned char protectedAPDU[27];
-	memcpy(protectedAPDU, cmdHeader, 4);  // Header
-	protectedAPDU[4] = 0x15;			  // Lc'
-	protectedAPDU[5] = 0x87;
-	protectedAPDU[6] = 0x09;
-	protectedAPDU[7] = 0x01;					   // '87' L '01'
-	memcpy(&protectedAPDU[8], encryptData, 8);	   // Encrypted data
-	memcpy(&protectedAPDU[16], dataObject8E, 10);  // DO'8E'
-	protectedAPDU[26] = 0x00;
+	memset(objects, 0, sizeof(SmObjects));
+	while (pos < bodyLen) {
+		unsigned int tag;
+		int length, headerLength;
+		if (TlvParse(&body[pos], bodyLen - pos, &tag, &length, &headerLength) != APP_SUCCESS) {
+			return APP_ERROR;
+		}
+		const unsigned char* value = &body[pos + headerLength];
+		if (tag == 0x87) {
+			if (length < 1 + blockSize || value[0] != 0x01 || (length - 1) % blockSize) {
+				return APP_ERROR;
+			}
+			objects->encrypted		 = &value[1];
+			objects->encryptedLength = length - 1;
+		} else if (tag == 0x97 || tag == 0x99) {
+			objects->plain		 = value;
+			objects->plainLength = length;
+		} else if (tag == 0x8E) {
+			if (length != SM_MAC_LENGTH) {
+				return APP_ERROR;
+			}
+			objects->macInput  = pos;
+			objects->macOffset = pos + headerLength;
+			return APP_SUCCESS;
+		}
+		pos += headerLength + length;
+	}
+	return APP_ERROR;
+}
 
-	// Send protected APDU
-	unsigned char protectedResponse[16];  // RAPDU
-	unsigned long protectedResponseLength = sizeof(protectedResponse);
-	int ret = TransmitDataToCard(protectedAPDU, sizeof(protectedAPDU), protectedResponse,
-								 &protectedResponseLength);
-	if (ret != APP_SUCCESS) {
-		printf("Fail to Send protected APDU.\n");
-		return ret;
+// Decrypts DO'87' and removes the ISO 9797-1 padding method 2
+static int DecryptObject(const SecureMessagingSession* session,
+						 const SmObjects* objects,
+						 unsigned char* data,
+						 int* dataLen) {
+	unsigned char plain[SM_MAX_PROTECTED_RESPONSE];
+	if (objects->encryptedLength > SM_MAX_PROTECTED_RESPONSE ||
+		SessionCrypt(session, AES_DECRYPT, objects->encrypted, objects->encryptedLength, plain) !=
+			0) {
+		return APP_ERROR;
+	}
+	// Remove padding
+	int length = objects->encryptedLength - 1;
+	while (length > 0 && plain[length] == 0x00) {
+		length--;
+	}
+	if (plain[length] != 0x80) {
+		return APP_ERROR;
+	}
+	memcpy(data, plain, length);
+	*dataLen = length;
+	return APP_SUCCESS;
+}
+
+void SecureMessagingInit(SecureMessagingSession* session,
+						 int cipher,
+						 const unsigned char* encryptKey,
+						 const unsigned char* macKey,
+						 int keyLength,
+						 const unsigned char* sendSequenceCounter) {
+	memset(session, 0, sizeof(SecureMessagingSession));
+	session->cipher	   = cipher;
+	session->keyLength = keyLength;
+	session->blockSize = cipher == SM_CIPHER_AES ? 16 : 8;
+	memcpy(session->encryptKey, encryptKey, keyLength);
+	memcpy(session->macKey, macKey, keyLength);
+	if (sendSequenceCounter != NULL) {
+		memcpy(session->sendSequenceCounter, sendSequenceCounter, session->blockSize);
+	}
+	session->readChunk = SM_MAX_READ_CHUNK;
+}
+
+void SecureMessagingKeyDerive(const unsigned char* secret,
+							  int secretLength,
+							  unsigned int counter,
+							  int cipher,
+							  int keyLength,
+							  unsigned char* key) {
+	// D = K || c, with c a 32-bit big-endian counter
+	unsigned char d[SM_MAX_SECRET_LENGTH + 4];
+	unsigned char digest[32];
+	memcpy(d, secret, secretLength);
+	d[secretLength]		= (unsigned char)(counter >> 24);
+	d[secretLength + 1] = (unsigned char)(counter >> 16);
+	d[secretLength + 2] = (unsigned char)(counter >> 8);
+	d[secretLength + 3] = (unsigned char)counter;
+
+	if (cipher == SM_CIPHER_3DES || keyLength == 16) {
+		crypto_sha1(d, secretLength + 4, digest);
+	} else {
+		sha256(d, secretLength + 4, digest);
+	}
+	memcpy(key, digest, keyLength);
+	memset(d, 0, sizeof(d));
+	memset(digest, 0, sizeof(digest));
+}
+
+void SecureMessagingChecksum(const SecureMessagingSession* session,
+							 const unsigned char* data,
+							 int length,
+							 unsigned char mac[SM_MAC_LENGTH]) {
+	unsigned char padded[SM_MAX_MAC_INPUT];
+	memcpy(padded, data, length);
+	int paddedLength = PadToBlock(padded, length, session->blockSize);
+
+	if (session->cipher == SM_CIPHER_3DES) {
+		crypto_mac3(session->macKey, padded, paddedLength, mac);
+	} else {
+		unsigned char fullMac[16];
+		aes_cmac_checksum(paddedLength, fullMac, padded, session->macKey, session->keyLength);
+		memcpy(mac, fullMac, SM_MAC_LENGTH);
+	}
+}
+
+int SecureMessagingWrap(SecureMessagingSession* session,
+						const unsigned char* cmd,
+						int cmdLen,
+						unsigned char* protectedCmd,
+						int* protectedCmdLen) {
+	int blockSize			  = session->blockSize;
+	const unsigned char* data = NULL;
+	int dataLen				  = 0;
+	int hasLe				  = 0;
+	unsigned char le		  = 0;
+
+	// Split the short APDU into header, command data and expected length
+	if (cmdLen < 4) {
+		return APP_ERROR;
+	} else if (cmdLen == 5) {
+		hasLe = 1;
+		le	  = cmd[4];
+	} else if (cmdLen > 5) {
+		dataLen = cmd[4];
+		data	= &cmd[5];
+		if (cmdLen == 6 + dataLen) {
+			hasLe = 1;
+			le	  = cmd[5 + dataLen];
+		} else if (cmdLen != 5 + dataLen) {
+			return APP_ERROR;
+		}
 	}
 
-	// Verify RAPDU CC by computing MAC of DO'99'
 	// Increment SSC with 1
-	IncreaseUnsignedCharByOne(sendSequenceCounter, 8);
+	IncreaseUnsignedCharByOne(session->sendSequenceCounter, blockSize);
 
-	// Concatenate SSC and DO'99' and add padding
-	unsigned char concatK[16];	// K
-	memcpy(concatK, sendSequenceCounter, 8);
-	memcpy(&concatK[8], protectedResponse, 4);
-	PadByteArray(concatK, 12);
+	// N = SSC || padded CmdHeader || DO'87' || DO'97'
+	unsigned char concatN[SM_MAX_MAC_INPUT];
+	memcpy(concatN, session->sendSequenceCounter, blockSize);
+	memcpy(&concatN[blockSize], cmd, 4);
+	concatN[blockSize] |= 0x0C;
+	int nLen	   = PadToBlock(concatN, blockSize + 4, blockSize);
+	int objectsPos = nLen;
+
+	if (dataLen > 0) {
+		// DO'87' = '87' L '01' || encrypted padded data
+		unsigned char padData[SM_MAX_COMMAND_DATA + SM_MAX_BLOCK_SIZE];
+		unsigned char encryptData[SM_MAX_COMMAND_DATA + SM_MAX_BLOCK_SIZE + 1];
+		memcpy(padData, data, dataLen);
+		int padLen	   = PadToBlock(padData, dataLen, blockSize);
+		encryptData[0] = 0x01;
+		if (SessionCrypt(session, AES_ENCRYPT, padData, padLen, &encryptData[1]) != 0) {
+			return APP_ERROR;
+		}
+		nLen += TlvEncode(0x87, encryptData, padLen + 1, &concatN[nLen]);
+	}
+	if (hasLe) {
+		// DO'97' = '97' '01' Le
+		concatN[nLen++] = 0x97;
+		concatN[nLen++] = 0x01;
+		concatN[nLen++] = le;
+	}
+	int objectsLen = nLen - objectsPos;
+
+	// Compute MAC of N and build DO'8E'
+	unsigned char mac[SM_MAC_LENGTH];  // CC
+	SecureMessagingChecksum(session, concatN, nLen, mac);
+
+	if (objectsLen + 2 + SM_MAC_LENGTH > SM_MAX_COMMAND_DATA) {
+		return APP_ERROR;
+	}
 
-	// Compute MAC with KS_MAC
-	unsigned char macCheck[8];	// CC'
-	des_mac3_checksum(16, macCheck, concatK, macSessionKey);
+	// Construct protected APDU: header || Lc' || DO'87' || DO'97' || DO'8E' || '00'
+	int pos = 4;
+	memcpy(protectedCmd, cmd, 4);
+	protectedCmd[0] |= 0x0C;
+	protectedCmd[pos++] = (unsigned char)(objectsLen + 2 + SM_MAC_LENGTH);
+	memcpy(&protectedCmd[pos], &concatN[objectsPos], objectsLen);
+	pos += objectsLen;
+	protectedCmd[pos++] = 0x8E;
+	protectedCmd[pos++] = SM_MAC_LENGTH;
+	memcpy(&protectedCmd[pos], mac, SM_MAC_LENGTH);
+	pos += SM_MAC_LENGTH;
+	protectedCmd[pos++] = 0x00;
+
+	*protectedCmdLen = pos;
+	return APP_SUCCESS;
+}
+
+int SecureMessagingUnwrap(SecureMessagingSession* session,
+						  const unsigned char* res,
+						  int resLen,
+						  unsigned char* data,
+						  int* dataLen,
+						  unsigned int* statusWord) {
+	int blockSize = session->blockSize;
+	SmObjects objects;
+	*dataLen = 0;
+
+	// Increment SSC with 1, the response counts even when it carries an error
+	IncreaseUnsignedCharByOne(session->sendSequenceCounter, blockSize);
+
+	// Locate DO'87' / DO'99' / DO'8E' in the response body
+	if (ParseObjects(res, resLen - 2, blockSize, &objects) != APP_SUCCESS ||
+		objects.macInput == 0 || (objects.plain != NULL && objects.plainLength != 2)) {
+		// The card answered without secure messaging, typically an SM error status
+		return APP_ERROR;
+	}
+
+	// K = SSC || DO'87' || DO'99'
+	unsigned char concatK[SM_MAX_MAC_INPUT];
+	if (blockSize + objects.macInput + blockSize > SM_MAX_MAC_INPUT) {
+		return APP_ERROR;
+	}
+	memcpy(concatK, session->sendSequenceCounter, blockSize);
+	memcpy(&concatK[blockSize], res, objects.macInput);
 
 	// Compare CC' with data of DO'8E' of RAPDU
-	if (memcmp(macCheck, &protectedResponse[6], 8)) {
-		printf("Invalid Response APDU.\n");
+	unsigned char macCheck[SM_MAC_LENGTH];	// CC'
+	SecureMessagingChecksum(session, concatK, blockSize + objects.macInput, macCheck);
+	if (memcmp(macCheck, &res[objects.macOffset], SM_MAC_LENGTH)) {
 		return APP_ERROR;
 	}
+
+	if (statusWord != NULL) {
+		*statusWord = objects.plain != NULL ? (objects.plain[0] << 8) | objects.plain[1] : 0;
+	}
+	if (objects.encrypted != NULL) {
+		return DecryptObject(session, &objects, data, dataLen);
+	}
 	return APP_SUCCESS;
 }
 
-int ProtectedReadBinaryAPDU(unsigned char cmdHeader[4],
-							unsigned char resLen,
-							unsigned char* responseBuf,
-							unsigned char* sendSequenceCounter,
-							unsigned char encryptSessionKey[16],
-							unsigned char macSessionKey[16]) {
-	// Padding CmdHeader
-	unsigned char padCmdHeader[8];
-	memcpy(padCmdHeader, cmdHeader, 4);
-	PadByteArray(padCmdHeader, 4);
-
-	// Build DO'97'
-	unsigned char dataObject97[3] = {0x97, 0x01, resLen};
-
-	// Concatenate CmdHeader and DO'97'
-	unsigned char concatM[11];
-	memcpy(concatM, padCmdHeader, 8);
-	memcpy(&concatM[8], dataObject97, 3);
+int SecureMessagingUnwrapCommand(SecureMessagingSession* session,
+								 const unsigned char* protectedCmd,
+								 int protectedCmdLen,
+								 unsigned char* cmd,
+								 int* cmdLen) {
+	int blockSize = session->blockSize;
+	SmObjects objects;
+	int dataLen = 0;
 
 	// Increment SSC with 1
-	IncreaseUnsignedCharByOne(sendSequenceCounter, 8);
-
-	// N = SSC || M || Padding
-	unsigned char concatN[24];
-	memcpy(concatN, sendSequenceCounter, 8);
-	memcpy(&concatN[8], concatM, 11);
-	PadByteArray(concatN, 19);
-
-	// Compute MAC of M
-	unsigned char mac[8];  // CC
-	des_mac3_checksum(24, mac, concatN, macSessionKey);
-
-	// Build DO'8E'
-	unsigned char dataObject8E[10] = {0x8E, 0x08};
-	memcpy(&dataObject8E[2], mac, 8);
-
-	// Construct protected APDU
-	unsigned char protectedAPDU[19];
-	memcpy(protectedAPDU, padCmdHeader, 4);	 // Header
-	protectedAPDU[4] = 0x0D;				 // Lc'
-	memcpy(&protectedAPDU[5], dataObject97, 3);
-	memcpy(&protectedAPDU[8], dataObject8E, 10);
-	protectedAPDU[18] = 0x00;
+	IncreaseUnsignedCharByOne(session->sendSequenceCounter, blockSize);
+
+	// Protected APDU: header || Lc' || DO'87' || DO'97' || DO'8E' || '00'
+	if (protectedCmdLen < 5 || protectedCmd[4] > protectedCmdLen - 5 ||
+		ParseObjects(&protectedCmd[5], protectedCmd[4], blockSize, &objects) != APP_SUCCESS ||
+		(objects.plain != NULL && objects.plainLength != 1)) {
+		return APP_ERROR;
+	}
+
+	// N = SSC || padded CmdHeader || DO'87' || DO'97'
+	unsigned char concatN[SM_MAX_MAC_INPUT];
+	memcpy(concatN, session->sendSequenceCounter, blockSize);
+	memcpy(&concatN[blockSize], protectedCmd, 4);
+	int nLen = PadToBlock(concatN, blockSize + 4, blockSize);
+	if (nLen + objects.macInput + blockSize > SM_MAX_MAC_INPUT) {
+		return APP_ERROR;
+	}
+	memcpy(&concatN[nLen], &protectedCmd[5], objects.macInput);
+	nLen += objects.macInput;
+
+	unsigned char macCheck[SM_MAC_LENGTH];
+	SecureMessagingChecksum(session, concatN, nLen, macCheck);
+	if (memcmp(macCheck, &protectedCmd[5 + objects.macOffset], SM_MAC_LENGTH)) {
+		return APP_ERROR;
+	}
+
+	// Rebuild the short APDU: header || Lc || data || Le
+	memcpy(cmd, protectedCmd, 4);
+	cmd[0] &= ~0x0C;
+	if (objects.encrypted != NULL) {
+		if (DecryptObject(session, &objects, &cmd[5], &dataLen) != APP_SUCCESS ||
+			dataLen > SM_MAX_COMMAND_DATA) {
+			return APP_ERROR;
+		}
+		cmd[4] = (unsigned char)dataLen;
+		dataLen++;
+	}
+	*cmdLen = 4 + dataLen;
+	if (objects.plain != NULL) {
+		cmd[(*cmdLen)++] = objects.plain[0];
+	}
+	return APP_SUCCESS;
+}
+
+int ProtectedTransmitAPDU(SecureMessagingSession* session,
+						  const unsigned char* cmd,
+						  int cmdLen,
+						  unsigned char* responseBuf,
+						  int* responseLen) {
+	unsigned char protectedAPDU[SM_MAX_PROTECTED_COMMAND];
+	int protectedAPDULength;
+	session->statusWord = 0;
+	int ret = SecureMessagingWrap(session, cmd, cmdLen, protectedAPDU, &protectedAPDULength);
+	if (ret != APP_SUCCESS) {
+		printf("Fail to Build protected APDU.\n");
+		return ret;
+	}
 
 	// Send protected APDU
-	unsigned char res[285];
-	unsigned long protectedResponseLength = sizeof(res);
-	int ret =
-		TransmitDataToCard(protectedAPDU, sizeof(protectedAPDU), res, &protectedResponseLength);
+	unsigned char protectedResponse[SM_MAX_PROTECTED_RESPONSE];	 // RAPDU
+	unsigned long protectedResponseLength = sizeof(protectedResponse);
+	ret = TransmitDataToCard(protectedAPDU, protectedAPDULength, protectedResponse,
+							 &protectedResponseLength);
 	if (ret != APP_SUCCESS) {
 		printf("Fail to Send protected APDU.\n");
 		return ret;
 	}
 
-	// Count
-	int responseLen = 0;
-	if (res[1] == 0x82) {
-		// File can be read more
-		responseLen = 285 - 5 - 16;
-		des3_cbc_decrypt(responseBuf, &res[5], responseLen, encryptSessionKey, 16, 0);
-	} else if (res[2] == 0x01) {
-		for (int i = 3; i < 280; i++) {
-			if (res[i] == 0x99 && res[i + 1] == 0x02 && res[i + 2] == 0x90) {
-				break;
-			}
-			responseLen++;
+	unsigned int statusWord;
+	ret = SecureMessagingUnwrap(session, protectedResponse, (int)protectedResponseLength,
+								responseBuf, responseLen, &statusWord);
+	if (ret != APP_SUCCESS) {
+		printf("Invalid Response APDU.\n");
+		return ret;
+	}
+	session->statusWord = statusWord;
+	if (statusWord != 0x9000 && statusWord != 0x6282) {
+		printf("Protected APDU failed with status %04X.\n", statusWord);
+		return APP_ERROR;
+	}
+	return APP_SUCCESS;
+}
+
+int ProtectedSelectAPDU(unsigned char cmdData[2], SecureMessagingSession* session) {
+	// Select EF under the current DF, no response data
+	unsigned char selectAPDU[7] = {0x00, 0xA4, 0x02, 0x0C, 0x02};
+	memcpy(&selectAPDU[5], cmdData, 2);
+
+	unsigned char response[SM_MAX_PROTECTED_RESPONSE];
+	int responseLen;
+	return ProtectedTransmitAPDU(session, selectAPDU, sizeof(selectAPDU), response, &responseLen);
+}
+
+int ProtectedReadBinaryAPDU(unsigned char cmdHeader[4],
+							unsigned char resLen,
+							unsigned char* responseBuf,
+							SecureMessagingSession* session) {
+	unsigned char readBinaryAPDU[5];
+	memcpy(readBinaryAPDU, cmdHeader, 4);
+	readBinaryAPDU[4] = resLen;
+
+	int responseLen;
+	int ret = ProtectedTransmitAPDU(session, readBinaryAPDU, sizeof(readBinaryAPDU), responseBuf,
+									&responseLen);
+	if (ret == APP_SUCCESS && session->readHash != NULL) {
+		hash_update(session->readHash, responseBuf, responseLen);
+	}
+	return ret;
+}
+
+// Read the current file, or the file the first READ BINARY selects by a short EF identifier
+static int ReadFileChunks(int shortFileId,
+						  ElementaryFileSink sink,
+						  void* context,
+						  int* fileLength,
+						  SecureMessagingSession* session) {
+	int ret;
+	int chunkSize = session->readChunk;
+	if (chunkSize <= 0 || chunkSize > SM_MAX_READ_CHUNK) {
+		chunkSize = SM_MAX_READ_CHUNK;
+	}
+
+	unsigned char readBinaryAPDU[5] = {0x00, 0xB0, 0x00, 0x00, 0x00};
+	unsigned char response[SM_MAX_PROTECTED_RESPONSE];
+	int responseLen;
+	int read  = 0;
+	int total = chunkSize;	// Until the length of the object is known from the first chunk
+	while (read < total) {
+		// Bit 7 of P1 would turn a higher offset into a short EF identifier
+		if (read > SM_MAX_READ_OFFSET) {
+			printf("Invalid or too large elementary file.\n");
+			return APP_ERROR;
+		}
+		int chunk		  = total - read < chunkSize ? total - read : chunkSize;
+		readBinaryAPDU[2] = (unsigned char)(read >> 8);
+		readBinaryAPDU[3] = (unsigned char)read;
+		readBinaryAPDU[4] = (unsigned char)chunk;  // 0 for 256
+		if (read == 0 && shortFileId != 0) {
+			readBinaryAPDU[2] = (unsigned char)(0x80 | shortFileId);
+		}
+		ret = ProtectedTransmitAPDU(session, readBinaryAPDU, sizeof(readBinaryAPDU), response,
+									&responseLen);
+		if (ret != APP_SUCCESS) {
+			return ret;
 		}
-		// Decrypt
-		des3_cbc_decrypt(responseBuf, &res[3], responseLen, encryptSessionKey, 16, 0);
-	} else if (res[3] = 0x01) {
-		for (int i = 4; i < 280; i++) {
-			if (res[i] == 0x99 && res[i + 1] == 0x02 && res[i + 2] == 0x90) {
-				break;
+		if (responseLen <= 0) {
+			return APP_ERROR;
+		}
+
+		if (read == 0) {
+			unsigned int tag;
+			int length, headerLength;
+			// The last chunk must start at an offset that P1-P2 can carry
+			if (TlvParseHeader(response, responseLen, &tag, &length, &headerLength) !=
+					APP_SUCCESS ||
+				length > SM_MAX_READ_OFFSET + chunkSize - headerLength ||
+				(headerLength + length - 1) / chunkSize * chunkSize > SM_MAX_READ_OFFSET) {
+				printf("Invalid or too large elementary file.\n");
+				return APP_ERROR;
 			}
-			responseLen++;
+			total = headerLength + length;
+		}
+		if (responseLen > total - read) {
+			responseLen = total - read;
+		}
+		if (session->readHash != NULL) {
+			hash_update(session->readHash, response, responseLen);
 		}
-		// Decrypt
-		des3_cbc_decrypt(responseBuf, &res[4], responseLen, encryptSessionKey, 16, 0);
+		ret = sink(response, responseLen, read, total, context);
+		if (ret != APP_SUCCESS) {
+			return ret;
+		}
+		read += responseLen;
 	}
 
-	// Increment SSC with 1
-	IncreaseUnsignedCharByOne(sendSequenceCounter, 8);
+	if (fileLength != NULL) {
+		*fileLength = total;
+	}
+	return APP_SUCCESS;
+}
+
+int ReadElementaryFile(unsigned char fileId[2],
+					   ElementaryFileSink sink,
+					   void* context,
+					   int* fileLength,
+					   SecureMessagingSession* session) {
+	if (fileId != NULL) {
+		int ret = ProtectedSelectAPDU(fileId, session);
+		if (ret != APP_SUCCESS) {
+			return ret;
+		}
+	}
+	return ReadFileChunks(0, sink, context, fileLength, session);
+}
+
+int ReadShortElementaryFile(unsigned char shortFileId,
+							ElementaryFileSink sink,
+							void* context,
+							int* fileLength,
+							SecureMessagingSession* session) {
+	return ReadFileChunks(shortFileId & 0x1F, sink, context, fileLength, session);
+}
+
+// Destination of ProtectedReadFile
+typedef struct {
+	unsigned char* buf;
+	int size;
+} FileBuffer;
 
+static int CopyToBuffer(const unsigned char* data,
+						int length,
+						int offset,
+						int total,
+						void* context) {
+	FileBuffer* buffer = (FileBuffer*)context;
+	if (total > buffer->size) {
+		printf("Invalid or too large elementary file.\n");
+		return APP_ERROR;
+	}
+	memcpy(&buffer->buf[offset], data, length);
 	return APP_SUCCESS;
 }
+
+int ProtectedReadFile(unsigned char fileId[2],
+					  unsigned char* fileBuf,
+					  int fileBufSize,
+					  int* fileLength,
+					  SecureMessagingSession* session) {
+	FileBuffer buffer = {fileBuf, fileBufSize};
+	return ReadElementaryFile(fileId, CopyToBuffer, &buffer, fileLength, session);
+}
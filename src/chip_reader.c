@@ -5,15 +5,446 @@
  *
  * This source file contains the implementation of a function for reading data from an ID card chip
  * using Basic Access Control (BAC) application functions. The ReadIdCardChip function is designed
- * to work with a smart card reader and a corresponding smart card that supports BAC protocol.
+ * to work with a smart card reader and a corresponding smart card that supports BAC protocol. When
+ * the chip advertises PACE in EF.CardAccess, PACE is used instead of BAC. EF.SOD is read first.
+ * When the chip has DG14, Chip Authentication is performed before the data groups are read,
+ * otherwise Active Authentication is performed when the chip has DG15, in both cases only once the
+ * data group matched its hash in EF.SOD. The data groups are checked against the hashes of EF.SOD
+ * as they are read, while the signature of EF.SOD is verified on a worker thread. Readers running
+ * on several threads batch their DES blocks together, see des_batch.h. The cryptography providers
+ * are timed before the first session, see provider.h.
  */
 
+#include <stdio.h>
+#include <string.h>
+
+#include <access/active_authentication.h>
 #include <access/bac_application.h>
+#include <access/bac_queue.h>
+#include <access/bac_search.h>
+#include <access/chip_authentication.h>
+#include <access/lds_dump.h>
+#include <access/pace.h>
+#include <access/passive_authentication.h>
 #include <chip_reader.h>
+#include <cryptography/des_batch.h>
+#include <cryptography/provider.h>
+#include <utils/key_cache.h>
+#include <utils/mrz.h>
 #include <utils/reader.h>
+#include <utils/sync.h>
+#include <utils/trust_store.h>
 #include <utils/util.h>
 
-long ReadIdCardChip(unsigned char mrzInformation[], unsigned char imageFilePath[]) {
+#define BAC_CHALLENGE_RETRIES 2	// GET CHALLENGE failures in a row before the search stops
+
+// Passive Authentication of the data groups being read, sod is NULL if the chip has no EF.SOD
+typedef struct {
+	unsigned char buffer[PA_MAX_SOD];
+	SodInfo info;
+	const SodInfo* sod;
+	SodVerification verification;
+	hash_ctx dgHash;
+} PassiveAuthenticationState;
+
+/**
+ * @brief Tries BAC candidates until the card accepts one.
+ *
+ * Each attempt is GET CHALLENGE then EXTERNAL AUTHENTICATE, only the encryption of RND.IC happens
+ * between the two. The scheduler watches the time and status word of the refusals.
+ *
+ * @param[out] found Receives the index of the accepted candidate.
+ * @param[out] action Receives the last action of the scheduler.
+ */
+static long AttemptBacCandidates(const BacCandidate candidates[],
+								 int count,
+								 const BacSearchModel* model,
+								 SecureMessagingSession* session,
+								 BacSearchStats* stats,
+								 int* found,
+								 int* action) {
+	unsigned char getChallengeResponse[10];
+	unsigned short statusWord;
+	int next = 0, challengeFailures = 0;
+	long res = APP_ERROR;
+
+	*action = BAC_SEARCH_CONTINUE;
+	while (res != APP_SUCCESS && next < count && *action != BAC_SEARCH_PROMPT) {
+		if (GetChallenge(getChallengeResponse, sizeof(getChallengeResponse)) != APP_SUCCESS) {
+			stats->challengeFailures++;
+			if (++challengeFailures > BAC_CHALLENGE_RETRIES) {
+				return APP_ERROR;
+			}
+			continue;
+		}
+		challengeFailures = 0;
+
+		long long start = SyncTicks();
+
+		res = ExternalAuthenticateCandidate(getChallengeResponse, &candidates[next++], session,
+											&statusWord);
+		if (res == APP_SUCCESS) {
+			break;
+		}
+		double milliseconds = (SyncTicks() - start) * 1000.0 / SyncTicksPerSecond();
+		*action				= BacSearchSchedule(model, stats, milliseconds, statusWord);
+		if (*action == BAC_SEARCH_RESELECT && SelectApplication() != APP_SUCCESS) {
+			return APP_ERROR;
+		}
+		if (*action == BAC_SEARCH_PAUSE) {
+			Delay(model->pauseMilliseconds);
+		}
+	}
+	if (res == APP_SUCCESS) {
+		stats->attempts++;
+		*found = next - 1;
+	}
+	return res;
+}
+
+// Establish secure messaging: PACE when EF.CardAccess lists a supported protocol, BAC otherwise.
+// The passwords are tried in order until the chip accepts one.
+static long AccessControl(int passwordType,
+						  unsigned char* passwords[],
+						  int count,
+						  SecureMessagingSession* session) {
+	unsigned char cardAccess[PACE_MAX_CARD_ACCESS];
+	int cardAccessLength;
+	PaceInfo paceInfo;
+	long res;
+
+	if (ReadCardAccess(cardAccess, &cardAccessLength) == APP_SUCCESS &&
+		ParseCardAccess(cardAccess, cardAccessLength, &paceInfo) == APP_SUCCESS) {
+		for (int i = 0; i < count; i++) {
+			res = PaceAuthenticate(&paceInfo, passwordType, passwords[i],
+								   (int)strlen((char*)passwords[i]), session);
+			if (res == APP_SUCCESS) {
+				return ProtectedSelectApplication(session);
+			}
+		}
+		printf("Fail to Perform PACE.\n");
+	}
+
+	// BAC is only keyed by the MRZ
+	if (passwordType != PACE_PASSWORD_MRZ) {
+		printf("PACE is not available on this chip.\n");
+		return APP_ERROR;
+	}
+
+	res = SelectApplication();
+	if (res != APP_SUCCESS) {
+		return res;
+	}
+
+	BacCandidate candidates[MRZ_MAX_CANDIDATES];
+	res = BacCandidatesGenerate(passwords, count, candidates);
+	if (res != APP_SUCCESS) {
+		return res;
+	}
+
+	BacSearchModel model;
+	BacSearchStats stats;
+	int found, action;
+	BacSearchModelDefault(&model);
+	BacSearchStatsInit(&stats);
+	res = AttemptBacCandidates(candidates, count, &model, session, &stats, &found, &action);
+	if (action == BAC_SEARCH_PROMPT) {
+		printf("The chip slows down the attempts, stopping.\n");
+	}
+	return res;
+}
+
+// Chip Authentication when the chip has DG14, it replaces the session keys of BAC or PACE
+static long ChipAuthentication(SecureMessagingSession* session,
+							   const unsigned char* dg14,
+							   int dg14Length,
+							   int* performed) {
+	ChipAuthenticationInfo caInfo;
+
+	*performed = 0;
+	if (dg14 == NULL) {
+		printf("Chip Authentication is not supported by this chip.\n");
+		return APP_SUCCESS;
+	}
+	if (ParseDG14(dg14, dg14Length, &caInfo) != APP_SUCCESS) {
+		printf("No supported Chip Authentication protocol in DG14.\n");
+		return APP_SUCCESS;
+	}
+
+	// A chip that cannot prove knowledge of the DG14 private key may be a clone
+	long res = ChipAuthenticate(&caInfo, session);
+	if (res != APP_SUCCESS) {
+		printf("Fail to Perform Chip Authentication.\n");
+		return res;
+	}
+	*performed = 1;
+	return APP_SUCCESS;
+}
+
+// Passive Authentication when the chip has EF.SOD, the signature is verified on a worker thread
+static long StartPassiveAuthentication(SecureMessagingSession* session,
+									   PassiveAuthenticationState* pa) {
+	int sodLength;
+
+	pa->sod = NULL;
+	if (ReadSOD(session, pa->buffer, &sodLength) != APP_SUCCESS) {
+		// Only a verified answer that the file is missing skips it, anything else may hide a
+		// tampered EF.SOD
+		if (session->statusWord != SM_STATUS_FILE_NOT_FOUND) {
+			return APP_ERROR;
+		}
+		printf("Passive Authentication is not supported by this chip.\n");
+		return APP_SUCCESS;
+	}
+	if (ParseSOD(pa->buffer, sodLength, &pa->info) != APP_SUCCESS) {
+		printf("Invalid or unsupported EF.SOD.\n");
+		return APP_ERROR;
+	}
+	if (!TrustStoreLoaded()) {
+		printf("No CSCA store is loaded, the Document Signer certificate is not checked.\n");
+	}
+	pa->sod = &pa->info;
+	StartSODVerification(&pa->verification, pa->sod);
+	return APP_SUCCESS;
+}
+
+// Starts the hash of a data group listed in EF.SOD, NULL without Passive Authentication
+static long StartDataGroup(PassiveAuthenticationState* pa, int dataGroup, hash_ctx** dgHash) {
+	*dgHash = NULL;
+	if (pa->sod == NULL) {
+		return APP_SUCCESS;
+	}
+	if (StartDataGroupHash(pa->sod, dataGroup, &pa->dgHash) != APP_SUCCESS) {
+		printf("DG%d is not listed in EF.SOD.\n", dataGroup);
+		return APP_ERROR;
+	}
+	*dgHash = &pa->dgHash;
+	return APP_SUCCESS;
+}
+
+// A wrong hash or an invalid signature stops the read before the next data group
+static long CheckDataGroup(PassiveAuthenticationState* pa, int dataGroup) {
+	if (pa->sod == NULL) {
+		return APP_SUCCESS;
+	}
+	if (CheckDataGroupHash(pa->sod, dataGroup, &pa->dgHash) != APP_SUCCESS) {
+		return APP_ERROR;
+	}
+	if (PollSODVerification(&pa->verification) == APP_ERROR) {
+		printf("Invalid EF.SOD signature or Document Signer certificate.\n");
+		return APP_ERROR;
+	}
+	return APP_SUCCESS;
+}
+
+// Reads DG14 or DG15 with its hash checked against EF.SOD, so a clone cannot bring its own key
+// pair. A data group that EF.SOD does not list is not read, present is 0 when it is not used.
+static long ReadKeyDataGroup(SecureMessagingSession* session,
+							 PassiveAuthenticationState* pa,
+							 int dataGroup,
+							 unsigned char* content,
+							 int* length,
+							 int* present) {
+	*present = 0;
+	if (pa->sod != NULL && StartDataGroupHash(pa->sod, dataGroup, &pa->dgHash) != APP_SUCCESS) {
+		return APP_SUCCESS;
+	}
+
+	session->readHash = pa->sod != NULL ? &pa->dgHash : NULL;
+	long res = dataGroup == 14 ? ReadDG14(session, content, length)
+							   : ReadDG15(session, content, length);
+	session->readHash = NULL;
+	if (res != APP_SUCCESS) {
+		// Without EF.SOD the chip may simply not have the file, a listed one must be readable
+		return pa->sod != NULL ? res : APP_SUCCESS;
+	}
+	res = CheckDataGroup(pa, dataGroup);
+	if (res != APP_SUCCESS) {
+		return res;
+	}
+	*present = 1;
+	return APP_SUCCESS;
+}
+
+// Active Authentication when the chip has DG15, the ECDSA hash is named by DG14
+static long ActiveAuthentication(SecureMessagingSession* session,
+								 PassiveAuthenticationState* pa,
+								 const unsigned char* dg14,
+								 int dg14Length) {
+	unsigned char dg15[AA_MAX_DG15];
+	int dg15Length = 0, hasDg15;
+	int signatureHash = AA_HASH_SHA1;
+
+	long res = ReadKeyDataGroup(session, pa, 15, dg15, &dg15Length, &hasDg15);
+	if (res != APP_SUCCESS) {
+		return res;
+	}
+	if (!hasDg15) {
+		printf("Active Authentication is not supported by this chip.\n");
+		return APP_SUCCESS;
+	}
+	if (dg14 != NULL) {
+		ParseActiveAuthenticationInfo(dg14, dg14Length, &signatureHash);
+	}
+
+	// A chip that cannot sign the challenge with the DG15 private key may be a clone
+	res = ActiveAuthenticate(session, dg15, dg15Length, signatureHash);
+	if (res != APP_SUCCESS) {
+		printf("Fail to Perform Active Authentication.\n");
+	}
+	return res;
+}
+
+// Chip Authentication if possible, otherwise Active Authentication, with the keys of EF.SOD
+static long AuthenticateChip(SecureMessagingSession* session, PassiveAuthenticationState* pa) {
+	unsigned char dg14[CA_MAX_DG14];
+	int dg14Length = 0, hasDg14;
+	int performed;
+
+	long res = ReadKeyDataGroup(session, pa, 14, dg14, &dg14Length, &hasDg14);
+	if (res != APP_SUCCESS) {
+		return res;
+	}
+	res = ChipAuthentication(session, hasDg14 ? dg14 : NULL, dg14Length, &performed);
+	if (res != APP_SUCCESS || performed) {
+		return res;
+	}
+	return ActiveAuthentication(session, pa, hasDg14 ? dg14 : NULL, dg14Length);
+}
+
+// The outcome goes to the callback, a read without EF.SOD never reports more than a verified one
+static long FinishPassiveAuthentication(PassiveAuthenticationState* pa,
+										long res,
+										const ReadCallbacks* callbacks) {
+	int result = READ_PA_NOT_PERFORMED;
+	if (pa->sod != NULL) {
+		// The worker must be done before the state goes out of scope, also when the read failed
+		long signature = FinishSODVerification(&pa->verification);
+		if (res == APP_SUCCESS && signature != APP_SUCCESS) {
+			printf("Invalid EF.SOD signature or Document Signer certificate.\n");
+			return APP_ERROR;
+		}
+		result = TrustStoreLoaded() ? READ_PA_VERIFIED : READ_PA_CHAIN_UNCHECKED;
+	}
+	if (res != APP_SUCCESS) {
+		return res;
+	}
+
+	if (result == READ_PA_VERIFIED) {
+		printf("\nPassive Authentication succeeded.\n");
+	} else if (result == READ_PA_CHAIN_UNCHECKED) {
+		printf("\nThe EF.SOD signature is verified, the certificate chain is unchecked.\n");
+	} else {
+		printf("\nPassive Authentication is not performed, the data groups are not verified.\n");
+	}
+	if (callbacks != NULL && callbacks->passiveAuthentication != NULL) {
+		callbacks->passiveAuthentication(result, callbacks->context);
+	}
+	return APP_SUCCESS;
+}
+
+// Data groups decoded by the reader, in the order they are read, the text before the portrait
+static const int readableDataGroups[] = {1, 13, 2};
+
+static long ReadDataGroup(SecureMessagingSession* session,
+						  int dataGroup,
+						  unsigned char imageFilePath[],
+						  hash_ctx* dgHash,
+						  const ReadCallbacks* callbacks,
+						  DataGroupFields* fields) {
+	ImageProgressCallback progress = callbacks != NULL ? callbacks->portraitProgress : NULL;
+	void* context				   = callbacks != NULL ? callbacks->context : NULL;
+
+	switch (dataGroup) {
+	case 1:
+		return ReadDG1(session, dgHash, fields);
+	case 2:
+		return ReadDG2(session, imageFilePath, dgHash, progress, context);
+	default:
+		return ReadDG13(session, dgHash, fields);
+	}
+}
+
+static long ReadVerifiedDataGroups(SecureMessagingSession* session,
+								   unsigned char imageFilePath[],
+								   unsigned int dataGroups,
+								   PassiveAuthenticationState* pa,
+								   const ReadCallbacks* callbacks) {
+	DataGroupFields fields;
+	long res = APP_SUCCESS;
+	for (int i = 0; i < (int)(sizeof(readableDataGroups) / sizeof(readableDataGroups[0])); i++) {
+		int dataGroup = readableDataGroups[i];
+		if (!(dataGroups & DG_MASK(dataGroup))) {
+			continue;
+		}
+		hash_ctx* dgHash;
+		fields.count = 0;
+		res			 = StartDataGroup(pa, dataGroup, &dgHash);
+		if (res == APP_SUCCESS) {
+			res = ReadDataGroup(session, dataGroup, imageFilePath, dgHash, callbacks, &fields);
+		}
+		if (res == APP_SUCCESS) {
+			res = CheckDataGroup(pa, dataGroup);
+		}
+		if (res != APP_SUCCESS) {
+			return res;
+		}
+		// Delivered at once, the later data groups are not waited for
+		if (callbacks != NULL && callbacks->dataGroupRead != NULL) {
+			callbacks->dataGroupRead(dataGroup, fields.count ? fields.fields : NULL, fields.count,
+									 pa->sod != NULL, callbacks->context);
+		}
+	}
+	return res;
+}
+
+// Read the wanted data groups that EF.COM lists
+static long ReadDataGroups(SecureMessagingSession* session,
+						   unsigned char imageFilePath[],
+						   unsigned int dataGroups,
+						   const ReadCallbacks* callbacks) {
+	PassiveAuthenticationState pa;
+	unsigned int present;
+
+	// EF.SOD first, DG14 and DG15 are checked against it before their keys are used
+	long res = StartPassiveAuthentication(session, &pa);
+	if (res != APP_SUCCESS) {
+		return res;
+	}
+
+	// Upgrade the session next, so the data groups are read with the Chip Authentication keys
+	res = AuthenticateChip(session, &pa);
+	if (res != APP_SUCCESS) {
+		goto end;
+	}
+
+	res = ReadEFCOM(session, &present);
+	if (res != APP_SUCCESS) {
+		goto end;
+	}
+	for (int i = 0; i < (int)(sizeof(readableDataGroups) / sizeof(readableDataGroups[0])); i++) {
+		if (dataGroups & ~present & DG_MASK(readableDataGroups[i])) {
+			printf("DG%d is not present on this chip.\n", readableDataGroups[i]);
+		}
+	}
+	dataGroups &= present;
+
+	res = ReadVerifiedDataGroups(session, imageFilePath, dataGroups, &pa, callbacks);
+
+end:
+	return FinishPassiveAuthentication(&pa, res, callbacks);
+}
+
+static long ReadWithPassword(int passwordType,
+							 unsigned char* passwords[],
+							 int count,
+							 unsigned int dataGroups,
+							 unsigned char imageFilePath[],
+							 const ReadCallbacks* callbacks) {
+
+	// The providers are timed before concurrent readers share the calls of the DES kernel
+	crypto_provider_init();
+	des_batch_attach();
 	long res = InitReader();
 	if (res != APP_SUCCESS) {
 		goto end;
@@ -26,58 +457,300 @@ long ReadIdCardChip(unsigned char mrzInformation[], unsigned char imageFilePath[
 	}
 #endif	// #if USE_NFC
 
-	res = SelectApplication();
+	SecureMessagingSession session;
+	res = AccessControl(passwordType, passwords, count, &session);
 	if (res != APP_SUCCESS) {
 		goto end;
 	}
 
-	unsigned char getChallengeResponse[10];
-	res = GetChallenge(getChallengeResponse, sizeof(getChallengeResponse));
+	res = ReadDataGroups(&session, imageFilePath, dataGroups, callbacks);
+
+end:
+	DisconnectFeliCaCard();
+	DisconnectReader();
+	des_batch_detach();
+	return res;
+}
+
+long ReadIdCardChip(unsigned char mrzInformation[], unsigned char imageFilePath[]) {
+	unsigned char* passwords[1] = {mrzInformation};
+	return ReadWithPassword(PACE_PASSWORD_MRZ, passwords, 1, DG_MASK_ALL, imageFilePath, NULL);
+}
+
+long ReadIdCardChipDataGroups(unsigned char mrzInformation[],
+							  unsigned int dataGroups,
+							  unsigned char imageFilePath[]) {
+	unsigned char* passwords[1] = {mrzInformation};
+	return ReadWithPassword(PACE_PASSWORD_MRZ, passwords, 1, dataGroups, imageFilePath, NULL);
+}
+
+long ReadIdCardChipWithCallbacks(unsigned char mrzInformation[],
+								 unsigned int dataGroups,
+								 unsigned char imageFilePath[],
+								 const ReadCallbacks* callbacks) {
+	unsigned char* passwords[1] = {mrzInformation};
+	return ReadWithPassword(PACE_PASSWORD_MRZ, passwords, 1, dataGroups, imageFilePath, callbacks);
+}
+
+long ReadIdCardChipDump(unsigned char mrzInformation[], const char* dumpFilePath) {
+	unsigned char* passwords[1] = {mrzInformation};
+
+	crypto_provider_init();
+	des_batch_attach();
+	long res = InitReader();
 	if (res != APP_SUCCESS) {
 		goto end;
 	}
 
-	unsigned char mrzKeySeed[16];
-	KeySeedCalculate(mrzInformation, mrzKeySeed);
-
-	unsigned char encryptKey[16], macKey[16];
-	SessionKeyGenerate(mrzKeySeed, encryptKey, macKey);
+#if USE_NFC
+	res = DetectCard();
+	if (res != APP_SUCCESS) {
+		goto end;
+	}
+#endif	// #if USE_NFC
 
-	unsigned char sessionKeyEncrypt[16], sessionKeyMac[16], sendSequenceCounter[8];
-	res = ExternalAuthenticate(getChallengeResponse, encryptKey, macKey, sessionKeyEncrypt,
-							   sessionKeyMac, sendSequenceCounter);
+	// One session for every file of the dump
+	SecureMessagingSession session;
+	res = AccessControl(PACE_PASSWORD_MRZ, passwords, 1, &session);
 	if (res != APP_SUCCESS) {
 		goto end;
 	}
 
-	res = ReadEFCOM(sessionKeyEncrypt, sessionKeyMac, sendSequenceCounter);
+	unsigned int dataGroups;
+	res = LdsDumpRead(&session, dumpFilePath, &dataGroups);
+	if (res == APP_SUCCESS) {
+		printf("\nThe LDS is dumped to %s.\n", dumpFilePath);
+	}
+
+end:
+	DisconnectFeliCaCard();
+	DisconnectReader();
+	des_batch_detach();
+	return res;
+}
+
+long ReadIdCardChipWithCan(unsigned char cardAccessNumber[], unsigned char imageFilePath[]) {
+	unsigned char* passwords[1] = {cardAccessNumber};
+	return ReadWithPassword(PACE_PASSWORD_CAN, passwords, 1, DG_MASK_ALL, imageFilePath, NULL);
+}
+
+long ReadIdCardChipWithMrzText(const unsigned char* text,
+							   int length,
+							   const unsigned char* confidence,
+							   unsigned char imageFilePath[]) {
+	MrzTd1 mrz;
+	MrzCandidate candidates[MRZ_MAX_CANDIDATES];
+	unsigned char* passwords[MRZ_MAX_CANDIDATES];
+
+	if (MrzTd1Parse(text, length, confidence, &mrz) != APP_SUCCESS) {
+		printf("Invalid TD1 MRZ text.\n");
+		return APP_ERROR;
+	}
+	// Keys that disagree with their check digits never reach the card
+	int count = MrzCandidatesGenerate(&mrz, candidates, MRZ_MAX_CANDIDATES);
+	if (count == 0) {
+		printf("No MRZ key agrees with its check digits.\n");
+		return APP_ERROR;
+	}
+	for (int i = 0; i < count; i++) {
+		passwords[i] = candidates[i].mrzInformation;
+	}
+	return ReadWithPassword(PACE_PASSWORD_MRZ, passwords, count, DG_MASK_ALL, imageFilePath, NULL);
+}
+
+// Authenticate with the key learned at a previous read of the document number
+static long CachedBacKey(unsigned char documentNumber[9],
+						 SecureMessagingSession* session,
+						 BacSearchStats* stats) {
+	KeyCacheEntry entry;
+	unsigned char getChallengeResponse[10];
+
+	if (KeyCacheLookup(documentNumber, &entry) != APP_SUCCESS) {
+		return APP_ERROR;
+	}
+	long res = GetChallenge(getChallengeResponse, sizeof(getChallengeResponse));
+	if (res == APP_SUCCESS) {
+		res = ExternalAuthenticate(getChallengeResponse, entry.encryptKey, entry.macKey, session);
+		if (res != APP_SUCCESS) {
+			printf("The learned key of the document number is refused, searching again.\n");
+			KeyCacheRemove(documentNumber);
+		}
+	}
+	stats->cached = res == APP_SUCCESS;
+	memset(&entry, 0, sizeof(entry));
+	return res;
+}
+
+// Keep the key that opened the card, the next read of the card needs a single attempt
+static void LearnBacKey(unsigned char documentNumber[9],
+						const unsigned char mrzInformation[],
+						const BacCandidate* candidate) {
+	KeyCacheEntry entry;
+	memcpy(entry.birthDate, &mrzInformation[10], 6);
+	memcpy(entry.expiryDate, &mrzInformation[17], 6);
+	memcpy(entry.encryptKey, candidate->encryptKey, 16);
+	memcpy(entry.macKey, candidate->macKey, 16);
+	KeyCacheStore(documentNumber, &entry);
+}
+
+// Authenticate with the MRZ information entered by the operator
+static long PromptBacKey(unsigned char documentNumber[9],
+						 const BacSearchModel* model,
+						 SecureMessagingSession* session,
+						 BacSearchStats* stats) {
+	unsigned char mrzInformation[25];
+	unsigned char* candidates[1] = {mrzInformation};
+	unsigned char getChallengeResponse[10];
+	BacCandidate candidate;
+
+	if (model->prompt == NULL) {
+		printf("The chip slows down the search, the MRZ is needed.\n");
+		return APP_ERROR;
+	}
+	stats->prompted = 1;
+	long res = model->prompt(documentNumber, mrzInformation, model->promptContext);
+	if (res != APP_SUCCESS) {
+		return res;
+	}
+	res = BacCandidatesGenerate(candidates, 1, &candidate);
+	if (res == APP_SUCCESS) {
+		res = GetChallenge(getChallengeResponse, sizeof(getChallengeResponse));
+	}
+	if (res == APP_SUCCESS) {
+		res = ExternalAuthenticateCandidate(getChallengeResponse, &candidate, session, NULL);
+	}
+	if (res == APP_SUCCESS) {
+		LearnBacKey(documentNumber, mrzInformation, &candidate);
+	}
+	return res;
+}
+
+// Try the candidates of the document number until the card accepts one
+static long SearchBacKey(unsigned char documentNumber[9],
+						 const BacSearchModel* model,
+						 SecureMessagingSession* session,
+						 BacSearchStats* stats) {
+	// The keys and nonces of all candidates are ready before the first attempt
+	BacSearchCandidate search[BAC_SEARCH_MAX_CANDIDATES];
+	unsigned char* candidates[BAC_SEARCH_MAX_CANDIDATES];
+	BacCandidate bacCandidates[BAC_SEARCH_MAX_CANDIDATES];
+	int count = BacSearchCandidatesGenerate(documentNumber, model, search);
+	for (int i = 0; i < count; i++) {
+		candidates[i] = search[i].mrzInformation;
+	}
+	long res = BacCandidatesGenerate(candidates, count, bacCandidates);
+	if (res != APP_SUCCESS) {
+		return res;
+	}
+
+	int found, action;
+	res = AttemptBacCandidates(bacCandidates, count, model, session, stats, &found, &action);
+	if (res == APP_SUCCESS) {
+		stats->found = found;
+		LearnBacKey(documentNumber, search[found].mrzInformation, &bacCandidates[found]);
+		return APP_SUCCESS;
+	}
+	if (action == BAC_SEARCH_PROMPT) {
+		return PromptBacKey(documentNumber, model, session, stats);
+	}
+	printf("No birth date matches the document number.\n");
+	return res;
+}
+
+long ReadIdCardChipWithSearchModel(unsigned char documentNumber[9],
+								   const BacSearchModel* model,
+								   unsigned char imageFilePath[],
+								   BacSearchStats* stats) {
+	BacSearchModel defaultModel;
+	BacSearchStats searchStats;
+	if (model == NULL) {
+		BacSearchModelDefault(&defaultModel);
+		model = &defaultModel;
+	}
+	if (stats == NULL) {
+		stats = &searchStats;
+	}
+	BacSearchStatsInit(stats);
+
+	crypto_provider_init();
+	des_batch_attach();
+	long res = InitReader();
 	if (res != APP_SUCCESS) {
 		goto end;
 	}
 
-	res = ReadDG1(sessionKeyEncrypt, sessionKeyMac, sendSequenceCounter);
+#if USE_NFC
+	res = DetectCard();
 	if (res != APP_SUCCESS) {
 		goto end;
 	}
+#endif	// #if USE_NFC
 
-	res = ReadDG2(sessionKeyEncrypt, sessionKeyMac, sendSequenceCounter, imageFilePath);
+	res = SelectApplication();
 	if (res != APP_SUCCESS) {
 		goto end;
 	}
 
-	res = ReadDG13(sessionKeyEncrypt, sessionKeyMac, sendSequenceCounter);
+	SecureMessagingSession session;
+	res = CachedBacKey(documentNumber, &session, stats);
+	if (res != APP_SUCCESS) {
+		res = SearchBacKey(documentNumber, model, &session, stats);
+	}
 	if (res != APP_SUCCESS) {
 		goto end;
 	}
 
+	res = ReadDataGroups(&session, imageFilePath, DG_MASK_ALL, NULL);
+
 end:
 	DisconnectFeliCaCard();
 	DisconnectReader();
+	des_batch_detach();
 	return res;
 }
 
-long ReadIdCardChipWithDocumentNumber(unsigned char documentNumber[9],
-									  unsigned char imageFilePath[]) {
+// Try the pending keys of the queue and claim the one the card accepts
+static long MatchQueuedKey(BacQueue* queue,
+						   SecureMessagingSession* session,
+						   BacQueueEntry* matched) {
+	BacQueueCandidate snapshot[BAC_QUEUE_MAX_ENTRIES];
+	BacCandidate candidates[BAC_QUEUE_MAX_ENTRIES];
+	BacSearchModel model;
+	BacSearchStats stats;
+	int found, action;
+
+	int count = BacQueueSnapshot(queue, snapshot);
+	if (count <= 0) {
+		printf("No MRZ is pending in the queue.\n");
+		return APP_ERROR;
+	}
+	for (int i = 0; i < count; i++) {
+		candidates[i] = snapshot[i].candidate;
+	}
+	BacSearchModelDefault(&model);
+	BacSearchStatsInit(&stats);
+	long res = AttemptBacCandidates(candidates, count, &model, session, &stats, &found, &action);
+	if (res != APP_SUCCESS) {
+		printf("No pending MRZ matches the card.\n");
+		return res;
+	}
+
+	// The card is open whoever claims the entry, but only one reader removes it
+	if (BacQueueClaim(queue, snapshot[found].id, matched) != APP_SUCCESS) {
+		printf("The matching MRZ was already removed from the queue.\n");
+		if (matched != NULL) {
+			memset(matched, 0, sizeof(BacQueueEntry));
+			matched->id = snapshot[found].id;
+		}
+	}
+	return APP_SUCCESS;
+}
+
+long ReadIdCardChipFromQueue(BacQueue* queue,
+							 unsigned char imageFilePath[],
+							 BacQueueEntry* matched) {
+	crypto_provider_init();
+	des_batch_attach();
 	long res = InitReader();
 	if (res != APP_SUCCESS) {
 		goto end;
@@ -95,51 +768,22 @@ long ReadIdCardChipWithDocumentNumber(unsigned char documentNumber[9],
 		goto end;
 	}
 
-	for (int month = 1; month <= 12; month++) {
-		for (int day = 1; day <= 31; day++) {
-			if (!IsValidDate(day, month)) {
-				continue;
-			}
-			unsigned char getChallengeResponse[10];
-			GetChallenge(getChallengeResponse, sizeof(getChallengeResponse));
-			unsigned char mrzInformation[24];
-			unsigned char birthDate[4] = {IntToChar(month / 10), IntToChar(month % 10),
-										  IntToChar(day / 10), IntToChar(day % 10)};
-			MrzInformationGenerate(documentNumber, birthDate, mrzInformation, 2023);
-
-			unsigned char mrzKeySeed[16];
-			KeySeedCalculate(mrzInformation, mrzKeySeed);
-
-			unsigned char encryptKey[16], macKey[16];
-			SessionKeyGenerate(mrzKeySeed, encryptKey, macKey);
-
-			unsigned char sessionKeyEncrypt[16], sessionKeyMac[16], sendSenquenceCounter[8];
-			int res = ExternalAuthenticate(getChallengeResponse, encryptKey, macKey,
-										   sessionKeyEncrypt, sessionKeyMac, sendSenquenceCounter);
-			if (res == 0) {
-				res = ReadEFCOM(sessionKeyEncrypt, sessionKeyMac, sendSenquenceCounter);
-				if (res != APP_SUCCESS) {
-					goto end;
-				}
-				res = ReadDG1(sessionKeyEncrypt, sessionKeyMac, sendSenquenceCounter);
-				if (res != APP_SUCCESS) {
-					goto end;
-				}
-				res =
-					ReadDG2(sessionKeyEncrypt, sessionKeyMac, sendSenquenceCounter, imageFilePath);
-				if (res != APP_SUCCESS) {
-					goto end;
-				}
-				res = ReadDG13(sessionKeyEncrypt, sessionKeyMac, sendSenquenceCounter);
-				if (res != APP_SUCCESS) {
-					goto end;
-				}
-				break;
-			}
-		}
+	SecureMessagingSession session;
+	res = MatchQueuedKey(queue, &session, matched);
+	if (res != APP_SUCCESS) {
+		goto end;
 	}
+
+	res = ReadDataGroups(&session, imageFilePath, DG_MASK_ALL, NULL);
+
 end:
 	DisconnectFeliCaCard();
 	DisconnectReader();
+	des_batch_detach();
 	return res;
-}
\ No newline at end of file
+}
+
+long ReadIdCardChipWithDocumentNumber(unsigned char documentNumber[9],
+									  unsigned char imageFilePath[]) {
+	return ReadIdCardChipWithSearchModel(documentNumber, NULL, imageFilePath, NULL);
+}
@@ -0,0 +1,268 @@
+/**
+ * @author Khoa Nguyen
+ * @file bignum.c
+ * @brief Source file for multi-precision integer and Montgomery arithmetic.
+ *
+ * This source file implements fixed-size multi-precision arithmetic on 32-bit limbs and Montgomery
+ * multiplication (CIOS method) used by the elliptic curve and RSA/DH code.
+ */
+
+#include <string.h>
+
+#include <cryptography/bignum.h>
+
+int bn_read_binary(unsigned int* x, int n, const unsigned char* buf, int len) {
+	memset(x, 0, n * sizeof(unsigned int));
+	for (int i = 0; i < len; i++) {
+		int byte = len - 1 - i;	 // Position counted from the least significant byte
+		if (byte / 4 >= n) {
+			if (buf[i] != 0) {
+				return BN_BAD_INPUT;
+			}
+			continue;
+		}
+		x[byte / 4] |= (unsigned int)buf[i] << ((byte % 4) * 8);
+	}
+	return 0;
+}
+
+void bn_write_binary(const unsigned int* x, int n, unsigned char* buf, int len) {
+	for (int i = 0; i < len; i++) {
+		int byte = len - 1 - i;
+		buf[i]	 = byte / 4 < n ? (unsigned char)(x[byte / 4] >> ((byte % 4) * 8)) : 0;
+	}
+}
+
+int bn_cmp(const unsigned int* a, const unsigned int* b, int n) {
+	for (int i = n - 1; i >= 0; i--) {
+		if (a[i] > b[i]) {
+			return 1;
+		}
+		if (a[i] < b[i]) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+unsigned int bn_add(unsigned int* r, const unsigned int* a, const unsigned int* b, int n) {
+	unsigned long long carry = 0;
+	for (int i = 0; i < n; i++) {
+		carry += (unsigned long long)a[i] + b[i];
+		r[i] = (unsigned int)carry;
+		carry >>= 32;
+	}
+	return (unsigned int)carry;
+}
+
+unsigned int bn_sub(unsigned int* r, const unsigned int* a, const unsigned int* b, int n) {
+	unsigned long long borrow = 0;
+	for (int i = 0; i < n; i++) {
+		unsigned long long t = (unsigned long long)a[i] - b[i] - borrow;
+		r[i]				 = (unsigned int)t;
+		borrow				 = (t >> 32) & 1;
+	}
+	return (unsigned int)borrow;
+}
+
+int bn_is_zero(const unsigned int* a, int n) {
+	unsigned int acc = 0;
+	for (int i = 0; i < n; i++) {
+		acc |= a[i];
+	}
+	return acc == 0;
+}
+
+int bn_bitlen(const unsigned int* a, int n) {
+	for (int i = n - 1; i >= 0; i--) {
+		if (a[i] != 0) {
+			int bits = 32;
+			while (!(a[i] >> (bits - 1))) {
+				bits--;
+			}
+			return i * 32 + bits;
+		}
+	}
+	return 0;
+}
+
+void bn_select(unsigned int* r,
+			   const unsigned int* a,
+			   const unsigned int* b,
+			   int n,
+			   unsigned int cond) {
+	unsigned int mask = 0u - cond;
+	for (int i = 0; i < n; i++) {
+		r[i] = (a[i] & mask) | (b[i] & ~mask);
+	}
+}
+
+// r = 2 * r mod m for r < m
+static void ModularDouble(unsigned int* r, const unsigned int* m, int n) {
+	unsigned int tmp[BN_MAX_LIMBS];
+	unsigned int carry	= bn_add(r, r, r, n);
+	unsigned int borrow = bn_sub(tmp, r, m, n);
+	bn_select(r, tmp, r, n, carry | (borrow ^ 1));
+}
+
+void bn_mod(unsigned int* r, const unsigned int* a, int an, const unsigned int* m, int n) {
+	unsigned int acc[BN_MAX_LIMBS], tmp[BN_MAX_LIMBS];
+	memset(acc, 0, n * sizeof(unsigned int));
+
+	// Binary long division: acc = 2 acc + bit, then subtract m once if acc >= m
+	for (int i = an * 32 - 1; i >= 0; i--) {
+		unsigned int carry = (a[i / 32] >> (i % 32)) & 1;
+		for (int j = 0; j < n; j++) {
+			unsigned int top = acc[j] >> 31;
+			acc[j]			 = (acc[j] << 1) | carry;
+			carry			 = top;
+		}
+		unsigned int borrow = bn_sub(tmp, acc, m, n);
+		bn_select(acc, tmp, acc, n, carry | (borrow ^ 1));
+	}
+	memcpy(r, acc, n * sizeof(unsigned int));
+}
+
+int mont_init(mont_context* ctx, const unsigned int* m, int n) {
+	if (n < 1 || n > BN_MAX_LIMBS || !(m[0] & 1)) {
+		return BN_BAD_INPUT;
+	}
+
+	memset(ctx, 0, sizeof(mont_context));
+	ctx->n = n;
+	memcpy(ctx->m, m, n * sizeof(unsigned int));
+
+	// Newton iteration for m^-1 mod 2^32
+	unsigned int inv = 1;
+	for (int i = 0; i < 5; i++) {
+		inv *= 2 - m[0] * inv;
+	}
+	ctx->mInv = 0u - inv;
+
+	// R mod m and R^2 mod m by repeated doubling of 1
+	unsigned int x[BN_MAX_LIMBS] = {1};
+	if (n == 1 && m[0] == 1) {
+		x[0] = 0;
+	}
+	for (int i = 0; i < 32 * n; i++) {
+		ModularDouble(x, m, n);
+	}
+	memcpy(ctx->one, x, n * sizeof(unsigned int));
+	for (int i = 0; i < 32 * n; i++) {
+		ModularDouble(x, m, n);
+	}
+	memcpy(ctx->rr, x, n * sizeof(unsigned int));
+	return 0;
+}
+
+void mont_mul(const mont_context* ctx,
+			  unsigned int* r,
+			  const unsigned int* a,
+			  const unsigned int* b) {
+	int n				  = ctx->n;
+	const unsigned int* m = ctx->m;
+	unsigned int t[BN_MAX_LIMBS + 2];
+	unsigned int tmp[BN_MAX_LIMBS];
+	unsigned long long c;
+
+	memset(t, 0, (n + 2) * sizeof(unsigned int));
+	for (int i = 0; i < n; i++) {
+		// t += a * b[i]
+		c = 0;
+		for (int j = 0; j < n; j++) {
+			c += (unsigned long long)a[j] * b[i] + t[j];
+			t[j] = (unsigned int)c;
+			c >>= 32;
+		}
+		c += t[n];
+		t[n]	 = (unsigned int)c;
+		t[n + 1] = (unsigned int)(c >> 32);
+
+		// t = (t + u * m) / 2^32
+		unsigned int u = t[0] * ctx->mInv;
+		c			   = ((unsigned long long)u * m[0] + t[0]) >> 32;
+		for (int j = 1; j < n; j++) {
+			c += (unsigned long long)u * m[j] + t[j];
+			t[j - 1] = (unsigned int)c;
+			c >>= 32;
+		}
+		c += t[n];
+		t[n - 1] = (unsigned int)c;
+		t[n]	 = t[n + 1] + (unsigned int)(c >> 32);
+	}
+
+	// Final conditional subtraction
+	unsigned int borrow = bn_sub(tmp, t, m, n);
+	bn_select(r, tmp, t, n, (t[n] != 0) | (borrow ^ 1));
+}
+
+void mont_add(const mont_context* ctx,
+			  unsigned int* r,
+			  const unsigned int* a,
+			  const unsigned int* b) {
+	unsigned int tmp[BN_MAX_LIMBS];
+	unsigned int carry	= bn_add(r, a, b, ctx->n);
+	unsigned int borrow = bn_sub(tmp, r, ctx->m, ctx->n);
+	bn_select(r, tmp, r, ctx->n, carry | (borrow ^ 1));
+}
+
+void mont_sub(const mont_context* ctx,
+			  unsigned int* r,
+			  const unsigned int* a,
+			  const unsigned int* b) {
+	unsigned int tmp[BN_MAX_LIMBS];
+	unsigned int borrow = bn_sub(r, a, b, ctx->n);
+	bn_add(tmp, r, ctx->m, ctx->n);
+	bn_select(r, tmp, r, ctx->n, borrow);
+}
+
+void mont_to(const mont_context* ctx, unsigned int* r, const unsigned int* a) {
+	mont_mul(ctx, r, a, ctx->rr);
+}
+
+void mont_from(const mont_context* ctx, unsigned int* r, const unsigned int* a) {
+	unsigned int one[BN_MAX_LIMBS] = {1};
+	mont_mul(ctx, r, a, one);
+}
+
+void mont_exp(const mont_context* ctx,
+			  unsigned int* r,
+			  const unsigned int* a,
+			  const unsigned int* e,
+			  int en) {
+	int n = ctx->n;
+	unsigned int table[16][BN_MAX_LIMBS];
+	unsigned int acc[BN_MAX_LIMBS], t[BN_MAX_LIMBS];
+
+	memset(t, 0, n * sizeof(unsigned int));
+
+	// table[i] = a^i for the 4-bit fixed window
+	memcpy(table[0], ctx->one, n * sizeof(unsigned int));
+	memcpy(table[1], a, n * sizeof(unsigned int));
+	for (int i = 2; i < 16; i++) {
+		mont_mul(ctx, table[i], table[i - 1], a);
+	}
+
+	memcpy(acc, ctx->one, n * sizeof(unsigned int));
+	for (int i = en * 8 - 1; i >= 0; i--) {
+		mont_mul(ctx, acc, acc, acc);
+		mont_mul(ctx, acc, acc, acc);
+		mont_mul(ctx, acc, acc, acc);
+		mont_mul(ctx, acc, acc, acc);
+
+		// Scan the whole table so the memory access pattern does not depend on the exponent
+		unsigned int window = (e[i / 8] >> ((i % 8) * 4)) & 0x0F;
+		for (unsigned int j = 0; j < 16; j++) {
+			bn_select(t, table[j], t, n, j == window);
+		}
+		mont_mul(ctx, acc, acc, t);
+	}
+	memcpy(r, acc, n * sizeof(unsigned int));
+}
+
+void mont_inv(const mont_context* ctx, unsigned int* r, const unsigned int* a) {
+	// a^(m - 2) by Fermat's little theorem
+	unsigned int e[BN_MAX_LIMBS] = {2};
+	bn_sub(e, ctx->m, e, ctx->n);
+	mont_exp(ctx, r, a, e, ctx->n);
+}
@@ -0,0 +1,104 @@
+/**
+ * @author Khoa Nguyen
+ * @file chacha20.c
+ * @brief Source file for the ChaCha20 keystream.
+ */
+
+#include <string.h>
+
+#include <cryptography/chacha20.h>
+
+#define rotl(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+#define GET_UINT32_LE(b)                                  \
+	((unsigned int)(b)[0] | ((unsigned int)(b)[1] << 8) | \
+	 ((unsigned int)(b)[2] << 16) | ((unsigned int)(b)[3] << 24))
+
+#define PUT_UINT32_LE(n, b)                  \
+	{                                        \
+		(b)[0] = (unsigned char)(n);         \
+		(b)[1] = (unsigned char)((n) >> 8);  \
+		(b)[2] = (unsigned char)((n) >> 16); \
+		(b)[3] = (unsigned char)((n) >> 24); \
+	}
+
+#define CHACHA20_QUARTER(a, b, c, d) \
+	{                                \
+		a += b;                      \
+		d = rotl(d ^ a, 16);         \
+		c += d;                      \
+		b = rotl(b ^ c, 12);         \
+		a += b;                      \
+		d = rotl(d ^ a, 8);          \
+		c += d;                      \
+		b = rotl(b ^ c, 7);          \
+	}
+
+static void chacha20_block(const unsigned int input[16], unsigned char output[64]) {
+	unsigned int x[16];
+	int i;
+
+	memcpy(x, input, sizeof(x));
+	for (i = 0; i < 10; i++) {
+		// Column rounds, then diagonal rounds
+		CHACHA20_QUARTER(x[0], x[4], x[8], x[12]);
+		CHACHA20_QUARTER(x[1], x[5], x[9], x[13]);
+		CHACHA20_QUARTER(x[2], x[6], x[10], x[14]);
+		CHACHA20_QUARTER(x[3], x[7], x[11], x[15]);
+		CHACHA20_QUARTER(x[0], x[5], x[10], x[15]);
+		CHACHA20_QUARTER(x[1], x[6], x[11], x[12]);
+		CHACHA20_QUARTER(x[2], x[7], x[8], x[13]);
+		CHACHA20_QUARTER(x[3], x[4], x[9], x[14]);
+	}
+	for (i = 0; i < 16; i++) {
+		x[i] += input[i];
+		PUT_UINT32_LE(x[i], &output[i * 4]);
+	}
+	memset(x, 0, sizeof(x));
+}
+
+void chacha20_keystream(const unsigned char key[CHACHA20_KEY_LENGTH],
+						const unsigned char nonce[CHACHA20_NONCE_LENGTH],
+						unsigned int counter,
+						unsigned char* output,
+						int blocks) {
+	unsigned int state[16];
+	int i;
+
+	// "expand 32-byte k"
+	state[0] = 0x61707865;
+	state[1] = 0x3320646E;
+	state[2] = 0x79622D32;
+	state[3] = 0x6B206574;
+	for (i = 0; i < 8; i++)
+		state[4 + i] = GET_UINT32_LE(&key[i * 4]);
+	state[12] = counter;
+	for (i = 0; i < 3; i++)
+		state[13 + i] = GET_UINT32_LE(&nonce[i * 4]);
+
+	for (i = 0; i < blocks; i++) {
+		chacha20_block(state, &output[i * CHACHA20_BLOCK_LENGTH]);
+		state[12]++;
+	}
+	memset(state, 0, sizeof(state));
+}
+
+int chacha20_self_test(void) {
+	static const unsigned char nonce[CHACHA20_NONCE_LENGTH] = {0x00, 0x00, 0x00, 0x09, 0x00, 0x00,
+															   0x00, 0x4A, 0x00, 0x00, 0x00, 0x00};
+	static const unsigned char expected[CHACHA20_BLOCK_LENGTH] = {
+		0x10, 0xF1, 0xE7, 0xE4, 0xD1, 0x3B, 0x59, 0x15, 0x50, 0x0F, 0xDD, 0x1F, 0xA3,
+		0x20, 0x71, 0xC4, 0xC7, 0xD1, 0xF4, 0xC7, 0x33, 0xC0, 0x68, 0x03, 0x04, 0x22,
+		0xAA, 0x9A, 0xC3, 0xD4, 0x6C, 0x4E, 0xD2, 0x82, 0x64, 0x46, 0x07, 0x9F, 0xAA,
+		0x09, 0x14, 0xC2, 0xD7, 0x05, 0xD9, 0x8B, 0x02, 0xA2, 0xB5, 0x12, 0x9C, 0xD1,
+		0xDE, 0x16, 0x4E, 0xB9, 0xCB, 0xD0, 0x83, 0xE8, 0xA2, 0x50, 0x3C, 0x4E};
+	unsigned char key[CHACHA20_KEY_LENGTH], output[CHACHA20_BLOCK_LENGTH];
+	int i;
+
+	// Key 00 01 .. 1F, block counter 1
+	for (i = 0; i < CHACHA20_KEY_LENGTH; i++)
+		key[i] = (unsigned char)i;
+	chacha20_keystream(key, nonce, 1, output, 1);
+
+	return memcmp(output, expected, sizeof(expected)) == 0 ? 0 : CHACHA20_SELF_TEST_FAILED;
+}
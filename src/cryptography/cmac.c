@@ -0,0 +1,69 @@
+/**
+ * @author Khoa Nguyen
+ * @file cmac.c
+ * @brief Source file for AES-CMAC message authentication code.
+ *
+ * This source file implements the function for calculating the checksum using CMAC with AES
+ * encryption.
+ */
+
+#include <string.h>
+
+#include <cryptography/aes.h>
+#include <cryptography/cmac.h>
+
+// Multiply a block by x in GF(2^128) to derive the CMAC subkeys
+static void LeftShiftBlock(const unsigned char input[16], unsigned char output[16]) {
+	unsigned char overflow = input[0] & 0x80;
+	for (int i = 0; i < 15; i++) {
+		output[i] = (unsigned char)((input[i] << 1) | (input[i + 1] >> 7));
+	}
+	output[15] = (unsigned char)(input[15] << 1);
+	if (overflow) {
+		output[15] ^= 0x87;
+	}
+}
+
+void aes_cmac_checksum(int length,
+					   unsigned char buff[16],
+					   const unsigned char* data,
+					   const unsigned char* key,
+					   int keyLength) {
+	aes_context ctx;
+	aes_setkey_enc(&ctx, key, keyLength * 8);
+
+	// Subkeys K1 and K2
+	unsigned char zero[16] = {0}, l[16], k1[16], k2[16];
+	aes_crypt_ecb(&ctx, AES_ENCRYPT, zero, l);
+	LeftShiftBlock(l, k1);
+	LeftShiftBlock(k1, k2);
+
+	// Iteration over all complete blocks except the last one
+	unsigned char block[16] = {0};
+	int blocks = length == 0 ? 1 : (length + 15) / 16;
+	for (int i = 0; i < blocks - 1; i++) {
+		for (int j = 0; j < 16; j++) {
+			block[j] ^= data[16 * i + j];
+		}
+		aes_crypt_ecb(&ctx, AES_ENCRYPT, block, block);
+	}
+
+	// Last block is XORed with K1 when complete, otherwise padded and XORed with K2
+	int last = length - 16 * (blocks - 1);
+	unsigned char lastBlock[16];
+	memset(lastBlock, 0, 16);
+	memcpy(lastBlock, &data[16 * (blocks - 1)], last);
+	if (last == 16) {
+		for (int j = 0; j < 16; j++) {
+			block[j] ^= lastBlock[j] ^ k1[j];
+		}
+	} else {
+		lastBlock[last] = 0x80;
+		for (int j = 0; j < 16; j++) {
+			block[j] ^= lastBlock[j] ^ k2[j];
+		}
+	}
+	aes_crypt_ecb(&ctx, AES_ENCRYPT, block, buff);
+
+	aes_free(&ctx);
+}
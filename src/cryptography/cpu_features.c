@@ -0,0 +1,91 @@
+/**
+ * @author Khoa Nguyen
+ * @file cpu_features.c
+ * @brief Source file for runtime CPU feature detection.
+ */
+
+#include <cryptography/cpu_features.h>
+
+#if CPU_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// Computed once, the detection is idempotent so concurrent first calls agree
+static volatile int featuresReady;
+static volatile unsigned int features;
+
+#if CPU_X86
+static void cpuid(unsigned int leaf, unsigned int subleaf, unsigned int regs[4]) {
+#if defined(_MSC_VER)
+	__cpuidex((int*)regs, (int)leaf, (int)subleaf);
+#else
+	__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// XCR0, the register states enabled by the operating system
+static unsigned long long xgetbv0(void) {
+#if defined(_MSC_VER)
+	return _xgetbv(0);
+#else
+	unsigned int eax, edx;
+	__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return ((unsigned long long)edx << 32) | eax;
+#endif
+}
+
+static unsigned int detect(void) {
+	unsigned int regs[4], result = 0;
+
+	cpuid(0, 0, regs);
+	unsigned int maxLeaf = regs[0];
+	if (maxLeaf < 1) {
+		return 0;
+	}
+
+	cpuid(1, 0, regs);
+	if (regs[2] & (1u << 9)) {
+		result |= CPU_FEATURE_SSSE3;
+	}
+	if (regs[2] & (1u << 19)) {
+		result |= CPU_FEATURE_SSE41;
+	}
+	int osxsave = (regs[2] & (1u << 27)) != 0;
+	int avx		= (regs[2] & (1u << 28)) != 0;
+	if (maxLeaf < 7) {
+		return result;
+	}
+
+	cpuid(7, 0, regs);
+	if (regs[1] & (1u << 29)) {
+		result |= CPU_FEATURE_SHA;
+	}
+	if (osxsave && avx) {
+		unsigned long long xcr0 = xgetbv0();
+		// XMM and YMM state for AVX2, plus opmask and ZMM state for AVX-512
+		if ((xcr0 & 0x06) == 0x06 && (regs[1] & (1u << 5))) {
+			result |= CPU_FEATURE_AVX2;
+		}
+		if ((xcr0 & 0xE6) == 0xE6 && (regs[1] & (1u << 16)) && (regs[1] & (1u << 30))) {
+			result |= CPU_FEATURE_AVX512;
+		}
+	}
+	return result;
+}
+#else
+static unsigned int detect(void) {
+	return 0;
+}
+#endif	// #if CPU_X86
+
+unsigned int cpu_features(void) {
+	if (!featuresReady) {
+		features	  = detect();
+		featuresReady = 1;
+	}
+	return features;
+}
@@ -6,11 +6,15 @@
  * This source file implements Triple DES (3DES) encryption and decryption operations.
  */
 
-#include <stdlib.h>
 #include <string.h>
 
+#include <cryptography/cpu_features.h>
 #include <cryptography/des.h>
 
+#if CPU_X86
+#include <immintrin.h>
+#endif
+
 // #if USE_DES_EN
 //  typedef struct
 //{
@@ -18,13 +22,6 @@
 // }des_context;
 // #endif
 
-#if USE_3DES_EN
-// brief Triple-DES context structure
-typedef struct {
-	uint32_t sk[96];  // 3DES subkeys
-} des3_context;
-#endif
-
 // Implementation that should never be optimized out by the compiler
 static void zeroize(void* v, size_t n) {
 	volatile unsigned char* p = (unsigned char*)v;
@@ -493,6 +490,21 @@ int des3_set3key_dec(des3_context* ctx, const unsigned char key[DES_KEY_SIZE * 3
 
 	return (0);
 }
+
+/*
+ * Triple-DES key schedule of a 16 or 24-byte key
+ */
+int des3_setkey(des3_context* ctx, int mode, const unsigned char* key, unsigned int keyLength) {
+	if (keyLength == DES3_KEY2_SIZE && mode == MBEDTLS_DES_ENCRYPT)
+		return des3_set2key_enc(ctx, key);
+	if (keyLength == DES3_KEY2_SIZE)
+		return des3_set2key_dec(ctx, key);
+	if (keyLength == DES3_KEY3_SIZE && mode == MBEDTLS_DES_ENCRYPT)
+		return des3_set3key_enc(ctx, key);
+	if (keyLength == DES3_KEY3_SIZE)
+		return des3_set3key_dec(ctx, key);
+	return (DES_KEY_LENGTH);
+}
 #endif	// #if USE_3DES_EN
 
 /*
@@ -527,35 +539,37 @@ int des_crypt_ecb(des_context* ctx, const unsigned char input[8], unsigned char
 #endif	// #if (USE_DES_ECB_EN || USE_DES_CBC_EN)
 
 #if USE_DES_ECB_EN
+// DES-ECB encryption, the last partial block is padded with zeros on the stack
+int des_ecb_encrypt_ctx(des_context* ctx,
+						const unsigned char* input,
+						size_t length,
+						unsigned char* output) {
+	unsigned char tail[8] = {0};
+	size_t i;
+
+	for (i = 0; i + 8 <= length; i += 8)
+		des_crypt_ecb(ctx, input + i, output + i);
+
+	if (i < length) {
+		memcpy(tail, input + i, length - i);
+		des_crypt_ecb(ctx, tail, output + i);
+		zeroize(tail, sizeof(tail));
+	}
+	return 0;
+}
+
 // DES-ECB buffer encryption API
 unsigned int des_ecb_encrypt(unsigned char* pout,
 							 unsigned char* pdata,
 							 unsigned int nlen,
 							 unsigned char* pkey) {
-	unsigned char* tmp;
-	unsigned int len, i;
-	unsigned char ch = '\0';
 	des_context ctx;
 
 	des_setkey_enc(&ctx, pkey);
-
-	len = (nlen / 8 + (nlen % 8 ? 1 : 0)) * 8;
-
-	// ch = 8 - nlen % 8;
-	for (i = 0; i < nlen; i += 8) {
-		des_crypt_ecb(&ctx, (pdata + i), (pout + i));
-	}
-	if (len > nlen) {
-		tmp = (unsigned char*)malloc(len);
-		i -= 8;
-		memcpy(tmp, pdata + i, nlen - i);
-		memset(tmp + nlen % 8, ch, (8 - nlen % 8) % 8);
-		des_crypt_ecb(&ctx, tmp, (pout + i));
-		free(tmp);
-	}
-
+	des_ecb_encrypt_ctx(&ctx, pdata, nlen, pout);
 	des_free(&ctx);
-	return len;
+
+	return (nlen + 7) / 8 * 8;
 }
 
 // DES-ECB buffer decryption API
@@ -591,8 +605,7 @@ int des_crypt_cbc(des_context* ctx,
 	unsigned char temp[8];
 
 	if (length % 8)
-		return (1);	 // The original MBEDTLS_ERR_DES_INVALID_INPUT_LENGTH is not
-					 // defined, find a replacement
+		return (DES_INPUT_LENGTH);
 
 	if (mode == MBEDTLS_DES_ENCRYPT) {
 		while (length > 0) {
@@ -715,41 +728,324 @@ int des3_crypt_ecb(des3_context* ctx, const unsigned char input[8], unsigned cha
 }
 #endif	// #if (USE_3DES_ECB_EN || USE_3DES_CBC_EN)
 
+#if USE_3DES_CBC_EN
+#define DES3_INTERLEAVE		4	// Blocks of the scalar kernel
+#define DES3_AVX2_LANES		DES_MULTI_LANES	 // Blocks of the AVX2 kernel
+#define DES3_MAX_PARALLEL	16	// Blocks decrypted per step of CBC decryption
+
+#define DES3_KERNEL_SCALAR	1
+#define DES3_KERNEL_AVX2	2
+
+/*
+ * DES round macro of one of the DES3_INTERLEAVE blocks, with the subkeys of the round in K0, K1
+ */
+#define DES_ROUND_LANE(X, Y, K0, K1)                                                               \
+	{                                                                                              \
+		T = (K0) ^ X;                                                                              \
+		Y ^= SB8[(T)&0x3F] ^ SB6[(T >> 8) & 0x3F] ^ SB4[(T >> 16) & 0x3F] ^ SB2[(T >> 24) & 0x3F]; \
+		T = (K1) ^ ((X << 28) | (X >> 4));                                                         \
+		Y ^= SB7[(T)&0x3F] ^ SB5[(T >> 8) & 0x3F] ^ SB3[(T >> 16) & 0x3F] ^ SB1[(T >> 24) & 0x3F]; \
+	}
+
+// Unrolled so the lookups of the independent blocks can be in flight together
+#define DES_ROUND_N(X, Y)                         \
+	{                                             \
+		DES_ROUND_LANE(X[0], Y[0], SK[0], SK[1]); \
+		DES_ROUND_LANE(X[1], Y[1], SK[0], SK[1]); \
+		DES_ROUND_LANE(X[2], Y[2], SK[0], SK[1]); \
+		DES_ROUND_LANE(X[3], Y[3], SK[0], SK[1]); \
+		SK += 2;                                  \
+	}
+
+// 3DES-ECB of DES3_INTERLEAVE blocks, the rounds of the blocks overlap in the pipeline
+static void des3_crypt_ecb_n(const des3_context* ctx,
+							 const unsigned char* input,
+							 unsigned char* output) {
+	int i, j;
+	uint32_t X[DES3_INTERLEAVE], Y[DES3_INTERLEAVE], T;
+	const uint32_t* SK = ctx->sk;
+
+	for (j = 0; j < DES3_INTERLEAVE; j++) {
+		GET_UINT32_BE(X[j], input, j * 8);
+		GET_UINT32_BE(Y[j], input, j * 8 + 4);
+		DES_IP(X[j], Y[j]);
+	}
+
+	for (i = 0; i < 8; i++) {
+		DES_ROUND_N(Y, X);
+		DES_ROUND_N(X, Y);
+	}
+
+	for (i = 0; i < 8; i++) {
+		DES_ROUND_N(X, Y);
+		DES_ROUND_N(Y, X);
+	}
+
+	for (i = 0; i < 8; i++) {
+		DES_ROUND_N(Y, X);
+		DES_ROUND_N(X, Y);
+	}
+
+	for (j = 0; j < DES3_INTERLEAVE; j++) {
+		DES_FP(Y[j], X[j]);
+		PUT_UINT32_BE(Y[j], output, j * 8);
+		PUT_UINT32_BE(X[j], output, j * 8 + 4);
+	}
+}
+
+// DES (passes = 1) or 3DES (passes = 3) of one block
+static void des_crypt_passes(const uint32_t* SK,
+							 int passes,
+							 const unsigned char input[8],
+							 unsigned char output[8]) {
+	int i, p;
+	uint32_t X, Y, T;
+
+	GET_UINT32_BE(X, input, 0);
+	GET_UINT32_BE(Y, input, 4);
+
+	DES_IP(X, Y);
+
+	for (p = 0; p < passes; p++) {
+		// The halves are not swapped back between the passes of 3DES
+		for (i = 0; i < 8; i++) {
+			if (p == 1) {
+				DES_ROUND(X, Y);
+				DES_ROUND(Y, X);
+			} else {
+				DES_ROUND(Y, X);
+				DES_ROUND(X, Y);
+			}
+		}
+	}
+
+	DES_FP(Y, X);
+
+	PUT_UINT32_BE(Y, output, 0);
+	PUT_UINT32_BE(X, output, 4);
+}
+
+// Subkey i of lane j goes to laneKeys[i * DES3_AVX2_LANES + j], lanes past count use block 0
+static void des_lane_keys(uint32_t* laneKeys, const uint32_t* const sk[], int count, int subkeys) {
+	int i, j;
+
+	for (i = 0; i < subkeys; i++) {
+		for (j = 0; j < DES3_AVX2_LANES; j++)
+			laneKeys[i * DES3_AVX2_LANES + j] = sk[j < count ? j : 0][i];
+	}
+}
+
+#if CPU_X86
+/*
+ * AVX2 kernel: one block per 32-bit lane, each lane with its own subkeys, the S-box lookups are
+ * gathers
+ */
+#define AVX2_ROL(X, n) _mm256_or_si256(_mm256_slli_epi32(X, n), _mm256_srli_epi32(X, 32 - (n)))
+
+#define AVX2_SWAPMOVE(A, B, n, m)                                              \
+	{                                                                          \
+		T = _mm256_and_si256(_mm256_xor_si256(_mm256_srli_epi32(A, n), B), m); \
+		B = _mm256_xor_si256(B, T);                                            \
+		A = _mm256_xor_si256(A, _mm256_slli_epi32(T, n));                      \
+	}
+
+#define AVX2_SBOX(S, T, n) \
+	_mm256_i32gather_epi32((const int*)(S), _mm256_and_si256(_mm256_srli_epi32(T, n), m3F), 4)
+
+#define DES_ROUND_AVX2(X, Y)                                                                  \
+	{                                                                                         \
+		T = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)SK), X);                      \
+		Y = _mm256_xor_si256(Y, _mm256_xor_si256(_mm256_xor_si256(AVX2_SBOX(SB8, T, 0),       \
+																	AVX2_SBOX(SB6, T, 8)),    \
+												 _mm256_xor_si256(AVX2_SBOX(SB4, T, 16),      \
+																	AVX2_SBOX(SB2, T, 24)))); \
+		T = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(SK + DES3_AVX2_LANES)),      \
+							 AVX2_ROL(X, 28));                                                \
+		Y = _mm256_xor_si256(Y, _mm256_xor_si256(_mm256_xor_si256(AVX2_SBOX(SB7, T, 0),       \
+																	AVX2_SBOX(SB5, T, 8)),    \
+												 _mm256_xor_si256(AVX2_SBOX(SB3, T, 16),      \
+																	AVX2_SBOX(SB1, T, 24)))); \
+		SK += 2 * DES3_AVX2_LANES;                                                            \
+	}
+
+// DES (passes = 1) or 3DES (passes = 3) of DES3_AVX2_LANES blocks, subkeys set by des_lane_keys
+CPU_TARGET("avx2")
+static void des_crypt_ecb_avx2(const uint32_t* laneKeys,
+							   int passes,
+							   const unsigned char* input,
+							   unsigned char* output) {
+	int i, p;
+	const uint32_t* SK = laneKeys;
+	const __m256i m3F  = _mm256_set1_epi32(0x3F);
+	const __m256i bswap =
+		_mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12, 3, 2, 1, 0, 7, 6,
+						 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+	const __m256i split = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+	const __m256i merge = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+	__m256i X, Y, T, a, b;
+
+	// Left halves of the 8 blocks in X, right halves in Y
+	a = _mm256_permutevar8x32_epi32(
+		_mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)input), bswap), split);
+	b = _mm256_permutevar8x32_epi32(
+		_mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(input + 32)), bswap), split);
+	X = _mm256_permute2x128_si256(a, b, 0x20);
+	Y = _mm256_permute2x128_si256(a, b, 0x31);
+
+	// Initial permutation
+	AVX2_SWAPMOVE(X, Y, 4, _mm256_set1_epi32(0x0F0F0F0F));
+	AVX2_SWAPMOVE(X, Y, 16, _mm256_set1_epi32(0x0000FFFF));
+	AVX2_SWAPMOVE(Y, X, 2, _mm256_set1_epi32(0x33333333));
+	AVX2_SWAPMOVE(Y, X, 8, _mm256_set1_epi32(0x00FF00FF));
+	Y = AVX2_ROL(Y, 1);
+	T = _mm256_and_si256(_mm256_xor_si256(X, Y), _mm256_set1_epi32((int)0xAAAAAAAA));
+	Y = _mm256_xor_si256(Y, T);
+	X = _mm256_xor_si256(X, T);
+	X = AVX2_ROL(X, 1);
+
+	for (p = 0; p < passes; p++) {
+		for (i = 0; i < 8; i++) {
+			if (p == 1) {
+				DES_ROUND_AVX2(X, Y);
+				DES_ROUND_AVX2(Y, X);
+			} else {
+				DES_ROUND_AVX2(Y, X);
+				DES_ROUND_AVX2(X, Y);
+			}
+		}
+	}
+
+	// Final permutation of (Y, X)
+	Y = AVX2_ROL(Y, 31);
+	T = _mm256_and_si256(_mm256_xor_si256(Y, X), _mm256_set1_epi32((int)0xAAAAAAAA));
+	Y = _mm256_xor_si256(Y, T);
+	X = _mm256_xor_si256(X, T);
+	X = AVX2_ROL(X, 31);
+	AVX2_SWAPMOVE(X, Y, 8, _mm256_set1_epi32(0x00FF00FF));
+	AVX2_SWAPMOVE(X, Y, 2, _mm256_set1_epi32(0x33333333));
+	AVX2_SWAPMOVE(Y, X, 16, _mm256_set1_epi32(0x0000FFFF));
+	AVX2_SWAPMOVE(Y, X, 4, _mm256_set1_epi32(0x0F0F0F0F));
+
+	// Output block j is Y[j] || X[j]
+	a = _mm256_permute2x128_si256(Y, X, 0x20);
+	b = _mm256_permute2x128_si256(Y, X, 0x31);
+	_mm256_storeu_si256((__m256i*)output,
+						_mm256_shuffle_epi8(_mm256_permutevar8x32_epi32(a, merge), bswap));
+	_mm256_storeu_si256((__m256i*)(output + 32),
+						_mm256_shuffle_epi8(_mm256_permutevar8x32_epi32(b, merge), bswap));
+}
+#endif	// #if CPU_X86
+
+static int des3_kernel;	 // DES3_KERNEL_*, chosen on first use
+
+// The widest kernel available on this CPU that passes the self test
+static int des3_kernel_select(void) {
+	if (des3_kernel == 0) {
+		des3_kernel = DES3_KERNEL_SCALAR;
+#if CPU_X86
+		if ((cpu_features() & CPU_FEATURE_AVX2) && des3_self_test() == 0) {
+			des3_kernel = DES3_KERNEL_AVX2;
+		}
+#endif
+	}
+	return des3_kernel;
+}
+
+// 3DES-ECB of any number of blocks with the selected kernel, AVX2 takes the lane keys of ctx
+static void des3_crypt_ecb_blocks(des3_context* ctx,
+								  int kernel,
+								  const uint32_t* laneKeys,
+								  const unsigned char* input,
+								  unsigned char* output,
+								  size_t blocks) {
+#if CPU_X86
+	if (kernel == DES3_KERNEL_AVX2) {
+		for (; blocks >= DES3_AVX2_LANES; blocks -= DES3_AVX2_LANES) {
+			des_crypt_ecb_avx2(laneKeys, 3, input, output);
+			input += DES3_AVX2_LANES * 8;
+			output += DES3_AVX2_LANES * 8;
+		}
+	}
+#endif
+	for (; blocks >= DES3_INTERLEAVE; blocks -= DES3_INTERLEAVE) {
+		des3_crypt_ecb_n(ctx, input, output);
+		input += DES3_INTERLEAVE * 8;
+		output += DES3_INTERLEAVE * 8;
+	}
+	for (; blocks > 0; blocks--) {
+		des3_crypt_ecb(ctx, input, output);
+		input += 8;
+		output += 8;
+	}
+}
+
+void des_crypt_ecb_multi(const uint32_t* const sk[],
+						 int passes,
+						 const unsigned char* const input[],
+						 unsigned char* const output[],
+						 int count) {
+	int i;
+#if CPU_X86
+	uint32_t laneKeys[96 * DES3_AVX2_LANES];
+	unsigned char buf[DES3_AVX2_LANES * 8];
+
+	if (count > 1 && des3_kernel_select() == DES3_KERNEL_AVX2) {
+		des_lane_keys(laneKeys, sk, count, passes * 32);
+		memset(buf, 0, sizeof(buf));
+		for (i = 0; i < count; i++)
+			memcpy(&buf[i * 8], input[i], 8);
+
+		des_crypt_ecb_avx2(laneKeys, passes, buf, buf);
+
+		for (i = 0; i < count; i++)
+			memcpy(output[i], &buf[i * 8], 8);
+		zeroize(laneKeys, passes * 32 * DES3_AVX2_LANES * sizeof(uint32_t));
+		return;
+	}
+#endif
+	for (i = 0; i < count; i++)
+		des_crypt_passes(sk[i], passes, input[i], output[i]);
+}
+
+int des_crypt_ecb_multi_lanes(void) {
+	return des3_kernel_select() == DES3_KERNEL_AVX2 ? DES_MULTI_LANES : 1;
+}
+#endif	// #if USE_3DES_CBC_EN
+
 #if USE_3DES_ECB_EN
+// 3DES-ECB encryption, the last partial block is padded with zeros on the stack
+int des3_ecb_encrypt_ctx(des3_context* ctx,
+						 const unsigned char* input,
+						 size_t length,
+						 unsigned char* output) {
+	unsigned char tail[8] = {0};
+	size_t i;
+
+	for (i = 0; i + 8 <= length; i += 8)
+		des3_crypt_ecb(ctx, input + i, output + i);
+
+	if (i < length) {
+		memcpy(tail, input + i, length - i);
+		des3_crypt_ecb(ctx, tail, output + i);
+		zeroize(tail, sizeof(tail));
+	}
+	return 0;
+}
+
 // 3DES-ECB buffer encryption API
 unsigned int des3_ecb_encrypt(unsigned char* pout,
 							  unsigned char* pdata,
 							  unsigned int nlen,
 							  unsigned char* pkey,
 							  unsigned int klen) {
-	unsigned char* tmp;
-	unsigned int len, i;
-	unsigned char ch = '\0';
 	des3_context ctx3;
 
-	if (klen == DES3_KEY2_SIZE)			// 16 bytes
-		des3_set2key_enc(&ctx3, pkey);	// Set the key according to the length
-	else if (klen == DES3_KEY3_SIZE)	// 24 bytes
-		des3_set3key_enc(&ctx3, pkey);
-
-	len = (nlen / 8 + (nlen % 8 ? 1 : 0)) * 8;
-
-	// ch = 8-nlen% 8;//You can set the complement content, usually 0 or 0xFF
-	for (i = 0; i < nlen; i += 8) {
-		des3_crypt_ecb(&ctx3, (pdata + i), (pout + i));
-	}
-	if (len > nlen)	 // Complete less than 8 bytes
-	{
-		tmp = (unsigned char*)malloc(len);
-		i -= 8;
-		memcpy(tmp, pdata + i, nlen - i);
-		memset(tmp + nlen % 8, ch, (8 - nlen % 8) % 8);
-		des3_crypt_ecb(&ctx3, tmp, (pout + i));
-		free(tmp);
-	}
+	if (des3_setkey(&ctx3, MBEDTLS_DES_ENCRYPT, pkey, klen) != 0)
+		return 0;
 
+	des3_ecb_encrypt_ctx(&ctx3, pdata, nlen, pout);
 	des3_free(&ctx3);
-	return len;
+	return (nlen + 7) / 8 * 8;
 }
 
 // 3DES-ECB buffer decryption API
@@ -761,14 +1057,9 @@ unsigned int des3_ecb_decrypt(unsigned char* pout,
 	unsigned int i;
 	des3_context ctx3;
 
-	if (nlen % 8)
+	if (nlen % 8 || des3_setkey(&ctx3, MBEDTLS_DES_DECRYPT, pkey, klen) != 0)
 		return 1;
 
-	if (klen == DES3_KEY2_SIZE)
-		des3_set2key_dec(&ctx3, pkey);
-	else if (klen == DES3_KEY3_SIZE)
-		des3_set3key_dec(&ctx3, pkey);
-
 	for (i = 0; i < nlen; i += 8) {
 		des3_crypt_ecb(&ctx3, (pdata + i), (pout + i));
 	}
@@ -785,11 +1076,14 @@ int des3_crypt_cbc(des3_context* ctx,
 				   unsigned char iv[8],
 				   const unsigned char* input,
 				   unsigned char* output) {
-	int i;
-	unsigned char temp[8];
+	int i, kernel;
+	size_t blocks;
+	unsigned char chain[(DES3_MAX_PARALLEL + 1) * 8];
+	uint32_t laneKeys[96 * DES3_AVX2_LANES];
+	const uint32_t* sk = ctx->sk;
 
 	if (length % 8)
-		return (MBEDTLS_ERR_DES_INVALID_INPUT_LENGTH);
+		return (DES_INPUT_LENGTH);
 
 	if (mode == MBEDTLS_DES_ENCRYPT) {
 		while (length > 0) {
@@ -805,24 +1099,51 @@ int des3_crypt_cbc(des3_context* ctx,
 		}
 	} else /* DES_DECRYPT */
 	{
+		// The blocks only depend on each other through the XOR, decrypt several at once
+		kernel = des3_kernel_select();
+		if (kernel == DES3_KERNEL_AVX2)
+			des_lane_keys(laneKeys, &sk, 1, 96);
 		while (length > 0) {
-			memcpy(temp, input, 8);
-			des3_crypt_ecb(ctx, input,
-						   output);	 // des3_crypt_cbc( ctx, 1, length, iv, temp, output);
-			for (i = 0; i < 8; i++)
-				output[i] = (unsigned char)(output[i] ^ iv[i]);
+			blocks = length / 8 < DES3_MAX_PARALLEL ? length / 8 : DES3_MAX_PARALLEL;
 
-			memcpy(iv, temp, 8);
+			// Keep IV || ciphertext, the output may overwrite the input
+			memcpy(chain, iv, 8);
+			memcpy(&chain[8], input, blocks * 8);
+			des3_crypt_ecb_blocks(ctx, kernel, laneKeys, &chain[8], output, blocks);
+			for (i = 0; i < (int)blocks * 8; i++)
+				output[i] = (unsigned char)(output[i] ^ chain[i]);
 
-			input += 8;
-			output += 8;
-			length -= 8;
+			memcpy(iv, &chain[blocks * 8], 8);
+
+			input += blocks * 8;
+			output += blocks * 8;
+			length -= blocks * 8;
 		}
+		if (kernel == DES3_KERNEL_AVX2)
+			zeroize(laneKeys, sizeof(laneKeys));
 	}
 
 	return (0);
 }
 
+// 3DES-CBC encryption, the last partial block is padded with zeros on the stack
+int des3_cbc_encrypt_ctx(des3_context* ctx,
+						 unsigned char iv[8],
+						 const unsigned char* input,
+						 size_t length,
+						 unsigned char* output) {
+	unsigned char tail[8] = {0};
+	size_t whole = length / 8 * 8;
+
+	des3_crypt_cbc(ctx, MBEDTLS_DES_ENCRYPT, whole, iv, input, output);
+	if (whole < length) {
+		memcpy(tail, input + whole, length - whole);
+		des3_crypt_cbc(ctx, MBEDTLS_DES_ENCRYPT, 8, iv, tail, output + whole);
+		zeroize(tail, sizeof(tail));
+	}
+	return 0;
+}
+
 // 3DES-CBC buffer encryption API
 unsigned int des3_cbc_encrypt(unsigned char* pout,
 							  unsigned char* pdata,
@@ -833,28 +1154,16 @@ unsigned int des3_cbc_encrypt(unsigned char* pout,
 	des3_context ctx;
 	unsigned char iv[8] = {0};
 	unsigned char* pivb;
-	unsigned int len;
-	unsigned char* tmp;
 
 	if (piv == NULL)
 		pivb = iv;
 	else
 		pivb = piv;
 
-	if (klen == DES3_KEY2_SIZE)
-		des3_set2key_enc(&ctx, pkey);
-	else if (klen == DES3_KEY3_SIZE)
-		des3_set3key_enc(&ctx, pkey);
+	if (des3_setkey(&ctx, MBEDTLS_DES_ENCRYPT, pkey, klen) != 0)
+		return 0;
 
-	if (nlen % 8) {
-		len = nlen + 8 - nlen % 8;
-		tmp = (unsigned char*)calloc(1, len);
-		memcpy(tmp, pdata, nlen);
-		des3_crypt_cbc(&ctx, 1, len, pivb, tmp, (pout));
-		free(tmp);
-	} else {
-		des3_crypt_cbc(&ctx, 1, nlen, pivb, pdata, (pout));
-	}
+	des3_cbc_encrypt_ctx(&ctx, pivb, pdata, nlen, pout);
 
 	des3_free(&ctx);
 
@@ -872,7 +1181,7 @@ unsigned int des3_cbc_decrypt(unsigned char* pout,
 	unsigned char iv[8] = {0};
 	unsigned char* pivb;
 
-	if (nlen % 8)
+	if (nlen % 8 || des3_setkey(&ctx, MBEDTLS_DES_DECRYPT, pkey, klen) != 0)
 		return 1;
 
 	if (piv == NULL)
@@ -880,16 +1189,101 @@ unsigned int des3_cbc_decrypt(unsigned char* pout,
 	else
 		pivb = piv;
 
-	if (klen == DES3_KEY2_SIZE)
-		des3_set2key_dec(&ctx, pkey);
-	else if (klen == DES3_KEY3_SIZE)
-		des3_set3key_dec(&ctx, pkey);
-
 	des3_crypt_cbc(&ctx, 0, nlen, pivb, pdata, (pout));
 
 	des3_free(&ctx);
 
 	return 0;
 }
+
+// Checks the multi-key kernels on DES3_AVX2_LANES blocks
+static int des_multi_self_test(const uint32_t* const sk[],
+							   int passes,
+							   const unsigned char* input,
+							   const unsigned char* expected) {
+	unsigned char output[DES3_AVX2_LANES * 8];
+	int i, ret = 0;
+
+	for (i = 0; i < DES3_AVX2_LANES; i++)
+		des_crypt_passes(sk[i], passes, &input[i * 8], &output[i * 8]);
+	if (memcmp(output, expected, sizeof(output)))
+		ret = DES_SELF_TEST_FAILED;
+
+#if CPU_X86
+	if (cpu_features() & CPU_FEATURE_AVX2) {
+		uint32_t laneKeys[96 * DES3_AVX2_LANES];
+
+		des_lane_keys(laneKeys, sk, DES3_AVX2_LANES, passes * 32);
+		des_crypt_ecb_avx2(laneKeys, passes, input, output);
+		if (memcmp(output, expected, sizeof(output)))
+			ret = DES_SELF_TEST_FAILED;
+	}
+#endif
+	return ret;
+}
+
+int des3_self_test(void) {
+	// 3DES-EDE2 known answer: "Now is t" under 0123456789ABCDEF FEDCBA9876543210
+	static const unsigned char key[16]	 = {0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF,
+											0xFE, 0xDC, 0xBA, 0x98, 0x76, 0x54, 0x32, 0x10};
+	static const unsigned char plain[8]	 = {0x4E, 0x6F, 0x77, 0x20, 0x69, 0x73, 0x20, 0x74};
+	static const unsigned char cipher[8] = {0xD8, 0x0A, 0x0D, 0x8B, 0x2B, 0xAE, 0x5E, 0x4E};
+	unsigned char input[(DES3_MAX_PARALLEL - 1) * 8];
+	unsigned char expected[sizeof(input)], output[sizeof(input)];
+	const uint32_t* sk[DES3_AVX2_LANES];
+	des3_context ctx, ctx2;
+	des_context ctx1;
+	int i, ret = 0;
+
+	// One block short of the maximum, so every kernel also runs its tail
+	memcpy(input, cipher, 8);
+	for (i = 8; i < (int)sizeof(input); i++)
+		input[i] = (unsigned char)(i * 37 + 11);
+
+	des3_set2key_dec(&ctx, key);
+	for (i = 0; i < (int)sizeof(input); i += 8)
+		des3_crypt_ecb(&ctx, &input[i], &expected[i]);
+	if (memcmp(expected, plain, 8))
+		ret = DES_SELF_TEST_FAILED;
+
+	des3_crypt_ecb_blocks(&ctx, DES3_KERNEL_SCALAR, NULL, input, output, sizeof(input) / 8);
+	if (memcmp(output, expected, sizeof(output)))
+		ret = DES_SELF_TEST_FAILED;
+
+#if CPU_X86
+	if (cpu_features() & CPU_FEATURE_AVX2) {
+		uint32_t laneKeys[96 * DES3_AVX2_LANES];
+
+		sk[0] = ctx.sk;
+		des_lane_keys(laneKeys, sk, 1, 96);
+		des3_crypt_ecb_blocks(&ctx, DES3_KERNEL_AVX2, laneKeys, input, output, sizeof(input) / 8);
+		if (memcmp(output, expected, sizeof(output)))
+			ret = DES_SELF_TEST_FAILED;
+	}
+#endif
+
+	// Lanes under different keys: even lanes decrypt with ctx, odd lanes encrypt with ctx2
+	des3_set2key_enc(&ctx2, &input[8]);
+	for (i = 0; i < DES3_AVX2_LANES; i++) {
+		sk[i] = i % 2 ? ctx2.sk : ctx.sk;
+		des3_crypt_ecb(i % 2 ? &ctx2 : &ctx, &input[i * 8], &expected[i * 8]);
+	}
+	if (des_multi_self_test(sk, 3, input, expected))
+		ret = DES_SELF_TEST_FAILED;
+
+	// Single DES under the first half of the key
+	des_setkey_enc(&ctx1, key);
+	for (i = 0; i < DES3_AVX2_LANES; i++) {
+		sk[i] = ctx1.sk;
+		des_crypt_ecb(&ctx1, &input[i * 8], &expected[i * 8]);
+	}
+	if (des_multi_self_test(sk, 1, input, expected))
+		ret = DES_SELF_TEST_FAILED;
+
+	des3_free(&ctx);
+	des3_free(&ctx2);
+	des_free(&ctx1);
+	return ret;
+}
 #endif	// #if USE_3DES_CBC_EN
 #endif	// #if USE_3DES_EN
\ No newline at end of file
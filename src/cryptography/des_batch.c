@@ -0,0 +1,276 @@
+/**
+ * @author Khoa Nguyen
+ * @file des_batch.c
+ * @brief Source file for the cross-session DES batching engine.
+ *
+ * The thread whose block opens a batch times it: it yields until the deadline and then computes
+ * whatever has joined. The other threads sleep until their blocks are computed. A batch only waits
+ * while another session is inside a call of the engine, a session busy with the card cannot join.
+ */
+
+#include <string.h>
+
+#include <cryptography/des.h>
+#include <cryptography/des_batch.h>
+#include <utils/sync.h>
+
+#define DES_BATCH_QUEUES	 2	 // Single DES and 3DES blocks are batched apart
+#define DES_BATCH_MAX_BLOCKS 64	 // Independent blocks of a call submitted at once
+
+// A queued block, its buffers belong to the thread waiting for it
+typedef struct {
+	const uint32_t* sk;			 // Subkeys of the session
+	const unsigned char* input;	 // 8 bytes
+	unsigned char* output;		 // 8 bytes
+	int* remaining;				 // Blocks of the submitting call not computed yet
+} des_batch_block;
+
+static struct {
+	SyncLock lock;
+	SyncCondition computed;
+	int sessions;			 // Attached sessions
+	int active;				 // Calls of des_batch_mac3 and des_batch_cbc in progress
+	int waiting;			 // Calls with blocks not computed yet
+	unsigned int latencyUs;	 // Bound on the wait of a block
+	des_batch_block queue[DES_BATCH_QUEUES][DES_MULTI_LANES];
+	int count[DES_BATCH_QUEUES];
+	des_batch_stats stats;
+} engine = {.lock = SYNC_INIT, .computed = SYNC_INIT, .latencyUs = DES_BATCH_LATENCY_US};
+
+// Computes the blocks of a queue, called with the lock held
+static void des_batch_flush(int q) {
+	const uint32_t* sk[DES_MULTI_LANES]			= {0};
+	const unsigned char* input[DES_MULTI_LANES] = {0};
+	unsigned char* output[DES_MULTI_LANES]		= {0};
+	int i, n = engine.count[q];
+
+	if (n == 0)
+		return;
+
+	for (i = 0; i < n; i++) {
+		sk[i]	  = engine.queue[q][i].sk;
+		input[i]  = engine.queue[q][i].input;
+		output[i] = engine.queue[q][i].output;
+	}
+	des_crypt_ecb_multi(sk, q ? 3 : 1, input, output, n);
+
+	// A call stops counting as waiting with its last block, before its thread wakes up
+	for (i = 0; i < n; i++) {
+		if (--(*engine.queue[q][i].remaining) == 0)
+			engine.waiting--;
+	}
+	engine.count[q] = 0;
+	engine.stats.blocks += n;
+	engine.stats.calls++;
+	SyncWakeAll(&engine.computed);
+}
+
+static void des_batch_flush_all(void) {
+	int q;
+
+	for (q = 0; q < DES_BATCH_QUEUES; q++)
+		des_batch_flush(q);
+}
+
+static int des_batch_remaining(const int* remaining) {
+	int n;
+
+	SyncLockShared(&engine.lock);
+	n = *remaining;
+	SyncUnlockShared(&engine.lock);
+	return n;
+}
+
+// Marks a call in progress, its blocks are the only ones worth waiting for
+static void des_batch_enter(void) {
+	SyncLockExclusive(&engine.lock);
+	engine.active++;
+	SyncUnlockExclusive(&engine.lock);
+}
+
+static void des_batch_leave(void) {
+	SyncLockExclusive(&engine.lock);
+	engine.active--;
+	if (engine.waiting > 0 && engine.waiting >= engine.active)
+		des_batch_flush_all();
+	SyncUnlockExclusive(&engine.lock);
+}
+
+// DES (passes = 1) or 3DES (passes = 3) of independent blocks
+static void des_batch_run(const uint32_t* const sk[],
+						  int passes,
+						  const unsigned char* const input[],
+						  unsigned char* const output[],
+						  int count) {
+	int i, q = passes == 3, remaining = count, opened = 0;
+	des_batch_block* block;
+	long long deadline = 0;
+
+	SyncLockExclusive(&engine.lock);
+	if (engine.sessions <= 1 || engine.active <= 1 || des_crypt_ecb_multi_lanes() == 1) {
+		// No other session is computing, none can share the call
+		SyncUnlockExclusive(&engine.lock);
+		for (i = 0; i < count; i += DES_MULTI_LANES) {
+			des_crypt_ecb_multi(&sk[i], passes, &input[i], &output[i],
+								count - i < DES_MULTI_LANES ? count - i : DES_MULTI_LANES);
+		}
+		return;
+	}
+
+	engine.waiting++;
+	for (i = 0; i < count; i++) {
+		if (engine.count[q] == 0) {
+			opened	 = 1;
+			deadline = SyncTicks() + engine.latencyUs * SyncTicksPerSecond() / 1000000;
+		}
+
+		block			 = &engine.queue[q][engine.count[q]++];
+		block->sk		 = sk[i];
+		block->input	 = input[i];
+		block->output	 = output[i];
+		block->remaining = &remaining;
+
+		if (engine.count[q] == DES_MULTI_LANES) {
+			des_batch_flush(q);
+			opened = 0;
+		}
+	}
+
+	// Every call in progress is waiting, nothing else can join
+	if (remaining > 0 && engine.waiting >= engine.active)
+		des_batch_flush_all();
+
+	while (remaining > 0) {
+		if (opened) {
+			// Other sessions may join until the deadline, the batch still holds our block
+			SyncUnlockExclusive(&engine.lock);
+			do {
+				SyncYield();
+			} while (SyncTicks() < deadline && des_batch_remaining(&remaining) > 0);
+			SyncLockExclusive(&engine.lock);
+
+			if (remaining > 0)
+				des_batch_flush(q);
+		} else {
+			SyncWait(&engine.computed, &engine.lock);
+		}
+	}
+	SyncUnlockExclusive(&engine.lock);
+}
+
+void des_batch_attach(void) {
+	SyncLockExclusive(&engine.lock);
+	engine.sessions++;
+	SyncUnlockExclusive(&engine.lock);
+}
+
+void des_batch_detach(void) {
+	SyncLockExclusive(&engine.lock);
+	engine.sessions--;
+	SyncUnlockExclusive(&engine.lock);
+}
+
+void des_batch_set_latency(unsigned int microseconds) {
+	SyncLockExclusive(&engine.lock);
+	engine.latencyUs = microseconds;
+	SyncUnlockExclusive(&engine.lock);
+}
+
+void des_batch_get_stats(des_batch_stats* stats) {
+	SyncLockShared(&engine.lock);
+	*stats = engine.stats;
+	SyncUnlockShared(&engine.lock);
+}
+
+int des_batch_mac3(const unsigned char key[16],
+				   const unsigned char* data,
+				   int length,
+				   unsigned char mac[8]) {
+	des_context ctx1;
+	des3_context ctx3;
+	unsigned char block[8] = {0};
+	const unsigned char* input = block;
+	unsigned char* output	   = block;
+	const uint32_t* sk;
+	int i, j;
+
+	if (length <= 0 || length % 8)
+		return DES_INPUT_LENGTH;
+
+	des_setkey_enc(&ctx1, key);
+	des3_set2key_enc(&ctx3, key);
+	des_batch_enter();
+
+	// DES-CBC with K1, output transformation 3 is 3DES-EDE2 of the last block
+	for (i = 0; i < length; i += 8) {
+		for (j = 0; j < 8; j++)
+			block[j] ^= data[i + j];
+
+		if (i + 8 < length) {
+			sk = ctx1.sk;
+			des_batch_run(&sk, 1, &input, &output, 1);
+		} else {
+			sk = ctx3.sk;
+			des_batch_run(&sk, 3, &input, &output, 1);
+		}
+	}
+	des_batch_leave();
+	memcpy(mac, block, 8);
+
+	des_free(&ctx1);
+	des3_free(&ctx3);
+	return 0;
+}
+
+int des_batch_cbc(int mode,
+				  const unsigned char key[16],
+				  const unsigned char* input,
+				  int length,
+				  unsigned char* output) {
+	des3_context ctx;
+	unsigned char chain[(DES_BATCH_MAX_BLOCKS + 1) * 8] = {0};
+	const uint32_t* sk[DES_BATCH_MAX_BLOCKS];
+	const unsigned char* in[DES_BATCH_MAX_BLOCKS];
+	unsigned char* out[DES_BATCH_MAX_BLOCKS];
+	int i, j, n;
+
+	if (length % 8)
+		return DES_INPUT_LENGTH;
+
+	des_batch_enter();
+	if (mode == MBEDTLS_DES_ENCRYPT) {
+		des3_set2key_enc(&ctx, key);
+		sk[0]  = ctx.sk;
+		in[0]  = chain;
+		out[0] = chain;
+		for (i = 0; i < length; i += 8) {
+			for (j = 0; j < 8; j++)
+				chain[j] ^= input[i + j];
+			des_batch_run(sk, 3, in, out, 1);
+			memcpy(&output[i], chain, 8);
+		}
+	} else {
+		// The blocks only depend on each other through the XOR, submit them together
+		des3_set2key_dec(&ctx, key);
+		for (i = 0; i < length; i += n * 8) {
+			n = (length - i) / 8 < DES_BATCH_MAX_BLOCKS ? (length - i) / 8 : DES_BATCH_MAX_BLOCKS;
+
+			// Keep IV || ciphertext, the output may overwrite the input
+			memcpy(&chain[8], &input[i], n * 8);
+			for (j = 0; j < n; j++) {
+				sk[j]  = ctx.sk;
+				in[j]  = &chain[(j + 1) * 8];
+				out[j] = &output[i + j * 8];
+			}
+			des_batch_run(sk, 3, in, out, n);
+
+			for (j = 0; j < n * 8; j++)
+				output[i + j] ^= chain[j];
+			memcpy(chain, &chain[n * 8], 8);
+		}
+	}
+	des_batch_leave();
+
+	des3_free(&ctx);
+	return 0;
+}
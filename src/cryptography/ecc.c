@@ -0,0 +1,1038 @@
+/**
+ * @author Khoa Nguyen
+ * @file ecc.c
+ * @brief Source file for elliptic curve arithmetic over prime fields.
+ *
+ * This source file implements Jacobian point arithmetic on top of Montgomery field arithmetic,
+ * the standardized curve table and the fixed-base (comb) and variable-base (Montgomery ladder)
+ * scalar multiplications.
+ */
+
+#include <string.h>
+
+#include <cryptography/ecc.h>
+#include <utils/sync.h>
+
+// NIST P-192 (standardized domain parameter ID 8)
+static const unsigned char SECP192R1_P[24] = {
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFE, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+static const unsigned char SECP192R1_A[24] = {
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFE, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFC};
+static const unsigned char SECP192R1_B[24] = {
+	0x64, 0x21, 0x05, 0x19, 0xE5, 0x9C, 0x80, 0xE7, 0x0F, 0xA7, 0xE9, 0xAB,
+	0x72, 0x24, 0x30, 0x49, 0xFE, 0xB8, 0xDE, 0xEC, 0xC1, 0x46, 0xB9, 0xB1};
+static const unsigned char SECP192R1_GX[24] = {
+	0x18, 0x8D, 0xA8, 0x0E, 0xB0, 0x30, 0x90, 0xF6, 0x7C, 0xBF, 0x20, 0xEB,
+	0x43, 0xA1, 0x88, 0x00, 0xF4, 0xFF, 0x0A, 0xFD, 0x82, 0xFF, 0x10, 0x12};
+static const unsigned char SECP192R1_GY[24] = {
+	0x07, 0x19, 0x2B, 0x95, 0xFF, 0xC8, 0xDA, 0x78, 0x63, 0x10, 0x11, 0xED,
+	0x6B, 0x24, 0xCD, 0xD5, 0x73, 0xF9, 0x77, 0xA1, 0x1E, 0x79, 0x48, 0x11};
+static const unsigned char SECP192R1_N[24] = {
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0x99, 0xDE, 0xF8, 0x36, 0x14, 0x6B, 0xC9, 0xB1, 0xB4, 0xD2, 0x28, 0x31};
+
+// BrainpoolP192r1 (standardized domain parameter ID 9)
+static const unsigned char BRAINPOOLP192R1_P[24] = {
+	0xC3, 0x02, 0xF4, 0x1D, 0x93, 0x2A, 0x36, 0xCD, 0xA7, 0xA3, 0x46, 0x30,
+	0x93, 0xD1, 0x8D, 0xB7, 0x8F, 0xCE, 0x47, 0x6D, 0xE1, 0xA8, 0x62, 0x97};
+static const unsigned char BRAINPOOLP192R1_A[24] = {
+	0x6A, 0x91, 0x17, 0x40, 0x76, 0xB1, 0xE0, 0xE1, 0x9C, 0x39, 0xC0, 0x31,
+	0xFE, 0x86, 0x85, 0xC1, 0xCA, 0xE0, 0x40, 0xE5, 0xC6, 0x9A, 0x28, 0xEF};
+static const unsigned char BRAINPOOLP192R1_B[24] = {
+	0x46, 0x9A, 0x28, 0xEF, 0x7C, 0x28, 0xCC, 0xA3, 0xDC, 0x72, 0x1D, 0x04,
+	0x4F, 0x44, 0x96, 0xBC, 0xCA, 0x7E, 0xF4, 0x14, 0x6F, 0xBF, 0x25, 0xC9};
+static const unsigned char BRAINPOOLP192R1_GX[24] = {
+	0xC0, 0xA0, 0x64, 0x7E, 0xAA, 0xB6, 0xA4, 0x87, 0x53, 0xB0, 0x33, 0xC5,
+	0x6C, 0xB0, 0xF0, 0x90, 0x0A, 0x2F, 0x5C, 0x48, 0x53, 0x37, 0x5F, 0xD6};
+static const unsigned char BRAINPOOLP192R1_GY[24] = {
+	0x14, 0xB6, 0x90, 0x86, 0x6A, 0xBD, 0x5B, 0xB8, 0x8B, 0x5F, 0x48, 0x28,
+	0xC1, 0x49, 0x00, 0x02, 0xE6, 0x77, 0x3F, 0xA2, 0xFA, 0x29, 0x9B, 0x8F};
+static const unsigned char BRAINPOOLP192R1_N[24] = {
+	0xC3, 0x02, 0xF4, 0x1D, 0x93, 0x2A, 0x36, 0xCD, 0xA7, 0xA3, 0x46, 0x2F,
+	0x9E, 0x9E, 0x91, 0x6B, 0x5B, 0xE8, 0xF1, 0x02, 0x9A, 0xC4, 0xAC, 0xC1};
+
+// NIST P-224 (standardized domain parameter ID 10)
+static const unsigned char SECP224R1_P[28] = {
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x01};
+static const unsigned char SECP224R1_A[28] = {
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFE, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFE};
+static const unsigned char SECP224R1_B[28] = {
+	0xB4, 0x05, 0x0A, 0x85, 0x0C, 0x04, 0xB3, 0xAB, 0xF5, 0x41, 0x32, 0x56,
+	0x50, 0x44, 0xB0, 0xB7, 0xD7, 0xBF, 0xD8, 0xBA, 0x27, 0x0B, 0x39, 0x43,
+	0x23, 0x55, 0xFF, 0xB4};
+static const unsigned char SECP224R1_GX[28] = {
+	0xB7, 0x0E, 0x0C, 0xBD, 0x6B, 0xB4, 0xBF, 0x7F, 0x32, 0x13, 0x90, 0xB9,
+	0x4A, 0x03, 0xC1, 0xD3, 0x56, 0xC2, 0x11, 0x22, 0x34, 0x32, 0x80, 0xD6,
+	0x11, 0x5C, 0x1D, 0x21};
+static const unsigned char SECP224R1_GY[28] = {
+	0xBD, 0x37, 0x63, 0x88, 0xB5, 0xF7, 0x23, 0xFB, 0x4C, 0x22, 0xDF, 0xE6,
+	0xCD, 0x43, 0x75, 0xA0, 0x5A, 0x07, 0x47, 0x64, 0x44, 0xD5, 0x81, 0x99,
+	0x85, 0x00, 0x7E, 0x34};
+static const unsigned char SECP224R1_N[28] = {
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0x16, 0xA2, 0xE0, 0xB8, 0xF0, 0x3E, 0x13, 0xDD, 0x29, 0x45,
+	0x5C, 0x5C, 0x2A, 0x3D};
+
+// BrainpoolP224r1 (standardized domain parameter ID 11)
+static const unsigned char BRAINPOOLP224R1_P[28] = {
+	0xD7, 0xC1, 0x34, 0xAA, 0x26, 0x43, 0x66, 0x86, 0x2A, 0x18, 0x30, 0x25,
+	0x75, 0xD1, 0xD7, 0x87, 0xB0, 0x9F, 0x07, 0x57, 0x97, 0xDA, 0x89, 0xF5,
+	0x7E, 0xC8, 0xC0, 0xFF};
+static const unsigned char BRAINPOOLP224R1_A[28] = {
+	0x68, 0xA5, 0xE6, 0x2C, 0xA9, 0xCE, 0x6C, 0x1C, 0x29, 0x98, 0x03, 0xA6,
+	0xC1, 0x53, 0x0B, 0x51, 0x4E, 0x18, 0x2A, 0xD8, 0xB0, 0x04, 0x2A, 0x59,
+	0xCA, 0xD2, 0x9F, 0x43};
+static const unsigned char BRAINPOOLP224R1_B[28] = {
+	0x25, 0x80, 0xF6, 0x3C, 0xCF, 0xE4, 0x41, 0x38, 0x87, 0x07, 0x13, 0xB1,
+	0xA9, 0x23, 0x69, 0xE3, 0x3E, 0x21, 0x35, 0xD2, 0x66, 0xDB, 0xB3, 0x72,
+	0x38, 0x6C, 0x40, 0x0B};
+static const unsigned char BRAINPOOLP224R1_GX[28] = {
+	0x0D, 0x90, 0x29, 0xAD, 0x2C, 0x7E, 0x5C, 0xF4, 0x34, 0x08, 0x23, 0xB2,
+	0xA8, 0x7D, 0xC6, 0x8C, 0x9E, 0x4C, 0xE3, 0x17, 0x4C, 0x1E, 0x6E, 0xFD,
+	0xEE, 0x12, 0xC0, 0x7D};
+static const unsigned char BRAINPOOLP224R1_GY[28] = {
+	0x58, 0xAA, 0x56, 0xF7, 0x72, 0xC0, 0x72, 0x6F, 0x24, 0xC6, 0xB8, 0x9E,
+	0x4E, 0xCD, 0xAC, 0x24, 0x35, 0x4B, 0x9E, 0x99, 0xCA, 0xA3, 0xF6, 0xD3,
+	0x76, 0x14, 0x02, 0xCD};
+static const unsigned char BRAINPOOLP224R1_N[28] = {
+	0xD7, 0xC1, 0x34, 0xAA, 0x26, 0x43, 0x66, 0x86, 0x2A, 0x18, 0x30, 0x25,
+	0x75, 0xD0, 0xFB, 0x98, 0xD1, 0x16, 0xBC, 0x4B, 0x6D, 0xDE, 0xBC, 0xA3,
+	0xA5, 0xA7, 0x93, 0x9F};
+
+// NIST P-256 (standardized domain parameter ID 12)
+static const unsigned char SECP256R1_P[32] = {
+	0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+static const unsigned char SECP256R1_A[32] = {
+	0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFC};
+static const unsigned char SECP256R1_B[32] = {
+	0x5A, 0xC6, 0x35, 0xD8, 0xAA, 0x3A, 0x93, 0xE7, 0xB3, 0xEB, 0xBD, 0x55,
+	0x76, 0x98, 0x86, 0xBC, 0x65, 0x1D, 0x06, 0xB0, 0xCC, 0x53, 0xB0, 0xF6,
+	0x3B, 0xCE, 0x3C, 0x3E, 0x27, 0xD2, 0x60, 0x4B};
+static const unsigned char SECP256R1_GX[32] = {
+	0x6B, 0x17, 0xD1, 0xF2, 0xE1, 0x2C, 0x42, 0x47, 0xF8, 0xBC, 0xE6, 0xE5,
+	0x63, 0xA4, 0x40, 0xF2, 0x77, 0x03, 0x7D, 0x81, 0x2D, 0xEB, 0x33, 0xA0,
+	0xF4, 0xA1, 0x39, 0x45, 0xD8, 0x98, 0xC2, 0x96};
+static const unsigned char SECP256R1_GY[32] = {
+	0x4F, 0xE3, 0x42, 0xE2, 0xFE, 0x1A, 0x7F, 0x9B, 0x8E, 0xE7, 0xEB, 0x4A,
+	0x7C, 0x0F, 0x9E, 0x16, 0x2B, 0xCE, 0x33, 0x57, 0x6B, 0x31, 0x5E, 0xCE,
+	0xCB, 0xB6, 0x40, 0x68, 0x37, 0xBF, 0x51, 0xF5};
+static const unsigned char SECP256R1_N[32] = {
+	0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xBC, 0xE6, 0xFA, 0xAD, 0xA7, 0x17, 0x9E, 0x84,
+	0xF3, 0xB9, 0xCA, 0xC2, 0xFC, 0x63, 0x25, 0x51};
+
+// BrainpoolP256r1 (standardized domain parameter ID 13)
+static const unsigned char BRAINPOOLP256R1_P[32] = {
+	0xA9, 0xFB, 0x57, 0xDB, 0xA1, 0xEE, 0xA9, 0xBC, 0x3E, 0x66, 0x0A, 0x90,
+	0x9D, 0x83, 0x8D, 0x72, 0x6E, 0x3B, 0xF6, 0x23, 0xD5, 0x26, 0x20, 0x28,
+	0x20, 0x13, 0x48, 0x1D, 0x1F, 0x6E, 0x53, 0x77};
+static const unsigned char BRAINPOOLP256R1_A[32] = {
+	0x7D, 0x5A, 0x09, 0x75, 0xFC, 0x2C, 0x30, 0x57, 0xEE, 0xF6, 0x75, 0x30,
+	0x41, 0x7A, 0xFF, 0xE7, 0xFB, 0x80, 0x55, 0xC1, 0x26, 0xDC, 0x5C, 0x6C,
+	0xE9, 0x4A, 0x4B, 0x44, 0xF3, 0x30, 0xB5, 0xD9};
+static const unsigned char BRAINPOOLP256R1_B[32] = {
+	0x26, 0xDC, 0x5C, 0x6C, 0xE9, 0x4A, 0x4B, 0x44, 0xF3, 0x30, 0xB5, 0xD9,
+	0xBB, 0xD7, 0x7C, 0xBF, 0x95, 0x84, 0x16, 0x29, 0x5C, 0xF7, 0xE1, 0xCE,
+	0x6B, 0xCC, 0xDC, 0x18, 0xFF, 0x8C, 0x07, 0xB6};
+static const unsigned char BRAINPOOLP256R1_GX[32] = {
+	0x8B, 0xD2, 0xAE, 0xB9, 0xCB, 0x7E, 0x57, 0xCB, 0x2C, 0x4B, 0x48, 0x2F,
+	0xFC, 0x81, 0xB7, 0xAF, 0xB9, 0xDE, 0x27, 0xE1, 0xE3, 0xBD, 0x23, 0xC2,
+	0x3A, 0x44, 0x53, 0xBD, 0x9A, 0xCE, 0x32, 0x62};
+static const unsigned char BRAINPOOLP256R1_GY[32] = {
+	0x54, 0x7E, 0xF8, 0x35, 0xC3, 0xDA, 0xC4, 0xFD, 0x97, 0xF8, 0x46, 0x1A,
+	0x14, 0x61, 0x1D, 0xC9, 0xC2, 0x77, 0x45, 0x13, 0x2D, 0xED, 0x8E, 0x54,
+	0x5C, 0x1D, 0x54, 0xC7, 0x2F, 0x04, 0x69, 0x97};
+static const unsigned char BRAINPOOLP256R1_N[32] = {
+	0xA9, 0xFB, 0x57, 0xDB, 0xA1, 0xEE, 0xA9, 0xBC, 0x3E, 0x66, 0x0A, 0x90,
+	0x9D, 0x83, 0x8D, 0x71, 0x8C, 0x39, 0x7A, 0xA3, 0xB5, 0x61, 0xA6, 0xF7,
+	0x90, 0x1E, 0x0E, 0x82, 0x97, 0x48, 0x56, 0xA7};
+
+// BrainpoolP320r1 (standardized domain parameter ID 14)
+static const unsigned char BRAINPOOLP320R1_P[40] = {
+	0xD3, 0x5E, 0x47, 0x20, 0x36, 0xBC, 0x4F, 0xB7, 0xE1, 0x3C, 0x78, 0x5E,
+	0xD2, 0x01, 0xE0, 0x65, 0xF9, 0x8F, 0xCF, 0xA6, 0xF6, 0xF4, 0x0D, 0xEF,
+	0x4F, 0x92, 0xB9, 0xEC, 0x78, 0x93, 0xEC, 0x28, 0xFC, 0xD4, 0x12, 0xB1,
+	0xF1, 0xB3, 0x2E, 0x27};
+static const unsigned char BRAINPOOLP320R1_A[40] = {
+	0x3E, 0xE3, 0x0B, 0x56, 0x8F, 0xBA, 0xB0, 0xF8, 0x83, 0xCC, 0xEB, 0xD4,
+	0x6D, 0x3F, 0x3B, 0xB8, 0xA2, 0xA7, 0x35, 0x13, 0xF5, 0xEB, 0x79, 0xDA,
+	0x66, 0x19, 0x0E, 0xB0, 0x85, 0xFF, 0xA9, 0xF4, 0x92, 0xF3, 0x75, 0xA9,
+	0x7D, 0x86, 0x0E, 0xB4};
+static const unsigned char BRAINPOOLP320R1_B[40] = {
+	0x52, 0x08, 0x83, 0x94, 0x9D, 0xFD, 0xBC, 0x42, 0xD3, 0xAD, 0x19, 0x86,
+	0x40, 0x68, 0x8A, 0x6F, 0xE1, 0x3F, 0x41, 0x34, 0x95, 0x54, 0xB4, 0x9A,
+	0xCC, 0x31, 0xDC, 0xCD, 0x88, 0x45, 0x39, 0x81, 0x6F, 0x5E, 0xB4, 0xAC,
+	0x8F, 0xB1, 0xF1, 0xA6};
+static const unsigned char BRAINPOOLP320R1_GX[40] = {
+	0x43, 0xBD, 0x7E, 0x9A, 0xFB, 0x53, 0xD8, 0xB8, 0x52, 0x89, 0xBC, 0xC4,
+	0x8E, 0xE5, 0xBF, 0xE6, 0xF2, 0x01, 0x37, 0xD1, 0x0A, 0x08, 0x7E, 0xB6,
+	0xE7, 0x87, 0x1E, 0x2A, 0x10, 0xA5, 0x99, 0xC7, 0x10, 0xAF, 0x8D, 0x0D,
+	0x39, 0xE2, 0x06, 0x11};
+static const unsigned char BRAINPOOLP320R1_GY[40] = {
+	0x14, 0xFD, 0xD0, 0x55, 0x45, 0xEC, 0x1C, 0xC8, 0xAB, 0x40, 0x93, 0x24,
+	0x7F, 0x77, 0x27, 0x5E, 0x07, 0x43, 0xFF, 0xED, 0x11, 0x71, 0x82, 0xEA,
+	0xA9, 0xC7, 0x78, 0x77, 0xAA, 0xAC, 0x6A, 0xC7, 0xD3, 0x52, 0x45, 0xD1,
+	0x69, 0x2E, 0x8E, 0xE1};
+static const unsigned char BRAINPOOLP320R1_N[40] = {
+	0xD3, 0x5E, 0x47, 0x20, 0x36, 0xBC, 0x4F, 0xB7, 0xE1, 0x3C, 0x78, 0x5E,
+	0xD2, 0x01, 0xE0, 0x65, 0xF9, 0x8F, 0xCF, 0xA5, 0xB6, 0x8F, 0x12, 0xA3,
+	0x2D, 0x48, 0x2E, 0xC7, 0xEE, 0x86, 0x58, 0xE9, 0x86, 0x91, 0x55, 0x5B,
+	0x44, 0xC5, 0x93, 0x11};
+
+// NIST P-384 (standardized domain parameter ID 15)
+static const unsigned char SECP384R1_P[48] = {
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFE, 0xFF, 0xFF, 0xFF, 0xFF,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF};
+static const unsigned char SECP384R1_A[48] = {
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFE, 0xFF, 0xFF, 0xFF, 0xFF,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFC};
+static const unsigned char SECP384R1_B[48] = {
+	0xB3, 0x31, 0x2F, 0xA7, 0xE2, 0x3E, 0xE7, 0xE4, 0x98, 0x8E, 0x05, 0x6B,
+	0xE3, 0xF8, 0x2D, 0x19, 0x18, 0x1D, 0x9C, 0x6E, 0xFE, 0x81, 0x41, 0x12,
+	0x03, 0x14, 0x08, 0x8F, 0x50, 0x13, 0x87, 0x5A, 0xC6, 0x56, 0x39, 0x8D,
+	0x8A, 0x2E, 0xD1, 0x9D, 0x2A, 0x85, 0xC8, 0xED, 0xD3, 0xEC, 0x2A, 0xEF};
+static const unsigned char SECP384R1_GX[48] = {
+	0xAA, 0x87, 0xCA, 0x22, 0xBE, 0x8B, 0x05, 0x37, 0x8E, 0xB1, 0xC7, 0x1E,
+	0xF3, 0x20, 0xAD, 0x74, 0x6E, 0x1D, 0x3B, 0x62, 0x8B, 0xA7, 0x9B, 0x98,
+	0x59, 0xF7, 0x41, 0xE0, 0x82, 0x54, 0x2A, 0x38, 0x55, 0x02, 0xF2, 0x5D,
+	0xBF, 0x55, 0x29, 0x6C, 0x3A, 0x54, 0x5E, 0x38, 0x72, 0x76, 0x0A, 0xB7};
+static const unsigned char SECP384R1_GY[48] = {
+	0x36, 0x17, 0xDE, 0x4A, 0x96, 0x26, 0x2C, 0x6F, 0x5D, 0x9E, 0x98, 0xBF,
+	0x92, 0x92, 0xDC, 0x29, 0xF8, 0xF4, 0x1D, 0xBD, 0x28, 0x9A, 0x14, 0x7C,
+	0xE9, 0xDA, 0x31, 0x13, 0xB5, 0xF0, 0xB8, 0xC0, 0x0A, 0x60, 0xB1, 0xCE,
+	0x1D, 0x7E, 0x81, 0x9D, 0x7A, 0x43, 0x1D, 0x7C, 0x90, 0xEA, 0x0E, 0x5F};
+static const unsigned char SECP384R1_N[48] = {
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xC7, 0x63, 0x4D, 0x81, 0xF4, 0x37, 0x2D, 0xDF, 0x58, 0x1A, 0x0D, 0xB2,
+	0x48, 0xB0, 0xA7, 0x7A, 0xEC, 0xEC, 0x19, 0x6A, 0xCC, 0xC5, 0x29, 0x73};
+
+// BrainpoolP384r1 (standardized domain parameter ID 16)
+static const unsigned char BRAINPOOLP384R1_P[48] = {
+	0x8C, 0xB9, 0x1E, 0x82, 0xA3, 0x38, 0x6D, 0x28, 0x0F, 0x5D, 0x6F, 0x7E,
+	0x50, 0xE6, 0x41, 0xDF, 0x15, 0x2F, 0x71, 0x09, 0xED, 0x54, 0x56, 0xB4,
+	0x12, 0xB1, 0xDA, 0x19, 0x7F, 0xB7, 0x11, 0x23, 0xAC, 0xD3, 0xA7, 0x29,
+	0x90, 0x1D, 0x1A, 0x71, 0x87, 0x47, 0x00, 0x13, 0x31, 0x07, 0xEC, 0x53};
+static const unsigned char BRAINPOOLP384R1_A[48] = {
+	0x7B, 0xC3, 0x82, 0xC6, 0x3D, 0x8C, 0x15, 0x0C, 0x3C, 0x72, 0x08, 0x0A,
+	0xCE, 0x05, 0xAF, 0xA0, 0xC2, 0xBE, 0xA2, 0x8E, 0x4F, 0xB2, 0x27, 0x87,
+	0x13, 0x91, 0x65, 0xEF, 0xBA, 0x91, 0xF9, 0x0F, 0x8A, 0xA5, 0x81, 0x4A,
+	0x50, 0x3A, 0xD4, 0xEB, 0x04, 0xA8, 0xC7, 0xDD, 0x22, 0xCE, 0x28, 0x26};
+static const unsigned char BRAINPOOLP384R1_B[48] = {
+	0x04, 0xA8, 0xC7, 0xDD, 0x22, 0xCE, 0x28, 0x26, 0x8B, 0x39, 0xB5, 0x54,
+	0x16, 0xF0, 0x44, 0x7C, 0x2F, 0xB7, 0x7D, 0xE1, 0x07, 0xDC, 0xD2, 0xA6,
+	0x2E, 0x88, 0x0E, 0xA5, 0x3E, 0xEB, 0x62, 0xD5, 0x7C, 0xB4, 0x39, 0x02,
+	0x95, 0xDB, 0xC9, 0x94, 0x3A, 0xB7, 0x86, 0x96, 0xFA, 0x50, 0x4C, 0x11};
+static const unsigned char BRAINPOOLP384R1_GX[48] = {
+	0x1D, 0x1C, 0x64, 0xF0, 0x68, 0xCF, 0x45, 0xFF, 0xA2, 0xA6, 0x3A, 0x81,
+	0xB7, 0xC1, 0x3F, 0x6B, 0x88, 0x47, 0xA3, 0xE7, 0x7E, 0xF1, 0x4F, 0xE3,
+	0xDB, 0x7F, 0xCA, 0xFE, 0x0C, 0xBD, 0x10, 0xE8, 0xE8, 0x26, 0xE0, 0x34,
+	0x36, 0xD6, 0x46, 0xAA, 0xEF, 0x87, 0xB2, 0xE2, 0x47, 0xD4, 0xAF, 0x1E};
+static const unsigned char BRAINPOOLP384R1_GY[48] = {
+	0x8A, 0xBE, 0x1D, 0x75, 0x20, 0xF9, 0xC2, 0xA4, 0x5C, 0xB1, 0xEB, 0x8E,
+	0x95, 0xCF, 0xD5, 0x52, 0x62, 0xB7, 0x0B, 0x29, 0xFE, 0xEC, 0x58, 0x64,
+	0xE1, 0x9C, 0x05, 0x4F, 0xF9, 0x91, 0x29, 0x28, 0x0E, 0x46, 0x46, 0x21,
+	0x77, 0x91, 0x81, 0x11, 0x42, 0x82, 0x03, 0x41, 0x26, 0x3C, 0x53, 0x15};
+static const unsigned char BRAINPOOLP384R1_N[48] = {
+	0x8C, 0xB9, 0x1E, 0x82, 0xA3, 0x38, 0x6D, 0x28, 0x0F, 0x5D, 0x6F, 0x7E,
+	0x50, 0xE6, 0x41, 0xDF, 0x15, 0x2F, 0x71, 0x09, 0xED, 0x54, 0x56, 0xB3,
+	0x1F, 0x16, 0x6E, 0x6C, 0xAC, 0x04, 0x25, 0xA7, 0xCF, 0x3A, 0xB6, 0xAF,
+	0x6B, 0x7F, 0xC3, 0x10, 0x3B, 0x88, 0x32, 0x02, 0xE9, 0x04, 0x65, 0x65};
+
+// BrainpoolP512r1 (standardized domain parameter ID 17)
+static const unsigned char BRAINPOOLP512R1_P[64] = {
+	0xAA, 0xDD, 0x9D, 0xB8, 0xDB, 0xE9, 0xC4, 0x8B, 0x3F, 0xD4, 0xE6, 0xAE,
+	0x33, 0xC9, 0xFC, 0x07, 0xCB, 0x30, 0x8D, 0xB3, 0xB3, 0xC9, 0xD2, 0x0E,
+	0xD6, 0x63, 0x9C, 0xCA, 0x70, 0x33, 0x08, 0x71, 0x7D, 0x4D, 0x9B, 0x00,
+	0x9B, 0xC6, 0x68, 0x42, 0xAE, 0xCD, 0xA1, 0x2A, 0xE6, 0xA3, 0x80, 0xE6,
+	0x28, 0x81, 0xFF, 0x2F, 0x2D, 0x82, 0xC6, 0x85, 0x28, 0xAA, 0x60, 0x56,
+	0x58, 0x3A, 0x48, 0xF3};
+static const unsigned char BRAINPOOLP512R1_A[64] = {
+	0x78, 0x30, 0xA3, 0x31, 0x8B, 0x60, 0x3B, 0x89, 0xE2, 0x32, 0x71, 0x45,
+	0xAC, 0x23, 0x4C, 0xC5, 0x94, 0xCB, 0xDD, 0x8D, 0x3D, 0xF9, 0x16, 0x10,
+	0xA8, 0x34, 0x41, 0xCA, 0xEA, 0x98, 0x63, 0xBC, 0x2D, 0xED, 0x5D, 0x5A,
+	0xA8, 0x25, 0x3A, 0xA1, 0x0A, 0x2E, 0xF1, 0xC9, 0x8B, 0x9A, 0xC8, 0xB5,
+	0x7F, 0x11, 0x17, 0xA7, 0x2B, 0xF2, 0xC7, 0xB9, 0xE7, 0xC1, 0xAC, 0x4D,
+	0x77, 0xFC, 0x94, 0xCA};
+static const unsigned char BRAINPOOLP512R1_B[64] = {
+	0x3D, 0xF9, 0x16, 0x10, 0xA8, 0x34, 0x41, 0xCA, 0xEA, 0x98, 0x63, 0xBC,
+	0x2D, 0xED, 0x5D, 0x5A, 0xA8, 0x25, 0x3A, 0xA1, 0x0A, 0x2E, 0xF1, 0xC9,
+	0x8B, 0x9A, 0xC8, 0xB5, 0x7F, 0x11, 0x17, 0xA7, 0x2B, 0xF2, 0xC7, 0xB9,
+	0xE7, 0xC1, 0xAC, 0x4D, 0x77, 0xFC, 0x94, 0xCA, 0xDC, 0x08, 0x3E, 0x67,
+	0x98, 0x40, 0x50, 0xB7, 0x5E, 0xBA, 0xE5, 0xDD, 0x28, 0x09, 0xBD, 0x63,
+	0x80, 0x16, 0xF7, 0x23};
+static const unsigned char BRAINPOOLP512R1_GX[64] = {
+	0x81, 0xAE, 0xE4, 0xBD, 0xD8, 0x2E, 0xD9, 0x64, 0x5A, 0x21, 0x32, 0x2E,
+	0x9C, 0x4C, 0x6A, 0x93, 0x85, 0xED, 0x9F, 0x70, 0xB5, 0xD9, 0x16, 0xC1,
+	0xB4, 0x3B, 0x62, 0xEE, 0xF4, 0xD0, 0x09, 0x8E, 0xFF, 0x3B, 0x1F, 0x78,
+	0xE2, 0xD0, 0xD4, 0x8D, 0x50, 0xD1, 0x68, 0x7B, 0x93, 0xB9, 0x7D, 0x5F,
+	0x7C, 0x6D, 0x50, 0x47, 0x40, 0x6A, 0x5E, 0x68, 0x8B, 0x35, 0x22, 0x09,
+	0xBC, 0xB9, 0xF8, 0x22};
+static const unsigned char BRAINPOOLP512R1_GY[64] = {
+	0x7D, 0xDE, 0x38, 0x5D, 0x56, 0x63, 0x32, 0xEC, 0xC0, 0xEA, 0xBF, 0xA9,
+	0xCF, 0x78, 0x22, 0xFD, 0xF2, 0x09, 0xF7, 0x00, 0x24, 0xA5, 0x7B, 0x1A,
+	0xA0, 0x00, 0xC5, 0x5B, 0x88, 0x1F, 0x81, 0x11, 0xB2, 0xDC, 0xDE, 0x49,
+	0x4A, 0x5F, 0x48, 0x5E, 0x5B, 0xCA, 0x4B, 0xD8, 0x8A, 0x27, 0x63, 0xAE,
+	0xD1, 0xCA, 0x2B, 0x2F, 0xA8, 0xF0, 0x54, 0x06, 0x78, 0xCD, 0x1E, 0x0F,
+	0x3A, 0xD8, 0x08, 0x92};
+static const unsigned char BRAINPOOLP512R1_N[64] = {
+	0xAA, 0xDD, 0x9D, 0xB8, 0xDB, 0xE9, 0xC4, 0x8B, 0x3F, 0xD4, 0xE6, 0xAE,
+	0x33, 0xC9, 0xFC, 0x07, 0xCB, 0x30, 0x8D, 0xB3, 0xB3, 0xC9, 0xD2, 0x0E,
+	0xD6, 0x63, 0x9C, 0xCA, 0x70, 0x33, 0x08, 0x70, 0x55, 0x3E, 0x5C, 0x41,
+	0x4C, 0xA9, 0x26, 0x19, 0x41, 0x86, 0x61, 0x19, 0x7F, 0xAC, 0x10, 0x47,
+	0x1D, 0xB1, 0xD3, 0x81, 0x08, 0x5D, 0xDA, 0xDD, 0xB5, 0x87, 0x96, 0x82,
+	0x9C, 0xA9, 0x00, 0x69};
+
+// NIST P-521 (standardized domain parameter ID 18)
+static const unsigned char SECP521R1_P[66] = {
+	0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+static const unsigned char SECP521R1_A[66] = {
+	0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFC};
+static const unsigned char SECP521R1_B[66] = {
+	0x00, 0x51, 0x95, 0x3E, 0xB9, 0x61, 0x8E, 0x1C, 0x9A, 0x1F, 0x92, 0x9A,
+	0x21, 0xA0, 0xB6, 0x85, 0x40, 0xEE, 0xA2, 0xDA, 0x72, 0x5B, 0x99, 0xB3,
+	0x15, 0xF3, 0xB8, 0xB4, 0x89, 0x91, 0x8E, 0xF1, 0x09, 0xE1, 0x56, 0x19,
+	0x39, 0x51, 0xEC, 0x7E, 0x93, 0x7B, 0x16, 0x52, 0xC0, 0xBD, 0x3B, 0xB1,
+	0xBF, 0x07, 0x35, 0x73, 0xDF, 0x88, 0x3D, 0x2C, 0x34, 0xF1, 0xEF, 0x45,
+	0x1F, 0xD4, 0x6B, 0x50, 0x3F, 0x00};
+static const unsigned char SECP521R1_GX[66] = {
+	0x00, 0xC6, 0x85, 0x8E, 0x06, 0xB7, 0x04, 0x04, 0xE9, 0xCD, 0x9E, 0x3E,
+	0xCB, 0x66, 0x23, 0x95, 0xB4, 0x42, 0x9C, 0x64, 0x81, 0x39, 0x05, 0x3F,
+	0xB5, 0x21, 0xF8, 0x28, 0xAF, 0x60, 0x6B, 0x4D, 0x3D, 0xBA, 0xA1, 0x4B,
+	0x5E, 0x77, 0xEF, 0xE7, 0x59, 0x28, 0xFE, 0x1D, 0xC1, 0x27, 0xA2, 0xFF,
+	0xA8, 0xDE, 0x33, 0x48, 0xB3, 0xC1, 0x85, 0x6A, 0x42, 0x9B, 0xF9, 0x7E,
+	0x7E, 0x31, 0xC2, 0xE5, 0xBD, 0x66};
+static const unsigned char SECP521R1_GY[66] = {
+	0x01, 0x18, 0x39, 0x29, 0x6A, 0x78, 0x9A, 0x3B, 0xC0, 0x04, 0x5C, 0x8A,
+	0x5F, 0xB4, 0x2C, 0x7D, 0x1B, 0xD9, 0x98, 0xF5, 0x44, 0x49, 0x57, 0x9B,
+	0x44, 0x68, 0x17, 0xAF, 0xBD, 0x17, 0x27, 0x3E, 0x66, 0x2C, 0x97, 0xEE,
+	0x72, 0x99, 0x5E, 0xF4, 0x26, 0x40, 0xC5, 0x50, 0xB9, 0x01, 0x3F, 0xAD,
+	0x07, 0x61, 0x35, 0x3C, 0x70, 0x86, 0xA2, 0x72, 0xC2, 0x40, 0x88, 0xBE,
+	0x94, 0x76, 0x9F, 0xD1, 0x66, 0x50};
+static const unsigned char SECP521R1_N[66] = {
+	0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFA, 0x51, 0x86,
+	0x87, 0x83, 0xBF, 0x2F, 0x96, 0x6B, 0x7F, 0xCC, 0x01, 0x48, 0xF7, 0x09,
+	0xA5, 0xD0, 0x3B, 0xB5, 0xC9, 0xB8, 0x89, 0x9C, 0x47, 0xAE, 0xBB, 0x6F,
+	0xB7, 0x1E, 0x91, 0x38, 0x64, 0x09};
+
+typedef struct {
+	int id;
+	int size;
+	const unsigned char* p;
+	const unsigned char* a;
+	const unsigned char* b;
+	const unsigned char* gx;
+	const unsigned char* gy;
+	const unsigned char* n;
+} ecc_curve_info;
+
+static const ecc_curve_info CURVES[] = {
+	{8, 24, SECP192R1_P, SECP192R1_A, SECP192R1_B, SECP192R1_GX, SECP192R1_GY, SECP192R1_N},
+	{9, 24, BRAINPOOLP192R1_P, BRAINPOOLP192R1_A, BRAINPOOLP192R1_B, BRAINPOOLP192R1_GX,
+	 BRAINPOOLP192R1_GY, BRAINPOOLP192R1_N},
+	{10, 28, SECP224R1_P, SECP224R1_A, SECP224R1_B, SECP224R1_GX, SECP224R1_GY, SECP224R1_N},
+	{11, 28, BRAINPOOLP224R1_P, BRAINPOOLP224R1_A, BRAINPOOLP224R1_B, BRAINPOOLP224R1_GX,
+	 BRAINPOOLP224R1_GY, BRAINPOOLP224R1_N},
+	{12, 32, SECP256R1_P, SECP256R1_A, SECP256R1_B, SECP256R1_GX, SECP256R1_GY, SECP256R1_N},
+	{13, 32, BRAINPOOLP256R1_P, BRAINPOOLP256R1_A, BRAINPOOLP256R1_B, BRAINPOOLP256R1_GX,
+	 BRAINPOOLP256R1_GY, BRAINPOOLP256R1_N},
+	{14, 40, BRAINPOOLP320R1_P, BRAINPOOLP320R1_A, BRAINPOOLP320R1_B, BRAINPOOLP320R1_GX,
+	 BRAINPOOLP320R1_GY, BRAINPOOLP320R1_N},
+	{15, 48, SECP384R1_P, SECP384R1_A, SECP384R1_B, SECP384R1_GX, SECP384R1_GY, SECP384R1_N},
+	{16, 48, BRAINPOOLP384R1_P, BRAINPOOLP384R1_A, BRAINPOOLP384R1_B, BRAINPOOLP384R1_GX,
+	 BRAINPOOLP384R1_GY, BRAINPOOLP384R1_N},
+	{17, 64, BRAINPOOLP512R1_P, BRAINPOOLP512R1_A, BRAINPOOLP512R1_B, BRAINPOOLP512R1_GX,
+	 BRAINPOOLP512R1_GY, BRAINPOOLP512R1_N},
+	{18, 66, SECP521R1_P, SECP521R1_A, SECP521R1_B, SECP521R1_GX, SECP521R1_GY, SECP521R1_N}};
+
+#define CURVE_COUNT ((int)(sizeof(CURVES) / sizeof(CURVES[0])))
+
+// Shared groups of the standardized curves, initialized on first use under groupsLock, the EF.SOD
+// worker and the reading threads may ask for the same curve at once
+static ecc_group groups[CURVE_COUNT];
+static int groupsReady[CURVE_COUNT];
+static SyncLock groupsLock = SYNC_INIT;
+
+#define FMUL(r, x, y) mont_mul(&grp->field, r, x, y)
+#define FADD(r, x, y) mont_add(&grp->field, r, x, y)
+#define FSUB(r, x, y) mont_sub(&grp->field, r, x, y)
+
+static int ScalarBit(const unsigned int* k, int n, int i) {
+	if (i >= 32 * n) {
+		return 0;
+	}
+	return (k[i / 32] >> (i % 32)) & 1;
+}
+
+// Length of a big-endian byte string without leading zeros
+static int SignificantLength(const unsigned char* buf, int len) {
+	while (len > 0 && buf[0] == 0) {
+		buf++;
+		len--;
+	}
+	return len;
+}
+
+static void PointCopy(const ecc_group* grp, ecc_point* r, const ecc_point* p) {
+	int n = grp->field.n;
+	memcpy(r->x, p->x, n * sizeof(unsigned int));
+	memcpy(r->y, p->y, n * sizeof(unsigned int));
+	memcpy(r->z, p->z, n * sizeof(unsigned int));
+}
+
+static void PointSelect(const ecc_group* grp,
+						ecc_point* r,
+						const ecc_point* p,
+						const ecc_point* q,
+						unsigned int cond) {
+	int n = grp->field.n;
+	bn_select(r->x, p->x, q->x, n, cond);
+	bn_select(r->y, p->y, q->y, n, cond);
+	bn_select(r->z, p->z, q->z, n, cond);
+}
+
+static void PointSwap(const ecc_group* grp, ecc_point* p, ecc_point* q, unsigned int cond) {
+	ecc_point t;
+	PointSelect(grp, &t, q, p, cond);
+	PointSelect(grp, q, p, q, cond);
+	PointCopy(grp, p, &t);
+}
+
+// R = 2P
+static void PointDouble(const ecc_group* grp, ecc_point* r, const ecc_point* p) {
+	unsigned int t1[ECC_MAX_LIMBS], t2[ECC_MAX_LIMBS], t3[ECC_MAX_LIMBS], t4[ECC_MAX_LIMBS];
+	unsigned int m[ECC_MAX_LIMBS], s[ECC_MAX_LIMBS], x3[ECC_MAX_LIMBS], y3[ECC_MAX_LIMBS],
+		z3[ECC_MAX_LIMBS];
+
+	if (grp->aIsMinusThree) {
+		// dbl-2001-b: M = 3 (X - Z^2)(X + Z^2), S = 4 X Y^2
+		FMUL(t1, p->z, p->z);  // delta
+		FMUL(t2, p->y, p->y);  // gamma
+		FMUL(s, p->x, t2);	   // beta
+		FSUB(t3, p->x, t1);
+		FADD(t4, p->x, t1);
+		FMUL(m, t3, t4);
+		FADD(t3, m, m);
+		FADD(m, t3, m);	 // alpha
+
+		// Z3 = (Y + Z)^2 - gamma - delta
+		FADD(z3, p->y, p->z);
+		FMUL(z3, z3, z3);
+		FSUB(z3, z3, t2);
+		FSUB(z3, z3, t1);
+
+		// X3 = alpha^2 - 8 beta
+		FADD(s, s, s);
+		FADD(s, s, s);	// 4 beta
+		FMUL(x3, m, m);
+		FSUB(x3, x3, s);
+		FSUB(x3, x3, s);
+
+		// Y3 = alpha (4 beta - X3) - 8 gamma^2
+		FSUB(y3, s, x3);
+		FMUL(y3, m, y3);
+		FMUL(t2, t2, t2);
+		FADD(t2, t2, t2);
+		FADD(t2, t2, t2);
+		FADD(t2, t2, t2);
+		FSUB(y3, y3, t2);
+	} else {
+		// dbl-2007-bl
+		FMUL(t1, p->x, p->x);  // XX
+		FMUL(t2, p->y, p->y);  // YY
+		FMUL(t3, t2, t2);	   // YYYY
+		FMUL(t4, p->z, p->z);  // ZZ
+
+		// S = 2 ((X + YY)^2 - XX - YYYY)
+		FADD(s, p->x, t2);
+		FMUL(s, s, s);
+		FSUB(s, s, t1);
+		FSUB(s, s, t3);
+		FADD(s, s, s);
+
+		// M = 3 XX + a ZZ^2
+		FADD(m, t1, t1);
+		FADD(m, m, t1);
+		FMUL(t1, t4, t4);
+		FMUL(t1, t1, grp->a);
+		FADD(m, m, t1);
+
+		// X3 = M^2 - 2 S
+		FMUL(x3, m, m);
+		FSUB(x3, x3, s);
+		FSUB(x3, x3, s);
+
+		// Z3 = (Y + Z)^2 - YY - ZZ
+		FADD(z3, p->y, p->z);
+		FMUL(z3, z3, z3);
+		FSUB(z3, z3, t2);
+		FSUB(z3, z3, t4);
+
+		// Y3 = M (S - X3) - 8 YYYY
+		FSUB(y3, s, x3);
+		FMUL(y3, m, y3);
+		FADD(t3, t3, t3);
+		FADD(t3, t3, t3);
+		FADD(t3, t3, t3);
+		FSUB(y3, y3, t3);
+	}
+
+	int n = grp->field.n;
+	memcpy(r->x, x3, n * sizeof(unsigned int));
+	memcpy(r->y, y3, n * sizeof(unsigned int));
+	memcpy(r->z, z3, n * sizeof(unsigned int));
+}
+
+// R = P + Q (add-2007-bl), handles the point at infinity and P = Q
+static void PointAdd(const ecc_group* grp, ecc_point* r, const ecc_point* p, const ecc_point* q) {
+	int n = grp->field.n;
+	unsigned int z1z1[ECC_MAX_LIMBS], z2z2[ECC_MAX_LIMBS], u1[ECC_MAX_LIMBS], u2[ECC_MAX_LIMBS];
+	unsigned int s1[ECC_MAX_LIMBS], s2[ECC_MAX_LIMBS], h[ECC_MAX_LIMBS], i[ECC_MAX_LIMBS];
+	unsigned int j[ECC_MAX_LIMBS], rr[ECC_MAX_LIMBS], v[ECC_MAX_LIMBS];
+	ecc_point sum;
+
+	FMUL(z1z1, p->z, p->z);
+	FMUL(z2z2, q->z, q->z);
+	FMUL(u1, p->x, z2z2);
+	FMUL(u2, q->x, z1z1);
+	FMUL(s1, p->y, q->z);
+	FMUL(s1, s1, z2z2);
+	FMUL(s2, q->y, p->z);
+	FMUL(s2, s2, z1z1);
+	FSUB(h, u2, u1);
+	FSUB(rr, s2, s1);
+
+	unsigned int pInfinity = bn_is_zero(p->z, n);
+	unsigned int qInfinity = bn_is_zero(q->z, n);
+	if (!pInfinity && !qInfinity && bn_is_zero(h, n) && bn_is_zero(rr, n)) {
+		PointDouble(grp, r, p);
+		return;
+	}
+
+	FADD(i, h, h);
+	FMUL(i, i, i);	// I = (2H)^2
+	FMUL(j, h, i);	// J = H I
+	FADD(rr, rr, rr);
+	FMUL(v, u1, i);
+
+	// X3 = r^2 - J - 2 V
+	FMUL(sum.x, rr, rr);
+	FSUB(sum.x, sum.x, j);
+	FSUB(sum.x, sum.x, v);
+	FSUB(sum.x, sum.x, v);
+
+	// Y3 = r (V - X3) - 2 S1 J
+	FSUB(sum.y, v, sum.x);
+	FMUL(sum.y, rr, sum.y);
+	FMUL(s1, s1, j);
+	FSUB(sum.y, sum.y, s1);
+	FSUB(sum.y, sum.y, s1);
+
+	// Z3 = ((Z1 + Z2)^2 - Z1Z1 - Z2Z2) H
+	FADD(sum.z, p->z, q->z);
+	FMUL(sum.z, sum.z, sum.z);
+	FSUB(sum.z, sum.z, z1z1);
+	FSUB(sum.z, sum.z, z2z2);
+	FMUL(sum.z, sum.z, h);
+
+	PointSelect(grp, &sum, q, &sum, pInfinity);
+	PointSelect(grp, r, p, &sum, qInfinity);
+}
+
+// R = P + (x, y) with an affine second operand (madd-2007-bl)
+static void PointAddMixed(const ecc_group* grp,
+						  ecc_point* r,
+						  const ecc_point* p,
+						  const unsigned int* x,
+						  const unsigned int* y) {
+	int n = grp->field.n;
+	unsigned int z1z1[ECC_MAX_LIMBS], u2[ECC_MAX_LIMBS], s2[ECC_MAX_LIMBS], h[ECC_MAX_LIMBS];
+	unsigned int hh[ECC_MAX_LIMBS], i[ECC_MAX_LIMBS], j[ECC_MAX_LIMBS], rr[ECC_MAX_LIMBS],
+		v[ECC_MAX_LIMBS];
+	ecc_point sum, affine;
+
+	FMUL(z1z1, p->z, p->z);
+	FMUL(u2, x, z1z1);
+	FMUL(s2, y, p->z);
+	FMUL(s2, s2, z1z1);
+	FSUB(h, u2, p->x);
+	FSUB(rr, s2, p->y);
+
+	memcpy(affine.x, x, n * sizeof(unsigned int));
+	memcpy(affine.y, y, n * sizeof(unsigned int));
+	memcpy(affine.z, grp->field.one, n * sizeof(unsigned int));
+
+	unsigned int pInfinity = bn_is_zero(p->z, n);
+	if (!pInfinity && bn_is_zero(h, n) && bn_is_zero(rr, n)) {
+		PointDouble(grp, r, &affine);
+		return;
+	}
+
+	FMUL(hh, h, h);
+	FADD(i, hh, hh);
+	FADD(i, i, i);	// I = 4 HH
+	FMUL(j, h, i);
+	FADD(rr, rr, rr);
+	FMUL(v, p->x, i);
+
+	// X3 = r^2 - J - 2 V
+	FMUL(sum.x, rr, rr);
+	FSUB(sum.x, sum.x, j);
+	FSUB(sum.x, sum.x, v);
+	FSUB(sum.x, sum.x, v);
+
+	// Y3 = r (V - X3) - 2 Y1 J
+	FSUB(sum.y, v, sum.x);
+	FMUL(sum.y, rr, sum.y);
+	FMUL(j, p->y, j);
+	FSUB(sum.y, sum.y, j);
+	FSUB(sum.y, sum.y, j);
+
+	// Z3 = (Z1 + H)^2 - Z1Z1 - HH
+	FADD(sum.z, p->z, h);
+	FMUL(sum.z, sum.z, sum.z);
+	FSUB(sum.z, sum.z, z1z1);
+	FSUB(sum.z, sum.z, hh);
+
+	PointSelect(grp, r, &affine, &sum, pInfinity);
+}
+
+// Affine coordinates (still in Montgomery form) of a finite point
+static void PointToAffine(const ecc_group* grp,
+						  const ecc_point* p,
+						  unsigned int* x,
+						  unsigned int* y) {
+	unsigned int zInv[ECC_MAX_LIMBS], zInv2[ECC_MAX_LIMBS];
+	mont_inv(&grp->field, zInv, p->z);
+	FMUL(zInv2, zInv, zInv);
+	FMUL(x, p->x, zInv2);
+	if (y != NULL) {
+		FMUL(zInv2, zInv2, zInv);
+		FMUL(y, p->y, zInv2);
+	}
+}
+
+// Check y^2 = x^3 + a x + b for affine coordinates in Montgomery form
+static int IsOnCurve(const ecc_group* grp, const unsigned int* x, const unsigned int* y) {
+	unsigned int lhs[ECC_MAX_LIMBS], rhs[ECC_MAX_LIMBS], t[ECC_MAX_LIMBS];
+	FMUL(lhs, y, y);
+	FMUL(rhs, x, x);
+	FADD(rhs, rhs, grp->a);
+	FMUL(rhs, rhs, x);
+	FADD(rhs, rhs, grp->b);
+	bn_sub(t, lhs, rhs, grp->field.n);
+	return bn_is_zero(t, grp->field.n);
+}
+
+// Reduce a big-endian scalar modulo the group order
+static int ScalarRead(const ecc_group* grp, unsigned int* k, const unsigned char* buf, int len) {
+	unsigned int wide[2 * ECC_MAX_LIMBS];
+	if (len > (int)sizeof(wide)) {
+		return ECC_BAD_INPUT;
+	}
+	bn_read_binary(wide, 2 * ECC_MAX_LIMBS, buf, len);
+	bn_mod(k, wide, (len + 3) / 4, grp->order.m, grp->order.n);
+	return 0;
+}
+
+// Comb table: comb[i] = sum of 2^(j * d) G over the bits j set in i, with d = ceil(t / w)
+static void CombBuild(ecc_group* grp) {
+	int d = (grp->orderBits + ECC_COMB_WIDTH - 1) / ECC_COMB_WIDTH;
+	ecc_point base[ECC_COMB_WIDTH];
+	ecc_point table[ECC_COMB_POINTS];
+
+	PointCopy(grp, &base[0], &grp->g);
+	for (int j = 1; j < ECC_COMB_WIDTH; j++) {
+		PointCopy(grp, &base[j], &base[j - 1]);
+		for (int i = 0; i < d; i++) {
+			PointDouble(grp, &base[j], &base[j]);
+		}
+	}
+
+	for (int i = 1; i < ECC_COMB_POINTS; i++) {
+		int top = ECC_COMB_WIDTH - 1;
+		while (!((i >> top) & 1)) {
+			top--;
+		}
+		if (i == (1 << top)) {
+			PointCopy(grp, &table[i], &base[top]);
+		} else {
+			PointAdd(grp, &table[i], &table[i ^ (1 << top)], &base[top]);
+		}
+		PointToAffine(grp, &table[i], grp->comb[i][0], grp->comb[i][1]);
+	}
+	memset(grp->comb[0], 0, sizeof(grp->comb[0]));
+	grp->combReady = 1;
+}
+
+static int GroupInit(ecc_group* grp,
+					 int id,
+					 const unsigned char* p,
+					 int pLen,
+					 const unsigned char* a,
+					 int aLen,
+					 const unsigned char* b,
+					 int bLen,
+					 const unsigned char* gx,
+					 const unsigned char* gy,
+					 int gLen,
+					 const unsigned char* order,
+					 int orderLen) {
+	unsigned int t[ECC_MAX_LIMBS];
+
+	memset(grp, 0, sizeof(ecc_group));
+	grp->id				 = id;
+	grp->byteLength		 = SignificantLength(p, pLen);
+	grp->orderByteLength = SignificantLength(order, orderLen);
+
+	int n  = (grp->byteLength + 3) / 4;
+	int nn = (grp->orderByteLength + 3) / 4;
+	if (n > ECC_MAX_LIMBS || nn > ECC_MAX_LIMBS || n == 0 || nn == 0 || gLen > grp->byteLength) {
+		return ECC_BAD_INPUT;
+	}
+
+	if (bn_read_binary(t, n, p, pLen) != 0 || mont_init(&grp->field, t, n) != 0) {
+		return ECC_BAD_INPUT;
+	}
+	if (bn_read_binary(t, nn, order, orderLen) != 0 || mont_init(&grp->order, t, nn) != 0) {
+		return ECC_BAD_INPUT;
+	}
+	grp->orderBits = bn_bitlen(grp->order.m, nn);
+
+	// Coefficients and generator must be reduced field elements
+	const unsigned char* values[4] = {a, b, gx, gy};
+	int lengths[4]				   = {aLen, bLen, gLen, gLen};
+	unsigned int* targets[4]	   = {grp->a, grp->b, grp->g.x, grp->g.y};
+	for (int i = 0; i < 4; i++) {
+		if (bn_read_binary(t, n, values[i], lengths[i]) != 0 ||
+			bn_cmp(t, grp->field.m, n) >= 0) {
+			return ECC_BAD_INPUT;
+		}
+		mont_to(&grp->field, targets[i], t);
+	}
+	memcpy(grp->g.z, grp->field.one, n * sizeof(unsigned int));
+
+	// a = p - 3 enables the faster doubling formula
+	unsigned int three[ECC_MAX_LIMBS] = {3};
+	bn_read_binary(t, n, a, aLen);
+	bn_add(t, t, three, n);
+	grp->aIsMinusThree = bn_cmp(t, grp->field.m, n) == 0;
+
+	if (!IsOnCurve(grp, grp->g.x, grp->g.y)) {
+		return ECC_NOT_ON_CURVE;
+	}
+	return 0;
+}
+
+const ecc_group* ecc_group_get(int id) {
+	for (int i = 0; i < CURVE_COUNT; i++) {
+		if (CURVES[i].id != id) {
+			continue;
+		}
+		SyncLockShared(&groupsLock);
+		int ready = groupsReady[i];
+		SyncUnlockShared(&groupsLock);
+		if (ready) {
+			return &groups[i];
+		}
+
+		// Built once, a thread that lost the race finds the table complete
+		SyncLockExclusive(&groupsLock);
+		if (!groupsReady[i]) {
+			const ecc_curve_info* c = &CURVES[i];
+			if (GroupInit(&groups[i], c->id, c->p, c->size, c->a, c->size, c->b, c->size, c->gx,
+						  c->gy, c->size, c->n, c->size) == 0) {
+				CombBuild(&groups[i]);
+				groupsReady[i] = 1;
+			}
+		}
+		ready = groupsReady[i];
+		SyncUnlockExclusive(&groupsLock);
+		return ready ? &groups[i] : NULL;
+	}
+	return NULL;
+}
+
+// Compare a big-endian value with a fixed-size table entry, ignoring leading zeros
+static int SameValue(const unsigned char* value, int len, const unsigned char* entry, int size) {
+	int l1 = SignificantLength(value, len);
+	int l2 = SignificantLength(entry, size);
+	return l1 == l2 && memcmp(value + len - l1, entry + size - l2, l1) == 0;
+}
+
+int ecc_group_load(ecc_group* grp,
+				   const unsigned char* p,
+				   int pLen,
+				   const unsigned char* a,
+				   int aLen,
+				   const unsigned char* b,
+				   int bLen,
+				   const unsigned char* g,
+				   int gLen,
+				   const unsigned char* n,
+				   int nLen) {
+	if (gLen < 3 || g[0] != 0x04 || (gLen - 1) % 2 != 0) {
+		return ECC_BAD_INPUT;
+	}
+	int coordinateLength = (gLen - 1) / 2;
+
+	// Reuse the shared group (and its comb table) when the parameters are a standardized curve
+	for (int i = 0; i < CURVE_COUNT; i++) {
+		const ecc_curve_info* c = &CURVES[i];
+		if (SameValue(p, pLen, c->p, c->size) && SameValue(a, aLen, c->a, c->size) &&
+			SameValue(b, bLen, c->b, c->size) && SameValue(n, nLen, c->n, c->size) &&
+			SameValue(&g[1], coordinateLength, c->gx, c->size) &&
+			SameValue(&g[1 + coordinateLength], coordinateLength, c->gy, c->size)) {
+			const ecc_group* shared = ecc_group_get(c->id);
+			if (shared == NULL) {
+				return ECC_BAD_INPUT;
+			}
+			memcpy(grp, shared, sizeof(ecc_group));
+			return 0;
+		}
+	}
+
+	return GroupInit(grp, 0, p, pLen, a, aLen, b, bLen, &g[1], &g[1 + coordinateLength],
+					 coordinateLength, n, nLen);
+}
+
+int ecc_point_read(const ecc_group* grp, ecc_point* pt, const unsigned char* buf, int len) {
+	int n = grp->field.n;
+	unsigned int t[ECC_MAX_LIMBS];
+
+	if (len != 1 + 2 * grp->byteLength || buf[0] != 0x04) {
+		return ECC_BAD_INPUT;
+	}
+
+	bn_read_binary(t, n, &buf[1], grp->byteLength);
+	if (bn_cmp(t, grp->field.m, n) >= 0) {
+		return ECC_BAD_INPUT;
+	}
+	mont_to(&grp->field, pt->x, t);
+
+	bn_read_binary(t, n, &buf[1 + grp->byteLength], grp->byteLength);
+	if (bn_cmp(t, grp->field.m, n) >= 0) {
+		return ECC_BAD_INPUT;
+	}
+	mont_to(&grp->field, pt->y, t);
+	memcpy(pt->z, grp->field.one, n * sizeof(unsigned int));
+
+	if (!IsOnCurve(grp, pt->x, pt->y)) {
+		return ECC_NOT_ON_CURVE;
+	}
+	return 0;
+}
+
+int ecc_point_write(const ecc_group* grp, const ecc_point* pt, unsigned char* buf) {
+	unsigned int x[ECC_MAX_LIMBS], y[ECC_MAX_LIMBS];
+
+	if (ecc_is_infinity(grp, pt)) {
+		return ECC_INFINITY;
+	}
+	PointToAffine(grp, pt, x, y);
+	mont_from(&grp->field, x, x);
+	mont_from(&grp->field, y, y);
+
+	buf[0] = 0x04;
+	bn_write_binary(x, grp->field.n, &buf[1], grp->byteLength);
+	bn_write_binary(y, grp->field.n, &buf[1 + grp->byteLength], grp->byteLength);
+	return 1 + 2 * grp->byteLength;
+}
+
+int ecc_point_x(const ecc_group* grp, const ecc_point* pt, unsigned char* x) {
+	unsigned int t[ECC_MAX_LIMBS];
+
+	if (ecc_is_infinity(grp, pt)) {
+		return ECC_INFINITY;
+	}
+	PointToAffine(grp, pt, t, NULL);
+	mont_from(&grp->field, t, t);
+	bn_write_binary(t, grp->field.n, x, grp->byteLength);
+	return 0;
+}
+
+int ecc_is_infinity(const ecc_group* grp, const ecc_point* pt) {
+	return bn_is_zero(pt->z, grp->field.n);
+}
+
+void ecc_add(const ecc_group* grp, ecc_point* r, const ecc_point* p, const ecc_point* q) {
+	PointAdd(grp, r, p, q);
+}
+
+int ecc_mul(const ecc_group* grp,
+			ecc_point* r,
+			const unsigned char* k,
+			int kLen,
+			const ecc_point* p) {
+	int nn = grp->order.n;
+	unsigned int scalar[ECC_MAX_LIMBS + 1], k1[ECC_MAX_LIMBS + 1], k2[ECC_MAX_LIMBS + 1];
+	unsigned int order[ECC_MAX_LIMBS + 1];
+	ecc_point r0, r1;
+
+	if (ecc_is_infinity(grp, p) || ScalarRead(grp, scalar, k, kLen) != 0) {
+		return ECC_BAD_INPUT;
+	}
+	if (bn_is_zero(scalar, nn)) {
+		memset(r, 0, sizeof(ecc_point));
+		return ECC_INFINITY;
+	}
+
+	// k + n or k + 2n, whichever has exactly t + 1 bits, so the ladder length is fixed
+	scalar[nn] = 0;
+	memcpy(order, grp->order.m, nn * sizeof(unsigned int));
+	order[nn] = 0;
+	bn_add(k1, scalar, order, nn + 1);
+	bn_add(k2, k1, order, nn + 1);
+	bn_select(scalar, k1, k2, nn + 1, (unsigned int)ScalarBit(k1, nn + 1, grp->orderBits));
+
+	PointCopy(grp, &r0, p);
+	PointDouble(grp, &r1, p);
+	for (int i = grp->orderBits - 1; i >= 0; i--) {
+		unsigned int bit = (unsigned int)ScalarBit(scalar, nn + 1, i);
+		PointSwap(grp, &r0, &r1, bit);
+		PointAdd(grp, &r1, &r0, &r1);
+		PointDouble(grp, &r0, &r0);
+		PointSwap(grp, &r0, &r1, bit);
+	}
+	PointCopy(grp, r, &r0);
+	return ecc_is_infinity(grp, r) ? ECC_INFINITY : 0;
+}
+
+int ecc_mul_base(const ecc_group* grp, ecc_point* r, const unsigned char* k, int kLen) {
+	int n  = grp->field.n;
+	int nn = grp->order.n;
+	int d  = (grp->orderBits + ECC_COMB_WIDTH - 1) / ECC_COMB_WIDTH;
+	unsigned int scalar[ECC_MAX_LIMBS], x[ECC_MAX_LIMBS], y[ECC_MAX_LIMBS];
+	ecc_point q, sum;
+
+	if (!grp->combReady) {
+		return ecc_mul(grp, r, k, kLen, &grp->g);
+	}
+	if (ScalarRead(grp, scalar, k, kLen) != 0) {
+		return ECC_BAD_INPUT;
+	}
+
+	memset(&q, 0, sizeof(ecc_point));
+	memset(x, 0, sizeof(x));
+	memset(y, 0, sizeof(y));
+	for (int col = d - 1; col >= 0; col--) {
+		PointDouble(grp, &q, &q);
+
+		unsigned int index = 0;
+		for (int j = 0; j < ECC_COMB_WIDTH; j++) {
+			index |= (unsigned int)ScalarBit(scalar, nn, j * d + col) << j;
+		}
+
+		// Scan the whole table so the memory access pattern does not depend on the scalar
+		for (unsigned int i = 1; i < ECC_COMB_POINTS; i++) {
+			bn_select(x, grp->comb[i][0], x, n, i == index);
+			bn_select(y, grp->comb[i][1], y, n, i == index);
+		}
+		PointAddMixed(grp, &sum, &q, x, y);
+		PointSelect(grp, &q, &sum, &q, index != 0);
+	}
+	PointCopy(grp, r, &q);
+	return ecc_is_infinity(grp, r) ? ECC_INFINITY : 0;
+}
+
+int ecc_gen_private(const ecc_group* grp,
+					unsigned char* d,
+					const unsigned char* random,
+					int randomLen) {
+	int nn = grp->order.n;
+	unsigned int wide[2 * ECC_MAX_LIMBS + 2], orderMinusOne[ECC_MAX_LIMBS], k[ECC_MAX_LIMBS];
+	unsigned int one[ECC_MAX_LIMBS] = {1};
+
+	if (randomLen < grp->orderByteLength + 8 || randomLen > (int)sizeof(wide)) {
+		return ECC_BAD_INPUT;
+	}
+
+	// d = random mod (n - 1) + 1
+	bn_read_binary(wide, 2 * ECC_MAX_LIMBS + 2, random, randomLen);
+	bn_sub(orderMinusOne, grp->order.m, one, nn);
+	bn_mod(k, wide, (randomLen + 3) / 4, orderMinusOne, nn);
+	bn_add(k, k, one, nn);
+	bn_write_binary(k, nn, d, grp->orderByteLength);
+	return 0;
+}
+
+int ecdsa_verify(const ecc_group* grp,
+				 const ecc_point* q,
+				 const unsigned char* hash,
+				 int hashLen,
+				 const unsigned char* r,
+				 const unsigned char* s) {
+	int n	= grp->field.n;
+	int nn	= grp->order.n;
+	int len = grp->orderByteLength;
+	unsigned int sr[ECC_MAX_LIMBS], ss[ECC_MAX_LIMBS], e[ECC_MAX_LIMBS], w[ECC_MAX_LIMBS];
+	unsigned int u1[ECC_MAX_LIMBS], u2[ECC_MAX_LIMBS], t[ECC_MAX_LIMBS];
+	unsigned char u1Bytes[ECC_MAX_BYTES], u2Bytes[ECC_MAX_BYTES], x[ECC_MAX_BYTES];
+	ecc_point p1, p2;
+
+	// 0 < r, s < n
+	if (bn_read_binary(sr, nn, r, len) != 0 || bn_read_binary(ss, nn, s, len) != 0 ||
+		bn_is_zero(sr, nn) || bn_is_zero(ss, nn) || bn_cmp(sr, grp->order.m, nn) >= 0 ||
+		bn_cmp(ss, grp->order.m, nn) >= 0) {
+		return ECC_BAD_SIGNATURE;
+	}
+
+	// e = leftmost orderBits bits of the hash, reduced modulo n
+	int eLen = hashLen < len ? hashLen : len;
+	bn_read_binary(t, nn, hash, eLen);
+	int shift = eLen * 8 - grp->orderBits;
+	if (shift > 0) {
+		for (int i = 0; i < nn; i++) {
+			t[i] = (t[i] >> shift) | (i + 1 < nn ? t[i + 1] << (32 - shift) : 0);
+		}
+	}
+	bn_mod(e, t, nn, grp->order.m, nn);
+
+	// w = s^-1, u1 = e w, u2 = r w (mont_mul with w in Montgomery form gives plain products)
+	mont_to(&grp->order, w, ss);
+	mont_inv(&grp->order, w, w);
+	mont_mul(&grp->order, u1, e, w);
+	mont_mul(&grp->order, u2, sr, w);
+	bn_write_binary(u1, nn, u1Bytes, len);
+	bn_write_binary(u2, nn, u2Bytes, len);
+
+	// R = u1 G + u2 Q, the signature is valid if x(R) mod n = r
+	int ret = ecc_mul_base(grp, &p1, u1Bytes, len);
+	if ((ret != 0 && ret != ECC_INFINITY) || ecc_mul(grp, &p2, u2Bytes, len, q) != 0) {
+		return ECC_BAD_SIGNATURE;
+	}
+	ecc_add(grp, &p1, &p1, &p2);
+	if (ecc_point_x(grp, &p1, x) != 0) {
+		return ECC_BAD_SIGNATURE;
+	}
+	unsigned int xr[ECC_MAX_LIMBS];
+	bn_read_binary(t, n, x, grp->byteLength);
+	bn_mod(xr, t, n, grp->order.m, nn);
+	return bn_cmp(xr, sr, nn) == 0 ? 0 : ECC_BAD_SIGNATURE;
+}
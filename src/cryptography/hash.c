@@ -0,0 +1,81 @@
+/**
+ * @author Khoa Nguyen
+ * @file hash.c
+ * @brief Source file for hashing with an algorithm chosen at runtime.
+ */
+
+#include <cryptography/hash.h>
+
+int hash_length(int algorithm) {
+	switch (algorithm) {
+		case HASH_SHA1:
+			return SHA1_DIGEST_LENGTH;
+		case HASH_SHA224:
+			return SHA224_DIGEST_LENGTH;
+		case HASH_SHA256:
+			return SHA256_DIGEST_LENGTH;
+		case HASH_SHA384:
+			return SHA384_DIGEST_LENGTH;
+		case HASH_SHA512:
+			return SHA512_DIGEST_LENGTH;
+		default:
+			return 0;
+	}
+}
+
+int hash_init(hash_ctx* ctx, int algorithm) {
+	switch (algorithm) {
+		case HASH_SHA1:
+			sha1_init(&ctx->ctx.sha1);
+			break;
+		case HASH_SHA224:
+			sha224_init(&ctx->ctx.sha256);
+			break;
+		case HASH_SHA256:
+			sha256_init(&ctx->ctx.sha256);
+			break;
+		case HASH_SHA384:
+			sha384_init(&ctx->ctx.sha512);
+			break;
+		case HASH_SHA512:
+			sha512_init(&ctx->ctx.sha512);
+			break;
+		default:
+			return HASH_BAD_ALGORITHM;
+	}
+	ctx->algorithm = algorithm;
+	return 0;
+}
+
+void hash_update(hash_ctx* ctx, const unsigned char* input, long long length) {
+	if (ctx->algorithm == HASH_SHA1) {
+		sha1_update(&ctx->ctx.sha1, input, length);
+	} else if (ctx->algorithm <= HASH_SHA256) {
+		sha256_update(&ctx->ctx.sha256, input, length);
+	} else {
+		sha512_update(&ctx->ctx.sha512, input, length);
+	}
+}
+
+void hash_final(hash_ctx* ctx, unsigned char* output) {
+	if (ctx->algorithm == HASH_SHA1) {
+		sha1_final(&ctx->ctx.sha1, output);
+	} else if (ctx->algorithm <= HASH_SHA256) {
+		sha256_final(&ctx->ctx.sha256, output);
+	} else {
+		sha512_final(&ctx->ctx.sha512, output);
+	}
+}
+
+int hash_compute(int algorithm,
+				 const unsigned char* input,
+				 long long length,
+				 unsigned char* output) {
+	hash_ctx ctx;
+
+	if (hash_init(&ctx, algorithm) != 0)
+		return HASH_BAD_ALGORITHM;
+	hash_update(&ctx, input, length);
+	hash_final(&ctx, output);
+	return hash_length(algorithm);
+}
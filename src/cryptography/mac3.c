@@ -12,26 +12,25 @@
 #include <cryptography/des.h>
 
 void des_mac3_checksum(int length, unsigned char buff[8], unsigned char* data, unsigned char* key) {
-	// Separate Key
-	unsigned char key1[8], key2[8];
-	memcpy(key1, key, 8);
-	memcpy(key2, &key[8], 8);
+	des_context ctx1;
+	des3_context ctx3;
+	unsigned char block[8] = {0};
 
-	// Initialize
-	unsigned char blockh[400];
-	des_ecb_encrypt(blockh, data, 8, key1);
-	for (int i = 0; i < 8; i++) {
-		data[i + 8] = data[i + 8] ^ blockh[i];
-	}
+	des_setkey_enc(&ctx1, key);
+	des3_set2key_enc(&ctx3, key);
 
-	// Iteration
-	for (int i = 0; i < length / 8 - 2; i++) {
-		des_ecb_encrypt(&blockh[8 * (i + 1)], &data[8 * (i + 1)], 8, key1);
+	// DES-CBC with K1 over one chaining block, Output Transformation 3 on the last block
+	for (int i = 0; i < length; i += 8) {
 		for (int j = 0; j < 8; j++) {
-			data[8 * (i + 2) + j] = data[8 * (i + 2) + j] ^ blockh[8 * (i + 1) + j];
+			block[j] ^= data[i + j];
+		}
+		if (i + 8 < length) {
+			des_crypt_ecb(&ctx1, block, block);
+		} else {
+			des3_crypt_ecb(&ctx3, block, buff);
 		}
 	}
 
-	// Output Transformation 3
-	des3_cbc_encrypt(buff, &data[length - 8], 8, key, 16, 0);
-}
\ No newline at end of file
+	des_free(&ctx1);
+	des3_free(&ctx3);
+}
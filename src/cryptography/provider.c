@@ -0,0 +1,283 @@
+/**
+ * @author Khoa Nguyen
+ * @file provider.c
+ * @brief Source file for the pluggable cryptography providers.
+ *
+ * The selection is a pointer per primitive, read without the lock by the dispatch functions. A
+ * pointer is written in one store, so a call sees either the old or the new provider.
+ */
+
+#include <string.h>
+
+#include <cryptography/des.h>
+#include <cryptography/des_batch.h>
+#include <cryptography/provider.h>
+#include <cryptography/sha1.h>
+#include <utils/sync.h>
+
+#define CRYPTO_BENCH_LENGTH	 256  // Bytes per call, a secure messaging chunk
+#define CRYPTO_BENCH_MIN_US	 200  // Shortest timing of a primitive
+#define CRYPTO_BENCH_MIN_OPS 16	  // Fewest calls of a timing
+
+static struct {
+	SyncLock lock;
+	volatile int ready;
+	const crypto_provider* providers[CRYPTO_PROVIDER_MAX];
+	int count;
+	long long timing[CRYPTO_PROVIDER_MAX][CRYPTO_PRIMITIVES];  // Nanoseconds per call
+	const crypto_provider* volatile selected[CRYPTO_PRIMITIVES];
+} registry = {.lock = SYNC_INIT};
+
+static int builtin_des_ecb(int mode,
+						   const unsigned char key[8],
+						   const unsigned char input[8],
+						   unsigned char output[8]) {
+	if (mode == CRYPTO_ENCRYPT)
+		des_ecb_encrypt(output, (unsigned char*)input, 8, (unsigned char*)key);
+	else
+		des_ecb_decrypt(output, (unsigned char*)input, 8, (unsigned char*)key);
+	return 0;
+}
+
+static int builtin_sha1(const unsigned char* input, long long length, unsigned char output[20]) {
+	sha1(input, length, output);
+	return 0;
+}
+
+// The DES calls go through the batching engine, which computes them at once for a single session
+static const crypto_provider builtin = {
+	"builtin",
+	CRYPTO_CAP_ALL,
+	builtin_des_ecb,
+	des_batch_cbc,
+	des_batch_mac3,
+	builtin_sha1,
+};
+
+const crypto_provider* crypto_provider_builtin(void) {
+	return &builtin;
+}
+
+// One call of a primitive on the benchmark input
+static int crypto_provider_call(const crypto_provider* provider,
+								int primitive,
+								const unsigned char* input,
+								unsigned char* output) {
+	static const unsigned char key[16] = {0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF,
+										  0xFE, 0xDC, 0xBA, 0x98, 0x76, 0x54, 0x32, 0x10};
+
+	switch (primitive) {
+	case CRYPTO_DES_ECB:
+		return provider->des_ecb(CRYPTO_ENCRYPT, key, input, output);
+	case CRYPTO_DES3_CBC:
+		return provider->des3_cbc(CRYPTO_ENCRYPT, key, input, CRYPTO_BENCH_LENGTH, output);
+	case CRYPTO_MAC3:
+		return provider->mac3(key, input, CRYPTO_BENCH_LENGTH, output);
+	default:
+		return provider->sha1(input, CRYPTO_BENCH_LENGTH, output);
+	}
+}
+
+// Length of the output of crypto_provider_call
+static int crypto_provider_output_length(int primitive) {
+	switch (primitive) {
+	case CRYPTO_DES3_CBC:
+		return CRYPTO_BENCH_LENGTH;
+	case CRYPTO_SHA1:
+		return 20;
+	default:
+		return 8;
+	}
+}
+
+// Nanoseconds per call, -1 if the provider disagrees with the built-in one
+static long long crypto_provider_time(const crypto_provider* provider, int primitive) {
+	unsigned char input[CRYPTO_BENCH_LENGTH];
+	unsigned char expected[CRYPTO_BENCH_LENGTH];
+	unsigned char output[CRYPTO_BENCH_LENGTH];
+	long long start, elapsed, minTicks = CRYPTO_BENCH_MIN_US * SyncTicksPerSecond() / 1000000;
+	int i, ops = 0;
+
+	for (i = 0; i < CRYPTO_BENCH_LENGTH; i++)
+		input[i] = (unsigned char)(i * 7 + 1);
+
+	if (crypto_provider_call(&builtin, primitive, input, expected) != 0 ||
+		crypto_provider_call(provider, primitive, input, output) != 0 ||
+		memcmp(expected, output, crypto_provider_output_length(primitive)) != 0)
+		return -1;
+
+	start = SyncTicks();
+	do {
+		for (i = 0; i < CRYPTO_BENCH_MIN_OPS; i++)
+			crypto_provider_call(provider, primitive, input, output);
+		ops += CRYPTO_BENCH_MIN_OPS;
+		elapsed = SyncTicks() - start;
+	} while (elapsed < minTicks);
+
+	return elapsed * 1000000000 / SyncTicksPerSecond() / ops;
+}
+
+// Called with the lock held
+static void crypto_provider_add(const crypto_provider* provider) {
+	int p;
+
+	for (p = 0; p < CRYPTO_PRIMITIVES; p++)
+		registry.timing[registry.count][p] = -1;
+	registry.providers[registry.count++] = provider;
+}
+
+// Called with the lock held
+static void crypto_provider_benchmark_locked(void) {
+	int i, p;
+	long long best;
+
+	for (p = 0; p < CRYPTO_PRIMITIVES; p++) {
+		best = -1;
+		for (i = 0; i < registry.count; i++) {
+			registry.timing[i][p] = -1;
+			if (!(registry.providers[i]->capabilities & CRYPTO_CAP(p)))
+				continue;
+
+			registry.timing[i][p] = crypto_provider_time(registry.providers[i], p);
+			if (registry.timing[i][p] >= 0 && (best < 0 || registry.timing[i][p] < best)) {
+				best					= registry.timing[i][p];
+				registry.selected[p]	= registry.providers[i];
+			}
+		}
+	}
+}
+
+void crypto_provider_init(void) {
+	const crypto_provider* openssl;
+	int p;
+
+	if (registry.ready)
+		return;
+
+	SyncLockExclusive(&registry.lock);
+	if (!registry.ready) {
+		crypto_provider_add(&builtin);
+		for (p = 0; p < CRYPTO_PRIMITIVES; p++)
+			registry.selected[p] = &builtin;
+
+		openssl = crypto_provider_openssl();
+		if (openssl != NULL)
+			crypto_provider_add(openssl);
+
+		if (registry.count > 1)
+			crypto_provider_benchmark_locked();
+		registry.ready = 1;
+	}
+	SyncUnlockExclusive(&registry.lock);
+}
+
+int crypto_provider_register(const crypto_provider* provider) {
+	int res = CRYPTO_PROVIDER_FULL;
+
+	crypto_provider_init();
+	SyncLockExclusive(&registry.lock);
+	if (registry.count < CRYPTO_PROVIDER_MAX) {
+		crypto_provider_add(provider);
+		res = 0;
+	}
+	SyncUnlockExclusive(&registry.lock);
+	return res;
+}
+
+void crypto_provider_benchmark(void) {
+	crypto_provider_init();
+	SyncLockExclusive(&registry.lock);
+	crypto_provider_benchmark_locked();
+	SyncUnlockExclusive(&registry.lock);
+}
+
+static const crypto_provider* crypto_provider_find(const char* name) {
+	int i;
+
+	for (i = 0; i < registry.count; i++) {
+		if (strcmp(registry.providers[i]->name, name) == 0)
+			return registry.providers[i];
+	}
+	return NULL;
+}
+
+int crypto_provider_select(int primitive, const char* name) {
+	const crypto_provider* provider;
+	unsigned int needed;
+	int p, res = 0;
+
+	if (primitive != CRYPTO_ALL && (primitive < 0 || primitive >= CRYPTO_PRIMITIVES))
+		return CRYPTO_PROVIDER_UNSUPPORTED;
+	needed = primitive == CRYPTO_ALL ? CRYPTO_CAP_ALL : CRYPTO_CAP(primitive);
+
+	crypto_provider_init();
+	SyncLockExclusive(&registry.lock);
+	provider = crypto_provider_find(name);
+	if (provider == NULL) {
+		res = CRYPTO_PROVIDER_NOT_FOUND;
+	} else if ((provider->capabilities & needed) != needed) {
+		res = CRYPTO_PROVIDER_UNSUPPORTED;
+	} else {
+		for (p = 0; p < CRYPTO_PRIMITIVES; p++) {
+			if (needed & CRYPTO_CAP(p))
+				registry.selected[p] = provider;
+		}
+	}
+	SyncUnlockExclusive(&registry.lock);
+	return res;
+}
+
+const char* crypto_provider_selected(int primitive) {
+	if (primitive < 0 || primitive >= CRYPTO_PRIMITIVES)
+		return NULL;
+
+	crypto_provider_init();
+	return registry.selected[primitive]->name;
+}
+
+long long crypto_provider_timing(const char* name, int primitive) {
+	long long timing = -1;
+	int i;
+
+	if (primitive < 0 || primitive >= CRYPTO_PRIMITIVES)
+		return -1;
+
+	crypto_provider_init();
+	SyncLockShared(&registry.lock);
+	for (i = 0; i < registry.count; i++) {
+		if (strcmp(registry.providers[i]->name, name) == 0)
+			timing = registry.timing[i][primitive];
+	}
+	SyncUnlockShared(&registry.lock);
+	return timing;
+}
+
+int crypto_des_ecb(int mode,
+				   const unsigned char key[8],
+				   const unsigned char input[8],
+				   unsigned char output[8]) {
+	crypto_provider_init();
+	return registry.selected[CRYPTO_DES_ECB]->des_ecb(mode, key, input, output);
+}
+
+int crypto_des3_cbc(int mode,
+					const unsigned char key[16],
+					const unsigned char* input,
+					int length,
+					unsigned char* output) {
+	crypto_provider_init();
+	return registry.selected[CRYPTO_DES3_CBC]->des3_cbc(mode, key, input, length, output);
+}
+
+int crypto_mac3(const unsigned char key[16],
+				const unsigned char* data,
+				int length,
+				unsigned char mac[8]) {
+	crypto_provider_init();
+	return registry.selected[CRYPTO_MAC3]->mac3(key, data, length, mac);
+}
+
+int crypto_sha1(const unsigned char* input, long long length, unsigned char output[20]) {
+	crypto_provider_init();
+	return registry.selected[CRYPTO_SHA1]->sha1(input, length, output);
+}
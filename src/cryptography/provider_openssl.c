@@ -0,0 +1,130 @@
+/**
+ * @author Khoa Nguyen
+ * @file provider_openssl.c
+ * @brief Source file for the OpenSSL libcrypto provider.
+ *
+ * Single DES is only in the legacy provider of OpenSSL 3, so it is computed as 3DES-EDE2 with the
+ * key K || K, which is DES with K. The headers of OpenSSL include stdint.h, which conflicts with
+ * the typedefs of des.h, so this file only includes provider.h.
+ */
+
+#include <string.h>
+
+#include "config.h"
+
+#include <cryptography/provider.h>
+
+#if USE_OPENSSL
+#include <openssl/evp.h>
+
+// ECB or CBC with a zero IV of whole blocks
+static int openssl_crypt(const EVP_CIPHER* cipher,
+						 int mode,
+						 const unsigned char key[16],
+						 const unsigned char* input,
+						 int length,
+						 unsigned char* output) {
+	static const unsigned char iv[8] = {0};
+	EVP_CIPHER_CTX* ctx;
+	int outLength, res = CRYPTO_PROVIDER_FAILED;
+
+	if (length % 8)
+		return CRYPTO_PROVIDER_INPUT_LENGTH;
+
+	ctx = EVP_CIPHER_CTX_new();
+	if (ctx == NULL)
+		return CRYPTO_PROVIDER_FAILED;
+
+	if (EVP_CipherInit_ex(ctx, cipher, NULL, key, iv, mode == CRYPTO_ENCRYPT) == 1 &&
+		EVP_CIPHER_CTX_set_padding(ctx, 0) == 1 &&
+		EVP_CipherUpdate(ctx, output, &outLength, input, length) == 1) {
+		res = 0;
+	}
+
+	EVP_CIPHER_CTX_free(ctx);
+	return res;
+}
+
+static int openssl_des_ecb(int mode,
+						   const unsigned char key[8],
+						   const unsigned char input[8],
+						   unsigned char output[8]) {
+	unsigned char key2[16];
+
+	memcpy(key2, key, 8);
+	memcpy(&key2[8], key, 8);
+	return openssl_crypt(EVP_des_ede_ecb(), mode, key2, input, 8, output);
+}
+
+static int openssl_des3_cbc(int mode,
+							const unsigned char key[16],
+							const unsigned char* input,
+							int length,
+							unsigned char* output) {
+	return openssl_crypt(EVP_des_ede_cbc(), mode, key, input, length, output);
+}
+
+static int openssl_mac3(const unsigned char key[16],
+						const unsigned char* data,
+						int length,
+						unsigned char mac[8]) {
+	static const unsigned char iv[8] = {0};
+	unsigned char key1[16], block[8];
+	EVP_CIPHER_CTX* ctx;
+	int i, outLength, res = CRYPTO_PROVIDER_FAILED;
+
+	if (length <= 0 || length % 8)
+		return CRYPTO_PROVIDER_INPUT_LENGTH;
+
+	ctx = EVP_CIPHER_CTX_new();
+	if (ctx == NULL)
+		return CRYPTO_PROVIDER_FAILED;
+
+	// DES-CBC with K1 keeps the last block as the chaining value, 3DES-EDE2 of the last block
+	memcpy(key1, key, 8);
+	memcpy(&key1[8], key, 8);
+	memset(block, 0, 8);
+	if (EVP_EncryptInit_ex(ctx, EVP_des_ede_cbc(), NULL, key1, iv) != 1 ||
+		EVP_CIPHER_CTX_set_padding(ctx, 0) != 1)
+		goto end;
+	for (i = 0; i + 8 < length; i += 8) {
+		if (EVP_EncryptUpdate(ctx, block, &outLength, &data[i], 8) != 1)
+			goto end;
+	}
+	for (i = 0; i < 8; i++)
+		block[i] ^= data[length - 8 + i];
+
+	if (EVP_EncryptInit_ex(ctx, EVP_des_ede_ecb(), NULL, key, NULL) != 1 ||
+		EVP_CIPHER_CTX_set_padding(ctx, 0) != 1 ||
+		EVP_EncryptUpdate(ctx, mac, &outLength, block, 8) != 1)
+		goto end;
+	res = 0;
+
+end:
+	EVP_CIPHER_CTX_free(ctx);
+	return res;
+}
+
+static int openssl_sha1(const unsigned char* input, long long length, unsigned char output[20]) {
+	if (EVP_Digest(input, (size_t)length, output, NULL, EVP_sha1(), NULL) != 1)
+		return CRYPTO_PROVIDER_FAILED;
+	return 0;
+}
+
+static const crypto_provider openssl = {
+	"openssl",
+	CRYPTO_CAP_ALL,
+	openssl_des_ecb,
+	openssl_des3_cbc,
+	openssl_mac3,
+	openssl_sha1,
+};
+
+const crypto_provider* crypto_provider_openssl(void) {
+	return &openssl;
+}
+#else
+const crypto_provider* crypto_provider_openssl(void) {
+	return NULL;
+}
+#endif	// #if USE_OPENSSL
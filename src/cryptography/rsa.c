@@ -0,0 +1,55 @@
+/**
+ * @author Khoa Nguyen
+ * @file rsa.c
+ * @brief Source file for the RSA public key operation.
+ */
+
+#include <string.h>
+
+#include <cryptography/rsa.h>
+
+int rsa_set_public(rsa_context* ctx,
+				   const unsigned char* n,
+				   int nLen,
+				   const unsigned char* e,
+				   int eLen) {
+	unsigned int m[BN_MAX_LIMBS];
+
+	while (nLen > 0 && n[0] == 0) {
+		n++;
+		nLen--;
+	}
+	while (eLen > 0 && e[0] == 0) {
+		e++;
+		eLen--;
+	}
+	if (nLen < 64 || nLen > RSA_MAX_BYTES || eLen == 0 || eLen > nLen) {
+		return RSA_BAD_INPUT;
+	}
+
+	memset(ctx, 0, sizeof(rsa_context));
+	ctx->len	= nLen;
+	ctx->eLimbs = (eLen + 3) / 4;
+	if (bn_read_binary(m, (nLen + 3) / 4, n, nLen) != 0 ||
+		mont_init(&ctx->n, m, (nLen + 3) / 4) != 0 ||
+		bn_read_binary(ctx->e, ctx->eLimbs, e, eLen) != 0) {
+		return RSA_BAD_INPUT;
+	}
+	return 0;
+}
+
+int rsa_public(const rsa_context* ctx, const unsigned char* input, unsigned char* output) {
+	unsigned int x[BN_MAX_LIMBS];
+	int n = ctx->n.n;
+
+	if (bn_read_binary(x, n, input, ctx->len) != 0 || bn_cmp(x, ctx->n.m, n) >= 0) {
+		return RSA_BAD_INPUT;
+	}
+
+	// The exponent is public, so the fixed window over its few limbs costs little
+	mont_to(&ctx->n, x, x);
+	mont_exp(&ctx->n, x, x, ctx->e, ctx->eLimbs);
+	mont_from(&ctx->n, x, x);
+	bn_write_binary(x, n, output, ctx->len);
+	return 0;
+}
@@ -9,86 +9,567 @@
 #endif
 
 #include <string.h>
-#define rol(x, y) ((x << y) | (x >> (32 - y)))	// Loop left shift
-
-// One cycle process, STR is a portion of the filled data or part in the data
-void round(unsigned char str[64], unsigned int h[5]) {
-	unsigned int a, b, c, d, e, tmp, w[80];
-	unsigned int i;
-	for (i = 0; i < 16; i++) {
-		w[i] = ((unsigned int)str[i * 4] << 24) | (((unsigned int)str[i * 4 + 1]) << 16) |
-			   (((unsigned int)str[i * 4 + 2]) << 8) | (((unsigned int)str[i * 4 + 3]) << 0);
-	}
-	for (i = 16; i < 80; i++) {
-		unsigned int tmp = w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16];
-		w[i]			 = rol(tmp, 1);
-	}
-
-	a = h[0];
-	b = h[1];
-	c = h[2];
-	d = h[3];
-	e = h[4];
-	for (i = 0; i < 80; i++) {
-		switch (i / 20) {
-			case 0:
-				tmp = rol(a, 5) + ((b & c) | (d & ~b)) + e + w[i] + 0x5a827999;
-				break;
-			case 1:
-				tmp = rol(a, 5) + (b ^ c ^ d) + e + w[i] + 0x6ed9eba1;
-				break;
-			case 2:
-				tmp = rol(a, 5) + ((b & c) | (b & d) | (c & d)) + e + w[i] + 0x8f1bbcdc;
-				break;
-			case 3:
-				tmp = rol(a, 5) + (b ^ c ^ d) + e + w[i] + 0xca62c1d6;
+
+#include <cryptography/cpu_features.h>
+#include <cryptography/sha1.h>
+
+#if CPU_X86
+#include <immintrin.h>
+#endif
+
+#define SHA1_KERNEL_PORTABLE 1
+#define SHA1_KERNEL_SHANI	 2
+
+#define rol(x, y)			 (((x) << (y)) | ((x) >> (32 - (y))))	// Loop left shift
+
+#define GET_UINT32_BE(b)                                           \
+	(((unsigned int)(b)[0] << 24) | ((unsigned int)(b)[1] << 16) | \
+	 ((unsigned int)(b)[2] << 8) | ((unsigned int)(b)[3]))
+
+/*
+ * Rounds of the portable kernel. The schedule is kept in a ring of 16 words and the five working
+ * variables rotate through the macro arguments instead of being moved.
+ */
+#define SHA1_W0(i) (w[i] = GET_UINT32_BE(data + (i) * 4))
+#define SHA1_W(i) \
+	(w[(i) & 15] = rol(w[((i) + 13) & 15] ^ w[((i) + 8) & 15] ^ w[((i) + 2) & 15] ^ w[(i) & 15], 1))
+
+#define SHA1_R0(a, b, c, d, e, i)                                       \
+	{                                                                   \
+		e += rol(a, 5) + ((b & (c ^ d)) ^ d) + SHA1_W0(i) + 0x5A827999; \
+		b = rol(b, 30);                                                 \
+	}
+#define SHA1_R1(a, b, c, d, e, i)                                      \
+	{                                                                  \
+		e += rol(a, 5) + ((b & (c ^ d)) ^ d) + SHA1_W(i) + 0x5A827999; \
+		b = rol(b, 30);                                                \
+	}
+#define SHA1_R2(a, b, c, d, e, i)                              \
+	{                                                          \
+		e += rol(a, 5) + (b ^ c ^ d) + SHA1_W(i) + 0x6ED9EBA1; \
+		b = rol(b, 30);                                        \
+	}
+#define SHA1_R3(a, b, c, d, e, i)                                            \
+	{                                                                        \
+		e += rol(a, 5) + (((b | c) & d) | (b & c)) + SHA1_W(i) + 0x8F1BBCDC; \
+		b = rol(b, 30);                                                      \
+	}
+#define SHA1_R4(a, b, c, d, e, i)                              \
+	{                                                          \
+		e += rol(a, 5) + (b ^ c ^ d) + SHA1_W(i) + 0xCA62C1D6; \
+		b = rol(b, 30);                                        \
+	}
+
+#define SHA1_ROUNDS5(R, i)         \
+	{                              \
+		R(a, b, c, d, e, (i));     \
+		R(e, a, b, c, d, (i) + 1); \
+		R(d, e, a, b, c, (i) + 2); \
+		R(c, d, e, a, b, (i) + 3); \
+		R(b, c, d, e, a, (i) + 4); \
+	}
+
+// Compresses whole 64-byte blocks, straight from the input
+static void sha1_blocks_portable(unsigned int h[5], const unsigned char* data, size_t blocks) {
+	unsigned int a, b, c, d, e, w[16];
+
+	for (; blocks > 0; blocks--, data += SHA1_BLOCK_LENGTH) {
+		a = h[0];
+		b = h[1];
+		c = h[2];
+		d = h[3];
+		e = h[4];
+
+		SHA1_ROUNDS5(SHA1_R0, 0);
+		SHA1_ROUNDS5(SHA1_R0, 5);
+		SHA1_ROUNDS5(SHA1_R0, 10);
+		SHA1_R0(a, b, c, d, e, 15);
+		SHA1_R1(e, a, b, c, d, 16);
+		SHA1_R1(d, e, a, b, c, 17);
+		SHA1_R1(c, d, e, a, b, 18);
+		SHA1_R1(b, c, d, e, a, 19);
+
+		SHA1_ROUNDS5(SHA1_R2, 20);
+		SHA1_ROUNDS5(SHA1_R2, 25);
+		SHA1_ROUNDS5(SHA1_R2, 30);
+		SHA1_ROUNDS5(SHA1_R2, 35);
+
+		SHA1_ROUNDS5(SHA1_R3, 40);
+		SHA1_ROUNDS5(SHA1_R3, 45);
+		SHA1_ROUNDS5(SHA1_R3, 50);
+		SHA1_ROUNDS5(SHA1_R3, 55);
+
+		SHA1_ROUNDS5(SHA1_R4, 60);
+		SHA1_ROUNDS5(SHA1_R4, 65);
+		SHA1_ROUNDS5(SHA1_R4, 70);
+		SHA1_ROUNDS5(SHA1_R4, 75);
+
+		h[0] += a;
+		h[1] += b;
+		h[2] += c;
+		h[3] += d;
+		h[4] += e;
+	}
+}
+
+#if CPU_X86
+/*
+ * Four rounds with the SHA extensions, m0 holds their message words. The schedule of the next
+ * groups is advanced at the same time: m1 is completed, m2 and m3 are prepared.
+ */
+#define SHA1_NI_ROUNDS4(f, eA, eB, m0, m1, m2, m3) \
+	{                                              \
+		eA	 = _mm_sha1nexte_epu32(eA, m0);        \
+		eB	 = abcd;                               \
+		m1	 = _mm_sha1msg2_epu32(m1, m0);         \
+		abcd = _mm_sha1rnds4_epu32(abcd, eA, f);   \
+		m3	 = _mm_sha1msg1_epu32(m3, m0);         \
+		m2	 = _mm_xor_si128(m2, m0);              \
+	}
+
+#define SHA1_NI_LOAD(i) \
+	_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + (i) * 16)), bswap)
+
+CPU_TARGET("sha,sse4.1")
+static void sha1_blocks_shani(unsigned int h[5], const unsigned char* data, size_t blocks) {
+	const __m128i bswap = _mm_set_epi64x(0x0001020304050607LL, 0x08090A0B0C0D0E0FLL);
+	__m128i abcd, e0, e1, abcdSave, eSave, m0, m1, m2, m3;
+
+	// a in the highest lane, e in the highest lane of its own register
+	abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)h), 0x1B);
+	e0	 = _mm_set_epi32((int)h[4], 0, 0, 0);
+
+	for (; blocks > 0; blocks--, data += SHA1_BLOCK_LENGTH) {
+		abcdSave = abcd;
+		eSave	 = e0;
+
+		// Rounds 0-15, the message words are loaded as they are needed
+		m0	 = SHA1_NI_LOAD(0);
+		e0	 = _mm_add_epi32(e0, m0);
+		e1	 = abcd;
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+
+		m1	 = SHA1_NI_LOAD(1);
+		e1	 = _mm_sha1nexte_epu32(e1, m1);
+		e0	 = abcd;
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+		m0	 = _mm_sha1msg1_epu32(m0, m1);
+
+		m2	 = SHA1_NI_LOAD(2);
+		e0	 = _mm_sha1nexte_epu32(e0, m2);
+		e1	 = abcd;
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+		m1	 = _mm_sha1msg1_epu32(m1, m2);
+		m0	 = _mm_xor_si128(m0, m2);
+
+		m3 = SHA1_NI_LOAD(3);
+		SHA1_NI_ROUNDS4(0, e1, e0, m3, m0, m1, m2);
+
+		// Rounds 16-67
+		SHA1_NI_ROUNDS4(0, e0, e1, m0, m1, m2, m3);
+		SHA1_NI_ROUNDS4(1, e1, e0, m1, m2, m3, m0);
+		SHA1_NI_ROUNDS4(1, e0, e1, m2, m3, m0, m1);
+		SHA1_NI_ROUNDS4(1, e1, e0, m3, m0, m1, m2);
+		SHA1_NI_ROUNDS4(1, e0, e1, m0, m1, m2, m3);
+		SHA1_NI_ROUNDS4(1, e1, e0, m1, m2, m3, m0);
+		SHA1_NI_ROUNDS4(2, e0, e1, m2, m3, m0, m1);
+		SHA1_NI_ROUNDS4(2, e1, e0, m3, m0, m1, m2);
+		SHA1_NI_ROUNDS4(2, e0, e1, m0, m1, m2, m3);
+		SHA1_NI_ROUNDS4(2, e1, e0, m1, m2, m3, m0);
+		SHA1_NI_ROUNDS4(2, e0, e1, m2, m3, m0, m1);
+		SHA1_NI_ROUNDS4(3, e1, e0, m3, m0, m1, m2);
+		SHA1_NI_ROUNDS4(3, e0, e1, m0, m1, m2, m3);
+
+		// Rounds 68-79, the last message words need no further schedule
+		e1	 = _mm_sha1nexte_epu32(e1, m1);
+		e0	 = abcd;
+		m2	 = _mm_sha1msg2_epu32(m2, m1);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+		m3	 = _mm_xor_si128(m3, m1);
+
+		e0	 = _mm_sha1nexte_epu32(e0, m2);
+		e1	 = abcd;
+		m3	 = _mm_sha1msg2_epu32(m3, m2);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 3);
+
+		e1	 = _mm_sha1nexte_epu32(e1, m3);
+		e0	 = abcd;
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+
+		e0	 = _mm_sha1nexte_epu32(e0, eSave);
+		abcd = _mm_add_epi32(abcd, abcdSave);
+	}
+
+	_mm_storeu_si128((__m128i*)h, _mm_shuffle_epi32(abcd, 0x1B));
+	h[4] = (unsigned int)_mm_extract_epi32(e0, 3);
+}
+
+#define SHA1_X8_ROL(x, y) _mm256_or_si256(_mm256_slli_epi32(x, y), _mm256_srli_epi32(x, 32 - (y)))
+#define SHA1_X8_XOR4(a, b, c, d) \
+	_mm256_xor_si256(_mm256_xor_si256(a, b), _mm256_xor_si256(c, d))
+
+// Message word i of the schedule, kept in a ring of 16 vectors
+#define SHA1_X8_W(i)            \
+	(w[(i) & 15] = SHA1_X8_ROL( \
+		 SHA1_X8_XOR4(w[((i) + 13) & 15], w[((i) + 8) & 15], w[((i) + 2) & 15], w[(i) & 15]), 1))
+
+/*
+ * One block of each of SHA1_MULTI_LANES messages, lane j of every vector belongs to message j. The
+ * state is kept transposed: state[i][j] is word i of message j.
+ */
+#define SHA1_X8_ROUND(f, k, w)                                                                  \
+	{                                                                                           \
+		tmp = _mm256_add_epi32(_mm256_add_epi32(SHA1_X8_ROL(a, 5), f), _mm256_add_epi32(e, w)); \
+		e	= d;                                                                                \
+		d	= c;                                                                                \
+		c	= SHA1_X8_ROL(b, 30);                                                               \
+		b	= a;                                                                                \
+		a	= _mm256_add_epi32(tmp, k);                                                         \
+	}
+
+#define SHA1_X8_F1 _mm256_xor_si256(d, _mm256_and_si256(b, _mm256_xor_si256(c, d)))
+#define SHA1_X8_F2 _mm256_xor_si256(_mm256_xor_si256(b, c), d)
+#define SHA1_X8_F3 \
+	_mm256_or_si256(_mm256_and_si256(_mm256_or_si256(b, c), d), _mm256_and_si256(b, c))
+
+/*
+ * One block of each of SHA1_MULTI_LANES messages, lane j of every vector belongs to message j. The
+ * state is kept transposed: state[i][j] is word i of message j.
+ */
+CPU_TARGET("avx2")
+static void sha1_multi_block_avx2(unsigned int state[5][SHA1_MULTI_LANES],
+								  const unsigned char* const block[SHA1_MULTI_LANES]) {
+	const __m256i bswap = _mm256_set_epi64x(0x0C0D0E0F08090A0BLL, 0x0405060700010203LL,
+											0x0C0D0E0F08090A0BLL, 0x0405060700010203LL);
+	__m256i a, b, c, d, e, tmp, k, w[16], r[8], t[8];
+	int i, j;
+
+	// Transpose the words, 8 of each block at a time
+	for (i = 0; i < 16; i += 8) {
+		for (j = 0; j < SHA1_MULTI_LANES; j++) {
+			r[j] = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(block[j] + i * 4)),
+									   bswap);
+		}
+		for (j = 0; j < 8; j += 2) {
+			t[j]	 = _mm256_unpacklo_epi32(r[j], r[j + 1]);
+			t[j + 1] = _mm256_unpackhi_epi32(r[j], r[j + 1]);
+		}
+		for (j = 0; j < 2; j++) {
+			r[j]	 = _mm256_unpacklo_epi64(t[j], t[j + 2]);
+			r[j + 2] = _mm256_unpackhi_epi64(t[j], t[j + 2]);
+			r[j + 4] = _mm256_unpacklo_epi64(t[j + 4], t[j + 6]);
+			r[j + 6] = _mm256_unpackhi_epi64(t[j + 4], t[j + 6]);
+		}
+		// r[0], r[2], r[1], r[3] hold words 0-3 of blocks 0-3 and 4-7 in their halves
+		w[i]	 = _mm256_permute2x128_si256(r[0], r[4], 0x20);
+		w[i + 1] = _mm256_permute2x128_si256(r[2], r[6], 0x20);
+		w[i + 2] = _mm256_permute2x128_si256(r[1], r[5], 0x20);
+		w[i + 3] = _mm256_permute2x128_si256(r[3], r[7], 0x20);
+		w[i + 4] = _mm256_permute2x128_si256(r[0], r[4], 0x31);
+		w[i + 5] = _mm256_permute2x128_si256(r[2], r[6], 0x31);
+		w[i + 6] = _mm256_permute2x128_si256(r[1], r[5], 0x31);
+		w[i + 7] = _mm256_permute2x128_si256(r[3], r[7], 0x31);
+	}
+
+	a = _mm256_loadu_si256((const __m256i*)state[0]);
+	b = _mm256_loadu_si256((const __m256i*)state[1]);
+	c = _mm256_loadu_si256((const __m256i*)state[2]);
+	d = _mm256_loadu_si256((const __m256i*)state[3]);
+	e = _mm256_loadu_si256((const __m256i*)state[4]);
+
+	k = _mm256_set1_epi32(0x5A827999);
+	for (i = 0; i < 16; i++)
+		SHA1_X8_ROUND(SHA1_X8_F1, k, w[i]);
+	for (; i < 20; i++)
+		SHA1_X8_ROUND(SHA1_X8_F1, k, SHA1_X8_W(i));
+	k = _mm256_set1_epi32(0x6ED9EBA1);
+	for (; i < 40; i++)
+		SHA1_X8_ROUND(SHA1_X8_F2, k, SHA1_X8_W(i));
+	k = _mm256_set1_epi32((int)0x8F1BBCDC);
+	for (; i < 60; i++)
+		SHA1_X8_ROUND(SHA1_X8_F3, k, SHA1_X8_W(i));
+	k = _mm256_set1_epi32((int)0xCA62C1D6);
+	for (; i < 80; i++)
+		SHA1_X8_ROUND(SHA1_X8_F2, k, SHA1_X8_W(i));
+
+	a = _mm256_add_epi32(a, _mm256_loadu_si256((const __m256i*)state[0]));
+	b = _mm256_add_epi32(b, _mm256_loadu_si256((const __m256i*)state[1]));
+	c = _mm256_add_epi32(c, _mm256_loadu_si256((const __m256i*)state[2]));
+	d = _mm256_add_epi32(d, _mm256_loadu_si256((const __m256i*)state[3]));
+	e = _mm256_add_epi32(e, _mm256_loadu_si256((const __m256i*)state[4]));
+	_mm256_storeu_si256((__m256i*)state[0], a);
+	_mm256_storeu_si256((__m256i*)state[1], b);
+	_mm256_storeu_si256((__m256i*)state[2], c);
+	_mm256_storeu_si256((__m256i*)state[3], d);
+	_mm256_storeu_si256((__m256i*)state[4], e);
+}
+#endif	// #if CPU_X86
+
+static int sha1_kernel;	 // SHA1_KERNEL_*, chosen on first use
+
+static void sha1_blocks(int kernel, unsigned int h[5], const unsigned char* data, size_t blocks) {
+#if CPU_X86
+	if (kernel == SHA1_KERNEL_SHANI) {
+		sha1_blocks_shani(h, data, blocks);
+		return;
+	}
+#endif
+	sha1_blocks_portable(h, data, blocks);
+}
+
+// Hashes a message with the given kernel
+static void sha1_kernel_digest(int kernel,
+							   const unsigned char* input,
+							   long long length,
+							   unsigned char output[SHA1_DIGEST_LENGTH]) {
+	sha1_ctx ctx;
+
+	sha1_init(&ctx);
+	ctx.kernel = kernel;
+	sha1_update(&ctx, input, length);
+	sha1_final(&ctx, output);
+}
+
+static int sha1_multi_avx2;	// 1 if the AVX2 kernel of sha1_multi is used, chosen on first use
+
+// Hashes up to SHA1_MULTI_LANES messages together
+static void sha1_multi_lanes_avx2(const unsigned char* const input[],
+								  const long long length[],
+								  unsigned char* const output[],
+								  int count) {
+#if CPU_X86
+	unsigned int state[5][SHA1_MULTI_LANES];
+	unsigned char tail[SHA1_MULTI_LANES][2 * SHA1_BLOCK_LENGTH];
+	const unsigned char* block[SHA1_MULTI_LANES];
+	long long full[SHA1_MULTI_LANES], blocks[SHA1_MULTI_LANES], maxBlocks = 0, n;
+	unsigned long long bits;
+	int i, j, size;
+
+	for (j = 0; j < SHA1_MULTI_LANES; j++) {
+		// Unused lanes hash an empty message that is thrown away
+		n			= j < count ? length[j] : 0;
+		full[j]		= n / SHA1_BLOCK_LENGTH;
+		blocks[j]	= full[j] + (n % SHA1_BLOCK_LENGTH > SHA1_BLOCK_LENGTH - 9 ? 2 : 1);
+		maxBlocks	= blocks[j] > maxBlocks ? blocks[j] : maxBlocks;
+		state[0][j] = 0x67452301;
+		state[1][j] = 0xEFCDAB89;
+		state[2][j] = 0x98BADCFE;
+		state[3][j] = 0x10325476;
+		state[4][j] = 0xC3D2E1F0;
+
+		// Padding: 0x80, zeros and the 64-bit message length in bits
+		size = (int)(blocks[j] - full[j]) * SHA1_BLOCK_LENGTH;
+		memset(tail[j], 0, size);
+		memcpy(tail[j], input[j] + full[j] * SHA1_BLOCK_LENGTH, (size_t)n % SHA1_BLOCK_LENGTH);
+		tail[j][n % SHA1_BLOCK_LENGTH] = 0x80;
+		bits						   = (unsigned long long)n * 8;
+		for (i = 0; i < 8; i++)
+			tail[j][size - 8 + i] = (unsigned char)(bits >> ((7 - i) * 8));
+	}
+
+	for (n = 0; n < maxBlocks; n++) {
+		for (j = 0; j < SHA1_MULTI_LANES; j++) {
+			if (n < full[j])
+				block[j] = input[j] + n * SHA1_BLOCK_LENGTH;
+			else if (n < blocks[j])
+				block[j] = tail[j] + (n - full[j]) * SHA1_BLOCK_LENGTH;
+			else
+				block[j] = tail[j];	 // Finished, the result is not used
+		}
+		sha1_multi_block_avx2(state, block);
+
+		for (j = 0; j < count; j++) {
+			if (n == blocks[j] - 1) {
+				for (i = 0; i < 5; i++) {
+					output[j][i * 4]	 = (unsigned char)(state[i][j] >> 24);
+					output[j][i * 4 + 1] = (unsigned char)(state[i][j] >> 16);
+					output[j][i * 4 + 2] = (unsigned char)(state[i][j] >> 8);
+					output[j][i * 4 + 3] = (unsigned char)(state[i][j]);
+				}
+			}
+		}
+	}
+#else
+	(void)input;
+	(void)length;
+	(void)output;
+	(void)count;
+#endif
+}
+
+// Checks the AVX2 lanes against the portable kernel, over messages of one to three blocks
+static int sha1_multi_self_test(void) {
+	unsigned char message[3 * SHA1_BLOCK_LENGTH];
+	unsigned char digest[SHA1_MULTI_LANES][SHA1_DIGEST_LENGTH], expected[SHA1_DIGEST_LENGTH];
+	const unsigned char* input[SHA1_MULTI_LANES];
+	unsigned char* output[SHA1_MULTI_LANES];
+	long long length[SHA1_MULTI_LANES];
+	int i, j;
+
+	for (i = 0; i < (int)sizeof(message); i++)
+		message[i] = (unsigned char)(i * 37 + 11);
+	for (j = 0; j < SHA1_MULTI_LANES; j++) {
+		input[j]  = &message[j];
+		length[j] = j * 23 + 7;	 // 7 to 168 bytes, across both padding cases
+		output[j] = digest[j];
+	}
+
+	sha1_multi_lanes_avx2(input, length, output, SHA1_MULTI_LANES);
+	for (j = 0; j < SHA1_MULTI_LANES; j++) {
+		sha1_kernel_digest(SHA1_KERNEL_PORTABLE, input[j], length[j], expected);
+		if (memcmp(digest[j], expected, SHA1_DIGEST_LENGTH))
+			return SHA1_SELF_TEST_FAILED;
+	}
+	return 0;
+}
+
+int sha1_self_test(void) {
+	// FIPS 180-2 appendix A: one and two blocks
+	static const unsigned char msg2[] = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+	static const unsigned char digest1[SHA1_DIGEST_LENGTH] = {
+		0xA9, 0x99, 0x3E, 0x36, 0x47, 0x06, 0x81, 0x6A, 0xBA, 0x3E,
+		0x25, 0x71, 0x78, 0x50, 0xC2, 0x6C, 0x9C, 0xD0, 0xD8, 0x9D};
+	static const unsigned char digest2[SHA1_DIGEST_LENGTH] = {
+		0x84, 0x98, 0x3E, 0x44, 0x1C, 0x3B, 0xD2, 0x6E, 0xBA, 0xAE,
+		0x4A, 0xA1, 0xF9, 0x51, 0x29, 0xE5, 0xE5, 0x46, 0x70, 0xF1};
+	unsigned char output[SHA1_DIGEST_LENGTH];
+	int kernel, ret = 0;
+
+	for (kernel = SHA1_KERNEL_PORTABLE; kernel <= SHA1_KERNEL_SHANI; kernel++) {
+		if (kernel == SHA1_KERNEL_SHANI) {
+#if CPU_X86
+			unsigned int need = CPU_FEATURE_SHA | CPU_FEATURE_SSE41 | CPU_FEATURE_SSSE3;
+			if ((cpu_features() & need) != need)
 				break;
+#else
+			break;
+#endif
+		}
+
+		sha1_kernel_digest(kernel, msg2, 3, output);
+		if (memcmp(output, digest1, SHA1_DIGEST_LENGTH))
+			ret = SHA1_SELF_TEST_FAILED;
+		sha1_kernel_digest(kernel, msg2, sizeof(msg2) - 1, output);
+		if (memcmp(output, digest2, SHA1_DIGEST_LENGTH))
+			ret = SHA1_SELF_TEST_FAILED;
+		if (ret != 0)
+			return ret;
+	}
+
+#if CPU_X86
+	if (cpu_features() & CPU_FEATURE_AVX2)
+		ret = sha1_multi_self_test();
+#endif
+	return ret;
+}
+
+// The fastest kernel available on this CPU that passes the self test
+static int sha1_kernel_select(void) {
+	if (sha1_kernel == 0) {
+		sha1_kernel = SHA1_KERNEL_PORTABLE;
+		if (sha1_self_test() == 0) {
+#if CPU_X86
+			unsigned int need = CPU_FEATURE_SHA | CPU_FEATURE_SSE41 | CPU_FEATURE_SSSE3;
+			if ((cpu_features() & need) == need)
+				sha1_kernel = SHA1_KERNEL_SHANI;
+#endif
 		}
-		e = d;
-		d = c;
-		c = rol(b, 30);
-		b = a;
-		a = tmp;
-	}
-	h[0] += a;
-	h[1] += b;
-	h[2] += c;
-	h[3] += d;
-	h[4] += e;
+	}
+	return sha1_kernel;
+}
+
+void sha1_init(sha1_ctx* ctx) {
+	ctx->state[0] = 0x67452301;
+	ctx->state[1] = 0xEFCDAB89;
+	ctx->state[2] = 0x98BADCFE;
+	ctx->state[3] = 0x10325476;
+	ctx->state[4] = 0xC3D2E1F0;
+	ctx->length	  = 0;
+	ctx->kernel	  = sha1_kernel_select();
+}
+
+void sha1_update(sha1_ctx* ctx, const unsigned char* input, long long length) {
+	size_t fill = (size_t)(ctx->length % SHA1_BLOCK_LENGTH);
+	size_t n	= (size_t)length;
+	size_t take;
+
+	ctx->length += (unsigned long long)length;
+
+	// Complete a partial block first
+	if (fill > 0) {
+		take = SHA1_BLOCK_LENGTH - fill < n ? SHA1_BLOCK_LENGTH - fill : n;
+		memcpy(&ctx->buffer[fill], input, take);
+		input += take;
+		n -= take;
+		if (fill + take < SHA1_BLOCK_LENGTH)
+			return;
+		sha1_blocks(ctx->kernel, ctx->state, ctx->buffer, 1);
+	}
+
+	// Whole blocks are compressed in place
+	if (n >= SHA1_BLOCK_LENGTH) {
+		sha1_blocks(ctx->kernel, ctx->state, input, n / SHA1_BLOCK_LENGTH);
+		input += n - n % SHA1_BLOCK_LENGTH;
+		n %= SHA1_BLOCK_LENGTH;
+	}
+	memcpy(ctx->buffer, input, n);
+}
+
+void sha1_final(sha1_ctx* ctx, unsigned char output[SHA1_DIGEST_LENGTH]) {
+	size_t fill				= (size_t)(ctx->length % SHA1_BLOCK_LENGTH);
+	unsigned long long bits = ctx->length * 8;
+	int i;
+
+	// Padding: 0x80, zeros and the 64-bit message length in bits
+	ctx->buffer[fill++] = 0x80;
+	if (fill > SHA1_BLOCK_LENGTH - 8) {
+		memset(&ctx->buffer[fill], 0, SHA1_BLOCK_LENGTH - fill);
+		sha1_blocks(ctx->kernel, ctx->state, ctx->buffer, 1);
+		fill = 0;
+	}
+	memset(&ctx->buffer[fill], 0, SHA1_BLOCK_LENGTH - 8 - fill);
+	for (i = 0; i < 8; i++)
+		ctx->buffer[SHA1_BLOCK_LENGTH - 8 + i] = (unsigned char)(bits >> ((7 - i) * 8));
+	sha1_blocks(ctx->kernel, ctx->state, ctx->buffer, 1);
+
+	for (i = 0; i < SHA1_DIGEST_LENGTH; i++)
+		output[i] = (unsigned char)(ctx->state[i / 4] >> ((3 - i % 4) * 8));
+	memset(ctx, 0, sizeof(sha1_ctx));
 }
 
 // SHA-1 algorithm
-void sha1(unsigned char* input, long long len, unsigned char* output) {
-	unsigned char temp[64];
-	unsigned int h[5] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
-	unsigned int i, tmp;
-	long long n = len;
-	while (n >= 64) {
-		memcpy(temp, input + len - n, 64);
-		round(temp, h);
-		n -= 64;
-	}
-
-	if (n >= 56) {
-		memset(temp, 0, 64);
-		memcpy(temp, input + len - n, n);
-		temp[n] = 128;
-		round(temp, h);
-		memset(temp, 0, 64);
-		for (i = 56; i < 64; i++)
-			temp[i] = ((len * 8) >> (63 - i) * 8) & 0xff;
-		round(temp, h);
-	} else {
-		memset(temp, 0, 64);
-		memcpy(temp, input + len - n, n);
-		temp[n] = 128;
-		for (i = 56; i < 64; i++)
-			temp[i] = ((len * 8) >> (63 - i) * 8) & 0xff;
-		round(temp, h);
-	}
-
-	for (i = 0; i < 20; i++) {
-		tmp		  = (h[i / 4] >> ((3 - i % 4) * 8)) & 0xff;
-		output[i] = tmp;
+void sha1(const unsigned char* input, long long len, unsigned char* output) {
+	sha1_ctx ctx;
+
+	sha1_init(&ctx);
+	sha1_update(&ctx, input, len);
+	sha1_final(&ctx, output);
+}
+
+int sha1_multi_lanes(void) {
+	if (sha1_multi_avx2 == 0) {
+		sha1_multi_avx2 = -1;
+#if CPU_X86
+		if ((cpu_features() & CPU_FEATURE_AVX2) && sha1_multi_self_test() == 0)
+			sha1_multi_avx2 = 1;
+#endif
+	}
+	return sha1_multi_avx2 == 1 ? SHA1_MULTI_LANES : 1;
+}
+
+void sha1_multi(const unsigned char* const input[],
+				const long long length[],
+				unsigned char* const output[],
+				int count) {
+	int i;
+
+	if (sha1_multi_lanes() == 1) {
+		for (i = 0; i < count; i++)
+			sha1(input[i], length[i], output[i]);
+		return;
+	}
+	for (i = 0; i < count; i += SHA1_MULTI_LANES) {
+		sha1_multi_lanes_avx2(&input[i], &length[i], &output[i],
+							  count - i < SHA1_MULTI_LANES ? count - i : SHA1_MULTI_LANES);
 	}
 }
@@ -0,0 +1,343 @@
+/**
+ * @author Khoa Nguyen
+ * @file sha256.c
+ * @brief Source file for SHA-224 and SHA-256 hash algorithms.
+ */
+
+#include <string.h>
+
+#include <cryptography/cpu_features.h>
+#include <cryptography/sha256.h>
+
+#if CPU_X86
+#include <immintrin.h>
+#endif
+
+#define SHA256_KERNEL_PORTABLE 1
+#define SHA256_KERNEL_SHANI	   2
+
+#define ror(x, y)			   (((x) >> (y)) | ((x) << (32 - (y))))	 // Loop right shift
+
+#define S0(x)				   (ror(x, 7) ^ ror(x, 18) ^ ((x) >> 3))
+#define S1(x)				   (ror(x, 17) ^ ror(x, 19) ^ ((x) >> 10))
+#define S2(x)				   (ror(x, 2) ^ ror(x, 13) ^ ror(x, 22))
+#define S3(x)				   (ror(x, 6) ^ ror(x, 11) ^ ror(x, 25))
+
+#define F0(x, y, z)			   (((x) & (y)) | ((z) & ((x) | (y))))
+#define F1(x, y, z)			   ((z) ^ ((x) & ((y) ^ (z))))
+
+static const unsigned int K[64] = {
+	0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+	0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+	0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+	0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+	0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+	0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+	0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+	0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2};
+
+// Compresses whole 64-byte blocks, straight from the input
+static void sha256_blocks_portable(unsigned int h[8], const unsigned char* data, size_t blocks) {
+	unsigned int a, b, c, d, e, f, g, k, tmp1, tmp2, w[64];
+	int i;
+
+	for (; blocks > 0; blocks--, data += SHA256_BLOCK_LENGTH) {
+		for (i = 0; i < 16; i++) {
+			w[i] = ((unsigned int)data[i * 4] << 24) | ((unsigned int)data[i * 4 + 1] << 16) |
+				   ((unsigned int)data[i * 4 + 2] << 8) | ((unsigned int)data[i * 4 + 3]);
+		}
+		for (i = 16; i < 64; i++) {
+			w[i] = S1(w[i - 2]) + w[i - 7] + S0(w[i - 15]) + w[i - 16];
+		}
+
+		a = h[0];
+		b = h[1];
+		c = h[2];
+		d = h[3];
+		e = h[4];
+		f = h[5];
+		g = h[6];
+		k = h[7];
+		for (i = 0; i < 64; i++) {
+			tmp1 = k + S3(e) + F1(e, f, g) + K[i] + w[i];
+			tmp2 = S2(a) + F0(a, b, c);
+			k	 = g;
+			g	 = f;
+			f	 = e;
+			e	 = d + tmp1;
+			d	 = c;
+			c	 = b;
+			b	 = a;
+			a	 = tmp1 + tmp2;
+		}
+		h[0] += a;
+		h[1] += b;
+		h[2] += c;
+		h[3] += d;
+		h[4] += e;
+		h[5] += f;
+		h[6] += g;
+		h[7] += k;
+	}
+}
+
+#if CPU_X86
+/*
+ * Four rounds with the SHA extensions, m0 holds their message words. The schedule of the next
+ * groups is advanced at the same time: m1 is completed from m0 and m3, m3 is prepared.
+ */
+#define SHA256_NI_ROUNDS4(i, m0, m1, m3)                                        \
+	{                                                                           \
+		msg	 = _mm_add_epi32(m0, _mm_loadu_si128((const __m128i*)&K[(i) * 4])); \
+		cdgh = _mm_sha256rnds2_epu32(cdgh, abef, msg);                          \
+		m1	 = _mm_add_epi32(m1, _mm_alignr_epi8(m0, m3, 4));                   \
+		m1	 = _mm_sha256msg2_epu32(m1, m0);                                    \
+		abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(msg, 0x0E)); \
+		m3	 = _mm_sha256msg1_epu32(m3, m0);                                    \
+	}
+
+// Four rounds whose message words need no further schedule
+#define SHA256_NI_ROUNDS4_LAST(i, m0)                                           \
+	{                                                                           \
+		msg	 = _mm_add_epi32(m0, _mm_loadu_si128((const __m128i*)&K[(i) * 4])); \
+		cdgh = _mm_sha256rnds2_epu32(cdgh, abef, msg);                          \
+		abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(msg, 0x0E)); \
+	}
+
+#define SHA256_NI_LOAD(i) \
+	_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + (i) * 16)), bswap)
+
+CPU_TARGET("sha,sse4.1")
+static void sha256_blocks_shani(unsigned int h[8], const unsigned char* data, size_t blocks) {
+	const __m128i bswap = _mm_set_epi64x(0x0C0D0E0F08090A0BLL, 0x0405060700010203LL);
+	__m128i abef, cdgh, tmp, msg, abefSave, cdghSave, m0, m1, m2, m3;
+
+	// The instructions keep the state as ABEF and CDGH
+	tmp	 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&h[0]), 0xB1);	  // CDAB
+	cdgh = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&h[4]), 0x1B);	  // EFGH
+	abef = _mm_alignr_epi8(tmp, cdgh, 8);
+	cdgh = _mm_blend_epi16(cdgh, tmp, 0xF0);
+
+	for (; blocks > 0; blocks--, data += SHA256_BLOCK_LENGTH) {
+		abefSave = abef;
+		cdghSave = cdgh;
+
+		// Rounds 0-15, the message words are loaded as they are needed
+		m0 = SHA256_NI_LOAD(0);
+		SHA256_NI_ROUNDS4_LAST(0, m0);
+
+		m1 = SHA256_NI_LOAD(1);
+		SHA256_NI_ROUNDS4_LAST(1, m1);
+		m0 = _mm_sha256msg1_epu32(m0, m1);
+
+		m2 = SHA256_NI_LOAD(2);
+		SHA256_NI_ROUNDS4_LAST(2, m2);
+		m1 = _mm_sha256msg1_epu32(m1, m2);
+
+		m3 = SHA256_NI_LOAD(3);
+		SHA256_NI_ROUNDS4(3, m3, m0, m2);
+
+		// Rounds 16-51
+		SHA256_NI_ROUNDS4(4, m0, m1, m3);
+		SHA256_NI_ROUNDS4(5, m1, m2, m0);
+		SHA256_NI_ROUNDS4(6, m2, m3, m1);
+		SHA256_NI_ROUNDS4(7, m3, m0, m2);
+		SHA256_NI_ROUNDS4(8, m0, m1, m3);
+		SHA256_NI_ROUNDS4(9, m1, m2, m0);
+		SHA256_NI_ROUNDS4(10, m2, m3, m1);
+		SHA256_NI_ROUNDS4(11, m3, m0, m2);
+		SHA256_NI_ROUNDS4(12, m0, m1, m3);
+
+		// Rounds 52-63, the schedule only has to be completed
+		m2 = _mm_add_epi32(m2, _mm_alignr_epi8(m1, m0, 4));
+		m2 = _mm_sha256msg2_epu32(m2, m1);
+		SHA256_NI_ROUNDS4_LAST(13, m1);
+		m3 = _mm_add_epi32(m3, _mm_alignr_epi8(m2, m1, 4));
+		m3 = _mm_sha256msg2_epu32(m3, m2);
+		SHA256_NI_ROUNDS4_LAST(14, m2);
+		SHA256_NI_ROUNDS4_LAST(15, m3);
+
+		abef = _mm_add_epi32(abef, abefSave);
+		cdgh = _mm_add_epi32(cdgh, cdghSave);
+	}
+
+	// Back to ABCD and EFGH
+	tmp	 = _mm_shuffle_epi32(abef, 0x1B);	// FEBA
+	cdgh = _mm_shuffle_epi32(cdgh, 0xB1);	// DCHG
+	_mm_storeu_si128((__m128i*)&h[0], _mm_blend_epi16(tmp, cdgh, 0xF0));
+	_mm_storeu_si128((__m128i*)&h[4], _mm_alignr_epi8(cdgh, tmp, 8));
+}
+#endif	// #if CPU_X86
+
+static int sha256_kernel;  // SHA256_KERNEL_*, chosen on first use
+
+static void sha256_blocks(int kernel, unsigned int h[8], const unsigned char* data, size_t blocks) {
+#if CPU_X86
+	if (kernel == SHA256_KERNEL_SHANI) {
+		sha256_blocks_shani(h, data, blocks);
+		return;
+	}
+#endif
+	sha256_blocks_portable(h, data, blocks);
+}
+
+// Hashes a message with the given kernel
+static void sha256_kernel_digest(int kernel,
+								 const unsigned char* input,
+								 long long length,
+								 unsigned char output[SHA256_DIGEST_LENGTH]) {
+	sha256_ctx ctx;
+
+	sha256_init(&ctx);
+	ctx.kernel = kernel;
+	sha256_update(&ctx, input, length);
+	sha256_final(&ctx, output);
+}
+
+int sha256_self_test(void) {
+	// FIPS 180-2 appendix B: one and two blocks
+	static const unsigned char msg2[] = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+	static const unsigned char digest1[SHA256_DIGEST_LENGTH] = {
+		0xBA, 0x78, 0x16, 0xBF, 0x8F, 0x01, 0xCF, 0xEA,
+		0x41, 0x41, 0x40, 0xDE, 0x5D, 0xAE, 0x22, 0x23,
+		0xB0, 0x03, 0x61, 0xA3, 0x96, 0x17, 0x7A, 0x9C,
+		0xB4, 0x10, 0xFF, 0x61, 0xF2, 0x00, 0x15, 0xAD};
+	static const unsigned char digest2[SHA256_DIGEST_LENGTH] = {
+		0x24, 0x8D, 0x6A, 0x61, 0xD2, 0x06, 0x38, 0xB8,
+		0xE5, 0xC0, 0x26, 0x93, 0x0C, 0x3E, 0x60, 0x39,
+		0xA3, 0x3C, 0xE4, 0x59, 0x64, 0xFF, 0x21, 0x67,
+		0xF6, 0xEC, 0xED, 0xD4, 0x19, 0xDB, 0x06, 0xC1};
+	unsigned char output[SHA256_DIGEST_LENGTH];
+	int kernel, ret = 0;
+
+	for (kernel = SHA256_KERNEL_PORTABLE; kernel <= SHA256_KERNEL_SHANI; kernel++) {
+		if (kernel == SHA256_KERNEL_SHANI) {
+#if CPU_X86
+			unsigned int need = CPU_FEATURE_SHA | CPU_FEATURE_SSE41 | CPU_FEATURE_SSSE3;
+			if ((cpu_features() & need) != need)
+				break;
+#else
+			break;
+#endif
+		}
+
+		sha256_kernel_digest(kernel, msg2, 3, output);
+		if (memcmp(output, digest1, SHA256_DIGEST_LENGTH))
+			ret = SHA256_SELF_TEST_FAILED;
+		sha256_kernel_digest(kernel, msg2, sizeof(msg2) - 1, output);
+		if (memcmp(output, digest2, SHA256_DIGEST_LENGTH))
+			ret = SHA256_SELF_TEST_FAILED;
+		if (ret != 0)
+			return ret;
+	}
+	return ret;
+}
+
+// The fastest kernel available on this CPU that passes the self test
+static int sha256_kernel_select(void) {
+	if (sha256_kernel == 0) {
+		sha256_kernel = SHA256_KERNEL_PORTABLE;
+		if (sha256_self_test() == 0) {
+#if CPU_X86
+			unsigned int need = CPU_FEATURE_SHA | CPU_FEATURE_SSE41 | CPU_FEATURE_SSSE3;
+			if ((cpu_features() & need) == need)
+				sha256_kernel = SHA256_KERNEL_SHANI;
+#endif
+		}
+	}
+	return sha256_kernel;
+}
+
+void sha224_init(sha256_ctx* ctx) {
+	ctx->state[0]	  = 0xC1059ED8;
+	ctx->state[1]	  = 0x367CD507;
+	ctx->state[2]	  = 0x3070DD17;
+	ctx->state[3]	  = 0xF70E5939;
+	ctx->state[4]	  = 0xFFC00B31;
+	ctx->state[5]	  = 0x68581511;
+	ctx->state[6]	  = 0x64F98FA7;
+	ctx->state[7]	  = 0xBEFA4FA4;
+	ctx->length		  = 0;
+	ctx->digestLength = SHA224_DIGEST_LENGTH;
+	ctx->kernel		  = sha256_kernel_select();
+}
+
+void sha256_init(sha256_ctx* ctx) {
+	ctx->state[0]	  = 0x6A09E667;
+	ctx->state[1]	  = 0xBB67AE85;
+	ctx->state[2]	  = 0x3C6EF372;
+	ctx->state[3]	  = 0xA54FF53A;
+	ctx->state[4]	  = 0x510E527F;
+	ctx->state[5]	  = 0x9B05688C;
+	ctx->state[6]	  = 0x1F83D9AB;
+	ctx->state[7]	  = 0x5BE0CD19;
+	ctx->length		  = 0;
+	ctx->digestLength = SHA256_DIGEST_LENGTH;
+	ctx->kernel		  = sha256_kernel_select();
+}
+
+void sha256_update(sha256_ctx* ctx, const unsigned char* input, long long length) {
+	size_t fill = (size_t)(ctx->length % SHA256_BLOCK_LENGTH);
+	size_t n	= (size_t)length;
+	size_t take;
+
+	ctx->length += (unsigned long long)length;
+
+	// Complete a partial block first
+	if (fill > 0) {
+		take = SHA256_BLOCK_LENGTH - fill < n ? SHA256_BLOCK_LENGTH - fill : n;
+		memcpy(&ctx->buffer[fill], input, take);
+		input += take;
+		n -= take;
+		if (fill + take < SHA256_BLOCK_LENGTH)
+			return;
+		sha256_blocks(ctx->kernel, ctx->state, ctx->buffer, 1);
+	}
+
+	// Whole blocks are compressed in place
+	if (n >= SHA256_BLOCK_LENGTH) {
+		sha256_blocks(ctx->kernel, ctx->state, input, n / SHA256_BLOCK_LENGTH);
+		input += n - n % SHA256_BLOCK_LENGTH;
+		n %= SHA256_BLOCK_LENGTH;
+	}
+	memcpy(ctx->buffer, input, n);
+}
+
+void sha256_final(sha256_ctx* ctx, unsigned char* output) {
+	size_t fill				= (size_t)(ctx->length % SHA256_BLOCK_LENGTH);
+	unsigned long long bits = ctx->length * 8;
+	int i;
+
+	// Padding: 0x80, zeros and the 64-bit message length in bits
+	ctx->buffer[fill++] = 0x80;
+	if (fill > SHA256_BLOCK_LENGTH - 8) {
+		memset(&ctx->buffer[fill], 0, SHA256_BLOCK_LENGTH - fill);
+		sha256_blocks(ctx->kernel, ctx->state, ctx->buffer, 1);
+		fill = 0;
+	}
+	memset(&ctx->buffer[fill], 0, SHA256_BLOCK_LENGTH - 8 - fill);
+	for (i = 0; i < 8; i++)
+		ctx->buffer[SHA256_BLOCK_LENGTH - 8 + i] = (unsigned char)(bits >> ((7 - i) * 8));
+	sha256_blocks(ctx->kernel, ctx->state, ctx->buffer, 1);
+
+	// SHA-224 is the truncated SHA-256 of other initial values
+	for (i = 0; i < ctx->digestLength; i++)
+		output[i] = (unsigned char)(ctx->state[i / 4] >> ((3 - i % 4) * 8));
+	memset(ctx, 0, sizeof(sha256_ctx));
+}
+
+void sha224(const unsigned char* input, long long len, unsigned char* output) {
+	sha256_ctx ctx;
+
+	sha224_init(&ctx);
+	sha256_update(&ctx, input, len);
+	sha256_final(&ctx, output);
+}
+
+void sha256(const unsigned char* input, long long len, unsigned char* output) {
+	sha256_ctx ctx;
+
+	sha256_init(&ctx);
+	sha256_update(&ctx, input, len);
+	sha256_final(&ctx, output);
+}
@@ -0,0 +1,346 @@
+/**
+ * @author Khoa Nguyen
+ * @file sha512.c
+ * @brief Source file for SHA-384 and SHA-512 hash algorithms.
+ */
+
+#include <string.h>
+
+#include <cryptography/cpu_features.h>
+#include <cryptography/sha512.h>
+
+#if CPU_X86
+#include <immintrin.h>
+#endif
+
+#define SHA512_KERNEL_PORTABLE 1
+#define SHA512_KERNEL_AVX2	   2
+
+#define ror64(x, y)			   (((x) >> (y)) | ((x) << (64 - (y))))	 // Loop right shift
+
+#define S0(x)				   (ror64(x, 1) ^ ror64(x, 8) ^ ((x) >> 7))
+#define S1(x)				   (ror64(x, 19) ^ ror64(x, 61) ^ ((x) >> 6))
+#define S2(x)				   (ror64(x, 28) ^ ror64(x, 34) ^ ror64(x, 39))
+#define S3(x)				   (ror64(x, 14) ^ ror64(x, 18) ^ ror64(x, 41))
+
+#define F0(x, y, z)			   (((x) & (y)) | ((z) & ((x) | (y))))
+#define F1(x, y, z)			   ((z) ^ ((x) & ((y) ^ (z))))
+
+// One round, the eight working variables rotate through the macro arguments instead of being moved
+#define SHA512_ROUND(a, b, c, d, e, f, g, h, i) \
+	{                                           \
+		tmp = h + S3(e) + F1(e, f, g) + wk[i];  \
+		d += tmp;                               \
+		h = tmp + S2(a) + F0(a, b, c);          \
+	}
+
+static const unsigned long long K[80] = {
+	0x428A2F98D728AE22ULL, 0x7137449123EF65CDULL, 0xB5C0FBCFEC4D3B2FULL, 0xE9B5DBA58189DBBCULL,
+	0x3956C25BF348B538ULL, 0x59F111F1B605D019ULL, 0x923F82A4AF194F9BULL, 0xAB1C5ED5DA6D8118ULL,
+	0xD807AA98A3030242ULL, 0x12835B0145706FBEULL, 0x243185BE4EE4B28CULL, 0x550C7DC3D5FFB4E2ULL,
+	0x72BE5D74F27B896FULL, 0x80DEB1FE3B1696B1ULL, 0x9BDC06A725C71235ULL, 0xC19BF174CF692694ULL,
+	0xE49B69C19EF14AD2ULL, 0xEFBE4786384F25E3ULL, 0x0FC19DC68B8CD5B5ULL, 0x240CA1CC77AC9C65ULL,
+	0x2DE92C6F592B0275ULL, 0x4A7484AA6EA6E483ULL, 0x5CB0A9DCBD41FBD4ULL, 0x76F988DA831153B5ULL,
+	0x983E5152EE66DFABULL, 0xA831C66D2DB43210ULL, 0xB00327C898FB213FULL, 0xBF597FC7BEEF0EE4ULL,
+	0xC6E00BF33DA88FC2ULL, 0xD5A79147930AA725ULL, 0x06CA6351E003826FULL, 0x142929670A0E6E70ULL,
+	0x27B70A8546D22FFCULL, 0x2E1B21385C26C926ULL, 0x4D2C6DFC5AC42AEDULL, 0x53380D139D95B3DFULL,
+	0x650A73548BAF63DEULL, 0x766A0ABB3C77B2A8ULL, 0x81C2C92E47EDAEE6ULL, 0x92722C851482353BULL,
+	0xA2BFE8A14CF10364ULL, 0xA81A664BBC423001ULL, 0xC24B8B70D0F89791ULL, 0xC76C51A30654BE30ULL,
+	0xD192E819D6EF5218ULL, 0xD69906245565A910ULL, 0xF40E35855771202AULL, 0x106AA07032BBD1B8ULL,
+	0x19A4C116B8D2D0C8ULL, 0x1E376C085141AB53ULL, 0x2748774CDF8EEB99ULL, 0x34B0BCB5E19B48A8ULL,
+	0x391C0CB3C5C95A63ULL, 0x4ED8AA4AE3418ACBULL, 0x5B9CCA4F7763E373ULL, 0x682E6FF3D6B2B8A3ULL,
+	0x748F82EE5DEFB2FCULL, 0x78A5636F43172F60ULL, 0x84C87814A1F0AB72ULL, 0x8CC702081A6439ECULL,
+	0x90BEFFFA23631E28ULL, 0xA4506CEBDE82BDE9ULL, 0xBEF9A3F7B2C67915ULL, 0xC67178F2E372532BULL,
+	0xCA273ECEEA26619CULL, 0xD186B8C721C0C207ULL, 0xEADA7DD6CDE0EB1EULL, 0xF57D4F7FEE6ED178ULL,
+	0x06F067AA72176FBAULL, 0x0A637DC5A2C898A6ULL, 0x113F9804BEF90DAEULL, 0x1B710B35131C471BULL,
+	0x28DB77F523047D84ULL, 0x32CAAB7B40C72493ULL, 0x3C9EBE0A15C9BEBCULL, 0x431D67C49C100D4CULL,
+	0x4CC5D4BECB3E42B6ULL, 0x597F299CFC657E2AULL, 0x5FCB6FAB3AD6FAECULL, 0x6C44198C4A475817ULL};
+
+// Rounds of one block, wk holds the message schedule plus the round constants
+static void sha512_rounds(unsigned long long h[8], const unsigned long long wk[80]) {
+	unsigned long long a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6],
+					   k = h[7], tmp;
+	int i;
+
+	for (i = 0; i < 80; i += 8) {
+		SHA512_ROUND(a, b, c, d, e, f, g, k, i);
+		SHA512_ROUND(k, a, b, c, d, e, f, g, i + 1);
+		SHA512_ROUND(g, k, a, b, c, d, e, f, i + 2);
+		SHA512_ROUND(f, g, k, a, b, c, d, e, i + 3);
+		SHA512_ROUND(e, f, g, k, a, b, c, d, i + 4);
+		SHA512_ROUND(d, e, f, g, k, a, b, c, i + 5);
+		SHA512_ROUND(c, d, e, f, g, k, a, b, i + 6);
+		SHA512_ROUND(b, c, d, e, f, g, k, a, i + 7);
+	}
+	h[0] += a;
+	h[1] += b;
+	h[2] += c;
+	h[3] += d;
+	h[4] += e;
+	h[5] += f;
+	h[6] += g;
+	h[7] += k;
+}
+
+// Compresses whole 128-byte blocks, straight from the input
+static void sha512_blocks_portable(unsigned long long h[8],
+								   const unsigned char* data,
+								   size_t blocks) {
+	unsigned long long w[80], wk[80];
+	int i, j;
+
+	for (; blocks > 0; blocks--, data += SHA512_BLOCK_LENGTH) {
+		for (i = 0; i < 16; i++) {
+			w[i] = 0;
+			for (j = 0; j < 8; j++)
+				w[i] = (w[i] << 8) | data[i * 8 + j];
+		}
+		for (i = 16; i < 80; i++)
+			w[i] = S1(w[i - 2]) + w[i - 7] + S0(w[i - 15]) + w[i - 16];
+		for (i = 0; i < 80; i++)
+			wk[i] = w[i] + K[i];
+
+		sha512_rounds(h, wk);
+	}
+}
+
+#if CPU_X86
+#define SHA512_AVX2_ROR(x, y) \
+	_mm256_or_si256(_mm256_srli_epi64(x, y), _mm256_slli_epi64(x, 64 - (y)))
+
+#define SHA512_AVX2_S0(x)                                                            \
+	_mm256_xor_si256(_mm256_xor_si256(SHA512_AVX2_ROR(x, 1), SHA512_AVX2_ROR(x, 8)), \
+					 _mm256_srli_epi64(x, 7))
+#define SHA512_AVX2_S1(x)                                                              \
+	_mm256_xor_si256(_mm256_xor_si256(SHA512_AVX2_ROR(x, 19), SHA512_AVX2_ROR(x, 61)), \
+					 _mm256_srli_epi64(x, 6))
+
+/*
+ * The message schedule is computed four words at a time. W[t + 2] and W[t + 3] depend on the first
+ * two words of the same vector, so the sigma1 term is added to each half in turn.
+ */
+CPU_TARGET("avx2")
+static void sha512_blocks_avx2(unsigned long long h[8], const unsigned char* data, size_t blocks) {
+	const __m256i bswap = _mm256_set_epi64x(0x08090A0B0C0D0E0FLL, 0x0001020304050607LL,
+											0x08090A0B0C0D0E0FLL, 0x0001020304050607LL);
+	const __m256i zero	= _mm256_setzero_si256();
+	unsigned long long w[80], wk[80];
+	__m256i x, prev;
+	int i;
+
+	for (; blocks > 0; blocks--, data += SHA512_BLOCK_LENGTH) {
+		for (i = 0; i < 16; i += 4) {
+			x = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(data + i * 8)), bswap);
+			_mm256_storeu_si256((__m256i*)&w[i], x);
+			_mm256_storeu_si256((__m256i*)&wk[i],
+								_mm256_add_epi64(x, _mm256_loadu_si256((const __m256i*)&K[i])));
+		}
+
+		prev = x;
+		for (i = 16; i < 80; i += 4) {
+			x = _mm256_add_epi64(_mm256_loadu_si256((const __m256i*)&w[i - 16]),
+								 SHA512_AVX2_S0(_mm256_loadu_si256((const __m256i*)&w[i - 15])));
+			x = _mm256_add_epi64(x, _mm256_loadu_si256((const __m256i*)&w[i - 7]));
+
+			// W[t - 2] and W[t - 1] are the upper half of the previous vector
+			prev = SHA512_AVX2_S1(_mm256_permute4x64_epi64(prev, 0xEE));
+			x	 = _mm256_add_epi64(x, _mm256_blend_epi32(prev, zero, 0xF0));
+			prev = SHA512_AVX2_S1(_mm256_permute4x64_epi64(x, 0x44));
+			x	 = _mm256_add_epi64(x, _mm256_blend_epi32(zero, prev, 0xF0));
+
+			_mm256_storeu_si256((__m256i*)&w[i], x);
+			_mm256_storeu_si256((__m256i*)&wk[i],
+								_mm256_add_epi64(x, _mm256_loadu_si256((const __m256i*)&K[i])));
+			prev = x;
+		}
+
+		sha512_rounds(h, wk);
+	}
+}
+#endif	// #if CPU_X86
+
+static int sha512_kernel;  // SHA512_KERNEL_*, chosen on first use
+
+static void sha512_blocks(int kernel,
+						  unsigned long long h[8],
+						  const unsigned char* data,
+						  size_t blocks) {
+#if CPU_X86
+	if (kernel == SHA512_KERNEL_AVX2) {
+		sha512_blocks_avx2(h, data, blocks);
+		return;
+	}
+#endif
+	sha512_blocks_portable(h, data, blocks);
+}
+
+// Hashes a message with the given kernel
+static void sha512_kernel_digest(int kernel,
+								 const unsigned char* input,
+								 long long length,
+								 unsigned char output[SHA512_DIGEST_LENGTH]) {
+	sha512_ctx ctx;
+
+	sha512_init(&ctx);
+	ctx.kernel = kernel;
+	sha512_update(&ctx, input, length);
+	sha512_final(&ctx, output);
+}
+
+int sha512_self_test(void) {
+	// FIPS 180-2 appendix C: one and two blocks
+	static const unsigned char msg2[] =
+		"abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmno"
+		"ijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu";
+	static const unsigned char digest1[SHA512_DIGEST_LENGTH] = {
+		0xDD, 0xAF, 0x35, 0xA1, 0x93, 0x61, 0x7A, 0xBA,
+		0xCC, 0x41, 0x73, 0x49, 0xAE, 0x20, 0x41, 0x31,
+		0x12, 0xE6, 0xFA, 0x4E, 0x89, 0xA9, 0x7E, 0xA2,
+		0x0A, 0x9E, 0xEE, 0xE6, 0x4B, 0x55, 0xD3, 0x9A,
+		0x21, 0x92, 0x99, 0x2A, 0x27, 0x4F, 0xC1, 0xA8,
+		0x36, 0xBA, 0x3C, 0x23, 0xA3, 0xFE, 0xEB, 0xBD,
+		0x45, 0x4D, 0x44, 0x23, 0x64, 0x3C, 0xE8, 0x0E,
+		0x2A, 0x9A, 0xC9, 0x4F, 0xA5, 0x4C, 0xA4, 0x9F};
+	static const unsigned char digest2[SHA512_DIGEST_LENGTH] = {
+		0x8E, 0x95, 0x9B, 0x75, 0xDA, 0xE3, 0x13, 0xDA,
+		0x8C, 0xF4, 0xF7, 0x28, 0x14, 0xFC, 0x14, 0x3F,
+		0x8F, 0x77, 0x79, 0xC6, 0xEB, 0x9F, 0x7F, 0xA1,
+		0x72, 0x99, 0xAE, 0xAD, 0xB6, 0x88, 0x90, 0x18,
+		0x50, 0x1D, 0x28, 0x9E, 0x49, 0x00, 0xF7, 0xE4,
+		0x33, 0x1B, 0x99, 0xDE, 0xC4, 0xB5, 0x43, 0x3A,
+		0xC7, 0xD3, 0x29, 0xEE, 0xB6, 0xDD, 0x26, 0x54,
+		0x5E, 0x96, 0xE5, 0x5B, 0x87, 0x4B, 0xE9, 0x09};
+	unsigned char output[SHA512_DIGEST_LENGTH];
+	int kernel, ret = 0;
+
+	for (kernel = SHA512_KERNEL_PORTABLE; kernel <= SHA512_KERNEL_AVX2; kernel++) {
+		if (kernel == SHA512_KERNEL_AVX2) {
+#if CPU_X86
+			if (!(cpu_features() & CPU_FEATURE_AVX2))
+				break;
+#else
+			break;
+#endif
+		}
+
+		sha512_kernel_digest(kernel, msg2, 3, output);
+		if (memcmp(output, digest1, SHA512_DIGEST_LENGTH))
+			ret = SHA512_SELF_TEST_FAILED;
+		sha512_kernel_digest(kernel, msg2, sizeof(msg2) - 1, output);
+		if (memcmp(output, digest2, SHA512_DIGEST_LENGTH))
+			ret = SHA512_SELF_TEST_FAILED;
+		if (ret != 0)
+			return ret;
+	}
+	return ret;
+}
+
+// The fastest kernel available on this CPU that passes the self test
+static int sha512_kernel_select(void) {
+	if (sha512_kernel == 0) {
+		sha512_kernel = SHA512_KERNEL_PORTABLE;
+		if (sha512_self_test() == 0) {
+#if CPU_X86
+			if (cpu_features() & CPU_FEATURE_AVX2)
+				sha512_kernel = SHA512_KERNEL_AVX2;
+#endif
+		}
+	}
+	return sha512_kernel;
+}
+
+void sha384_init(sha512_ctx* ctx) {
+	ctx->state[0]	  = 0xCBBB9D5DC1059ED8ULL;
+	ctx->state[1]	  = 0x629A292A367CD507ULL;
+	ctx->state[2]	  = 0x9159015A3070DD17ULL;
+	ctx->state[3]	  = 0x152FECD8F70E5939ULL;
+	ctx->state[4]	  = 0x67332667FFC00B31ULL;
+	ctx->state[5]	  = 0x8EB44A8768581511ULL;
+	ctx->state[6]	  = 0xDB0C2E0D64F98FA7ULL;
+	ctx->state[7]	  = 0x47B5481DBEFA4FA4ULL;
+	ctx->length		  = 0;
+	ctx->digestLength = SHA384_DIGEST_LENGTH;
+	ctx->kernel		  = sha512_kernel_select();
+}
+
+void sha512_init(sha512_ctx* ctx) {
+	ctx->state[0]	  = 0x6A09E667F3BCC908ULL;
+	ctx->state[1]	  = 0xBB67AE8584CAA73BULL;
+	ctx->state[2]	  = 0x3C6EF372FE94F82BULL;
+	ctx->state[3]	  = 0xA54FF53A5F1D36F1ULL;
+	ctx->state[4]	  = 0x510E527FADE682D1ULL;
+	ctx->state[5]	  = 0x9B05688C2B3E6C1FULL;
+	ctx->state[6]	  = 0x1F83D9ABFB41BD6BULL;
+	ctx->state[7]	  = 0x5BE0CD19137E2179ULL;
+	ctx->length		  = 0;
+	ctx->digestLength = SHA512_DIGEST_LENGTH;
+	ctx->kernel		  = sha512_kernel_select();
+}
+
+void sha512_update(sha512_ctx* ctx, const unsigned char* input, long long length) {
+	size_t fill = (size_t)(ctx->length % SHA512_BLOCK_LENGTH);
+	size_t n	= (size_t)length;
+	size_t take;
+
+	ctx->length += (unsigned long long)length;
+
+	// Complete a partial block first
+	if (fill > 0) {
+		take = SHA512_BLOCK_LENGTH - fill < n ? SHA512_BLOCK_LENGTH - fill : n;
+		memcpy(&ctx->buffer[fill], input, take);
+		input += take;
+		n -= take;
+		if (fill + take < SHA512_BLOCK_LENGTH)
+			return;
+		sha512_blocks(ctx->kernel, ctx->state, ctx->buffer, 1);
+	}
+
+	// Whole blocks are compressed in place
+	if (n >= SHA512_BLOCK_LENGTH) {
+		sha512_blocks(ctx->kernel, ctx->state, input, n / SHA512_BLOCK_LENGTH);
+		input += n - n % SHA512_BLOCK_LENGTH;
+		n %= SHA512_BLOCK_LENGTH;
+	}
+	memcpy(ctx->buffer, input, n);
+}
+
+void sha512_final(sha512_ctx* ctx, unsigned char* output) {
+	size_t fill				= (size_t)(ctx->length % SHA512_BLOCK_LENGTH);
+	unsigned long long high = ctx->length >> 61, low = ctx->length << 3;
+	int i;
+
+	// Padding: 0x80, zeros and the 128-bit message length in bits
+	ctx->buffer[fill++] = 0x80;
+	if (fill > SHA512_BLOCK_LENGTH - 16) {
+		memset(&ctx->buffer[fill], 0, SHA512_BLOCK_LENGTH - fill);
+		sha512_blocks(ctx->kernel, ctx->state, ctx->buffer, 1);
+		fill = 0;
+	}
+	memset(&ctx->buffer[fill], 0, SHA512_BLOCK_LENGTH - 16 - fill);
+	for (i = 0; i < 8; i++) {
+		ctx->buffer[SHA512_BLOCK_LENGTH - 16 + i] = (unsigned char)(high >> ((7 - i) * 8));
+		ctx->buffer[SHA512_BLOCK_LENGTH - 8 + i]  = (unsigned char)(low >> ((7 - i) * 8));
+	}
+	sha512_blocks(ctx->kernel, ctx->state, ctx->buffer, 1);
+
+	// SHA-384 is the truncated SHA-512 of other initial values
+	for (i = 0; i < ctx->digestLength; i++)
+		output[i] = (unsigned char)(ctx->state[i / 8] >> ((7 - i % 8) * 8));
+	memset(ctx, 0, sizeof(sha512_ctx));
+}
+
+void sha384(const unsigned char* input, long long len, unsigned char* output) {
+	sha512_ctx ctx;
+
+	sha384_init(&ctx);
+	sha512_update(&ctx, input, len);
+	sha512_final(&ctx, output);
+}
+
+void sha512(const unsigned char* input, long long len, unsigned char* output) {
+	sha512_ctx ctx;
+
+	sha512_init(&ctx);
+	sha512_update(&ctx, input, len);
+	sha512_final(&ctx, output);
+}
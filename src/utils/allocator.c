@@ -0,0 +1,55 @@
+/**
+ * @author Khoa Nguyen
+ * @file allocator.c
+ * @brief Source file for the heap allocations of the library.
+ */
+
+#include <stdlib.h>
+
+#include "config.h"
+
+#include <utils/allocator.h>
+
+#if USE_ALLOC_COUNTER
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+// Each thread counts its own allocations, the others cannot change the count it checks
+static THREAD_LOCAL long long allocations;
+
+static void CountAllocation(void) {
+	allocations++;
+}
+#else
+#define CountAllocation()
+#endif	// #if USE_ALLOC_COUNTER
+
+void* AllocatorMalloc(size_t size) {
+	CountAllocation();
+	return malloc(size);
+}
+
+void* AllocatorCalloc(size_t count, size_t size) {
+	CountAllocation();
+	return calloc(count, size);
+}
+
+void* AllocatorRealloc(void* block, size_t size) {
+	CountAllocation();
+	return realloc(block, size);
+}
+
+void AllocatorFree(void* block) {
+	free(block);
+}
+
+long long AllocatorThreadCount(void) {
+#if USE_ALLOC_COUNTER
+	return allocations;
+#else
+	return 0;
+#endif	// #if USE_ALLOC_COUNTER
+}
@@ -0,0 +1,531 @@
+/**
+ * @author Khoa Nguyen
+ * @file certificate.c
+ * @brief Source file for X.509 certificate decoding and signature verification functions.
+ */
+
+#include <string.h>
+
+#include <cryptography/ecc.h>
+#include <cryptography/hash.h>
+#include <cryptography/rsa.h>
+#include <utils/certificate.h>
+#include <utils/public_key.h>
+#include <utils/reader.h>
+#include <utils/tlv.h>
+
+#define CERTIFICATE_MAX_FIELDS 10
+
+// id-sha1 = 1.3.14.3.2.26, id-sha224 to id-sha512 = 2.16.840.1.101.3.4.2.4, 1, 2 and 3
+static const unsigned char SHA1_OID[5] = {0x2B, 0x0E, 0x03, 0x02, 0x1A};
+static const unsigned char SHA2_OID[8] = {0x60, 0x86, 0x48, 0x01, 0x65, 0x03, 0x04, 0x02};
+
+// PKCS #1 = 1.2.840.113549.1.1: rsaEncryption 1, RSASSA-PSS 10, id-mgf1 8, sha*WithRSAEncryption
+static const unsigned char PKCS1_OID[8] = {0x2A, 0x86, 0x48, 0x86, 0xF7, 0x0D, 0x01, 0x01};
+
+// ecdsa-with-SHA1 = 1.2.840.10045.4.1, ecdsa-with-SHA224 to SHA512 = 1.2.840.10045.4.3.1 to 4
+static const unsigned char ECDSA_SHA1_OID[7] = {0x2A, 0x86, 0x48, 0xCE, 0x3D, 0x04, 0x01};
+static const unsigned char ECDSA_SHA2_OID[7] = {0x2A, 0x86, 0x48, 0xCE, 0x3D, 0x04, 0x03};
+
+// rsaEncryption = 1.2.840.113549.1.1.1, id-ecPublicKey = 1.2.840.10045.2.1
+static const unsigned char RSA_OID[9] = {0x2A, 0x86, 0x48, 0x86, 0xF7, 0x0D, 0x01, 0x01, 0x01};
+static const unsigned char EC_PUBLIC_KEY_OID[7] = {0x2A, 0x86, 0x48, 0xCE, 0x3D, 0x02, 0x01};
+
+#define PKCS1_RSA_ENCRYPTION 0x01
+#define PKCS1_MGF1			 0x08
+#define PKCS1_RSASSA_PSS	 0x0A
+
+// RSASSA-PSS parameters, SHA-1 and 20 bytes of salt when absent
+typedef struct {
+	int hashAlgorithm;
+	int maskHashAlgorithm;
+	int saltLength;
+} PssParameters;
+
+// Decodes the next object of a constructed value, keeping its tag and length
+static int NextObject(const unsigned char* buf,
+					  int bufLen,
+					  int* pos,
+					  unsigned int* tag,
+					  const unsigned char** object,
+					  int* objectLength,
+					  int* headerLength) {
+	int length;
+	if (*pos >= bufLen ||
+		TlvParse(&buf[*pos], bufLen - *pos, tag, &length, headerLength) != APP_SUCCESS) {
+		return APP_ERROR;
+	}
+	*object		  = &buf[*pos];
+	*objectLength = *headerLength + length;
+	*pos += *objectLength;
+	return APP_SUCCESS;
+}
+
+static int IsPkcs1Oid(const unsigned char* oid, int oidLength, unsigned char last) {
+	return oidLength == sizeof(PKCS1_OID) + 1 && !memcmp(oid, PKCS1_OID, sizeof(PKCS1_OID)) &&
+		   oid[sizeof(PKCS1_OID)] == last;
+}
+
+int ParseCertificate(const unsigned char* buf, int bufLen, Certificate* cert) {
+	const unsigned char *certificate, *values[3];
+	int certificateLength, lengths[3];
+	unsigned int tags[3];
+
+	// Certificate ::= SEQUENCE { tbsCertificate, signatureAlgorithm, signatureValue BIT STRING }
+	if (TlvFind(buf, bufLen, 0x30, &certificate, &certificateLength) != APP_SUCCESS ||
+		TlvSplit(certificate, certificateLength, tags, values, lengths, 3) != 3 ||
+		tags[0] != 0x30 || tags[1] != 0x30 || tags[2] != 0x03 || lengths[2] < 2 ||
+		values[2][0] != 0x00) {
+		return APP_ERROR;
+	}
+	cert->signatureAlgorithm	   = values[1];
+	cert->signatureAlgorithmLength = lengths[1];
+	cert->signature				   = &values[2][1];
+	cert->signatureLength		   = lengths[2] - 1;
+
+	int headerLength, pos = 0;
+	unsigned int tag;
+	const unsigned char* object;
+	int objectLength;
+	if (NextObject(certificate, certificateLength, &pos, &tag, &cert->tbs, &cert->tbsLength,
+				   &headerLength) != APP_SUCCESS) {
+		return APP_ERROR;
+	}
+	const unsigned char* tbs = &cert->tbs[headerLength];
+	int tbsLength			 = cert->tbsLength - headerLength;
+
+	// TBSCertificate ::= SEQUENCE { version [0] EXPLICIT DEFAULT v1, serialNumber, signature,
+	//								 issuer, validity, subject, subjectPublicKeyInfo,
+	//								 issuerUniqueID [1], subjectUniqueID [2], extensions [3] }
+	const unsigned char* fields[CERTIFICATE_MAX_FIELDS];
+	int fieldLengths[CERTIFICATE_MAX_FIELDS], fieldHeaders[CERTIFICATE_MAX_FIELDS];
+	unsigned int fieldTags[CERTIFICATE_MAX_FIELDS];
+	int count = 0;
+	pos		  = 0;
+	while (pos < tbsLength && count < CERTIFICATE_MAX_FIELDS) {
+		if (NextObject(tbs, tbsLength, &pos, &fieldTags[count], &fields[count],
+					   &fieldLengths[count], &fieldHeaders[count]) != APP_SUCCESS) {
+			return APP_ERROR;
+		}
+		count++;
+	}
+	int first = count > 0 && fieldTags[0] == 0xA0 ? 1 : 0;
+	if (count < first + 6 || fieldTags[first] != 0x02 || fieldTags[first + 1] != 0x30 ||
+		fieldTags[first + 2] != 0x30 || fieldTags[first + 3] != 0x30 ||
+		fieldTags[first + 4] != 0x30 || fieldTags[first + 5] != 0x30) {
+		return APP_ERROR;
+	}
+	cert->serialNumber		 = &fields[first][fieldHeaders[first]];
+	cert->serialNumberLength = fieldLengths[first] - fieldHeaders[first];
+	cert->issuer			 = fields[first + 2];
+	cert->issuerLength		 = fieldLengths[first + 2];
+	cert->subject			 = fields[first + 4];
+	cert->subjectLength		 = fieldLengths[first + 4];
+	cert->publicKey			 = fields[first + 5];
+	cert->publicKeyLength	 = fieldLengths[first + 5];
+
+	// Extensions ::= SEQUENCE SIZE (1..MAX) OF Extension, wrapped in [3]
+	cert->extensions	   = NULL;
+	cert->extensionsLength = 0;
+	for (int i = first + 6; i < count; i++) {
+		if (fieldTags[i] == 0xA3) {
+			pos = 0;
+			if (NextObject(&fields[i][fieldHeaders[i]], fieldLengths[i] - fieldHeaders[i], &pos,
+						   &tag, &object, &objectLength, &headerLength) != APP_SUCCESS ||
+				tag != 0x30) {
+				return APP_ERROR;
+			}
+			cert->extensions	   = &object[headerLength];
+			cert->extensionsLength = objectLength - headerLength;
+		}
+	}
+	return APP_SUCCESS;
+}
+
+int CertificateExtension(const Certificate* cert,
+						 const unsigned char* oid,
+						 int oidLength,
+						 const unsigned char** value,
+						 int* length) {
+	int pos = 0;
+	while (pos < cert->extensionsLength) {
+		unsigned int tag;
+		int extensionLength, headerLength;
+		if (TlvParse(&cert->extensions[pos], cert->extensionsLength - pos, &tag,
+					 &extensionLength, &headerLength) != APP_SUCCESS) {
+			return APP_ERROR;
+		}
+		const unsigned char* extension = &cert->extensions[pos + headerLength];
+		pos += headerLength + extensionLength;
+
+		// Extension ::= SEQUENCE { extnID OID, critical BOOLEAN DEFAULT FALSE, extnValue OCTET }
+		const unsigned char* fields[3];
+		int fieldLengths[3];
+		unsigned int fieldTags[3];
+		int count = TlvSplit(extension, extensionLength, fieldTags, fields, fieldLengths, 3);
+		if (tag != 0x30 || count < 2 || fieldTags[0] != 0x06 || fieldLengths[0] != oidLength ||
+			memcmp(fields[0], oid, oidLength) || fieldTags[count - 1] != 0x04) {
+			continue;
+		}
+		*value	= fields[count - 1];
+		*length = fieldLengths[count - 1];
+		return APP_SUCCESS;
+	}
+	return APP_ERROR;
+}
+
+int DigestAlgorithm(const unsigned char* oid, int oidLength) {
+	if (oidLength == sizeof(SHA1_OID) && !memcmp(oid, SHA1_OID, sizeof(SHA1_OID))) {
+		return HASH_SHA1;
+	}
+	if (oidLength == sizeof(SHA2_OID) + 1 && !memcmp(oid, SHA2_OID, sizeof(SHA2_OID))) {
+		switch (oid[sizeof(SHA2_OID)]) {
+			case 0x01:
+				return HASH_SHA256;
+			case 0x02:
+				return HASH_SHA384;
+			case 0x03:
+				return HASH_SHA512;
+			case 0x04:
+				return HASH_SHA224;
+		}
+	}
+	return APP_ERROR;
+}
+
+// Hash of an AlgorithmIdentifier content, the parameters (NULL or absent) are not checked
+static int AlgorithmIdentifierHash(const unsigned char* algorithm, int algorithmLength) {
+	const unsigned char* values[2];
+	int lengths[2];
+	unsigned int tags[2];
+	if (TlvSplit(algorithm, algorithmLength, tags, values, lengths, 2) < 1 || tags[0] != 0x06) {
+		return APP_ERROR;
+	}
+	return DigestAlgorithm(values[0], lengths[0]);
+}
+
+// RSASSA-PSS-params ::= SEQUENCE { hashAlgorithm [0], maskGenAlgorithm [1], saltLength [2],
+//									trailerField [3] }
+static int ParsePssParameters(const unsigned char* parameters,
+							  int parametersLength,
+							  PssParameters* pss) {
+	const unsigned char *values[4], *inner;
+	int lengths[4], innerLength;
+	unsigned int tags[4];
+
+	pss->hashAlgorithm	   = HASH_SHA1;
+	pss->maskHashAlgorithm = HASH_SHA1;
+	pss->saltLength		   = 20;
+	int count = TlvSplit(parameters, parametersLength, tags, values, lengths, 4);
+	if (count < 0) {
+		return APP_ERROR;
+	}
+	for (int i = 0; i < count; i++) {
+		if (tags[i] == 0xA0) {
+			if (TlvFind(values[i], lengths[i], 0x30, &inner, &innerLength) != APP_SUCCESS ||
+				(pss->hashAlgorithm = AlgorithmIdentifierHash(inner, innerLength)) == APP_ERROR) {
+				return APP_ERROR;
+			}
+		} else if (tags[i] == 0xA1) {
+			// MaskGenAlgorithm ::= SEQUENCE { id-mgf1, hashAlgorithm AlgorithmIdentifier }
+			const unsigned char* mgf[2];
+			int mgfLengths[2];
+			unsigned int mgfTags[2];
+			if (TlvFind(values[i], lengths[i], 0x30, &inner, &innerLength) != APP_SUCCESS ||
+				TlvSplit(inner, innerLength, mgfTags, mgf, mgfLengths, 2) != 2 ||
+				mgfTags[0] != 0x06 || !IsPkcs1Oid(mgf[0], mgfLengths[0], PKCS1_MGF1) ||
+				mgfTags[1] != 0x30 ||
+				(pss->maskHashAlgorithm = AlgorithmIdentifierHash(mgf[1], mgfLengths[1])) ==
+					APP_ERROR) {
+				return APP_ERROR;
+			}
+		} else if (tags[i] == 0xA2) {
+			if (TlvFind(values[i], lengths[i], 0x02, &inner, &innerLength) != APP_SUCCESS ||
+				(pss->saltLength = TlvReadInteger(inner, innerLength)) < 0) {
+				return APP_ERROR;
+			}
+		}
+	}
+	return APP_SUCCESS;
+}
+
+int SignatureHashAlgorithm(const unsigned char* algorithm, int algorithmLength) {
+	const unsigned char* values[2];
+	int lengths[2];
+	unsigned int tags[2];
+	int count = TlvSplit(algorithm, algorithmLength, tags, values, lengths, 2);
+	if (count < 1 || tags[0] != 0x06) {
+		return APP_ERROR;
+	}
+	const unsigned char* oid = values[0];
+	int oidLength			 = lengths[0];
+
+	if (IsPkcs1Oid(oid, oidLength, PKCS1_RSA_ENCRYPTION)) {
+		return 0;
+	}
+	if (IsPkcs1Oid(oid, oidLength, PKCS1_RSASSA_PSS)) {
+		PssParameters pss;
+		if (ParsePssParameters(count == 2 ? values[1] : NULL, count == 2 ? lengths[1] : 0,
+							   &pss) != APP_SUCCESS) {
+			return APP_ERROR;
+		}
+		return pss.hashAlgorithm;
+	}
+	if (oidLength == sizeof(PKCS1_OID) + 1 && !memcmp(oid, PKCS1_OID, sizeof(PKCS1_OID))) {
+		// sha1WithRSAEncryption 5, sha256 11, sha384 12, sha512 13, sha224 14
+		switch (oid[sizeof(PKCS1_OID)]) {
+			case 0x05:
+				return HASH_SHA1;
+			case 0x0B:
+				return HASH_SHA256;
+			case 0x0C:
+				return HASH_SHA384;
+			case 0x0D:
+				return HASH_SHA512;
+			case 0x0E:
+				return HASH_SHA224;
+		}
+		return APP_ERROR;
+	}
+	if (oidLength == sizeof(ECDSA_SHA1_OID) && !memcmp(oid, ECDSA_SHA1_OID, oidLength)) {
+		return HASH_SHA1;
+	}
+	if (oidLength == sizeof(ECDSA_SHA2_OID) + 1 &&
+		!memcmp(oid, ECDSA_SHA2_OID, sizeof(ECDSA_SHA2_OID)) && oid[sizeof(ECDSA_SHA2_OID)] >= 1 &&
+		oid[sizeof(ECDSA_SHA2_OID)] <= 4) {
+		return HASH_SHA224 + oid[sizeof(ECDSA_SHA2_OID)] - 1;
+	}
+	return APP_ERROR;
+}
+
+// EMSA-PKCS1-v1_5: 00 01 FF .. FF 00 DigestInfo, DigestInfo ::= SEQUENCE { digestAlgorithm,
+// digest OCTET STRING }
+static int Pkcs1Verify(const unsigned char* em,
+					   int emLength,
+					   int hashAlgorithm,
+					   const unsigned char* digest) {
+	int pos = 2;
+	if (em[0] != 0x00 || em[1] != 0x01) {
+		return APP_ERROR;
+	}
+	while (pos < emLength && em[pos] == 0xFF) {
+		pos++;
+	}
+	if (pos < 10 || pos >= emLength || em[pos++] != 0x00) {
+		return APP_ERROR;
+	}
+
+	const unsigned char *digestInfo, *values[2];
+	int digestInfoLength, lengths[2];
+	unsigned int tag, tags[2];
+	int headerLength;
+	if (TlvParse(&em[pos], emLength - pos, &tag, &digestInfoLength, &headerLength) !=
+			APP_SUCCESS ||
+		tag != 0x30 || pos + headerLength + digestInfoLength != emLength) {
+		return APP_ERROR;
+	}
+	digestInfo = &em[pos + headerLength];
+	if (TlvSplit(digestInfo, digestInfoLength, tags, values, lengths, 2) != 2 || tags[0] != 0x30 ||
+		tags[1] != 0x04 || AlgorithmIdentifierHash(values[0], lengths[0]) != hashAlgorithm ||
+		lengths[1] != hash_length(hashAlgorithm) || memcmp(values[1], digest, lengths[1])) {
+		return APP_ERROR;
+	}
+	return APP_SUCCESS;
+}
+
+// MGF1 mask XORed into a buffer
+static void Mgf1Mask(int hashAlgorithm,
+					 const unsigned char* seed,
+					 int seedLength,
+					 unsigned char* buf,
+					 int bufLength) {
+	unsigned char counter[4];
+	unsigned char mask[HASH_MAX_DIGEST_LENGTH];
+	int hashLength = hash_length(hashAlgorithm);
+	hash_ctx ctx;
+
+	for (int pos = 0; pos < bufLength; pos += hashLength) {
+		// Big-endian block counter
+		unsigned int block = (unsigned int)(pos / hashLength);
+		counter[0]		   = (unsigned char)(block >> 24);
+		counter[1]		   = (unsigned char)(block >> 16);
+		counter[2]		   = (unsigned char)(block >> 8);
+		counter[3]		   = (unsigned char)block;
+		hash_init(&ctx, hashAlgorithm);
+		hash_update(&ctx, seed, seedLength);
+		hash_update(&ctx, counter, 4);
+		hash_final(&ctx, mask);
+		for (int i = 0; i < hashLength && pos + i < bufLength; i++) {
+			buf[pos + i] ^= mask[i];
+		}
+	}
+}
+
+// EMSA-PSS: EM = maskedDB || H || BC, DB = 00 .. 00 01 || salt, H = Hash(00 * 8 || mHash || salt)
+static int PssVerify(unsigned char* em,
+					 int emBits,
+					 const PssParameters* pss,
+					 int hashAlgorithm,
+					 const unsigned char* digest) {
+	static const unsigned char zeros[8] = {0};
+	unsigned char h[HASH_MAX_DIGEST_LENGTH];
+	int hashLength = hash_length(pss->hashAlgorithm);
+	int emLength   = (emBits + 7) / 8;
+	int dbLength   = emLength - hashLength - 1;
+	hash_ctx ctx;
+
+	if (hashAlgorithm != pss->hashAlgorithm || dbLength < pss->saltLength + 1 ||
+		em[emLength - 1] != 0xBC || (em[0] >> (8 - (8 * emLength - emBits))) != 0) {
+		return APP_ERROR;
+	}
+	Mgf1Mask(pss->maskHashAlgorithm, &em[dbLength], hashLength, em, dbLength);
+	em[0] &= (unsigned char)(0xFF >> (8 * emLength - emBits));
+
+	int saltStart = dbLength - pss->saltLength;
+	for (int i = 0; i < saltStart - 1; i++) {
+		if (em[i] != 0x00) {
+			return APP_ERROR;
+		}
+	}
+	if (em[saltStart - 1] != 0x01) {
+		return APP_ERROR;
+	}
+
+	hash_init(&ctx, pss->hashAlgorithm);
+	hash_update(&ctx, zeros, sizeof(zeros));
+	hash_update(&ctx, digest, hashLength);
+	hash_update(&ctx, &em[saltStart], pss->saltLength);
+	hash_final(&ctx, h);
+	return memcmp(h, &em[dbLength], hashLength) ? APP_ERROR : APP_SUCCESS;
+}
+
+static int RsaSignatureVerify(const PublicKeyInfo* info,
+							  const unsigned char* algorithm,
+							  int algorithmLength,
+							  int hashAlgorithm,
+							  const unsigned char* digest,
+							  const unsigned char* signature,
+							  int signatureLength) {
+	unsigned char em[RSA_MAX_BYTES];
+	rsa_context rsa;
+
+	// RSAPublicKey ::= SEQUENCE { modulus INTEGER, publicExponent INTEGER }
+	const unsigned char *rsaKey, *values[2];
+	int rsaKeyLength, lengths[2];
+	unsigned int tags[2];
+	if (TlvFind(info->key, info->keyLength, 0x30, &rsaKey, &rsaKeyLength) != APP_SUCCESS ||
+		TlvSplit(rsaKey, rsaKeyLength, tags, values, lengths, 2) != 2 || tags[0] != 0x02 ||
+		tags[1] != 0x02 ||
+		rsa_set_public(&rsa, values[0], lengths[0], values[1], lengths[1]) != 0 ||
+		signatureLength != rsa.len || rsa_public(&rsa, signature, em) != 0) {
+		return APP_ERROR;
+	}
+
+	const unsigned char* parameters[2];
+	int parameterLengths[2];
+	unsigned int parameterTags[2];
+	int count =
+		TlvSplit(algorithm, algorithmLength, parameterTags, parameters, parameterLengths, 2);
+	if (count < 1 || parameterTags[0] != 0x06) {
+		return APP_ERROR;
+	}
+	if (!IsPkcs1Oid(parameters[0], parameterLengths[0], PKCS1_RSASSA_PSS)) {
+		return Pkcs1Verify(em, rsa.len, hashAlgorithm, digest);
+	}
+
+	// The encoded message has one bit less than the modulus, and one byte less when it is 8k + 1
+	PssParameters pss;
+	const unsigned char* modulus = values[0];
+	int modulusLength			 = lengths[0];
+	while (modulusLength > 0 && modulus[0] == 0x00) {
+		modulus++;
+		modulusLength--;
+	}
+	int modulusBits = 8 * modulusLength;
+	for (unsigned char top = modulus[0]; !(top & 0x80); top <<= 1) {
+		modulusBits--;
+	}
+	if (ParsePssParameters(count == 2 ? parameters[1] : NULL, count == 2 ? parameterLengths[1] : 0,
+						   &pss) != APP_SUCCESS) {
+		return APP_ERROR;
+	}
+	if (modulusBits % 8 == 1) {
+		return em[0] == 0x00 ? PssVerify(&em[1], modulusBits - 1, &pss, hashAlgorithm, digest)
+							 : APP_ERROR;
+	}
+	return PssVerify(em, modulusBits - 1, &pss, hashAlgorithm, digest);
+}
+
+// ECDSA-Sig-Value ::= SEQUENCE { r INTEGER, s INTEGER }
+static int EcdsaSignatureVerify(const PublicKeyInfo* info,
+								int hashAlgorithm,
+								const unsigned char* digest,
+								const unsigned char* signature,
+								int signatureLength) {
+	unsigned char r[ECC_MAX_BYTES], s[ECC_MAX_BYTES];
+	ecc_group explicitGroup;
+	ecc_point q;
+
+	const ecc_group* grp = PublicKeyCurve(info, &explicitGroup);
+	if (grp == NULL || ecc_point_read(grp, &q, info->key, info->keyLength) != 0) {
+		return APP_ERROR;
+	}
+
+	const unsigned char *sequence, *values[2];
+	int sequenceLength, lengths[2];
+	unsigned int tags[2];
+	int len = grp->orderByteLength;
+	if (TlvFind(signature, signatureLength, 0x30, &sequence, &sequenceLength) != APP_SUCCESS ||
+		TlvSplit(sequence, sequenceLength, tags, values, lengths, 2) != 2 || tags[0] != 0x02 ||
+		tags[1] != 0x02) {
+		return APP_ERROR;
+	}
+	for (int i = 0; i < 2; i++) {
+		while (lengths[i] > 0 && values[i][0] == 0x00) {
+			values[i]++;
+			lengths[i]--;
+		}
+		if (lengths[i] > len) {
+			return APP_ERROR;
+		}
+	}
+	memset(r, 0, len);
+	memset(s, 0, len);
+	memcpy(&r[len - lengths[0]], values[0], lengths[0]);
+	memcpy(&s[len - lengths[1]], values[1], lengths[1]);
+
+	if (ecdsa_verify(grp, &q, digest, hash_length(hashAlgorithm), r, s) != 0) {
+		return APP_ERROR;
+	}
+	return APP_SUCCESS;
+}
+
+int SignatureVerify(const unsigned char* publicKey,
+					int publicKeyLength,
+					const unsigned char* algorithm,
+					int algorithmLength,
+					int hashAlgorithm,
+					const unsigned char* digest,
+					const unsigned char* signature,
+					int signatureLength) {
+	PublicKeyInfo info;
+	int signatureHash = SignatureHashAlgorithm(algorithm, algorithmLength);
+
+	// The hash named by the signature algorithm must be the hash of the digest
+	if (hash_length(hashAlgorithm) == 0 || signatureHash == APP_ERROR ||
+		(signatureHash != 0 && signatureHash != hashAlgorithm) ||
+		ParsePublicKeyInfo(publicKey, publicKeyLength, &info) != APP_SUCCESS) {
+		return APP_ERROR;
+	}
+	if (info.algorithmLength == sizeof(RSA_OID) &&
+		!memcmp(info.algorithm, RSA_OID, sizeof(RSA_OID))) {
+		return RsaSignatureVerify(&info, algorithm, algorithmLength, hashAlgorithm, digest,
+								  signature, signatureLength);
+	}
+	if (info.algorithmLength == sizeof(EC_PUBLIC_KEY_OID) &&
+		!memcmp(info.algorithm, EC_PUBLIC_KEY_OID, sizeof(EC_PUBLIC_KEY_OID)) &&
+		signatureHash != 0) {
+		return EcdsaSignatureVerify(&info, hashAlgorithm, digest, signature, signatureLength);
+	}
+	return APP_ERROR;
+}
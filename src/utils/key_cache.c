@@ -0,0 +1,276 @@
+/**
+ * @author Khoa Nguyen
+ * @file key_cache.c
+ * @brief Source file for the learned BAC key cache of document-number reads.
+ */
+
+#include <Windows.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cryptography/aes.h>
+#include <cryptography/cmac.h>
+#include <cryptography/sha256.h>
+#include <utils/key_cache.h>
+#include <utils/random.h>
+#include <utils/reader.h>
+#include <utils/sync.h>
+
+#define KEY_CACHE_TAG_LENGTH	 16
+#define KEY_CACHE_PAYLOAD_LENGTH 48	 // KeyCacheEntry padded to whole AES blocks
+
+// Cache file: the header then the slots, integers are little-endian
+typedef struct {
+	char magic[8];
+	unsigned int slots;
+	unsigned int clock;	 // Last stamp given to a used slot
+} KeyCacheHeader;
+
+// Slot of a document number, empty while its tag is zero
+typedef struct {
+	unsigned char tag[KEY_CACHE_TAG_LENGTH];  // AES-CMAC of the document number
+	unsigned char iv[16];
+	unsigned char payload[KEY_CACHE_PAYLOAD_LENGTH];  // KeyCacheEntry, AES-128-CBC encrypted
+	unsigned char mac[16];							  // AES-CMAC of the tag, IV and payload
+	unsigned int lastUsed;
+} KeyCacheSlot;
+
+C_ASSERT(sizeof(KeyCacheEntry) <= KEY_CACHE_PAYLOAD_LENGTH);
+
+// The open cache, view is NULL when there is none
+static SyncLock cacheLock = SYNC_INIT;
+static struct {
+	HANDLE file;
+	unsigned char* view;
+	unsigned int slots;
+	unsigned char tagKey[16];
+	unsigned char encryptKey[16];
+	unsigned char macKey[16];
+} cache;
+
+// Key of the given label: the first 16 bytes of SHA-256(secret || label)
+static void DeriveKey(const unsigned char secret[KEY_CACHE_SECRET_LENGTH],
+					  unsigned char label,
+					  unsigned char key[16]) {
+	unsigned char digest[SHA256_DIGEST_LENGTH];
+	sha256_ctx ctx;
+	sha256_init(&ctx);
+	sha256_update(&ctx, secret, KEY_CACHE_SECRET_LENGTH);
+	sha256_update(&ctx, &label, 1);
+	sha256_final(&ctx, digest);
+	memcpy(key, digest, 16);
+}
+
+// The first byte of the file is locked while a process uses the slots
+static void LockCacheFile(HANDLE file) {
+	OVERLAPPED overlapped = {0};
+	LockFileEx(file, LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &overlapped);
+}
+
+static void UnlockCacheFile(HANDLE file) {
+	OVERLAPPED overlapped = {0};
+	UnlockFileEx(file, 0, 1, 0, &overlapped);
+}
+
+static void CloseCache(void) {
+	if (cache.view != NULL) {
+		UnmapViewOfFile(cache.view);
+		CloseHandle(cache.file);
+	}
+	memset(&cache, 0, sizeof(cache));
+}
+
+long KeyCacheOpen(const char* path,
+				  int slots,
+				  const unsigned char secret[KEY_CACHE_SECRET_LENGTH]) {
+	unsigned char* view = NULL;
+	HANDLE mapping		= NULL;
+	LARGE_INTEGER size;
+
+	if (slots <= 0) {
+		slots = KEY_CACHE_DEFAULT_SLOTS;
+	}
+	slots = (slots + KEY_CACHE_WAYS - 1) / KEY_CACHE_WAYS * KEY_CACHE_WAYS;
+
+	HANDLE file =
+		CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+					OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		printf("Fail to Open key cache.\n");
+		return APP_ERROR;
+	}
+
+	// The first process to lock an empty file formats it, the mapping extends it to its size
+	LockCacheFile(file);
+	if (GetFileSizeEx(file, &size) &&
+		(size.QuadPart == 0 || size.QuadPart >= (LONGLONG)sizeof(KeyCacheHeader)) &&
+		size.QuadPart <= 0x7FFFFFFF) {
+		if (size.QuadPart == 0) {
+			size.QuadPart = sizeof(KeyCacheHeader) + (LONGLONG)slots * sizeof(KeyCacheSlot);
+		}
+		mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, 0, (DWORD)size.QuadPart, NULL);
+	}
+	if (mapping != NULL) {
+		view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+		CloseHandle(mapping);
+	}
+	KeyCacheHeader* header = (KeyCacheHeader*)view;
+	if (view != NULL && header->slots == 0) {
+		memcpy(header->magic, KEY_CACHE_MAGIC, 8);
+		header->slots = slots;
+	}
+	UnlockCacheFile(file);
+
+	if (view == NULL || memcmp(header->magic, KEY_CACHE_MAGIC, 8) ||
+		header->slots % KEY_CACHE_WAYS || header->slots == 0 ||
+		size.QuadPart != sizeof(KeyCacheHeader) + (LONGLONG)header->slots * sizeof(KeyCacheSlot)) {
+		printf("Invalid key cache.\n");
+		if (view != NULL) {
+			UnmapViewOfFile(view);
+		}
+		CloseHandle(file);
+		return APP_ERROR;
+	}
+
+	SyncLockExclusive(&cacheLock);
+	CloseCache();
+	cache.file	= file;
+	cache.view	= view;
+	cache.slots = header->slots;
+	DeriveKey(secret, 'T', cache.tagKey);
+	DeriveKey(secret, 'E', cache.encryptKey);
+	DeriveKey(secret, 'M', cache.macKey);
+	SyncUnlockExclusive(&cacheLock);
+	return APP_SUCCESS;
+}
+
+void KeyCacheClose(void) {
+	SyncLockExclusive(&cacheLock);
+	CloseCache();
+	SyncUnlockExclusive(&cacheLock);
+}
+
+static void SlotMac(const KeyCacheSlot* slot, unsigned char mac[16]) {
+	aes_cmac_checksum(KEY_CACHE_TAG_LENGTH + 16 + KEY_CACHE_PAYLOAD_LENGTH, mac, slot->tag,
+					  cache.macKey, 16);
+}
+
+/**
+ * @brief Locks the cache and returns the first slot of the set of a document number, or NULL
+ * without a lock if no cache is open.
+ */
+static KeyCacheSlot* LockSet(const unsigned char documentNumber[9],
+							 unsigned char tag[KEY_CACHE_TAG_LENGTH]) {
+	SyncLockExclusive(&cacheLock);
+	if (cache.view == NULL) {
+		SyncUnlockExclusive(&cacheLock);
+		return NULL;
+	}
+	aes_cmac_checksum(9, tag, documentNumber, cache.tagKey, 16);
+	tag[0] |= 1;  // A used slot never has a zero tag
+
+	unsigned int set = (tag[1] | tag[2] << 8 | (unsigned int)tag[3] << 16) %
+					   (cache.slots / KEY_CACHE_WAYS);
+	LockCacheFile(cache.file);
+	return (KeyCacheSlot*)&cache.view[sizeof(KeyCacheHeader)] + set * KEY_CACHE_WAYS;
+}
+
+static void UnlockSet(void) {
+	UnlockCacheFile(cache.file);
+	SyncUnlockExclusive(&cacheLock);
+}
+
+long KeyCacheLookup(const unsigned char documentNumber[9], KeyCacheEntry* entry) {
+	unsigned char tag[KEY_CACHE_TAG_LENGTH], mac[16];
+	unsigned char payload[KEY_CACHE_PAYLOAD_LENGTH];
+	long res = APP_ERROR;
+
+	KeyCacheSlot* set = LockSet(documentNumber, tag);
+	if (set == NULL) {
+		return APP_ERROR;
+	}
+	for (int i = 0; i < KEY_CACHE_WAYS; i++) {
+		KeyCacheSlot* slot = &set[i];
+		if (memcmp(slot->tag, tag, KEY_CACHE_TAG_LENGTH)) {
+			continue;
+		}
+		// A slot that was tampered with or torn by a crash is dropped
+		SlotMac(slot, mac);
+		if (memcmp(mac, slot->mac, 16)) {
+			memset(slot, 0, sizeof(KeyCacheSlot));
+			break;
+		}
+		aes_cbc_decrypt(payload, slot->payload, KEY_CACHE_PAYLOAD_LENGTH, cache.encryptKey, 16,
+						slot->iv);
+		memcpy(entry, payload, sizeof(KeyCacheEntry));
+		memset(payload, 0, sizeof(payload));
+
+		KeyCacheHeader* header = (KeyCacheHeader*)cache.view;
+		slot->lastUsed		   = ++header->clock;
+		res					   = APP_SUCCESS;
+		break;
+	}
+	UnlockSet();
+	return res;
+}
+
+long KeyCacheStore(const unsigned char documentNumber[9], const KeyCacheEntry* entry) {
+	unsigned char tag[KEY_CACHE_TAG_LENGTH];
+	unsigned char payload[KEY_CACHE_PAYLOAD_LENGTH] = {0};
+	long res										= APP_ERROR;
+
+	KeyCacheSlot* set = LockSet(documentNumber, tag);
+	if (set == NULL) {
+		return APP_ERROR;
+	}
+
+	// The slot of the document number, else an empty slot, else the least recently used one
+	KeyCacheSlot* target = NULL;
+	for (int i = 0; i < KEY_CACHE_WAYS && target == NULL; i++) {
+		if (!memcmp(set[i].tag, tag, KEY_CACHE_TAG_LENGTH)) {
+			target = &set[i];
+		}
+	}
+	for (int i = 0; i < KEY_CACHE_WAYS && target == NULL; i++) {
+		if (set[i].tag[0] == 0) {
+			target = &set[i];
+		}
+	}
+	if (target == NULL) {
+		target = &set[0];
+		for (int i = 1; i < KEY_CACHE_WAYS; i++) {
+			if (set[i].lastUsed < target->lastUsed) {
+				target = &set[i];
+			}
+		}
+	}
+
+	memcpy(payload, entry, sizeof(KeyCacheEntry));
+	if (RandomBytes(target->iv, 16) == APP_SUCCESS) {
+		KeyCacheHeader* header = (KeyCacheHeader*)cache.view;
+		memcpy(target->tag, tag, KEY_CACHE_TAG_LENGTH);
+		aes_cbc_encrypt(target->payload, payload, KEY_CACHE_PAYLOAD_LENGTH, cache.encryptKey, 16,
+						target->iv);
+		SlotMac(target, target->mac);
+		target->lastUsed = ++header->clock;
+		res				 = APP_SUCCESS;
+	}
+	memset(payload, 0, sizeof(payload));
+	UnlockSet();
+	return res;
+}
+
+void KeyCacheRemove(const unsigned char documentNumber[9]) {
+	unsigned char tag[KEY_CACHE_TAG_LENGTH];
+
+	KeyCacheSlot* set = LockSet(documentNumber, tag);
+	if (set == NULL) {
+		return;
+	}
+	for (int i = 0; i < KEY_CACHE_WAYS; i++) {
+		if (!memcmp(set[i].tag, tag, KEY_CACHE_TAG_LENGTH)) {
+			memset(&set[i], 0, sizeof(KeyCacheSlot));
+		}
+	}
+	UnlockSet();
+}
@@ -0,0 +1,318 @@
+/**
+ * @author Khoa Nguyen
+ * @file mrz.c
+ * @brief Source file for the ingestion of OCR-read TD1 MRZ text.
+ *
+ * The corrections of each field are enumerated on their own, depth first over the characters of
+ * the field and its check digit, and the MRZ_FIELD_VARIANTS most likely ones that agree with the
+ * check digit are kept. The keys are then the combinations of the corrections of the document
+ * number, the date of birth and the date of expiry, weighted by the composite check digit.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <utils/mrz.h>
+#include <utils/reader.h>
+#include <utils/util.h>
+
+#define MRZ_MAX_POSITIONS 24  // Characters of the longest field with its check digit
+#define MRZ_MAX_COMBINATIONS (MRZ_FIELD_VARIANTS * MRZ_FIELD_VARIANTS * MRZ_FIELD_VARIANTS)
+
+// Characters an OCR engine reads for one another
+static const struct {
+	unsigned char c;
+	const char* alternatives;
+} confusions[] = {
+	{'0', "OD8"}, {'O', "0DQ"}, {'D', "0O"}, {'Q', "0O"}, {'1', "I7"}, {'I', "1L"}, {'L', "1I"},
+	{'7', "1"},	  {'2', "Z"},	{'Z', "2"},	 {'5', "S6"}, {'S', "5"},  {'6', "G58"}, {'G', "6"},
+	{'8', "B3"},  {'B', "8"},	{'3', "8"},	 {'<', "K"},  {'K', "<"},
+};
+
+// Corrected field with its likelihood
+typedef struct {
+	unsigned char text[MRZ_MAX_POSITIONS];
+	double likelihood;
+} MrzVariant;
+
+// Enumeration of the corrections of a field, the check digit is the last character
+typedef struct {
+	unsigned char read[MRZ_MAX_POSITIONS];	// Characters as read
+	double right[MRZ_MAX_POSITIONS];		// Probability that each is read right
+	int length;
+	int numeric;
+	int date;
+	unsigned char text[MRZ_MAX_POSITIONS];	// Correction being built
+	MrzVariant variants[MRZ_FIELD_VARIANTS];
+	int count;
+} MrzFieldSearch;
+
+static unsigned char Upper(unsigned char c) {
+	return c >= 'a' && c <= 'z' ? (unsigned char)(c - 'a' + 'A') : c;
+}
+
+static int IsDigit(unsigned char c) {
+	return c >= '0' && c <= '9';
+}
+
+static int CharAllowed(unsigned char c, int numeric) {
+	return IsDigit(c) || (!numeric && ((c >= 'A' && c <= 'Z') || c == '<'));
+}
+
+static const char* Alternatives(unsigned char c) {
+	for (size_t i = 0; i < sizeof(confusions) / sizeof(confusions[0]); i++) {
+		if (confusions[i].c == c) {
+			return confusions[i].alternatives;
+		}
+	}
+	return "";
+}
+
+static void FieldSet(MrzField* field, const MrzTd1* mrz, int line, int offset, int length) {
+	field->text		  = &mrz->line[line][offset];
+	field->confidence = mrz->lineConfidence[line] ? &mrz->lineConfidence[line][offset] : NULL;
+	field->length	  = length;
+}
+
+long MrzTd1Parse(const unsigned char* text,
+				 int length,
+				 const unsigned char* confidence,
+				 MrzTd1* mrz) {
+	int lines = 0, start = 0;
+
+	memset(mrz, 0, sizeof(MrzTd1));
+	for (int i = 0; i <= length; i++) {
+		if (i < length && text[i] != '\n') {
+			continue;
+		}
+		int end = i;
+		while (end > start && (text[end - 1] == '\r' || text[end - 1] == ' ')) {
+			end--;
+		}
+		if (end > start) {
+			if (lines == 3 || end - start != MRZ_TD1_LINE_LENGTH) {
+				return APP_ERROR;
+			}
+			mrz->line[lines]		   = &text[start];
+			mrz->lineConfidence[lines] = confidence ? &confidence[start] : NULL;
+			lines++;
+		}
+		start = i + 1;
+	}
+	if (lines != 3) {
+		return APP_ERROR;
+	}
+
+	// A number longer than 9 characters has a filler in place of its check digit, it goes on in
+	// the optional data and its check digit ends it
+	const unsigned char* line = mrz->line[0];
+	FieldSet(&mrz->documentNumber, mrz, 0, 5, 9);
+	if (Upper(line[14]) == '<' && Upper(line[15]) != '<') {
+		int end = 15;
+		while (end < MRZ_TD1_LINE_LENGTH && Upper(line[end]) != '<') {
+			end++;
+		}
+		if (end - 15 < 2 || end - 15 > MRZ_MAX_POSITIONS - 10) {
+			return APP_ERROR;
+		}
+		FieldSet(&mrz->documentNumberExtension, mrz, 0, 15, end - 16);
+		FieldSet(&mrz->documentNumberCheck, mrz, 0, end - 1, 1);
+	} else {
+		FieldSet(&mrz->documentNumberExtension, mrz, 0, 15, 0);
+		FieldSet(&mrz->documentNumberCheck, mrz, 0, 14, 1);
+	}
+
+	FieldSet(&mrz->birthDate, mrz, 1, 0, 6);
+	FieldSet(&mrz->birthDateCheck, mrz, 1, 6, 1);
+	FieldSet(&mrz->expiryDate, mrz, 1, 8, 6);
+	FieldSet(&mrz->expiryDateCheck, mrz, 1, 14, 1);
+	FieldSet(&mrz->compositeCheck, mrz, 1, 29, 1);
+	return APP_SUCCESS;
+}
+
+static double RightProbability(const MrzField* field, int i) {
+	int confidence = field->confidence ? field->confidence[i] : 99;
+	if (confidence < 1) {
+		confidence = 1;
+	} else if (confidence > 99) {
+		confidence = 99;
+	}
+	return confidence / 100.0;
+}
+
+static void FieldAppend(MrzFieldSearch* search, const MrzField* field) {
+	for (int i = 0; i < field->length; i++) {
+		search->read[search->length]	= Upper(field->text[i]);
+		search->right[search->length++] = RightProbability(field, i);
+	}
+}
+
+static void VariantAdd(MrzFieldSearch* search, double likelihood) {
+	int i = search->count < MRZ_FIELD_VARIANTS ? search->count++ : MRZ_FIELD_VARIANTS;
+	if (i == MRZ_FIELD_VARIANTS && likelihood <= search->variants[i - 1].likelihood) {
+		return;
+	}
+	// Insertion in the list sorted by likelihood, the last one falls off a full list
+	if (i == MRZ_FIELD_VARIANTS) {
+		i--;
+	}
+	while (i > 0 && search->variants[i - 1].likelihood < likelihood) {
+		search->variants[i] = search->variants[i - 1];
+		i--;
+	}
+	memcpy(search->variants[i].text, search->text, search->length);
+	search->variants[i].likelihood = likelihood;
+}
+
+static int FieldValid(const MrzFieldSearch* search) {
+	int n = search->length - 1;
+	if (!IsDigit(search->text[n]) ||
+		CheckDigitCalculate(search->text, n) != CharToInt(search->text[n])) {
+		return 0;
+	}
+	if (search->date) {
+		int month = CharToInt(search->text[2]) * 10 + CharToInt(search->text[3]);
+		int day	  = CharToInt(search->text[4]) * 10 + CharToInt(search->text[5]);
+		return IsValidDate(day, month);
+	}
+	return 1;
+}
+
+static void FieldSearch(MrzFieldSearch* search, int index, int corrections, double likelihood) {
+	if (index == search->length) {
+		if (FieldValid(search)) {
+			VariantAdd(search, likelihood);
+		}
+		return;
+	}
+
+	unsigned char c			 = search->read[index];
+	const char* alternatives = Alternatives(c);
+	int allowed				 = CharAllowed(c, search->numeric);
+	int count				 = 0;
+	for (int i = 0; alternatives[i]; i++) {
+		count += CharAllowed(alternatives[i], search->numeric);
+	}
+
+	if (allowed) {
+		search->text[index] = c;
+		FieldSearch(search, index + 1, corrections, likelihood * search->right[index]);
+	}
+	if (corrections == MRZ_MAX_CORRECTIONS || count == 0) {
+		return;
+	}
+	// A character that cannot be in the field is surely one of its alternatives
+	double share = allowed ? (1 - search->right[index]) / count : 1.0 / count;
+	for (int i = 0; alternatives[i]; i++) {
+		if (CharAllowed(alternatives[i], search->numeric)) {
+			search->text[index] = alternatives[i];
+			FieldSearch(search, index + 1, corrections + 1, likelihood * share);
+		}
+	}
+}
+
+// Weight of a key from the composite check digit of the upper and middle lines
+static double CompositeWeight(const MrzTd1* mrz,
+							  const MrzVariant* documentNumber,
+							  const MrzVariant* birthDate,
+							  const MrzVariant* expiryDate) {
+	unsigned char upper[MRZ_TD1_LINE_LENGTH], middle[MRZ_TD1_LINE_LENGTH], composite[50];
+	int extension = mrz->documentNumberExtension.length;
+
+	for (int i = 0; i < MRZ_TD1_LINE_LENGTH; i++) {
+		upper[i]  = Upper(mrz->line[0][i]);
+		middle[i] = Upper(mrz->line[1][i]);
+	}
+	memcpy(&upper[5], documentNumber->text, 9);
+	if (extension > 0) {
+		memcpy(&upper[15], &documentNumber->text[9], extension + 1);
+	} else {
+		upper[14] = documentNumber->text[9];
+	}
+	memcpy(&middle[0], birthDate->text, 7);
+	memcpy(&middle[8], expiryDate->text, 7);
+
+	memcpy(composite, &upper[5], 25);
+	memcpy(&composite[25], &middle[0], 7);
+	memcpy(&composite[32], &middle[8], 7);
+	memcpy(&composite[39], &middle[18], 11);
+	unsigned char digit = (unsigned char)IntToChar(CheckDigitCalculate(composite, 50));
+
+	unsigned char read		 = Upper(mrz->compositeCheck.text[0]);
+	double right			 = RightProbability(&mrz->compositeCheck, 0);
+	const char* alternatives = Alternatives(read);
+	if (read == digit) {
+		return right;
+	}
+	if (strchr(alternatives, digit) != NULL) {
+		return (1 - right) / strlen(alternatives);
+	}
+	return MRZ_COMPOSITE_FLOOR;
+}
+
+static int CandidateCompare(const void* a, const void* b) {
+	const MrzCandidate* x = (const MrzCandidate*)a;
+	const MrzCandidate* y = (const MrzCandidate*)b;
+	if (x->likelihood != y->likelihood) {
+		return x->likelihood > y->likelihood ? -1 : 1;
+	}
+	return strcmp((const char*)x->mrzInformation, (const char*)y->mrzInformation);
+}
+
+int MrzCandidatesGenerate(const MrzTd1* mrz, MrzCandidate candidates[], int maxCandidates) {
+	MrzFieldSearch fields[3];
+	MrzCandidate combinations[MRZ_MAX_COMBINATIONS];
+
+	memset(fields, 0, sizeof(fields));
+	FieldAppend(&fields[0], &mrz->documentNumber);
+	FieldAppend(&fields[0], &mrz->documentNumberExtension);
+	FieldAppend(&fields[0], &mrz->documentNumberCheck);
+	FieldAppend(&fields[1], &mrz->birthDate);
+	FieldAppend(&fields[1], &mrz->birthDateCheck);
+	FieldAppend(&fields[2], &mrz->expiryDate);
+	FieldAppend(&fields[2], &mrz->expiryDateCheck);
+	for (int i = 0; i < 3; i++) {
+		fields[i].numeric = i > 0;
+		fields[i].date	  = i > 0;
+		FieldSearch(&fields[i], 0, 0, 1.0);
+	}
+
+	int count	 = 0;
+	double total = 0;
+	for (int d = 0; d < fields[0].count; d++) {
+		for (int b = 0; b < fields[1].count; b++) {
+			for (int e = 0; e < fields[2].count; e++) {
+				const MrzVariant* documentNumber = &fields[0].variants[d];
+				const MrzVariant* birthDate		 = &fields[1].variants[b];
+				const MrzVariant* expiryDate	 = &fields[2].variants[e];
+				MrzCandidate* candidate			 = &combinations[count++];
+
+				// Document number || check digit || date of birth || check digit || date of
+				// expiry || check digit
+				unsigned char* key = candidate->mrzInformation;
+				memcpy(key, documentNumber->text, fields[0].length);
+				memcpy(&key[fields[0].length], birthDate->text, 7);
+				memcpy(&key[fields[0].length + 7], expiryDate->text, 7);
+				key[fields[0].length + 14] = '\0';
+
+				candidate->likelihood = documentNumber->likelihood * birthDate->likelihood *
+										expiryDate->likelihood *
+										CompositeWeight(mrz, documentNumber, birthDate, expiryDate);
+				total += candidate->likelihood;
+			}
+		}
+	}
+	qsort(combinations, count, sizeof(MrzCandidate), CandidateCompare);
+
+	if (count > maxCandidates) {
+		count = maxCandidates;
+	}
+	if (count > MRZ_MAX_CANDIDATES) {
+		count = MRZ_MAX_CANDIDATES;
+	}
+	for (int i = 0; i < count; i++) {
+		candidates[i] = combinations[i];
+		candidates[i].likelihood /= total;
+	}
+	return count;
+}
@@ -0,0 +1,117 @@
+/**
+ * @author Khoa Nguyen
+ * @file public_key.c
+ * @brief Source file for SubjectPublicKeyInfo decoding functions.
+ */
+
+#include <string.h>
+
+#include <utils/public_key.h>
+#include <utils/reader.h>
+#include <utils/tlv.h>
+
+// prime-field = 1.2.840.10045.1.1
+static const unsigned char PRIME_FIELD_OID[7] = {0x2A, 0x86, 0x48, 0xCE, 0x3D, 0x01, 0x01};
+
+// Named curves of the standardized domain parameters
+typedef struct {
+	int id;
+	int oidLength;
+	unsigned char oid[9];
+} NamedCurve;
+
+static const NamedCurve NAMED_CURVES[] = {
+	{8, 8, {0x2A, 0x86, 0x48, 0xCE, 0x3D, 0x03, 0x01, 0x01}},
+	{9, 9, {0x2B, 0x24, 0x03, 0x03, 0x02, 0x08, 0x01, 0x01, 0x03}},
+	{10, 5, {0x2B, 0x81, 0x04, 0x00, 0x21}},
+	{11, 9, {0x2B, 0x24, 0x03, 0x03, 0x02, 0x08, 0x01, 0x01, 0x05}},
+	{12, 8, {0x2A, 0x86, 0x48, 0xCE, 0x3D, 0x03, 0x01, 0x07}},
+	{13, 9, {0x2B, 0x24, 0x03, 0x03, 0x02, 0x08, 0x01, 0x01, 0x07}},
+	{14, 9, {0x2B, 0x24, 0x03, 0x03, 0x02, 0x08, 0x01, 0x01, 0x09}},
+	{15, 5, {0x2B, 0x81, 0x04, 0x00, 0x22}},
+	{16, 9, {0x2B, 0x24, 0x03, 0x03, 0x02, 0x08, 0x01, 0x01, 0x0B}},
+	{17, 9, {0x2B, 0x24, 0x03, 0x03, 0x02, 0x08, 0x01, 0x01, 0x0D}},
+	{18, 5, {0x2B, 0x81, 0x04, 0x00, 0x23}}};
+
+int ParsePublicKeyInfo(const unsigned char* buf, int bufLen, PublicKeyInfo* info) {
+	const unsigned char* spki;
+	const unsigned char* values[2];
+	int spkiLength, lengths[2];
+	unsigned int tags[2];
+
+	// SubjectPublicKeyInfo ::= SEQUENCE { algorithm AlgorithmIdentifier,
+	//									   subjectPublicKey BIT STRING }
+	if (TlvFind(buf, bufLen, 0x30, &spki, &spkiLength) != APP_SUCCESS ||
+		TlvSplit(spki, spkiLength, tags, values, lengths, 2) != 2 || tags[0] != 0x30 ||
+		tags[1] != 0x03 || lengths[1] < 2 || values[1][0] != 0x00) {
+		return APP_ERROR;
+	}
+	info->key		= &values[1][1];
+	info->keyLength = lengths[1] - 1;
+
+	// AlgorithmIdentifier ::= SEQUENCE { algorithm OID, parameters ANY OPTIONAL }
+	const unsigned char* algorithmValues[2];
+	int algorithmLengths[2];
+	unsigned int algorithmTags[2];
+	int count =
+		TlvSplit(values[0], lengths[0], algorithmTags, algorithmValues, algorithmLengths, 2);
+	if (count < 1 || algorithmTags[0] != 0x06) {
+		return APP_ERROR;
+	}
+	info->algorithm		   = algorithmValues[0];
+	info->algorithmLength  = algorithmLengths[0];
+	info->parametersTag	   = count == 2 ? algorithmTags[1] : 0;
+	info->parameters	   = count == 2 ? algorithmValues[1] : NULL;
+	info->parametersLength = count == 2 ? algorithmLengths[1] : 0;
+	return APP_SUCCESS;
+}
+
+// ECParameters ::= SEQUENCE { version, fieldID, curve, base, order, cofactor OPTIONAL }
+static int LoadCurve(const unsigned char* parameters, int parametersLength, ecc_group* grp) {
+	const unsigned char *values[6], *fieldValues[2], *curveValues[3];
+	int lengths[6], fieldLengths[2], curveLengths[3];
+	unsigned int tags[6], fieldTags[2], curveTags[3];
+
+	if (TlvSplit(parameters, parametersLength, tags, values, lengths, 6) < 5 ||
+		tags[1] != 0x30 || tags[2] != 0x30 || tags[3] != 0x04 || tags[4] != 0x02) {
+		return APP_ERROR;
+	}
+
+	// fieldID ::= SEQUENCE { prime-field OID, prime INTEGER }
+	if (TlvSplit(values[1], lengths[1], fieldTags, fieldValues, fieldLengths, 2) != 2 ||
+		fieldTags[0] != 0x06 || fieldLengths[0] != sizeof(PRIME_FIELD_OID) ||
+		memcmp(fieldValues[0], PRIME_FIELD_OID, sizeof(PRIME_FIELD_OID)) || fieldTags[1] != 0x02) {
+		return APP_ERROR;
+	}
+
+	// Curve ::= SEQUENCE { a OCTET STRING, b OCTET STRING, seed BIT STRING OPTIONAL }
+	if (TlvSplit(values[2], lengths[2], curveTags, curveValues, curveLengths, 3) < 2 ||
+		curveTags[0] != 0x04 || curveTags[1] != 0x04) {
+		return APP_ERROR;
+	}
+
+	if (ecc_group_load(grp, fieldValues[1], fieldLengths[1], curveValues[0], curveLengths[0],
+					   curveValues[1], curveLengths[1], values[3], lengths[3], values[4],
+					   lengths[4]) != 0) {
+		return APP_ERROR;
+	}
+	return APP_SUCCESS;
+}
+
+const ecc_group* PublicKeyCurve(const PublicKeyInfo* info, ecc_group* explicitGroup) {
+	// Named curve, standardized domain parameter ID or explicit parameters
+	if (info->parametersTag == 0x06) {
+		for (int i = 0; i < (int)(sizeof(NAMED_CURVES) / sizeof(NAMED_CURVES[0])); i++) {
+			if (info->parametersLength == NAMED_CURVES[i].oidLength &&
+				!memcmp(info->parameters, NAMED_CURVES[i].oid, NAMED_CURVES[i].oidLength)) {
+				return ecc_group_get(NAMED_CURVES[i].id);
+			}
+		}
+	} else if (info->parametersTag == 0x02) {
+		return ecc_group_get(TlvReadInteger(info->parameters, info->parametersLength));
+	} else if (info->parametersTag == 0x30 &&
+			   LoadCurve(info->parameters, info->parametersLength, explicitGroup) == APP_SUCCESS) {
+		return explicitGroup;
+	}
+	return NULL;
+}
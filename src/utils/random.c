@@ -0,0 +1,91 @@
+/**
+ * @author Khoa Nguyen
+ * @file random.c
+ * @brief Source file for the random generator of nonces and keys.
+ */
+
+#pragma comment(lib, "bcrypt.lib")
+
+#include <Windows.h>
+#include <bcrypt.h>
+#include <string.h>
+
+#include <cryptography/chacha20.h>
+#include <utils/random.h>
+#include <utils/reader.h>
+
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+#define RANDOM_POOL_LENGTH	   (RANDOM_POOL_BLOCKS * CHACHA20_BLOCK_LENGTH)
+
+#define RANDOM_UNSEEDED		   0  // Keyed from the system generator on the next call
+#define RANDOM_SYSTEM		   1  // Keyed from the system generator
+#define RANDOM_DETERMINISTIC   2  // Keyed by RandomSeed, never renewed
+
+// Generator of a thread, the key changes with every refill
+typedef struct {
+	unsigned char key[CHACHA20_KEY_LENGTH];
+	unsigned char pool[RANDOM_POOL_LENGTH];
+	int available;	// Bytes at the end of the pool not served yet
+	long served;	// Bytes served since the key came from the system generator
+	int state;
+} RandomGenerator;
+
+static THREAD_LOCAL RandomGenerator generator;
+
+static void RandomRefill(void) {
+	static const unsigned char nonce[CHACHA20_NONCE_LENGTH] = {0};
+
+	// Fast key erasure: the first bytes of the keystream become the next key
+	chacha20_keystream(generator.key, nonce, 0, generator.pool, RANDOM_POOL_BLOCKS);
+	memcpy(generator.key, generator.pool, CHACHA20_KEY_LENGTH);
+	memset(generator.pool, 0, CHACHA20_KEY_LENGTH);
+	generator.available = RANDOM_POOL_LENGTH - CHACHA20_KEY_LENGTH;
+}
+
+long RandomBytes(unsigned char* buffer, int length) {
+	int offset, chunk;
+
+	if (generator.state == RANDOM_UNSEEDED && chacha20_self_test() != 0) {
+		return APP_ERROR;
+	}
+	if (generator.state == RANDOM_UNSEEDED ||
+		(generator.state == RANDOM_SYSTEM && generator.served >= RANDOM_RESEED_BYTES)) {
+		if (!BCRYPT_SUCCESS(BCryptGenRandom(NULL, generator.key, CHACHA20_KEY_LENGTH,
+											BCRYPT_USE_SYSTEM_PREFERRED_RNG))) {
+			return APP_ERROR;
+		}
+		generator.available = 0;
+		generator.served	= 0;
+		generator.state		= RANDOM_SYSTEM;
+	}
+
+	while (length > 0) {
+		if (generator.available == 0) {
+			RandomRefill();
+		}
+		chunk  = length < generator.available ? length : generator.available;
+		offset = RANDOM_POOL_LENGTH - generator.available;
+
+		// Served bytes are wiped from the pool
+		memcpy(buffer, &generator.pool[offset], chunk);
+		memset(&generator.pool[offset], 0, chunk);
+		generator.available -= chunk;
+		generator.served += chunk;
+		buffer += chunk;
+		length -= chunk;
+	}
+	return APP_SUCCESS;
+}
+
+void RandomSeed(const unsigned char seed[RANDOM_SEED_LENGTH]) {
+	memset(&generator, 0, sizeof(generator));
+	if (seed != NULL) {
+		memcpy(generator.key, seed, CHACHA20_KEY_LENGTH);
+		generator.state = RANDOM_DETERMINISTIC;
+	}
+}
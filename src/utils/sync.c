@@ -0,0 +1,87 @@
+/**
+ * @author Khoa Nguyen
+ * @file sync.c
+ * @brief Source file for synchronization primitives.
+ */
+
+#include <Windows.h>
+
+#include <utils/sync.h>
+
+// The wrappers are cast to the Windows types
+C_ASSERT(sizeof(SyncLock) == sizeof(SRWLOCK));
+C_ASSERT(sizeof(SyncCondition) == sizeof(CONDITION_VARIABLE));
+
+void SyncLockExclusive(SyncLock* lock) {
+	AcquireSRWLockExclusive((PSRWLOCK)lock);
+}
+
+void SyncUnlockExclusive(SyncLock* lock) {
+	ReleaseSRWLockExclusive((PSRWLOCK)lock);
+}
+
+void SyncLockShared(SyncLock* lock) {
+	AcquireSRWLockShared((PSRWLOCK)lock);
+}
+
+void SyncUnlockShared(SyncLock* lock) {
+	ReleaseSRWLockShared((PSRWLOCK)lock);
+}
+
+void SyncWait(SyncCondition* condition, SyncLock* lock) {
+	SleepConditionVariableSRW((PCONDITION_VARIABLE)condition, (PSRWLOCK)lock, INFINITE, 0);
+}
+
+void SyncWakeAll(SyncCondition* condition) {
+	WakeAllConditionVariable((PCONDITION_VARIABLE)condition);
+}
+
+void SyncYield(void) {
+	SwitchToThread();
+}
+
+static DWORD WINAPI SyncThreadMain(LPVOID parameter) {
+	SyncThread* thread = (SyncThread*)parameter;
+
+	thread->routine(thread->argument);
+	return 0;
+}
+
+int SyncThreadStart(SyncThread* thread, void (*routine)(void*), void* argument) {
+	thread->routine	 = routine;
+	thread->argument = argument;
+	thread->handle	 = CreateThread(NULL, 0, SyncThreadMain, thread, 0, NULL);
+	return thread->handle != NULL ? 0 : -1;
+}
+
+void SyncThreadJoin(SyncThread* thread) {
+	WaitForSingleObject((HANDLE)thread->handle, INFINITE);
+	CloseHandle((HANDLE)thread->handle);
+	thread->handle = NULL;
+}
+
+int SyncProcessorCount(void) {
+	SYSTEM_INFO info;
+
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+}
+
+long long SyncTicks(void) {
+	LARGE_INTEGER counter;
+
+	QueryPerformanceCounter(&counter);
+	return counter.QuadPart;
+}
+
+long long SyncTicksPerSecond(void) {
+	static long long frequency;
+	LARGE_INTEGER f;
+
+	// Fixed at boot
+	if (frequency == 0) {
+		QueryPerformanceFrequency(&f);
+		frequency = f.QuadPart;
+	}
+	return frequency;
+}
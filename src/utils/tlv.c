@@ -0,0 +1,161 @@
+/**
+ * @author Khoa Nguyen
+ * @file tlv.c
+ * @brief Source file for BER-TLV encoding and decoding functions.
+ */
+
+#include <string.h>
+
+#include <utils/reader.h>
+#include <utils/tlv.h>
+
+int TlvParseHeader(const unsigned char* buf,
+				   int bufLen,
+				   unsigned int* tag,
+				   int* length,
+				   int* headerLength) {
+	int pos = 0;
+	if (bufLen < 2) {
+		return APP_ERROR;
+	}
+
+	// Tag: the low 5 bits all set announce subsequent tag bytes, bit 8 of those marks continuation
+	*tag = buf[pos++];
+	if ((*tag & 0x1F) == 0x1F) {
+		do {
+			if (pos >= bufLen || pos > 3) {
+				return APP_ERROR;
+			}
+			*tag = (*tag << 8) | buf[pos];
+		} while (buf[pos++] & 0x80);
+	}
+
+	// Length: short form below 0x80, otherwise 0x81 to 0x84 give the number of length bytes
+	if (pos >= bufLen) {
+		return APP_ERROR;
+	}
+	int first = buf[pos++];
+	if (first < 0x80) {
+		*length = first;
+	} else {
+		int count = first & 0x7F;
+		if (count == 0 || count > 4 || pos + count > bufLen) {
+			return APP_ERROR;
+		}
+		unsigned int value = 0;
+		for (int i = 0; i < count; i++) {
+			value = (value << 8) | buf[pos++];
+		}
+		if (value > 0x7FFFFFFF) {
+			return APP_ERROR;
+		}
+		*length = (int)value;
+	}
+
+	*headerLength = pos;
+	return APP_SUCCESS;
+}
+
+int TlvParse(const unsigned char* buf,
+			 int bufLen,
+			 unsigned int* tag,
+			 int* length,
+			 int* headerLength) {
+	if (TlvParseHeader(buf, bufLen, tag, length, headerLength) != APP_SUCCESS) {
+		return APP_ERROR;
+	}
+	if (*length > bufLen - *headerLength) {
+		return APP_ERROR;
+	}
+	return APP_SUCCESS;
+}
+
+int TlvFind(const unsigned char* buf,
+			int bufLen,
+			unsigned int tag,
+			const unsigned char** value,
+			int* length) {
+	int pos = 0;
+	while (pos < bufLen) {
+		unsigned int currentTag;
+		int currentLength, headerLength;
+		if (TlvParse(&buf[pos], bufLen - pos, &currentTag, &currentLength, &headerLength) !=
+			APP_SUCCESS) {
+			return APP_ERROR;
+		}
+		if (currentTag == tag) {
+			*value	= &buf[pos + headerLength];
+			*length = currentLength;
+			return APP_SUCCESS;
+		}
+		pos += headerLength + currentLength;
+	}
+	return APP_ERROR;
+}
+
+int TlvSplit(const unsigned char* buf,
+			 int bufLen,
+			 unsigned int* tags,
+			 const unsigned char** values,
+			 int* lengths,
+			 int maxCount) {
+	int pos	  = 0;
+	int count = 0;
+	while (pos < bufLen && count < maxCount) {
+		int headerLength;
+		if (TlvParse(&buf[pos], bufLen - pos, &tags[count], &lengths[count], &headerLength) !=
+			APP_SUCCESS) {
+			return APP_ERROR;
+		}
+		values[count] = &buf[pos + headerLength];
+		pos += headerLength + lengths[count];
+		count++;
+	}
+	return count;
+}
+
+int TlvReadInteger(const unsigned char* value, int length) {
+	if (length < 1 || (value[0] & 0x80)) {
+		return -1;
+	}
+	// A leading zero byte keeps the sign bit clear
+	if (length > 1 && value[0] == 0x00) {
+		value++;
+		length--;
+	}
+	if (length > 4 || (length == 4 && (value[0] & 0x80))) {
+		return -1;
+	}
+	int result = 0;
+	for (int i = 0; i < length; i++) {
+		result = (result << 8) | value[i];
+	}
+	return result;
+}
+
+int TlvEncodeLength(int length, unsigned char* out) {
+	if (length < 0x80) {
+		out[0] = (unsigned char)length;
+		return 1;
+	}
+	if (length < 0x100) {
+		out[0] = 0x81;
+		out[1] = (unsigned char)length;
+		return 2;
+	}
+	out[0] = 0x82;
+	out[1] = (unsigned char)(length >> 8);
+	out[2] = (unsigned char)length;
+	return 3;
+}
+
+int TlvEncode(unsigned int tag, const unsigned char* value, int length, unsigned char* out) {
+	int pos = 0;
+	if (tag > 0xFF) {
+		out[pos++] = (unsigned char)(tag >> 8);
+	}
+	out[pos++] = (unsigned char)tag;
+	pos += TlvEncodeLength(length, &out[pos]);
+	memmove(&out[pos], value, length);
+	return pos + length;
+}
@@ -0,0 +1,474 @@
+/**
+ * @author Khoa Nguyen
+ * @file trust_store.c
+ * @brief Source file for the CSCA certificate store of Passive Authentication.
+ */
+
+#include <Windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cryptography/hash.h>
+#include <cryptography/sha1.h>
+#include <cryptography/sha256.h>
+#include <utils/allocator.h>
+#include <utils/public_key.h>
+#include <utils/reader.h>
+#include <utils/sync.h>
+#include <utils/tlv.h>
+#include <utils/trust_store.h>
+
+#define TRUST_CACHE_PROBES 8  // Slots tried from the home slot of a digest
+
+// id-signedData = 1.2.840.113549.1.7.2, id-icao-cscaMasterList = 2.23.136.1.1.2
+static const unsigned char SIGNED_DATA_OID[9] = {0x2A, 0x86, 0x48, 0x86, 0xF7,
+												 0x0D, 0x01, 0x07, 0x02};
+static const unsigned char CSCA_MASTER_LIST_OID[6] = {0x67, 0x81, 0x08, 0x01, 0x01, 0x02};
+
+// id-ce-subjectKeyIdentifier = 2.5.29.14, id-ce-authorityKeyIdentifier = 2.5.29.35
+static const unsigned char SUBJECT_KEY_IDENTIFIER_OID[3] = {0x55, 0x1D, 0x0E};
+static const unsigned char AUTHORITY_KEY_IDENTIFIER_OID[3] = {0x55, 0x1D, 0x23};
+
+// Store file: the header, the index by key identifier, the index by subject, then the DER
+// certificates. Both indexes have count entries sorted by key, integers are little-endian.
+typedef struct {
+	char magic[8];
+	unsigned int count;
+	unsigned int keyIndex;		// Offset of the index by subject key identifier
+	unsigned int subjectIndex;	// Offset of the index by subject
+	unsigned int length;		// Length of the whole file
+} TrustStoreHeader;
+
+typedef struct {
+	unsigned char key[TRUST_KEY_LENGTH];
+	unsigned int offset;  // Offset of the certificate in the file
+	unsigned int length;
+} TrustStoreEntry;
+
+// A mapped store, freed when its last reference is released
+typedef struct {
+	const unsigned char* view;
+	unsigned int count;
+	const TrustStoreEntry* keyIndex;
+	const TrustStoreEntry* subjectIndex;
+	volatile LONG references;  // One while it is the current store, plus one per reader
+	SyncLock cacheLock;
+	unsigned char cacheUsed[TRUST_CACHE_SIZE];
+	unsigned char cache[TRUST_CACHE_SIZE][SHA256_DIGEST_LENGTH];  // Verified TBSCertificates
+} TrustStore;
+
+static SyncLock storeLock = SYNC_INIT;
+static TrustStore* currentStore;
+
+/**
+ * @brief Computes the index key of a CSCA: the SHA-1 of its subject key identifier, or of the
+ * SHA-1 of its public key (RFC 5280 method 1) if it has none.
+ */
+static int SubjectKey(const Certificate* cert, unsigned char key[TRUST_KEY_LENGTH]) {
+	const unsigned char *extension, *keyIdentifier;
+	int extensionLength, keyIdentifierLength;
+	unsigned char computed[SHA1_DIGEST_LENGTH];
+	PublicKeyInfo info;
+
+	if (CertificateExtension(cert, SUBJECT_KEY_IDENTIFIER_OID, sizeof(SUBJECT_KEY_IDENTIFIER_OID),
+							 &extension, &extensionLength) == APP_SUCCESS &&
+		TlvFind(extension, extensionLength, 0x04, &keyIdentifier, &keyIdentifierLength) ==
+			APP_SUCCESS) {
+		sha1(keyIdentifier, keyIdentifierLength, key);
+		return APP_SUCCESS;
+	}
+	if (ParsePublicKeyInfo(cert->publicKey, cert->publicKeyLength, &info) != APP_SUCCESS) {
+		return APP_ERROR;
+	}
+	sha1(info.key, info.keyLength, computed);
+	sha1(computed, sizeof(computed), key);
+	return APP_SUCCESS;
+}
+
+/**
+ * @brief Finds the keyIdentifier of the authority key identifier of a certificate.
+ */
+static int AuthorityKeyIdentifier(const Certificate* cert,
+								  const unsigned char** keyIdentifier,
+								  int* keyIdentifierLength) {
+	const unsigned char *extension, *sequence;
+	int extensionLength, sequenceLength;
+
+	// AuthorityKeyIdentifier ::= SEQUENCE { keyIdentifier [0] IMPLICIT OCTET STRING OPTIONAL, ... }
+	if (CertificateExtension(cert, AUTHORITY_KEY_IDENTIFIER_OID,
+							 sizeof(AUTHORITY_KEY_IDENTIFIER_OID), &extension,
+							 &extensionLength) != APP_SUCCESS ||
+		TlvFind(extension, extensionLength, 0x30, &sequence, &sequenceLength) != APP_SUCCESS) {
+		return APP_ERROR;
+	}
+	return TlvFind(sequence, sequenceLength, 0x80, keyIdentifier, keyIdentifierLength);
+}
+
+/**
+ * @brief Finds the certificates of a CSCA master list, or returns the whole buffer if it is not a
+ * master list.
+ */
+static void MasterListCertificates(const unsigned char* buf,
+								   int bufLen,
+								   const unsigned char** certificates,
+								   int* certificatesLength) {
+	const unsigned char *contentInfo, *signedData, *content, *masterList;
+	const unsigned char* values[3];
+	int contentInfoLength, signedDataLength, contentLength, masterListLength, lengths[3];
+	unsigned int tags[3];
+
+	*certificates		= buf;
+	*certificatesLength = bufLen;
+
+	// ContentInfo ::= SEQUENCE { contentType id-signedData, content [0] EXPLICIT SignedData }
+	if (TlvFind(buf, bufLen, 0x30, &contentInfo, &contentInfoLength) != APP_SUCCESS ||
+		TlvSplit(contentInfo, contentInfoLength, tags, values, lengths, 2) != 2 ||
+		tags[0] != 0x06 || lengths[0] != sizeof(SIGNED_DATA_OID) ||
+		memcmp(values[0], SIGNED_DATA_OID, sizeof(SIGNED_DATA_OID)) || tags[1] != 0xA0 ||
+		TlvFind(values[1], lengths[1], 0x30, &signedData, &signedDataLength) != APP_SUCCESS) {
+		return;
+	}
+
+	// SignedData ::= SEQUENCE { version, digestAlgorithms, encapContentInfo, ... }
+	if (TlvSplit(signedData, signedDataLength, tags, values, lengths, 3) != 3 || tags[2] != 0x30 ||
+		TlvSplit(values[2], lengths[2], tags, values, lengths, 2) != 2 || tags[0] != 0x06 ||
+		lengths[0] != sizeof(CSCA_MASTER_LIST_OID) ||
+		memcmp(values[0], CSCA_MASTER_LIST_OID, sizeof(CSCA_MASTER_LIST_OID)) || tags[1] != 0xA0 ||
+		TlvFind(values[1], lengths[1], 0x04, &content, &contentLength) != APP_SUCCESS ||
+		TlvFind(content, contentLength, 0x30, &masterList, &masterListLength) != APP_SUCCESS) {
+		return;
+	}
+
+	// CscaMasterList ::= SEQUENCE { version INTEGER, certList SET OF Certificate }
+	if (TlvSplit(masterList, masterListLength, tags, values, lengths, 2) == 2 && tags[1] == 0x31) {
+		*certificates		= values[1];
+		*certificatesLength = lengths[1];
+	}
+}
+
+static int CompareEntries(const void* a, const void* b) {
+	return memcmp(((const TrustStoreEntry*)a)->key, ((const TrustStoreEntry*)b)->key,
+				  TRUST_KEY_LENGTH);
+}
+
+long TrustStoreCompile(const char* masterListPath, const char* storePath) {
+	long res						= APP_ERROR;
+	FILE* file						= NULL;
+	unsigned char* masterList		= NULL;
+	TrustStoreEntry* keyIndex		= NULL;
+	TrustStoreEntry* subjectIndex	= NULL;
+	const unsigned char* certificates;
+	int masterListLength, certificatesLength, position, headerLength, length;
+	unsigned int count = 0, offset, tag;
+	Certificate cert;
+
+	if (fopen_s(&file, masterListPath, "rb") != 0 || file == NULL) {
+		printf("Fail to Open CSCA master list.\n");
+		return APP_ERROR;
+	}
+	fseek(file, 0, SEEK_END);
+	masterListLength = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	if (masterListLength <= 0 || masterListLength > TRUST_MAX_MASTER_LIST ||
+		(masterList = AllocatorMalloc(masterListLength)) == NULL ||
+		fread(masterList, 1, masterListLength, file) != (size_t)masterListLength) {
+		printf("Fail to Read CSCA master list.\n");
+		goto end;
+	}
+	fclose(file);
+	file = NULL;
+
+	// Count the objects first to size the indexes, only the certificates among them are kept
+	MasterListCertificates(masterList, masterListLength, &certificates, &certificatesLength);
+	for (position = 0; position < certificatesLength; position += headerLength + length) {
+		if (TlvParse(&certificates[position], certificatesLength - position, &tag, &length,
+					 &headerLength) != APP_SUCCESS) {
+			printf("Invalid CSCA master list.\n");
+			goto end;
+		}
+		count++;
+	}
+	keyIndex	 = AllocatorMalloc((count + 1) * sizeof(TrustStoreEntry));
+	subjectIndex = AllocatorMalloc((count + 1) * sizeof(TrustStoreEntry));
+	if (keyIndex == NULL || subjectIndex == NULL) {
+		goto end;
+	}
+
+	// Offsets are relative to the certificates until the size of the indexes is known
+	count = 0;
+	for (position = 0; position < certificatesLength; position += headerLength + length) {
+		TlvParse(&certificates[position], certificatesLength - position, &tag, &length,
+				 &headerLength);
+		if (tag != 0x30 || ParseCertificate(&certificates[position], headerLength + length,
+											&cert) != APP_SUCCESS ||
+			SubjectKey(&cert, keyIndex[count].key) != APP_SUCCESS) {
+			continue;
+		}
+		sha1(cert.subject, cert.subjectLength, subjectIndex[count].key);
+		keyIndex[count].offset = subjectIndex[count].offset = position;
+		keyIndex[count].length = subjectIndex[count].length = headerLength + length;
+		count++;
+	}
+	if (count == 0) {
+		printf("No certificate in CSCA master list.\n");
+		goto end;
+	}
+
+	TrustStoreHeader header;
+	memcpy(header.magic, TRUST_STORE_MAGIC, sizeof(header.magic));
+	header.count		= count;
+	header.keyIndex		= sizeof(TrustStoreHeader);
+	header.subjectIndex = header.keyIndex + count * sizeof(TrustStoreEntry);
+	offset				= header.subjectIndex + count * sizeof(TrustStoreEntry);
+	header.length		= offset + certificatesLength;
+	for (unsigned int i = 0; i < count; i++) {
+		keyIndex[i].offset += offset;
+		subjectIndex[i].offset += offset;
+	}
+	qsort(keyIndex, count, sizeof(TrustStoreEntry), CompareEntries);
+	qsort(subjectIndex, count, sizeof(TrustStoreEntry), CompareEntries);
+
+	if (fopen_s(&file, storePath, "wb") != 0 || file == NULL) {
+		printf("Fail to Create CSCA store.\n");
+		goto end;
+	}
+	if (fwrite(&header, sizeof(header), 1, file) != 1 ||
+		fwrite(keyIndex, sizeof(TrustStoreEntry), count, file) != count ||
+		fwrite(subjectIndex, sizeof(TrustStoreEntry), count, file) != count ||
+		fwrite(certificates, 1, certificatesLength, file) != (size_t)certificatesLength) {
+		printf("Fail to Write CSCA store.\n");
+		goto end;
+	}
+	res = APP_SUCCESS;
+
+end:
+	if (file != NULL) {
+		fclose(file);
+	}
+	AllocatorFree(masterList);
+	AllocatorFree(keyIndex);
+	AllocatorFree(subjectIndex);
+	return res;
+}
+
+/**
+ * @brief Checks that the header and every index entry of a mapped store lie within the file.
+ */
+static int CheckStore(const unsigned char* view, unsigned int length) {
+	const TrustStoreHeader* header = (const TrustStoreHeader*)view;
+
+	if (memcmp(header->magic, TRUST_STORE_MAGIC, sizeof(header->magic)) ||
+		header->length != length || header->keyIndex != sizeof(TrustStoreHeader) ||
+		header->count == 0 || header->count > length / (2 * sizeof(TrustStoreEntry)) ||
+		header->subjectIndex != header->keyIndex + header->count * sizeof(TrustStoreEntry)) {
+		return APP_ERROR;
+	}
+
+	unsigned int certificates = header->subjectIndex + header->count * sizeof(TrustStoreEntry);
+	const TrustStoreEntry* entries = (const TrustStoreEntry*)&view[header->keyIndex];
+	for (unsigned int i = 0; i < 2 * header->count; i++) {
+		if (entries[i].offset < certificates || entries[i].offset > length ||
+			entries[i].length > length - entries[i].offset) {
+			return APP_ERROR;
+		}
+	}
+	return certificates <= length ? APP_SUCCESS : APP_ERROR;
+}
+
+static void ReleaseStore(TrustStore* store) {
+	if (store != NULL && InterlockedDecrement(&store->references) == 0) {
+		UnmapViewOfFile(store->view);
+		AllocatorFree(store);
+	}
+}
+
+static TrustStore* AcquireStore(void) {
+	SyncLockShared(&storeLock);
+	TrustStore* store = currentStore;
+	if (store != NULL) {
+		InterlockedIncrement(&store->references);
+	}
+	SyncUnlockShared(&storeLock);
+	return store;
+}
+
+/**
+ * @brief Publishes a store, or none, and releases the previous one.
+ */
+static void PublishStore(TrustStore* store) {
+	SyncLockExclusive(&storeLock);
+	TrustStore* previous = currentStore;
+	currentStore		 = store;
+	SyncUnlockExclusive(&storeLock);
+
+	// Readers holding the previous store keep it mapped until they release it
+	ReleaseStore(previous);
+}
+
+long TrustStoreLoad(const char* storePath) {
+	const unsigned char* view = NULL;
+	HANDLE mapping			  = NULL;
+	LARGE_INTEGER size;
+	TrustStore* store;
+
+	// Sharing delete lets a new store be renamed over this file while it is mapped
+	HANDLE file = CreateFileA(storePath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+							  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		printf("Fail to Open CSCA store.\n");
+		return APP_ERROR;
+	}
+	if (GetFileSizeEx(file, &size) && size.QuadPart >= (LONGLONG)sizeof(TrustStoreHeader) &&
+		size.QuadPart <= 0x7FFFFFFF) {
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	}
+	if (mapping != NULL) {
+		view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle(mapping);
+	}
+	CloseHandle(file);
+	if (view == NULL) {
+		printf("Fail to Map CSCA store.\n");
+		return APP_ERROR;
+	}
+	if (CheckStore(view, (unsigned int)size.QuadPart) != APP_SUCCESS) {
+		printf("Invalid CSCA store.\n");
+		UnmapViewOfFile(view);
+		return APP_ERROR;
+	}
+
+	store = AllocatorCalloc(1, sizeof(TrustStore));
+	if (store == NULL) {
+		UnmapViewOfFile(view);
+		return APP_ERROR;
+	}
+	const TrustStoreHeader* header = (const TrustStoreHeader*)view;
+	store->view					   = view;
+	store->count				   = header->count;
+	store->keyIndex				   = (const TrustStoreEntry*)&view[header->keyIndex];
+	store->subjectIndex			   = (const TrustStoreEntry*)&view[header->subjectIndex];
+	store->references			   = 1;  // The cache lock is zeroed, as SYNC_INIT
+
+	PublishStore(store);
+	return APP_SUCCESS;
+}
+
+void TrustStoreUnload(void) {
+	PublishStore(NULL);
+}
+
+int TrustStoreLoaded(void) {
+	SyncLockShared(&storeLock);
+	int loaded = currentStore != NULL;
+	SyncUnlockShared(&storeLock);
+	return loaded;
+}
+
+static int CacheFind(TrustStore* store, const unsigned char digest[SHA256_DIGEST_LENGTH]) {
+	unsigned int slot = (digest[0] | digest[1] << 8) % TRUST_CACHE_SIZE;
+	int found		  = 0;
+
+	SyncLockShared(&store->cacheLock);
+	for (int i = 0; i < TRUST_CACHE_PROBES && !found; i++) {
+		unsigned int probe = (slot + i) % TRUST_CACHE_SIZE;
+		found =
+			store->cacheUsed[probe] && !memcmp(store->cache[probe], digest, SHA256_DIGEST_LENGTH);
+	}
+	SyncUnlockShared(&store->cacheLock);
+	return found;
+}
+
+static void CacheInsert(TrustStore* store, const unsigned char digest[SHA256_DIGEST_LENGTH]) {
+	unsigned int slot = (digest[0] | digest[1] << 8) % TRUST_CACHE_SIZE;
+	unsigned int target = slot;
+
+	// The home slot is overwritten when all probed slots are taken
+	SyncLockExclusive(&store->cacheLock);
+	for (int i = 0; i < TRUST_CACHE_PROBES; i++) {
+		unsigned int probe = (slot + i) % TRUST_CACHE_SIZE;
+		if (!store->cacheUsed[probe]) {
+			target = probe;
+			break;
+		}
+	}
+	memcpy(store->cache[target], digest, SHA256_DIGEST_LENGTH);
+	store->cacheUsed[target] = 1;
+	SyncUnlockExclusive(&store->cacheLock);
+}
+
+/**
+ * @brief Tries every CSCA of an index entry range with the given key.
+ */
+static long VerifyWithIndex(const TrustStore* store,
+							const TrustStoreEntry* index,
+							const unsigned char key[TRUST_KEY_LENGTH],
+							const Certificate* documentSigner,
+							int hashAlgorithm,
+							const unsigned char* digest) {
+	unsigned int low = 0, high = store->count;
+	Certificate csca;
+
+	while (low < high) {
+		unsigned int middle = low + (high - low) / 2;
+		if (memcmp(index[middle].key, key, TRUST_KEY_LENGTH) < 0) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	for (; low < store->count && !memcmp(index[low].key, key, TRUST_KEY_LENGTH); low++) {
+		if (ParseCertificate(&store->view[index[low].offset], index[low].length, &csca) ==
+				APP_SUCCESS &&
+			SignatureVerify(csca.publicKey, csca.publicKeyLength,
+							documentSigner->signatureAlgorithm,
+							documentSigner->signatureAlgorithmLength, hashAlgorithm, digest,
+							documentSigner->signature,
+							documentSigner->signatureLength) == APP_SUCCESS) {
+			return APP_SUCCESS;
+		}
+	}
+	return APP_ERROR;
+}
+
+long VerifyDocumentSigner(const Certificate* documentSigner) {
+	unsigned char tbsDigest[SHA256_DIGEST_LENGTH], digest[HASH_MAX_DIGEST_LENGTH];
+	unsigned char key[TRUST_KEY_LENGTH];
+	const unsigned char* keyIdentifier;
+	int keyIdentifierLength;
+	long res = APP_ERROR;
+
+	TrustStore* store = AcquireStore();
+	if (store == NULL) {
+		return APP_ERROR;
+	}
+
+	// The signature is over the TBSCertificate only, so a TBSCertificate verified once is trusted
+	sha256(documentSigner->tbs, documentSigner->tbsLength, tbsDigest);
+	if (CacheFind(store, tbsDigest)) {
+		ReleaseStore(store);
+		return APP_SUCCESS;
+	}
+
+	int hashAlgorithm = SignatureHashAlgorithm(documentSigner->signatureAlgorithm,
+											   documentSigner->signatureAlgorithmLength);
+	if (hashAlgorithm > 0 && hash_compute(hashAlgorithm, documentSigner->tbs,
+										  documentSigner->tbsLength, digest) > 0) {
+		if (AuthorityKeyIdentifier(documentSigner, &keyIdentifier, &keyIdentifierLength) ==
+			APP_SUCCESS) {
+			sha1(keyIdentifier, keyIdentifierLength, key);
+			res = VerifyWithIndex(store, store->keyIndex, key, documentSigner, hashAlgorithm,
+								  digest);
+		} else {
+			sha1(documentSigner->issuer, documentSigner->issuerLength, key);
+			res = VerifyWithIndex(store, store->subjectIndex, key, documentSigner, hashAlgorithm,
+								  digest);
+		}
+	}
+	if (res == APP_SUCCESS) {
+		CacheInsert(store, tbsDigest);
+	}
+
+	ReleaseStore(store);
+	return res;
+}
@@ -6,19 +6,16 @@
 
 #include <Windows.h>
 #include <stdlib.h>
-#include <time.h>
 
+#include <utils/random.h>
 #include <utils/util.h>
 
 void Delay(int millisecond) {
 	Sleep(millisecond);
 }
 
-void RandomNonceGenerate(unsigned char* buffer, int length) {
-	srand((int)time(NULL));
-	for (int i = 0; i < length; i++) {
-		buffer[i] = rand() % 256;
-	}
+long RandomNonceGenerate(unsigned char* buffer, int length) {
+	return RandomBytes(buffer, length);
 }
 
 void PadByteArray(unsigned char* byteArray, int startPosition) {
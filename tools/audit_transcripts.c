@@ -0,0 +1,57 @@
+/**
+ * @file audit_transcripts.c
+ * @brief Offline verification of recorded secure messaging sessions.
+ * @author Khoa Nguyen
+ *
+ * Replays every session of a transcript file (see access/audit.h for the format) on one worker
+ * thread per logical processor, or on the given number of threads. One line is printed per
+ * session with its verdict, in the order the sessions finish, then the totals and the throughput
+ * in sessions per second. The exit code is 1 if a session failed or the file is truncated.
+ *
+ * Usage: audit_transcripts <transcript> [threads] > verdicts.txt
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <access/audit.h>
+#include <utils/reader.h>
+
+static const struct {
+	int flag;
+	const char* name;
+} verdictNames[] = {
+	{AUDIT_BAD_MAC, "bad_mac"},
+	{AUDIT_SSC_GAP, "ssc_gap"},
+	{AUDIT_BAD_HASH, "bad_hash"},
+	{AUDIT_UNLISTED, "unlisted_dg"},
+	{AUDIT_MALFORMED, "malformed"},
+	{AUDIT_NO_SOD, "no_sod"},
+};
+
+static void PrintVerdict(const AuditResult* result, void* context) {
+	(void)context;
+	printf("%lld %s", result->session, result->verdict & AUDIT_FAILURES ? "FAIL" : "OK");
+	for (size_t i = 0; i < sizeof(verdictNames) / sizeof(verdictNames[0]); i++) {
+		if (result->verdict & verdictNames[i].flag) {
+			printf(" %s", verdictNames[i].name);
+		}
+	}
+	printf(" exchanges=%d data_groups=%d\n", result->exchanges, result->dataGroups);
+}
+
+int main(int argc, char* argv[]) {
+	AuditSummary summary = {0};
+
+	if (argc < 2) {
+		fprintf(stderr, "Usage: audit_transcripts <transcript> [threads]\n");
+		return 2;
+	}
+	long res = AuditTranscript(argv[1], argc > 2 ? atoi(argv[2]) : 0, PrintVerdict, NULL,
+							   &summary);
+
+	printf("sessions=%lld failed=%lld threads=%d seconds=%.3f sessions_per_second=%.0f\n",
+		   summary.sessions, summary.failed, summary.threads, summary.seconds,
+		   summary.sessionsPerSecond);
+	return res != APP_SUCCESS || summary.failed > 0 ? 1 : 0;
+}